@@ -0,0 +1,544 @@
+/**
+ * @file       x8_bench.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Codec throughput and command round trip benchmarks
+ * @note       1. Encoders (x8_can_encode_*, x8_can_send_*) and decoders
+ *                (x8_can_get_*, x8_can_receive) in ns per frame
+ *             2. Status request round trip through the request table, either
+ *                in-process against the emulator or over a SocketCAN
+ *                interface with x8_emulate (or real motors) on the other end.
+ *                Latency percentiles and replies per second are reported.
+ *             Usage: x8_bench [-i ifname] [-n requests] [-w window] [-m motors]
+ * @example    ./x8_bench
+ *             ./x8_bench -i vcan0 -n 20000 -w 4 -m 8
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_request.h"
+#include "x8_can_rx.h"
+#include "x8_emulator.h"
+#include "x8_socketcan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private defines ---------------------------------------------------- */
+#define X8_BENCH_ITERATIONS       (2000000)
+#define X8_BENCH_REQUESTS         (100000)
+#define X8_BENCH_TIMEOUT_US       (100000)
+
+/* Private enumerate/structure ---------------------------------------- */
+/**
+ * @brief Microbenchmark
+ */
+typedef struct
+{
+  const char *name;
+  void (*run) (uint32_t i);
+}
+m_bench_t;
+
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static volatile uint32_t m_sink;
+static uint8_t m_can_data[8];
+static x8_can_t m_x8_can[RMD_X8_MOTOR_ID_MAX];
+static x8_can_registry_t m_x8_registry;
+static x8_can_request_table_t m_x8_requests;
+static x8_can_rx_ring_t m_can_rx_ring;
+static x8_emulator_t m_emulator;
+static x8_socketcan_t m_bus;
+
+static uint64_t *m_start_ns;
+static uint32_t *m_latency_ns;
+static uint32_t  m_done;
+static uint32_t  m_timeout;
+
+/* Private function prototypes ---------------------------------------- */
+static uint64_t m_now_ns(void);
+static void m_sink_send(uint16_t msg_id, uint8_t *buffer);
+static void m_loopback_send(uint16_t msg_id, uint8_t *buffer);
+static void m_loopback_reply(uint16_t msg_id, uint8_t *buffer);
+static void m_request_done(x8_can_request_t *req, void *context);
+static int m_compare(const void *a, const void *b);
+static void m_micro(void);
+static void m_round_trip(bool loopback, uint32_t requests, uint32_t window, uint8_t motors);
+
+static void m_encode_cmd(uint32_t i);
+static void m_encode_torque(uint32_t i);
+static void m_encode_speed(uint32_t i);
+static void m_encode_position_1(uint32_t i);
+static void m_encode_position_2(uint32_t i);
+static void m_encode_position_3(uint32_t i);
+static void m_encode_position_4(uint32_t i);
+static void m_send_encoder_offset(uint32_t i);
+static void m_send_torque(uint32_t i);
+static void m_send_speed(uint32_t i);
+static void m_send_position_1(uint32_t i);
+static void m_send_position_2(uint32_t i);
+static void m_send_position_3(uint32_t i);
+static void m_send_position_4(uint32_t i);
+static void m_send_get_motor_status(uint32_t i);
+static void m_send_get_multi_turn_angle(uint32_t i);
+static void m_send_get_pid_data(uint32_t i);
+static void m_send_motor_command(uint32_t i);
+static void m_get_motor_status(uint32_t i);
+static void m_get_multi_turn_angle(uint32_t i);
+static void m_get_pid_data(uint32_t i);
+static void m_receive(uint32_t i);
+
+/* Function definitions ----------------------------------------------- */
+int main(int argc, char **argv)
+{
+  const char *ifname = NULL;
+  uint32_t requests  = X8_BENCH_REQUESTS;
+  uint32_t window    = 1;
+  int motors         = 1;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "i:n:w:m:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'i': ifname   = optarg;                     break;
+    case 'n': requests = (uint32_t)atol(optarg);     break;
+    case 'w': window   = (uint32_t)atol(optarg);     break;
+    case 'm': motors   = atoi(optarg);               break;
+    default:
+      fprintf(stderr, "Usage: %s [-i ifname] [-n requests] [-w window] [-m motors]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if ((motors < RMD_X8_MOTOR_ID_MIN) || (motors > RMD_X8_MOTOR_ID_MAX) ||
+      (window < 1) || (window > X8_CAN_REQUEST_TABLE_SIZE) || (requests < 1))
+  {
+    fprintf(stderr, "motors 1 ... %d, window 1 ... %d, requests > 0\n",
+            RMD_X8_MOTOR_ID_MAX, X8_CAN_REQUEST_TABLE_SIZE);
+    return 1;
+  }
+
+  m_micro();
+
+  if (ifname != NULL)
+  {
+    if (!x8_socketcan_open(&m_bus, ifname))
+    {
+      perror(ifname);
+      return 1;
+    }
+    x8_socketcan_bind(&m_bus);
+  }
+
+  m_round_trip(ifname == NULL, requests, window, (uint8_t)motors);
+
+  if (ifname != NULL)
+  {
+    x8_socketcan_close(&m_bus);
+  }
+
+  return 0;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Run the encoder and decoder microbenchmarks
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_micro(void)
+{
+  static const m_bench_t M_BENCH[] =
+  {
+    { "x8_can_encode_cmd",                        m_encode_cmd                },
+    { "x8_can_encode_torque_close_loop_cmd",      m_encode_torque             },
+    { "x8_can_encode_speed_close_loop_cmd",       m_encode_speed              },
+    { "x8_can_encode_position_ctrl_1_cmd",        m_encode_position_1         },
+    { "x8_can_encode_position_ctrl_2_cmd",        m_encode_position_2         },
+    { "x8_can_encode_position_ctrl_3_cmd",        m_encode_position_3         },
+    { "x8_can_encode_position_ctrl_4_cmd",        m_encode_position_4         },
+    { "x8_can_send_encoder_offset_cmd",           m_send_encoder_offset       },
+    { "x8_can_send_torque_close_loop_cmd",        m_send_torque               },
+    { "x8_can_send_speed_close_loop_cmd",         m_send_speed                },
+    { "x8_can_send_position_ctrl_1_cmd",          m_send_position_1           },
+    { "x8_can_send_position_ctrl_2_cmd",          m_send_position_2           },
+    { "x8_can_send_position_ctrl_3_cmd",          m_send_position_3           },
+    { "x8_can_send_position_ctrl_4_cmd",          m_send_position_4           },
+    { "x8_can_send_get_motor_status",             m_send_get_motor_status     },
+    { "x8_can_send_get_motor_multi_turn_angle",   m_send_get_multi_turn_angle },
+    { "x8_can_send_get_pid_data",                 m_send_get_pid_data         },
+    { "x8_can_send_motor_command",                m_send_motor_command        },
+    { "x8_can_get_motor_status",                  m_get_motor_status          },
+    { "x8_can_get_motor_multi_turn_angle",        m_get_multi_turn_angle      },
+    { "x8_can_get_pid_data",                      m_get_pid_data              },
+    { "x8_can_receive",                           m_receive                   }
+  };
+
+  x8_can_t *me = &m_x8_can[0];
+
+  me->cansend  = m_sink_send;
+  me->motor_id = 1;
+
+  // Reply frame for the decoders
+  m_can_data[0] = RMD_X8_READ_MOTOR_STATUS_2_CMD;
+  m_can_data[1] = 0x20;
+  m_can_data[2] = 0x64;
+  m_can_data[3] = 0x00;
+  m_can_data[4] = 0xF4;
+  m_can_data[5] = 0x01;
+  m_can_data[6] = 0x00;
+  m_can_data[7] = 0x20;
+
+  printf("%-40s %10s %12s\n", "function", "ns/frame", "frames/s");
+
+  for (uint8_t b = 0; b < sizeof(M_BENCH) / sizeof(M_BENCH[0]); b++)
+  {
+    uint64_t start_ns, elapsed_ns;
+
+    // Warm up, then measure
+    for (uint32_t i = 0; i < X8_BENCH_ITERATIONS / 10; i++)
+    {
+      M_BENCH[b].run(i);
+    }
+
+    start_ns = m_now_ns();
+    for (uint32_t i = 0; i < X8_BENCH_ITERATIONS; i++)
+    {
+      M_BENCH[b].run(i);
+    }
+    elapsed_ns = m_now_ns() - start_ns;
+
+    printf("%-40s %10.2f %12.0f\n", M_BENCH[b].name,
+           (double)elapsed_ns / X8_BENCH_ITERATIONS,
+           X8_BENCH_ITERATIONS * 1e9 / (double)elapsed_ns);
+  }
+}
+
+/**
+ * @brief       Run status requests with a window of outstanding requests
+ *
+ * @param[in]   loopback      true => in-process emulator, false => SocketCAN bus
+ * @param[in]   requests      Number of requests
+ * @param[in]   window        Requests in flight
+ * @param[in]   motors        Motors 1 ... motors are asked in turn
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_round_trip(bool loopback, uint32_t requests, uint32_t window, uint8_t motors)
+{
+  x8_can_frame_t frame;
+  uint32_t sent = 0;
+  uint64_t start_ns, elapsed_ns;
+
+  m_start_ns   = (uint64_t *)calloc(requests, sizeof(uint64_t));
+  m_latency_ns = (uint32_t *)calloc(requests, sizeof(uint32_t));
+  m_done       = 0;
+  m_timeout    = 0;
+
+  x8_can_registry_init(&m_x8_registry);
+  x8_can_request_init(&m_x8_requests);
+  x8_can_rx_ring_init(&m_can_rx_ring);
+  x8_emulator_init(&m_emulator, m_loopback_reply);
+
+  for (uint8_t i = 0; i < motors; i++)
+  {
+    m_x8_can[i].cansend  = loopback ? m_loopback_send : x8_socketcan_cansend;
+    m_x8_can[i].motor_id = i + 1;
+    x8_can_registry_add(&m_x8_registry, &m_x8_can[i]);
+    x8_emulator_add(&m_emulator, i + 1);
+  }
+
+  start_ns = m_now_ns();
+
+  while (m_done + m_timeout < requests)
+  {
+    // Keep the window full
+    while ((sent < requests) && (sent - m_done - m_timeout < window))
+    {
+      m_start_ns[sent] = m_now_ns();
+      if (x8_can_request_send(&m_x8_requests, &m_x8_can[sent % motors], RMD_X8_READ_MOTOR_STATUS_2_CMD,
+                              x8_socketcan_now_us(), X8_BENCH_TIMEOUT_US,
+                              m_request_done, (void *)(uintptr_t)sent) == NULL)
+        break;
+      sent++;
+    }
+
+    if (loopback)
+    {
+      x8_can_frame_t *rx;
+
+      while ((rx = x8_can_rx_ring_peek(&m_can_rx_ring)) != NULL)
+      {
+        x8_can_registry_receive(&m_x8_registry, rx->msg_id, rx->data);
+        x8_can_request_receive(&m_x8_requests, rx->msg_id, rx->data);
+        x8_can_rx_ring_pop(&m_can_rx_ring);
+      }
+    }
+    else if (x8_socketcan_receive(&m_bus, &frame, 1) == 1)
+    {
+      x8_can_registry_receive(&m_x8_registry, frame.msg_id, frame.data);
+      x8_can_request_receive(&m_x8_requests, frame.msg_id, frame.data);
+    }
+
+    x8_can_request_expire(&m_x8_requests, x8_socketcan_now_us());
+  }
+
+  elapsed_ns = m_now_ns() - start_ns;
+
+  printf("\nround trip, %s, %u requests, window %u, %u motors\n",
+         loopback ? "in-process emulator" : "SocketCAN", requests, window, motors);
+
+  if (m_done > 0)
+  {
+    qsort(m_latency_ns, m_done, sizeof(uint32_t), m_compare);
+    printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+           m_latency_ns[m_done * 50 / 100] / 1000.0,
+           m_latency_ns[m_done * 90 / 100] / 1000.0,
+           m_latency_ns[m_done * 99 / 100] / 1000.0,
+           m_latency_ns[m_done - 1] / 1000.0);
+  }
+
+  printf("replies %u, timeouts %u, %.0f replies/s\n", m_done, m_timeout, m_done * 1e9 / (double)elapsed_ns);
+
+  free(m_start_ns);
+  free(m_latency_ns);
+}
+
+/**
+ * @brief       Request completion, record latency
+ *
+ * @param[in]   req           Completed request
+ * @param[in]   context       Request number
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_request_done(x8_can_request_t *req, void *context)
+{
+  uint32_t index = (uint32_t)(uintptr_t)context;
+
+  if (req->state != X8_CAN_REQUEST_DONE)
+  {
+    m_timeout++;
+    return;
+  }
+
+  m_latency_ns[m_done++] = (uint32_t)(m_now_ns() - m_start_ns[index]);
+}
+
+/**
+ * @brief       Compare latencies for qsort
+ */
+static int m_compare(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief       Monotonic time
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      Time (ns)
+ */
+static uint64_t m_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief       Consume a frame so the encoder is not optimised away
+ */
+static void m_sink_send(uint16_t msg_id, uint8_t *buffer)
+{
+  m_sink = msg_id ^ buffer[0] ^ buffer[3] ^ buffer[7];
+}
+
+/**
+ * @brief       Controller to emulator
+ */
+static void m_loopback_send(uint16_t msg_id, uint8_t *buffer)
+{
+  x8_emulator_receive(&m_emulator, msg_id, buffer);
+}
+
+/**
+ * @brief       Emulator to controller, through the receive ring like the ISR
+ */
+static void m_loopback_reply(uint16_t msg_id, uint8_t *buffer)
+{
+  x8_can_frame_t *frame = x8_can_rx_ring_claim(&m_can_rx_ring);
+
+  if (frame == NULL)
+    return;
+
+  frame->timestamp_us = x8_socketcan_now_us();
+  frame->msg_id       = msg_id;
+  frame->dlc          = 8;
+  frame->flags        = 0;
+  memcpy(frame->data, buffer, 8);
+  x8_can_rx_ring_publish(&m_can_rx_ring);
+}
+
+/* Encoders ----------------------------------------------------------- */
+static void m_encode_cmd(uint32_t i)
+{
+  x8_can_encode_cmd(m_can_data, (uint8_t)i);
+  m_sink = m_can_data[0];
+}
+
+static void m_encode_torque(uint32_t i)
+{
+  x8_can_encode_torque_close_loop_cmd(m_can_data, (int16_t)i);
+  m_sink = m_can_data[4];
+}
+
+static void m_encode_speed(uint32_t i)
+{
+  x8_can_encode_speed_close_loop_cmd(m_can_data, (int32_t)i);
+  m_sink = m_can_data[4];
+}
+
+static void m_encode_position_1(uint32_t i)
+{
+  x8_can_encode_position_ctrl_1_cmd(m_can_data, (int32_t)i);
+  m_sink = m_can_data[4];
+}
+
+static void m_encode_position_2(uint32_t i)
+{
+  x8_can_encode_position_ctrl_2_cmd(m_can_data, (uint16_t)i, (int32_t)i);
+  m_sink = m_can_data[4];
+}
+
+static void m_encode_position_3(uint32_t i)
+{
+  x8_can_encode_position_ctrl_3_cmd(m_can_data, (uint16_t)i, (x8_motor_dir_type_t)(i & 1));
+  m_sink = m_can_data[4];
+}
+
+static void m_encode_position_4(uint32_t i)
+{
+  x8_can_encode_position_ctrl_4_cmd(m_can_data, (uint16_t)i, (uint16_t)i, (x8_motor_dir_type_t)(i & 1));
+  m_sink = m_can_data[4];
+}
+
+static void m_send_encoder_offset(uint32_t i)
+{
+  x8_can_send_encoder_offset_cmd(&m_x8_can[0], (uint16_t)i);
+}
+
+static void m_send_torque(uint32_t i)
+{
+  x8_can_send_torque_close_loop_cmd(&m_x8_can[0], (int16_t)i);
+}
+
+static void m_send_speed(uint32_t i)
+{
+  x8_can_send_speed_close_loop_cmd(&m_x8_can[0], (int32_t)i);
+}
+
+static void m_send_position_1(uint32_t i)
+{
+  x8_can_send_position_ctrl_1_cmd(&m_x8_can[0], (int32_t)i);
+}
+
+static void m_send_position_2(uint32_t i)
+{
+  x8_can_send_position_ctrl_2_cmd(&m_x8_can[0], (uint16_t)i, (int32_t)i);
+}
+
+static void m_send_position_3(uint32_t i)
+{
+  x8_can_send_position_ctrl_3_cmd(&m_x8_can[0], (uint16_t)i, (x8_motor_dir_type_t)(i & 1));
+}
+
+static void m_send_position_4(uint32_t i)
+{
+  x8_can_send_position_ctrl_4_cmd(&m_x8_can[0], (uint16_t)i, (uint16_t)i, (x8_motor_dir_type_t)(i & 1));
+}
+
+static void m_send_get_motor_status(uint32_t i)
+{
+  (void)i;
+  x8_can_send_get_motor_status(&m_x8_can[0]);
+}
+
+static void m_send_get_multi_turn_angle(uint32_t i)
+{
+  (void)i;
+  x8_can_send_get_motor_multi_turn_angle(&m_x8_can[0]);
+}
+
+static void m_send_get_pid_data(uint32_t i)
+{
+  (void)i;
+  x8_can_send_get_pid_data(&m_x8_can[0]);
+}
+
+static void m_send_motor_command(uint32_t i)
+{
+  x8_can_send_motor_command(&m_x8_can[0], (x8_motor_command_t)(i % 3));
+}
+
+/* Decoders ----------------------------------------------------------- */
+static void m_get_motor_status(uint32_t i)
+{
+  x8_motor_status_t status;
+
+  m_can_data[5] = (uint8_t)i;
+  x8_can_get_motor_status(m_can_data, &status);
+  m_sink = status.speed;
+}
+
+static void m_get_multi_turn_angle(uint32_t i)
+{
+  int64_t angle;
+
+  m_can_data[5] = (uint8_t)i;
+  x8_can_get_motor_multi_turn_angle(m_can_data, &angle);
+  m_sink = (uint32_t)angle;
+}
+
+static void m_get_pid_data(uint32_t i)
+{
+  x8_motor_pid_data_t pid;
+
+  m_can_data[5] = (uint8_t)i;
+  x8_can_get_pid_data(m_can_data, &pid);
+  m_sink = pid.speed_ki;
+}
+
+static void m_receive(uint32_t i)
+{
+  m_can_data[5] = (uint8_t)i;
+  x8_can_receive(&m_x8_can[0], m_can_data);
+  m_sink = m_x8_can[0].status.speed;
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,194 @@
+/**
+ * @file       x8_capture.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Memory mapped capture files of CAN frames
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_capture.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Private defines ---------------------------------------------------- */
+#define X8_CAPTURE_INITIAL_FRAMES   (4096)
+
+static_assert(sizeof(x8_capture_header_t) == 16, "Capture header layout");
+static_assert(sizeof(x8_can_frame_t) == 16, "Capture record layout");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static bool m_x8_capture_map(x8_capture_t *me, size_t size);
+static bool m_x8_capture_grow(x8_capture_t *me);
+
+/* Function definitions ----------------------------------------------- */
+bool x8_capture_create(x8_capture_t *me, const char *path)
+{
+  memset(me, 0, sizeof(*me));
+  me->writable = true;
+
+  me->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (me->fd < 0)
+    return false;
+
+  if (!m_x8_capture_map(me, sizeof(x8_capture_header_t) + X8_CAPTURE_INITIAL_FRAMES * sizeof(x8_can_frame_t)))
+  {
+    x8_capture_close(me);
+    return false;
+  }
+
+  me->header->magic       = X8_CAPTURE_MAGIC;
+  me->header->version     = X8_CAPTURE_VERSION;
+  me->header->record_size = sizeof(x8_can_frame_t);
+  me->header->count       = 0;
+
+  return true;
+}
+
+bool x8_capture_open(x8_capture_t *me, const char *path)
+{
+  struct stat st;
+
+  memset(me, 0, sizeof(*me));
+
+  me->fd = open(path, O_RDONLY);
+  if (me->fd < 0)
+    return false;
+
+  if ((fstat(me->fd, &st) < 0) || ((size_t)st.st_size < sizeof(x8_capture_header_t)) ||
+      !m_x8_capture_map(me, (size_t)st.st_size))
+  {
+    x8_capture_close(me);
+    return false;
+  }
+
+  if ((me->header->magic != X8_CAPTURE_MAGIC) ||
+      (me->header->version != X8_CAPTURE_VERSION) ||
+      (me->header->record_size != sizeof(x8_can_frame_t)) ||
+      (me->header->count > me->capacity))
+  {
+    x8_capture_close(me);
+    return false;
+  }
+
+  return true;
+}
+
+bool x8_capture_append(x8_capture_t *me, const x8_can_frame_t *frame)
+{
+  if ((me->header->count >= me->capacity) && !m_x8_capture_grow(me))
+    return false;
+
+  me->frame[me->header->count] = *frame;
+
+  // Record first, then the count that makes it visible
+  __atomic_store_n(&me->header->count, me->header->count + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+uint32_t x8_capture_count(x8_capture_t *me)
+{
+  return me->header->count;
+}
+
+const x8_can_frame_t *x8_capture_frame(x8_capture_t *me, uint32_t index)
+{
+  if (index >= me->header->count)
+    return NULL;
+
+  return &me->frame[index];
+}
+
+bool x8_capture_close(x8_capture_t *me)
+{
+  size_t used = 0;
+  bool ret = true;
+
+  if (me->map != NULL)
+  {
+    used = sizeof(x8_capture_header_t) + (size_t)me->header->count * sizeof(x8_can_frame_t);
+    munmap(me->map, me->map_size);
+    me->map = NULL;
+  }
+
+  if (me->fd >= 0)
+  {
+    if (me->writable && (used != 0))
+    {
+      ret = (ftruncate(me->fd, (off_t)used) == 0);
+    }
+
+    close(me->fd);
+    me->fd = -1;
+  }
+
+  return ret;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Size the file (when writable) and map it
+ *
+ * @param[in]   me            Pointer to capture
+ * @param[in]   size          Mapping size (bytes)
+ *
+ * @attention   Replaces the previous mapping
+ *
+ * @return      true if mapped
+ */
+static bool m_x8_capture_map(x8_capture_t *me, size_t size)
+{
+  void *map;
+
+  if (me->writable && (ftruncate(me->fd, (off_t)size) < 0))
+    return false;
+
+  map = mmap(NULL, size, me->writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, me->fd, 0);
+  if (map == MAP_FAILED)
+    return false;
+
+  if (me->map != NULL)
+  {
+    munmap(me->map, me->map_size);
+  }
+
+  me->map      = (uint8_t *)map;
+  me->map_size = size;
+  me->header   = (x8_capture_header_t *)map;
+  me->frame    = (x8_can_frame_t *)(me->map + sizeof(x8_capture_header_t));
+  me->capacity = (uint32_t)((size - sizeof(x8_capture_header_t)) / sizeof(x8_can_frame_t));
+
+  return true;
+}
+
+/**
+ * @brief       Double the file
+ *
+ * @param[in]   me            Pointer to capture
+ *
+ * @attention   None
+ *
+ * @return      true if grown
+ */
+static bool m_x8_capture_grow(x8_capture_t *me)
+{
+  if (me->capacity >= UINT32_MAX / 2)
+    return false;
+
+  return m_x8_capture_map(me, sizeof(x8_capture_header_t) + (size_t)me->capacity * 2 * sizeof(x8_can_frame_t));
+}
+
+/* End of file -------------------------------------------------------- */
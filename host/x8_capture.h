@@ -0,0 +1,135 @@
+/**
+ * @file       x8_capture.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Memory mapped capture files of CAN frames
+ * @note       A capture is a 16 byte header followed by x8_can_frame_t
+ *             records in host byte order, the records of x8_can_recorder.h.
+ *             Frames are appended with a store into the mapping, the file
+ *             grows by doubling. The header frame count is updated after
+ *             each record, so a capture cut short by a crash stays readable.
+ * @example    x8_capture_create(&cap, "incident.x8c");
+ *             x8_capture_append(&cap, &frame);
+ *             x8_capture_close(&cap);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAPTURE_H
+#define __X8_CAPTURE_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+
+/* Public defines ----------------------------------------------------- */
+#define X8_CAPTURE_MAGIC          (0x4E414338)  // "8CAN" little endian
+#define X8_CAPTURE_VERSION        (1)
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Capture file header
+ */
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t record_size;                 // sizeof(x8_can_frame_t)
+  uint32_t count;                       // Records in the file
+  uint32_t reserved;
+}
+x8_capture_header_t;
+
+/**
+ * @brief Open capture file
+ */
+typedef struct
+{
+  int                  fd;
+  bool                 writable;
+  uint8_t             *map;
+  size_t               map_size;
+  x8_capture_header_t *header;          // Start of the mapping
+  x8_can_frame_t      *frame;           // Records after the header
+  uint32_t             capacity;        // Records that fit the mapping
+}
+x8_capture_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Create an empty capture, replacing an existing file
+ *
+ * @param[in]   me            Pointer to capture
+ * @param[in]   path          File path
+ *
+ * @attention   None
+ *
+ * @return      true if created
+ */
+bool x8_capture_create(x8_capture_t *me, const char *path);
+
+/**
+ * @brief       Open a capture for reading
+ *
+ * @param[in]   me            Pointer to capture
+ * @param[in]   path          File path
+ *
+ * @attention   None
+ *
+ * @return      true if opened and the header is valid
+ */
+bool x8_capture_open(x8_capture_t *me, const char *path);
+
+/**
+ * @brief       Append a frame
+ *
+ * @param[in]   me            Pointer to capture made by x8_capture_create()
+ * @param[in]   frame         Pointer to frame
+ *
+ * @attention   None
+ *
+ * @return      false if the file could not grow
+ */
+bool x8_capture_append(x8_capture_t *me, const x8_can_frame_t *frame);
+
+/**
+ * @brief       Number of frames
+ *
+ * @param[in]   me            Pointer to capture
+ *
+ * @attention   None
+ *
+ * @return      Frames in the capture
+ */
+uint32_t x8_capture_count(x8_capture_t *me);
+
+/**
+ * @brief       Frame of the capture
+ *
+ * @param[in]   me            Pointer to capture
+ * @param[in]   index         0 => first frame
+ *
+ * @attention   Valid until the next append or close
+ *
+ * @return      Pointer to frame, NULL if index >= x8_capture_count()
+ */
+const x8_can_frame_t *x8_capture_frame(x8_capture_t *me, uint32_t index);
+
+/**
+ * @brief       Close capture, a written file is cut to its frames
+ *
+ * @param[in]   me            Pointer to capture
+ *
+ * @attention   A file that could not be cut keeps spare records after the
+ *              frames, the header count still bounds them
+ *
+ * @return      false if a written file could not be cut
+ */
+bool x8_capture_close(x8_capture_t *me);
+
+#endif // __X8_CAPTURE_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,445 @@
+/**
+ * @file       x8_coro.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      C++20 coroutines for motor command sequences on one bus
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_coro.h"
+
+#include <type_traits>
+
+/* Private defines ---------------------------------------------------- */
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+// Lists hold the waiter, the first member, of commands and sleeps
+static_assert(std::is_standard_layout<x8_coro_cmd_t>::value, "Waiter first in a command");
+static_assert(std::is_standard_layout<x8_coro_sleep_t>::value, "Waiter first in a sleep");
+
+/* Private function prototypes ---------------------------------------- */
+static void m_x8_coro_push(x8_coro_waiter_t ***tail, x8_coro_waiter_t *waiter);
+static bool m_x8_coro_start(x8_coro_cmd_t *me);
+static void m_x8_coro_done(x8_can_request_t *req, void *context);
+static void m_x8_coro_can_ready(void *context);
+static void m_x8_coro_tick(void *context);
+static void m_x8_coro_resume(x8_coro_executor_t *me);
+static x8_coro_cmd_t m_x8_coro_cmd(const x8_coro_motor_t *motor, uint8_t cmd_byte, void (*send) (x8_coro_cmd_t *me));
+
+/* Function definitions ----------------------------------------------- */
+bool x8_coro_init(x8_coro_executor_t *me, x8_socketcan_t *can)
+{
+  me->can          = can;
+  me->ready        = NULL;
+  me->ready_tail   = &me->ready;
+  me->blocked      = NULL;
+  me->blocked_tail = &me->blocked;
+  me->sleeping     = NULL;
+  me->tasks        = 0;
+  me->replies      = 0;
+  me->timeouts     = 0;
+
+  x8_can_registry_init(&me->registry);
+  x8_can_request_init(&me->requests);
+  x8_socketcan_bind(can);
+
+  if (!x8_event_init(&me->loop) ||
+      (x8_event_add_fd(&me->loop, can->fd, m_x8_coro_can_ready, me) == NULL) ||
+      (x8_event_add_timer(&me->loop, X8_CORO_TICK_US, m_x8_coro_tick, me) == NULL))
+  {
+    x8_event_close(&me->loop);
+    return false;
+  }
+
+  return true;
+}
+
+void x8_coro_close(x8_coro_executor_t *me)
+{
+  x8_event_close(&me->loop);
+}
+
+bool x8_coro_add(x8_coro_executor_t *me, x8_can_t *motor)
+{
+  if (!x8_can_registry_add(&me->registry, motor))
+    return false;
+
+  motor->cansend = x8_socketcan_cansend_queued;
+
+  return true;
+}
+
+x8_coro_motor_t x8_coro_motor(x8_coro_executor_t *me, x8_can_t *motor)
+{
+  x8_coro_motor_t handle;
+
+  handle.executor = me;
+  handle.can      = motor;
+
+  return handle;
+}
+
+void x8_coro_spawn(x8_coro_executor_t *me, x8_coro_task_t task)
+{
+  x8_coro_task_t::promise_type &promise = task.handle.promise();
+
+  promise.executor     = me;
+  promise.start.handle = task.handle;
+  m_x8_coro_push(&me->ready_tail, &promise.start);
+  me->tasks++;
+}
+
+x8_coro_sleep_t x8_coro_sleep(x8_coro_executor_t *me, uint32_t period_us)
+{
+  x8_coro_sleep_t sleep;
+
+  sleep.executor = me;
+  sleep.wake_us  = x8_socketcan_now_us() + period_us;
+
+  return sleep;
+}
+
+bool x8_coro_run(x8_coro_executor_t *me)
+{
+  m_x8_coro_resume(me);
+
+  while (me->tasks > 0)
+  {
+    if (x8_event_run(&me->loop, -1) < 0)
+      return false;
+
+    m_x8_coro_resume(me);
+  }
+
+  return true;
+}
+
+std::suspend_never x8_coro_task_t::promise_type::final_suspend(void) noexcept
+{
+  executor->tasks--;
+
+  return {};
+}
+
+void x8_coro_cmd_t::await_suspend(std::coroutine_handle<> handle)
+{
+  waiter.handle = handle;
+
+  // Behind the ones already waiting for a slot, commands of a motor keep their order
+  if ((executor->blocked != NULL) || !m_x8_coro_start(this))
+  {
+    m_x8_coro_push(&executor->blocked_tail, &waiter);
+  }
+}
+
+void x8_coro_sleep_t::await_suspend(std::coroutine_handle<> handle)
+{
+  waiter.handle      = handle;
+  waiter.next        = executor->sleeping;
+  executor->sleeping = &waiter;
+}
+
+x8_coro_cmd_t x8_coro_motor_t::read_status(void)
+{
+  return m_x8_coro_cmd(this, RMD_X8_READ_MOTOR_STATUS_2_CMD, [](x8_coro_cmd_t *me)
+  {
+    x8_can_send_cmd(me->can, me->cmd_byte);
+  });
+}
+
+x8_coro_cmd_t x8_coro_motor_t::read_error(void)
+{
+  return m_x8_coro_cmd(this, RMD_X8_READ_MOTOR_STATUS_CMD, [](x8_coro_cmd_t *me)
+  {
+    x8_can_send_cmd(me->can, me->cmd_byte);
+  });
+}
+
+x8_coro_cmd_t x8_coro_motor_t::read_multi_turn_angle(void)
+{
+  return m_x8_coro_cmd(this, RMD_X8_READ_MULTI_TURNS_ANGLE_CMD, [](x8_coro_cmd_t *me)
+  {
+    x8_can_send_cmd(me->can, me->cmd_byte);
+  });
+}
+
+x8_coro_cmd_t x8_coro_motor_t::read_pid(void)
+{
+  return m_x8_coro_cmd(this, RMD_X8_READ_PID_DATA_CMD, [](x8_coro_cmd_t *me)
+  {
+    x8_can_send_cmd(me->can, me->cmd_byte);
+  });
+}
+
+x8_coro_cmd_t x8_coro_motor_t::write_pid(const x8_motor_pid_data_t *pid, bool rom)
+{
+  x8_coro_cmd_t cmd;
+
+  cmd = m_x8_coro_cmd(this, rom ? RMD_X8_WRITE_PID_TO_ROM_CMD : RMD_X8_WRITE_PID_TO_RAM_CMD, [](x8_coro_cmd_t *me)
+  {
+    x8_can_send_write_pid_cmd(me->can, &me->pid, me->rom);
+  });
+  cmd.pid = *pid;
+  cmd.rom = rom;
+
+  return cmd;
+}
+
+x8_coro_cmd_t x8_coro_motor_t::torque(int16_t torque)
+{
+  x8_coro_cmd_t cmd;
+
+  cmd = m_x8_coro_cmd(this, RMD_X8_TORQUE_CLOSED_LOOP_CMD, [](x8_coro_cmd_t *me)
+  {
+    x8_can_send_torque_close_loop_cmd(me->can, (int16_t)me->value);
+  });
+  cmd.value = torque;
+
+  return cmd;
+}
+
+x8_coro_cmd_t x8_coro_motor_t::speed(int32_t speed)
+{
+  x8_coro_cmd_t cmd;
+
+  cmd = m_x8_coro_cmd(this, RMD_X8_SPEED_CLOSED_LOOP_CMD, [](x8_coro_cmd_t *me)
+  {
+    x8_can_send_speed_close_loop_cmd(me->can, me->value);
+  });
+  cmd.value = speed;
+
+  return cmd;
+}
+
+x8_coro_cmd_t x8_coro_motor_t::position(int32_t pos_ctrl, uint16_t speed_limited)
+{
+  x8_coro_cmd_t cmd;
+
+  cmd = m_x8_coro_cmd(this, RMD_X8_POSITION_CTRL_2_CMD, [](x8_coro_cmd_t *me)
+  {
+    x8_can_send_position_ctrl_2_cmd(me->can, me->speed_limited, me->value);
+  });
+  cmd.value         = pos_ctrl;
+  cmd.speed_limited = speed_limited;
+
+  return cmd;
+}
+
+x8_coro_cmd_t x8_coro_motor_t::command(x8_motor_command_t command)
+{
+  static const uint8_t CMD_BYTE[] = { RMD_X8_MOTOR_OFF_CMD, RMD_X8_MOTOR_STOP_CMD, RMD_X8_MOTOR_RUNNING_CMD };
+  x8_coro_cmd_t cmd;
+
+  cmd = m_x8_coro_cmd(this, CMD_BYTE[command], [](x8_coro_cmd_t *me)
+  {
+    x8_can_send_motor_command(me->can, (x8_motor_command_t)me->value);
+  });
+  cmd.value = command;
+
+  return cmd;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Append a waiter to a list
+ *
+ * @param[in]   tail          Pointer to the tail pointer of the list
+ * @param[in]   waiter        Waiter
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_coro_push(x8_coro_waiter_t ***tail, x8_coro_waiter_t *waiter)
+{
+  waiter->next = NULL;
+  **tail       = waiter;
+  *tail        = &waiter->next;
+}
+
+/**
+ * @brief       Register a command in the request table and queue its frame
+ *
+ * @param[in]   me            Pointer to command
+ *
+ * @attention   None
+ *
+ * @return      false if the request table is full, nothing sent
+ */
+static bool m_x8_coro_start(x8_coro_cmd_t *me)
+{
+  x8_can_request_t *req;
+
+  req = x8_can_request_expect(&me->executor->requests, me->can, me->cmd_byte,
+                              x8_socketcan_now_us(), X8_CORO_TIMEOUT_US, m_x8_coro_done, me);
+  if (req == NULL)
+    return false;
+
+  me->send(me);
+
+  return true;
+}
+
+/**
+ * @brief       Request callback, makes the coroutine of a command ready
+ *
+ * @param[in]   req           Request, DONE or TIMEOUT
+ * @param[in]   context       Pointer to command
+ *
+ * @attention   Runs inside x8_can_request_receive or x8_can_request_expire,
+ *              the coroutine is only resumed after
+ *
+ * @return      None
+ */
+static void m_x8_coro_done(x8_can_request_t *req, void *context)
+{
+  x8_coro_cmd_t *me = (x8_coro_cmd_t *)context;
+
+  me->replied = (req->state == X8_CAN_REQUEST_DONE);
+  if (me->replied)
+  {
+    me->executor->replies++;
+  }
+  else
+  {
+    me->executor->timeouts++;
+  }
+
+  m_x8_coro_push(&me->executor->ready_tail, &me->waiter);
+}
+
+/**
+ * @brief       Decode the received frames and complete their requests
+ *
+ * @param[in]   context       Pointer to executor
+ *
+ * @attention   Values are decoded into the motor before its coroutine sees the reply
+ *
+ * @return      None
+ */
+static void m_x8_coro_can_ready(void *context)
+{
+  x8_coro_executor_t *me = (x8_coro_executor_t *)context;
+  x8_can_frame_t frame[X8_SOCKETCAN_BATCH];
+  int count;
+
+  do
+  {
+    count = x8_socketcan_receive_batch(me->can, frame, X8_SOCKETCAN_BATCH);
+
+    for (int i = 0; i < count; i++)
+    {
+      x8_can_registry_receive(&me->registry, frame[i].msg_id, frame[i].data);
+      x8_can_request_receive(&me->requests, frame[i].msg_id, frame[i].data);
+    }
+  }
+  while (count == X8_SOCKETCAN_BATCH);
+}
+
+/**
+ * @brief       Expire unanswered commands and wake the sleeps due
+ *
+ * @param[in]   context       Pointer to executor
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_coro_tick(void *context)
+{
+  x8_coro_executor_t *me = (x8_coro_executor_t *)context;
+  uint32_t now_us = x8_socketcan_now_us();
+  x8_coro_waiter_t **link = &me->sleeping;
+  x8_coro_waiter_t *waiter;
+
+  x8_can_request_expire(&me->requests, now_us);
+
+  while ((waiter = *link) != NULL)
+  {
+    if ((int32_t)(now_us - ((x8_coro_sleep_t *)waiter)->wake_us) >= 0)
+    {
+      *link = waiter->next;
+      m_x8_coro_push(&me->ready_tail, waiter);
+    }
+    else
+    {
+      link = &waiter->next;
+    }
+  }
+}
+
+/**
+ * @brief       Send the commands waiting for a slot, resume the ready coroutines
+ *              and send what they queued
+ *
+ * @param[in]   me            Pointer to executor
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_coro_resume(x8_coro_executor_t *me)
+{
+  x8_coro_waiter_t *waiter;
+
+  // Slots are freed by the replies and timeouts of the last wake
+  while ((me->blocked != NULL) && m_x8_coro_start((x8_coro_cmd_t *)me->blocked))
+  {
+    me->blocked = me->blocked->next;
+    if (me->blocked == NULL)
+    {
+      me->blocked_tail = &me->blocked;
+    }
+  }
+
+  while ((waiter = me->ready) != NULL)
+  {
+    me->ready = waiter->next;
+    if (me->ready == NULL)
+    {
+      me->ready_tail = &me->ready;
+    }
+
+    waiter->handle.resume();
+  }
+
+  // Frames the interface did not take stay queued for the next wake
+  x8_socketcan_flush(me->can);
+}
+
+/**
+ * @brief       Command of a motor without arguments set
+ *
+ * @param[in]   motor         Motor handle
+ * @param[in]   cmd_byte      Command byte of the reply
+ * @param[in]   send          Sends the command from its fields
+ *
+ * @attention   None
+ *
+ * @return      Command
+ */
+static x8_coro_cmd_t m_x8_coro_cmd(const x8_coro_motor_t *motor, uint8_t cmd_byte, void (*send) (x8_coro_cmd_t *me))
+{
+  x8_coro_cmd_t cmd;
+
+  cmd.waiter.next   = NULL;
+  cmd.executor      = motor->executor;
+  cmd.can           = motor->can;
+  cmd.cmd_byte      = cmd_byte;
+  cmd.send          = send;
+  cmd.value         = 0;
+  cmd.speed_limited = 0;
+  cmd.rom           = false;
+  cmd.replied       = false;
+
+  return cmd;
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,260 @@
+/**
+ * @file       x8_coro.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      C++20 coroutines for motor command sequences on one bus
+ * @note       A sequence such as "read PID, write new gains, read status,
+ *             then move" is written as one coroutine returning x8_coro_task_t
+ *             that co_awaits each command of a x8_coro_motor_t. An awaited
+ *             command is sent and registered in the request table of the
+ *             executor, the coroutine is resumed once the reply is decoded
+ *             into the x8_can_t or after X8_CORO_TIMEOUT_US. co_await gives
+ *             true for a reply, false for a timeout.
+ *             The executor runs every coroutine in the thread calling
+ *             x8_coro_run, on one epoll loop (x8_event.h) over the socket and
+ *             a X8_CORO_TICK_US timer: hundreds of sequences need neither a
+ *             thread nor a flag each. Frames sent by the coroutines resumed
+ *             in one wake go in one sendmmsg.
+ *             With X8_CAN_REQUEST_TABLE_SIZE commands in flight, further
+ *             ones wait, in order, for a free slot before they are sent.
+ *             Coroutine frames are allocated by operator new, nothing else is.
+ *             An exception leaving a coroutine terminates the process.
+ *             One executor per process, it binds its socket for cansend.
+ *             Build with -std=c++20, host/x8_event.cpp and host/x8_socketcan.cpp.
+ * @example    static x8_coro_task_t m_tune(x8_coro_motor_t motor)
+ *             {
+ *               if (!co_await motor.read_pid())
+ *                 co_return;
+ *               motor.can->pid.speed_kp += 10;
+ *               co_await motor.write_pid(&motor.can->pid, false);
+ *               co_await motor.position(9000, 360);
+ *             }
+ *             x8_coro_init(&ex, &bus);
+ *             x8_coro_add(&ex, &motor);
+ *             x8_coro_spawn(&ex, m_tune(x8_coro_motor(&ex, &motor)));
+ *             x8_coro_run(&ex);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CORO_H
+#define __X8_CORO_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_request.h"
+#include "x8_socketcan.h"
+#include "x8_event.h"
+
+#include <coroutine>
+#include <exception>
+
+/* Public defines ----------------------------------------------------- */
+#define X8_CORO_TIMEOUT_US              (10000)   // Reply wait of an awaited command
+#define X8_CORO_TICK_US                 (1000)    // Resolution of timeouts and sleeps
+
+/* Public enumerate/structure ----------------------------------------- */
+typedef struct x8_coro_executor x8_coro_executor_t;
+
+/**
+ * @brief Suspended coroutine, linked in one list of the executor
+ */
+typedef struct x8_coro_waiter
+{
+  std::coroutine_handle<> handle;
+  struct x8_coro_waiter  *next;
+}
+x8_coro_waiter_t;
+
+/**
+ * @brief Executor
+ */
+struct x8_coro_executor
+{
+  x8_socketcan_t         *can;
+  x8_event_t              loop;
+  x8_can_registry_t       registry;
+  x8_can_request_table_t  requests;
+
+  x8_coro_waiter_t       *ready;                // To resume, in order
+  x8_coro_waiter_t      **ready_tail;
+  x8_coro_waiter_t       *blocked;              // Commands waiting for a request slot, in order
+  x8_coro_waiter_t      **blocked_tail;
+  x8_coro_waiter_t       *sleeping;             // x8_coro_sleep, any order
+
+  uint32_t                tasks;                // Coroutines spawned and not finished
+  uint32_t                replies;              // Awaited commands answered
+  uint32_t                timeouts;             // Awaited commands not answered
+};
+
+/**
+ * @brief Coroutine spawned on an executor, its frame is freed when it returns
+ */
+struct x8_coro_task_t
+{
+  struct promise_type
+  {
+    x8_coro_executor_t *executor = nullptr;
+    x8_coro_waiter_t    start;
+
+    x8_coro_task_t get_return_object(void)
+    {
+      return x8_coro_task_t { std::coroutine_handle<promise_type>::from_promise(*this) };
+    }
+
+    std::suspend_always initial_suspend(void) noexcept { return {}; }
+    std::suspend_never final_suspend(void) noexcept;
+    void return_void(void) {}
+    void unhandled_exception(void) { std::terminate(); }   // Nobody awaits a task to take it
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * @brief Awaitable command: send it, resume on its reply or timeout
+ */
+typedef struct x8_coro_cmd
+{
+  x8_coro_waiter_t    waiter;               // First, the lists link it
+  x8_coro_executor_t *executor;
+  x8_can_t           *can;
+  uint8_t             cmd_byte;             // Command byte of the reply
+  void              (*send) (struct x8_coro_cmd *me);
+  x8_motor_pid_data_t pid;                  // Arguments of send
+  int32_t             value;
+  uint16_t            speed_limited;
+  bool                rom;
+  bool                replied;
+
+  bool await_ready(void) const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle);
+  bool await_resume(void) const noexcept { return replied; }
+}
+x8_coro_cmd_t;
+
+/**
+ * @brief Awaitable pause
+ */
+typedef struct
+{
+  x8_coro_waiter_t    waiter;               // First, the lists link it
+  x8_coro_executor_t *executor;
+  uint32_t            wake_us;
+
+  bool await_ready(void) const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle);
+  void await_resume(void) const noexcept {}
+}
+x8_coro_sleep_t;
+
+/**
+ * @brief Motor as seen by coroutines, its replies are decoded into can
+ */
+typedef struct
+{
+  x8_coro_executor_t *executor;
+  x8_can_t           *can;
+
+  x8_coro_cmd_t read_status(void);                                    // 0x9C => can->status
+  x8_coro_cmd_t read_error(void);                                     // 0x9A => can->error
+  x8_coro_cmd_t read_multi_turn_angle(void);                          // 0x92 => can->multi_turn_angle
+  x8_coro_cmd_t read_pid(void);                                       // 0x30 => can->pid
+  x8_coro_cmd_t write_pid(const x8_motor_pid_data_t *pid, bool rom);  // 0x31/0x32, echoed
+  x8_coro_cmd_t torque(int16_t torque);                               // 0xA1 => can->status
+  x8_coro_cmd_t speed(int32_t speed);                                 // 0xA2 => can->status
+  x8_coro_cmd_t position(int32_t pos_ctrl, uint16_t speed_limited);   // 0xA4 => can->status
+  x8_coro_cmd_t command(x8_motor_command_t command);                  // 0x80/0x81/0x88, echoed
+}
+x8_coro_motor_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init an executor on an open bus
+ *
+ * @param[in]   me            Pointer to executor
+ * @param[in]   can           Pointer to open bus
+ *
+ * @attention   Binds the bus (x8_socketcan_bind)
+ *
+ * @return      false if the event loop cannot be created
+ */
+bool x8_coro_init(x8_coro_executor_t *me, x8_socketcan_t *can);
+
+/**
+ * @brief       Close the event loop of an executor
+ *
+ * @param[in]   me            Pointer to executor
+ *
+ * @attention   The bus is left open, unfinished coroutines are not freed
+ *
+ * @return      None
+ */
+void x8_coro_close(x8_coro_executor_t *me);
+
+/**
+ * @brief       Attach a motor to the executor
+ *
+ * @param[in]   me            Pointer to executor
+ * @param[in]   motor         Pointer to can handler, motor_id set
+ *
+ * @attention   Sets motor->cansend to the batched send of the bus
+ *
+ * @return      false if the motor id is taken
+ */
+bool x8_coro_add(x8_coro_executor_t *me, x8_can_t *motor);
+
+/**
+ * @brief       Motor handle for coroutines
+ *
+ * @param[in]   me            Pointer to executor
+ * @param[in]   motor         Pointer to can handler added with x8_coro_add
+ *
+ * @attention   None
+ *
+ * @return      Motor handle
+ */
+x8_coro_motor_t x8_coro_motor(x8_coro_executor_t *me, x8_can_t *motor);
+
+/**
+ * @brief       Start a coroutine on the next x8_coro_run wake
+ *
+ * @param[in]   me            Pointer to executor
+ * @param[in]   task          Coroutine, just called
+ *
+ * @attention   May be called from a coroutine of the executor
+ *
+ * @return      None
+ */
+void x8_coro_spawn(x8_coro_executor_t *me, x8_coro_task_t task);
+
+/**
+ * @brief       Awaitable pause of a coroutine
+ *
+ * @param[in]   me            Pointer to executor
+ * @param[in]   period_us     Time to sleep (us), rounded up to X8_CORO_TICK_US
+ *
+ * @attention   None
+ *
+ * @return      Awaitable
+ */
+x8_coro_sleep_t x8_coro_sleep(x8_coro_executor_t *me, uint32_t period_us);
+
+/**
+ * @brief       Run the coroutines until all have returned
+ *
+ * @param[in]   me            Pointer to executor
+ *
+ * @attention   None
+ *
+ * @return      false on an epoll error
+ */
+bool x8_coro_run(x8_coro_executor_t *me);
+
+#endif // __X8_CORO_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,181 @@
+/**
+ * @file       x8_emulate.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Emulated motors on a SocketCAN interface
+ * @note       Usage: x8_emulate <ifname> [first_id] [count] [bitrate]
+ *             Prints frames per second, bus load and syscalls once a second.
+ *             One epoll loop serves the socket, the motion step and the
+ *             report, replies to the frames of one wake go in one sendmmsg.
+ * @example    ./x8_emulate vcan0 1 32
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_socketcan.h"
+#include "x8_emulator.h"
+#include "x8_event.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Private defines ---------------------------------------------------- */
+#define X8_EMULATE_STEP_US        (1000)
+#define X8_EMULATE_REPORT_US      (1000000)
+#define X8_EMULATE_BITRATE        (1000000)
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static x8_socketcan_t m_bus;
+static x8_emulator_t m_emulator;
+static x8_event_t m_loop;
+static uint32_t m_bitrate;
+static uint32_t m_step_us;
+static uint32_t m_report_us;
+
+/* Private function prototypes ---------------------------------------- */
+static void m_can_ready(void *context);
+static void m_step(void *context);
+static void m_report(void *context);
+
+/* Function definitions ----------------------------------------------- */
+int main(int argc, char **argv)
+{
+  int first_id = (argc > 2) ? atoi(argv[2]) : RMD_X8_MOTOR_ID_MIN;
+  int count    = (argc > 3) ? atoi(argv[3]) : 1;
+
+  m_bitrate = (argc > 4) ? (uint32_t)atol(argv[4]) : X8_EMULATE_BITRATE;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <ifname> [first_id] [count] [bitrate]\n", argv[0]);
+    return 1;
+  }
+
+  if (!x8_socketcan_open(&m_bus, argv[1]))
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  // Replies are queued and sent together once the frames received are handled
+  x8_socketcan_bind(&m_bus);
+  x8_emulator_init(&m_emulator, x8_socketcan_cansend_queued);
+
+  for (int motor_id = first_id; motor_id < first_id + count; motor_id++)
+  {
+    if (!x8_emulator_add(&m_emulator, (uint8_t)motor_id))
+    {
+      fprintf(stderr, "Invalid motor id %d\n", motor_id);
+      return 1;
+    }
+  }
+
+  m_step_us   = x8_socketcan_now_us();
+  m_report_us = m_step_us;
+
+  if (!x8_event_init(&m_loop) ||
+      (x8_event_add_fd(&m_loop, m_bus.fd, m_can_ready, NULL) == NULL) ||
+      (x8_event_add_timer(&m_loop, X8_EMULATE_STEP_US, m_step, NULL) == NULL) ||
+      (x8_event_add_timer(&m_loop, X8_EMULATE_REPORT_US, m_report, NULL) == NULL))
+  {
+    perror("epoll");
+    return 1;
+  }
+
+  printf("Emulating motors %d ... %d on %s\n", first_id, first_id + count - 1, argv[1]);
+
+  while (x8_event_run(&m_loop, -1) >= 0)
+  {
+  }
+
+  perror("epoll_wait");
+
+  return 1;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Answer the frames received, all replies in one batch
+ *
+ * @param[in]   context       Unused
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_can_ready(void *context)
+{
+  x8_can_frame_t frame[X8_SOCKETCAN_BATCH];
+  int count;
+
+  (void)context;
+
+  do
+  {
+    count = x8_socketcan_receive_batch(&m_bus, frame, X8_SOCKETCAN_BATCH);
+
+    for (int i = 0; i < count; i++)
+    {
+      x8_emulator_receive(&m_emulator, frame[i].msg_id, frame[i].data);
+    }
+  }
+  while (count == X8_SOCKETCAN_BATCH);
+
+  x8_socketcan_flush(&m_bus);
+}
+
+/**
+ * @brief       Move the motors by the time since the last step
+ *
+ * @param[in]   context       Unused
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_step(void *context)
+{
+  uint32_t now_us = x8_socketcan_now_us();
+
+  (void)context;
+
+  x8_emulator_step(&m_emulator, now_us - m_step_us);
+  m_step_us = now_us;
+}
+
+/**
+ * @brief       Print frame rates, bus load and syscalls since the last report
+ *
+ * @param[in]   context       Unused
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_report(void *context)
+{
+  static uint32_t rx_frames = 0, tx_frames = 0, calls = 0;
+  uint32_t now_us = x8_socketcan_now_us();
+  uint32_t rx     = m_emulator.rx_frames - rx_frames;
+  uint32_t tx     = m_emulator.tx_frames - tx_frames;
+  uint32_t total  = m_bus.rx_calls + m_bus.tx_calls + m_loop.waits;
+  double   sec    = (now_us - m_report_us) / 1000000.0;
+
+  (void)context;
+
+  printf("rx %.0f fps, tx %.0f fps, bus load %.1f %%, %.0f syscalls/s\n", rx / sec, tx / sec,
+         100.0 * (rx + tx) * RMD_X8_CAN_FRAME_BITS / (m_bitrate * sec), (total - calls) / sec);
+  fflush(stdout);
+
+  rx_frames   = m_emulator.rx_frames;
+  tx_frames   = m_emulator.tx_frames;
+  calls       = total;
+  m_report_us = now_us;
+}
+
+/* End of file -------------------------------------------------------- */
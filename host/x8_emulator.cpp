@@ -0,0 +1,541 @@
+/**
+ * @file       x8_emulator.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Software RMD X8 PRO motors speaking the CAN protocol
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_emulator.h"
+#include "x8_can_codec.h"
+
+#include <math.h>
+#include <string.h>
+
+/* Private defines ---------------------------------------------------- */
+#define X8_EMULATOR_ACCELERATION      (20000)   // Default acceleration (dps/s)
+#define X8_EMULATOR_SPEED_MAX         (3000.0)  // Motor shaft speed (dps)
+#define X8_EMULATOR_TORQUE_GAIN       (25.0)    // dps/s per unit of torque current
+#define X8_EMULATOR_DAMPING           (2.0)     // 1/s, speed loss when free running
+#define X8_EMULATOR_POSITION_GAIN     (20.0)    // 1/s, position error to speed
+#define X8_EMULATOR_ENCODER_RANGE     (16384)   // 14 bit encoder
+#define X8_EMULATOR_CIRCLE            (36000.0) // 0.01 degree per turn
+
+/* Private enumerate/structure ---------------------------------------- */
+// Command fields in wire units
+typedef x8_can_field<1, 1, false>  m_cmd_direction;
+typedef x8_can_field<2, 2, false>  m_cmd_speed_limited;     // dps
+typedef x8_can_field<4, 2, true>   m_cmd_torque;
+typedef x8_can_field<4, 4, true>   m_cmd_value_32;          // 0.01 dps, 0.01 degree
+typedef x8_can_field<4, 2, false>  m_cmd_angle_16;          // 0.01 degree
+
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static bool m_x8_emulator_command(x8_emulator_t *me, uint8_t motor_id, const uint8_t *can_data);
+static void m_x8_emulator_reply(x8_emulator_t *me, uint8_t motor_id, uint8_t *can_data);
+static void m_x8_emulator_status_2(x8_emulator_motor_t *motor, uint8_t *can_data);
+static void m_x8_emulator_pid(x8_emulator_motor_t *motor, uint8_t *can_data);
+static void m_x8_emulator_torque(x8_emulator_motor_t *motor, int16_t torque);
+static void m_x8_emulator_position(x8_emulator_motor_t *motor, double angle, double speed_limit);
+static void m_x8_emulator_circle(x8_emulator_motor_t *motor, uint16_t circle_angle, uint8_t dir,
+                                 double speed_limit);
+static uint16_t m_x8_emulator_encoder_raw(x8_emulator_motor_t *motor);
+static double m_x8_emulator_clamp(double value, double limit);
+
+/* Function definitions ----------------------------------------------- */
+void x8_emulator_init(x8_emulator_t *me, void (*cansend) (uint16_t msg_id, uint8_t * buffer))
+{
+  memset(me, 0, sizeof(*me));
+  me->cansend = cansend;
+}
+
+bool x8_emulator_add(x8_emulator_t *me, uint8_t motor_id)
+{
+  x8_emulator_motor_t *motor;
+
+  if ((motor_id < RMD_X8_MOTOR_ID_MIN) || (motor_id > RMD_X8_MOTOR_ID_MAX))
+    return false;
+
+  motor = &me->motor[motor_id - 1];
+  memset(motor, 0, sizeof(*motor));
+
+  motor->present      = true;
+  motor->mode         = X8_EMULATOR_MODE_OFF;
+  motor->speed_limit  = X8_EMULATOR_SPEED_MAX;
+  motor->acceleration = X8_EMULATOR_ACCELERATION;
+  motor->temperature  = 30;
+  motor->voltage      = 240;
+
+  motor->pid.angle_kp  = 100;
+  motor->pid.angle_ki  = 100;
+  motor->pid.speed_kp  = 50;
+  motor->pid.speed_ki  = 40;
+  motor->pid.torque_kp = 50;
+  motor->pid.torque_ki = 50;
+
+  return true;
+}
+
+bool x8_emulator_receive(x8_emulator_t *me, uint16_t msg_id, const uint8_t *can_data)
+{
+  uint8_t can_tx_data[8];
+  bool answered = false;
+
+  // Torque of motors 1 ... 4, each answers with a torque command reply
+  if (msg_id == RMD_X8_CAN_MULTI_TORQUE_MSG_ID)
+  {
+    for (uint8_t motor_id = 1; motor_id <= RMD_X8_MULTI_TORQUE_MOTORS; motor_id++)
+    {
+      x8_emulator_motor_t *motor = &me->motor[motor_id - 1];
+
+      if (!motor->present)
+        continue;
+
+      me->rx_frames++;
+      m_x8_emulator_torque(motor, (int16_t)x8_can_bytes<0, 2>::get<uint16_t>(&can_data[2 * (motor_id - 1)]));
+
+      can_tx_data[0] = RMD_X8_TORQUE_CLOSED_LOOP_CMD;
+      m_x8_emulator_status_2(motor, can_tx_data);
+      m_x8_emulator_reply(me, motor_id, can_tx_data);
+      answered = true;
+    }
+
+    return answered;
+  }
+
+  if ((msg_id < RMD_X8_CAN_MSG_ID_OF(RMD_X8_MOTOR_ID_MIN)) || (msg_id > RMD_X8_CAN_MSG_ID_OF(RMD_X8_MOTOR_ID_MAX)))
+    return false;
+
+  if (!me->motor[RMD_X8_MOTOR_ID_OF(msg_id) - 1].present)
+    return false;
+
+  me->rx_frames++;
+
+  return m_x8_emulator_command(me, RMD_X8_MOTOR_ID_OF(msg_id), can_data);
+}
+
+void x8_emulator_step(x8_emulator_t *me, uint32_t dt_us)
+{
+  double dt = dt_us / 1000000.0;
+
+  for (uint8_t i = 0; i < RMD_X8_MOTOR_ID_MAX; i++)
+  {
+    x8_emulator_motor_t *motor = &me->motor[i];
+    double accel_max = motor->acceleration;
+    double target    = motor->speed;
+    double speed;
+    double accel;
+
+    if (!motor->present)
+      continue;
+
+    switch (motor->mode)
+    {
+    case X8_EMULATOR_MODE_OFF:
+      target = motor->speed * (1.0 - X8_EMULATOR_DAMPING * dt);
+      break;
+
+    case X8_EMULATOR_MODE_STOP:
+      target = 0;
+      break;
+
+    case X8_EMULATOR_MODE_TORQUE:
+      target = motor->speed + (motor->torque_target * X8_EMULATOR_TORQUE_GAIN -
+                               motor->speed * X8_EMULATOR_DAMPING) * dt;
+      break;
+
+    case X8_EMULATOR_MODE_SPEED:
+      target = motor->speed_target;
+      break;
+
+    case X8_EMULATOR_MODE_POSITION:
+    {
+      double error = (motor->angle_target - motor->angle) / 100.0;
+
+      // Slow enough to stop at the target with the acceleration limit
+      target = m_x8_emulator_clamp(error * X8_EMULATOR_POSITION_GAIN, motor->speed_limit);
+      target = m_x8_emulator_clamp(target, sqrt(2.0 * accel_max * fabs(error)));
+      break;
+    }
+    }
+
+    target = m_x8_emulator_clamp(target, X8_EMULATOR_SPEED_MAX);
+
+    // Acceleration limit, free running is not driven
+    speed = (motor->mode == X8_EMULATOR_MODE_OFF) ?
+            target : motor->speed + m_x8_emulator_clamp(target - motor->speed, accel_max * dt);
+    accel = (dt > 0) ? (speed - motor->speed) / dt : 0;
+
+    motor->angle += (motor->speed + speed) * 0.5 * dt * 100.0;
+    motor->speed  = speed;
+
+    if ((motor->mode == X8_EMULATOR_MODE_POSITION) &&
+        (fabs(motor->angle_target - motor->angle) < 1.0) && (fabs(motor->speed) < 1.0))
+    {
+      motor->angle = motor->angle_target;
+      motor->speed = 0;
+    }
+
+    if (motor->mode == X8_EMULATOR_MODE_OFF)
+    {
+      motor->torque_current = 0;
+    }
+    else if (motor->mode == X8_EMULATOR_MODE_TORQUE)
+    {
+      motor->torque_current = motor->torque_target;
+    }
+    else
+    {
+      motor->torque_current = (int16_t)m_x8_emulator_clamp(accel / X8_EMULATOR_TORQUE_GAIN, 2048);
+    }
+  }
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Execute a single motor command and reply
+ *
+ * @param[in]   me            Pointer to emulator
+ * @param[in]   motor_id      Motor ID
+ * @param[in]   can_data      Command
+ *
+ * @attention   None
+ *
+ * @return      true if the command is known
+ */
+static bool m_x8_emulator_command(x8_emulator_t *me, uint8_t motor_id, const uint8_t *can_data)
+{
+  x8_emulator_motor_t *motor = &me->motor[motor_id - 1];
+  uint8_t can_tx_data[8];
+
+  memset(can_tx_data, 0, sizeof(can_tx_data));
+  can_tx_data[0] = can_data[0];
+
+  switch (can_data[0])
+  {
+  case RMD_X8_READ_PID_DATA_CMD:
+    m_x8_emulator_pid(motor, can_tx_data);
+    break;
+
+  case RMD_X8_WRITE_PID_TO_RAM_CMD:
+  case RMD_X8_WRITE_PID_TO_ROM_CMD:
+    motor->pid.angle_kp  = x8_can_layout_pid::angle_kp::decode(can_data);
+    motor->pid.angle_ki  = x8_can_layout_pid::angle_ki::decode(can_data);
+    motor->pid.speed_kp  = x8_can_layout_pid::speed_kp::decode(can_data);
+    motor->pid.speed_ki  = x8_can_layout_pid::speed_ki::decode(can_data);
+    motor->pid.torque_kp = x8_can_layout_pid::torque_kp::decode(can_data);
+    motor->pid.torque_ki = x8_can_layout_pid::torque_ki::decode(can_data);
+    m_x8_emulator_pid(motor, can_tx_data);
+    break;
+
+  case RMD_X8_WRITE_ACCELERATION_CMD:
+    motor->acceleration = x8_can_layout_acceleration::acceleration::decode(can_data);
+    if (motor->acceleration <= 0)
+    {
+      motor->acceleration = X8_EMULATOR_ACCELERATION;
+    }
+    x8_can_layout_acceleration::acceleration::encode(can_tx_data, motor->acceleration);
+    break;
+
+  case RMD_X8_READ_ACCELERATION_CMD:
+    x8_can_layout_acceleration::acceleration::encode(can_tx_data, motor->acceleration);
+    break;
+
+  case RMD_X8_WRITE_ENCODER_OFFSET_CMD:
+    motor->encoder_offset = x8_can_layout_encoder::encoder_offset::decode(can_data);
+    x8_can_layout_encoder::encoder_offset::encode(can_tx_data, motor->encoder_offset);
+    break;
+
+  case RMD_X8_WRITE_CURRENT_POSITION_CMD:
+    motor->encoder_offset = m_x8_emulator_encoder_raw(motor);
+    x8_can_layout_encoder::encoder_offset::encode(can_tx_data, motor->encoder_offset);
+    break;
+
+  case RMD_X8_READ_ENCODE_DATA_CMD:
+  {
+    uint16_t raw = m_x8_emulator_encoder_raw(motor);
+
+    x8_can_layout_encoder::encoder::encode(can_tx_data, (raw - motor->encoder_offset) & (X8_EMULATOR_ENCODER_RANGE - 1));
+    x8_can_layout_encoder::encoder_raw::encode(can_tx_data, raw);
+    x8_can_layout_encoder::encoder_offset::encode(can_tx_data, motor->encoder_offset);
+    break;
+  }
+
+  case RMD_X8_READ_MULTI_TURNS_ANGLE_CMD:
+    x8_can_bytes<x8_can_layout_multi_turn_angle::angle::offset,
+                 x8_can_layout_multi_turn_angle::angle::width>::put(can_tx_data, (uint64_t)llround(motor->angle));
+    break;
+
+  case RMD_X8_READ_SINGLE_CIRCLE_ANGLE_CMD:
+  {
+    double circle = fmod(motor->angle, X8_EMULATOR_CIRCLE);
+
+    if (circle < 0)
+    {
+      circle += X8_EMULATOR_CIRCLE;
+    }
+    x8_can_layout_single_circle_angle::circle_angle::encode(can_tx_data, (uint16_t)circle % 36000);
+    break;
+  }
+
+  case RMD_X8_CLEAR_MOTOR_ERROR_FLAG_CMD:
+  case RMD_X8_READ_MOTOR_STATUS_CMD:
+    if (can_data[0] == RMD_X8_CLEAR_MOTOR_ERROR_FLAG_CMD)
+    {
+      motor->error_state = 0;
+    }
+    x8_can_layout_motor_status_1::temperature::encode(can_tx_data, motor->temperature);
+    x8_can_layout_motor_status_1::voltage::encode(can_tx_data, motor->voltage);
+    x8_can_layout_motor_status_1::error_state::encode(can_tx_data, motor->error_state);
+    break;
+
+  case RMD_X8_READ_MOTOR_STATUS_3_CMD:
+  {
+    // Phase currents of the torque current vector at the electrical angle
+    double theta = fmod(motor->angle, X8_EMULATOR_CIRCLE) * 2.0 * M_PI / X8_EMULATOR_CIRCLE;
+
+    x8_can_layout_motor_status_3::temperature::encode(can_tx_data, motor->temperature);
+    x8_can_layout_motor_status_3::phase_a_current::encode(can_tx_data, (int16_t)(motor->torque_current * cos(theta)));
+    x8_can_layout_motor_status_3::phase_b_current::encode(can_tx_data, (int16_t)(motor->torque_current * cos(theta - 2.0 * M_PI / 3.0)));
+    x8_can_layout_motor_status_3::phase_c_current::encode(can_tx_data, (int16_t)(motor->torque_current * cos(theta + 2.0 * M_PI / 3.0)));
+    break;
+  }
+
+  case RMD_X8_MOTOR_OFF_CMD:
+    motor->mode = X8_EMULATOR_MODE_OFF;
+    break;
+
+  case RMD_X8_MOTOR_STOP_CMD:
+  case RMD_X8_MOTOR_RUNNING_CMD:
+    motor->mode = X8_EMULATOR_MODE_STOP;
+    break;
+
+  case RMD_X8_TORQUE_CLOSED_LOOP_CMD:
+    m_x8_emulator_torque(motor, m_cmd_torque::decode(can_data));
+    m_x8_emulator_status_2(motor, can_tx_data);
+    break;
+
+  case RMD_X8_SPEED_CLOSED_LOOP_CMD:
+    motor->mode         = X8_EMULATOR_MODE_SPEED;
+    motor->speed_target = m_cmd_value_32::decode(can_data) / 100.0;
+    m_x8_emulator_status_2(motor, can_tx_data);
+    break;
+
+  case RMD_X8_POSITION_CTRL_1_CMD:
+    m_x8_emulator_position(motor, m_cmd_value_32::decode(can_data), X8_EMULATOR_SPEED_MAX);
+    m_x8_emulator_status_2(motor, can_tx_data);
+    break;
+
+  case RMD_X8_POSITION_CTRL_2_CMD:
+    m_x8_emulator_position(motor, m_cmd_value_32::decode(can_data), m_cmd_speed_limited::decode(can_data));
+    m_x8_emulator_status_2(motor, can_tx_data);
+    break;
+
+  case RMD_X8_POSITION_CTRL_3_CMD:
+    m_x8_emulator_circle(motor, m_cmd_angle_16::decode(can_data), m_cmd_direction::decode(can_data),
+                         X8_EMULATOR_SPEED_MAX);
+    m_x8_emulator_status_2(motor, can_tx_data);
+    break;
+
+  case RMD_X8_POSITION_CTRL_4_CMD:
+    m_x8_emulator_circle(motor, m_cmd_angle_16::decode(can_data), m_cmd_direction::decode(can_data),
+                         m_cmd_speed_limited::decode(can_data));
+    m_x8_emulator_status_2(motor, can_tx_data);
+    break;
+
+  case RMD_X8_READ_MOTOR_STATUS_2_CMD:
+    m_x8_emulator_status_2(motor, can_tx_data);
+    break;
+
+  default:
+    me->ignored++;
+    return false;
+  }
+
+  m_x8_emulator_reply(me, motor_id, can_tx_data);
+
+  return true;
+}
+
+/**
+ * @brief       Send reply of a motor
+ *
+ * @param[in]   me            Pointer to emulator
+ * @param[in]   motor_id      Motor ID
+ * @param[in]   can_data      Reply
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_emulator_reply(x8_emulator_t *me, uint8_t motor_id, uint8_t *can_data)
+{
+  me->tx_frames++;
+
+  if (me->cansend != NULL)
+  {
+    me->cansend(RMD_X8_CAN_MSG_ID_OF(motor_id), can_data);
+  }
+}
+
+/**
+ * @brief       Fill bytes 1 ... 7 with status 2
+ *
+ * @param[in]   motor         Pointer to motor
+ * @param[in]   can_data      Reply, command byte already set
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_emulator_status_2(x8_emulator_motor_t *motor, uint8_t *can_data)
+{
+  x8_can_layout_motor_status_2::temperature::encode(can_data, motor->temperature);
+  x8_can_layout_motor_status_2::torque_current::encode(can_data, motor->torque_current);
+  x8_can_bytes<x8_can_layout_motor_status_2::speed::offset,
+               x8_can_layout_motor_status_2::speed::width>::put(can_data, (uint16_t)(int16_t)lround(motor->speed));
+  x8_can_layout_motor_status_2::encoder::encode(can_data,
+                                                (m_x8_emulator_encoder_raw(motor) - motor->encoder_offset) &
+                                                (X8_EMULATOR_ENCODER_RANGE - 1));
+}
+
+/**
+ * @brief       Fill bytes 2 ... 7 with PID parameters
+ *
+ * @param[in]   motor         Pointer to motor
+ * @param[in]   can_data      Reply, command byte already set
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_emulator_pid(x8_emulator_motor_t *motor, uint8_t *can_data)
+{
+  x8_can_layout_pid::angle_kp::encode(can_data, motor->pid.angle_kp);
+  x8_can_layout_pid::angle_ki::encode(can_data, motor->pid.angle_ki);
+  x8_can_layout_pid::speed_kp::encode(can_data, motor->pid.speed_kp);
+  x8_can_layout_pid::speed_ki::encode(can_data, motor->pid.speed_ki);
+  x8_can_layout_pid::torque_kp::encode(can_data, motor->pid.torque_kp);
+  x8_can_layout_pid::torque_ki::encode(can_data, motor->pid.torque_ki);
+}
+
+/**
+ * @brief       Enter torque mode
+ *
+ * @param[in]   motor         Pointer to motor
+ * @param[in]   torque        Torque current (-2000 ... 2000)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_emulator_torque(x8_emulator_motor_t *motor, int16_t torque)
+{
+  motor->mode          = X8_EMULATOR_MODE_TORQUE;
+  motor->torque_target = (int16_t)m_x8_emulator_clamp(torque, 2000);
+}
+
+/**
+ * @brief       Enter position mode with a multi turn target
+ *
+ * @param[in]   motor         Pointer to motor
+ * @param[in]   angle         Target (0.01 degree)
+ * @param[in]   speed_limit   Speed limit (dps), 0 => no limit
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_emulator_position(x8_emulator_motor_t *motor, double angle, double speed_limit)
+{
+  motor->mode         = X8_EMULATOR_MODE_POSITION;
+  motor->angle_target = angle;
+  motor->speed_limit  = (speed_limit > 0) ? speed_limit : X8_EMULATOR_SPEED_MAX;
+}
+
+/**
+ * @brief       Enter position mode with a single turn target reached in a direction
+ *
+ * @param[in]   motor         Pointer to motor
+ * @param[in]   circle_angle  Target within one turn (0.01 degree)
+ * @param[in]   dir           X8_CLOCKWISE => angle increases
+ * @param[in]   speed_limit   Speed limit (dps)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_emulator_circle(x8_emulator_motor_t *motor, uint16_t circle_angle, uint8_t dir,
+                                 double speed_limit)
+{
+  double turn  = floor(motor->angle / X8_EMULATOR_CIRCLE) * X8_EMULATOR_CIRCLE;
+  double angle = turn + fmod(circle_angle, X8_EMULATOR_CIRCLE);
+
+  if (dir == X8_CLOCKWISE)
+  {
+    if (angle < motor->angle)
+    {
+      angle += X8_EMULATOR_CIRCLE;
+    }
+  }
+  else
+  {
+    if (angle > motor->angle)
+    {
+      angle -= X8_EMULATOR_CIRCLE;
+    }
+  }
+
+  m_x8_emulator_position(motor, angle, speed_limit);
+}
+
+/**
+ * @brief       Encoder position of the shaft angle
+ *
+ * @param[in]   motor         Pointer to motor
+ *
+ * @attention   None
+ *
+ * @return      Raw encoder (0 ... 16383)
+ */
+static uint16_t m_x8_emulator_encoder_raw(x8_emulator_motor_t *motor)
+{
+  double circle = fmod(motor->angle, X8_EMULATOR_CIRCLE);
+
+  if (circle < 0)
+  {
+    circle += X8_EMULATOR_CIRCLE;
+  }
+
+  return (uint16_t)(circle * X8_EMULATOR_ENCODER_RANGE / X8_EMULATOR_CIRCLE) & (X8_EMULATOR_ENCODER_RANGE - 1);
+}
+
+/**
+ * @brief       Clamp to [-limit, limit]
+ *
+ * @param[in]   value         Value
+ * @param[in]   limit         Limit, positive
+ *
+ * @attention   None
+ *
+ * @return      Clamped value
+ */
+static double m_x8_emulator_clamp(double value, double limit)
+{
+  if (value > limit)
+    return limit;
+
+  if (value < -limit)
+    return -limit;
+
+  return value;
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,140 @@
+/**
+ * @file       x8_emulator.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Software RMD X8 PRO motors speaking the CAN protocol
+ * @note       Answers reads (0x30 ... 0x34, 0x90 ... 0x9D), motor off/stop/run
+ *             and the 0xA1 ... 0xA6 control commands, also the 0x280 multi
+ *             motor torque command. Motion is a rigid shaft with limited
+ *             acceleration, enough to close position and speed loops on.
+ *             State is kept in wire units: angle in 0.01 degree and speed in
+ *             dps, both of the motor shaft.
+ * @example    x8_emulator_init(&emu, reply_to_controller);
+ *             x8_emulator_add(&emu, 1);
+ *             x8_emulator_receive(&emu, msg_id, can_data);
+ *             x8_emulator_step(&emu, 1000);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_EMULATOR_H
+#define __X8_EMULATOR_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+
+/* Public defines ----------------------------------------------------- */
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Control mode
+ */
+typedef enum
+{
+  X8_EMULATOR_MODE_OFF,               // Free running, no torque
+  X8_EMULATOR_MODE_STOP,              // Braking to standstill, holding
+  X8_EMULATOR_MODE_TORQUE,
+  X8_EMULATOR_MODE_SPEED,
+  X8_EMULATOR_MODE_POSITION
+}
+x8_emulator_mode_t;
+
+/**
+ * @brief Emulated motor
+ */
+typedef struct
+{
+  bool                present;
+  x8_emulator_mode_t  mode;
+
+  double              angle;          // Multi turn angle (0.01 degree)
+  double              speed;          // Speed (dps)
+  int16_t             torque_current; // Last torque current (-2048 ... 2048)
+
+  int16_t             torque_target;  // Torque mode (-2000 ... 2000)
+  double              speed_target;   // Speed mode (dps)
+  double              angle_target;   // Position mode (0.01 degree)
+  double              speed_limit;    // Position mode (dps)
+
+  int32_t             acceleration;   // dps/s
+  uint16_t            encoder_offset;
+  int8_t              temperature;
+  uint16_t            voltage;        // 0.1 V
+  uint8_t             error_state;
+  x8_motor_pid_data_t pid;
+}
+x8_emulator_motor_t;
+
+/**
+ * @brief Emulated bus of motors
+ */
+typedef struct
+{
+  // Reply of a motor, same shape as x8_can_t::cansend
+  void (*cansend) (uint16_t msg_id, uint8_t * buffer);
+
+  x8_emulator_motor_t motor[RMD_X8_MOTOR_ID_MAX];   // Index motor_id - 1
+
+  uint32_t rx_frames;                               // Frames for a present motor
+  uint32_t tx_frames;                               // Replies sent
+  uint32_t ignored;                                 // Unknown commands
+}
+x8_emulator_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init emulator without motors
+ *
+ * @param[in]   me            Pointer to emulator
+ * @param[in]   cansend       Reply sender
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_emulator_init(x8_emulator_t *me, void (*cansend) (uint16_t msg_id, uint8_t * buffer));
+
+/**
+ * @brief       Add motor at standstill, angle 0
+ *
+ * @param[in]   me            Pointer to emulator
+ * @param[in]   motor_id      Motor ID (1 ... 32)
+ *
+ * @attention   None
+ *
+ * @return      false if motor_id is out of range
+ */
+bool x8_emulator_add(x8_emulator_t *me, uint8_t motor_id);
+
+/**
+ * @brief       Handle a frame sent by the controller
+ *
+ * @param[in]   me            Pointer to emulator
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   can_data      Pointer to can data (8 bytes)
+ *
+ * @attention   The reply is sent through cansend before returning
+ *
+ * @return      true if a motor answered
+ */
+bool x8_emulator_receive(x8_emulator_t *me, uint16_t msg_id, const uint8_t *can_data);
+
+/**
+ * @brief       Advance motion of all motors
+ *
+ * @param[in]   me            Pointer to emulator
+ * @param[in]   dt_us         Elapsed time (us)
+ *
+ * @attention   Keep dt_us in the ms range, larger steps overshoot
+ *
+ * @return      None
+ */
+void x8_emulator_step(x8_emulator_t *me, uint32_t dt_us);
+
+#endif // __X8_EMULATOR_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,164 @@
+/**
+ * @file       x8_event.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      epoll loop over sockets and periodic timers
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_event.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+/* Private defines ---------------------------------------------------- */
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static x8_event_source_t *m_x8_event_add(x8_event_t *me, int fd, bool timer, void (*handler) (void *context), void *context);
+
+/* Function definitions ----------------------------------------------- */
+bool x8_event_init(x8_event_t *me)
+{
+  me->sources  = 0;
+  me->waits    = 0;
+  me->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+  return me->epoll_fd >= 0;
+}
+
+void x8_event_close(x8_event_t *me)
+{
+  for (uint8_t i = 0; i < me->sources; i++)
+  {
+    if (me->source[i].timer)
+    {
+      close(me->source[i].fd);
+    }
+  }
+
+  if (me->epoll_fd >= 0)
+  {
+    close(me->epoll_fd);
+    me->epoll_fd = -1;
+  }
+
+  me->sources = 0;
+}
+
+x8_event_source_t *x8_event_add_fd(x8_event_t *me, int fd, void (*handler) (void *context), void *context)
+{
+  return m_x8_event_add(me, fd, false, handler, context);
+}
+
+x8_event_source_t *x8_event_add_timer(x8_event_t *me, uint32_t period_us, void (*handler) (void *context), void *context)
+{
+  struct itimerspec spec;
+  x8_event_source_t *source;
+  int fd;
+
+  fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+
+  spec.it_interval.tv_sec  = period_us / 1000000;
+  spec.it_interval.tv_nsec = (long)(period_us % 1000000) * 1000;
+  spec.it_value            = spec.it_interval;
+
+  if (timerfd_settime(fd, 0, &spec, NULL) < 0)
+  {
+    close(fd);
+    return NULL;
+  }
+
+  source = m_x8_event_add(me, fd, true, handler, context);
+  if (source == NULL)
+  {
+    close(fd);
+  }
+
+  return source;
+}
+
+int x8_event_run(x8_event_t *me, int timeout_ms)
+{
+  struct epoll_event event[X8_EVENT_SOURCES];
+  int ready;
+
+  me->waits++;
+  ready = epoll_wait(me->epoll_fd, event, X8_EVENT_SOURCES, timeout_ms);
+  if (ready < 0)
+    return (errno == EINTR) ? 0 : -1;
+
+  for (int i = 0; i < ready; i++)
+  {
+    x8_event_source_t *source = (x8_event_source_t *)event[i].data.ptr;
+    uint64_t expirations;
+
+    // A timer is due again only once it is read
+    if (source->timer)
+    {
+      if (read(source->fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations))
+        continue;
+
+      source->missed += (uint32_t)(expirations - 1);
+    }
+
+    source->handler(source->context);
+  }
+
+  return ready;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Add a source to the table and the epoll set
+ *
+ * @param[in]   me            Pointer to loop
+ * @param[in]   fd            File descriptor
+ * @param[in]   timer         fd is a timerfd owned by the loop
+ * @param[in]   handler       Handler
+ * @param[in]   context       Passed to handler
+ *
+ * @attention   None
+ *
+ * @return      Source, NULL if the table is full or epoll refused it
+ */
+static x8_event_source_t *m_x8_event_add(x8_event_t *me, int fd, bool timer, void (*handler) (void *context), void *context)
+{
+  struct epoll_event event;
+  x8_event_source_t *source;
+
+  if (me->sources >= X8_EVENT_SOURCES)
+    return NULL;
+
+  source          = &me->source[me->sources];
+  source->fd      = fd;
+  source->timer   = timer;
+  source->handler = handler;
+  source->context = context;
+  source->missed  = 0;
+
+  memset(&event, 0, sizeof(event));
+  event.events   = EPOLLIN;
+  event.data.ptr = source;
+
+  if (epoll_ctl(me->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    return NULL;
+
+  me->sources++;
+
+  return source;
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,126 @@
+/**
+ * @file       x8_event.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      epoll loop over sockets and periodic timers
+ * @note       Sockets and timers (timerfd) are sources of one epoll set, a
+ *             wait returns every source ready at once, so the syscalls of a
+ *             cycle do not grow with the number of sockets. Handlers run in
+ *             the thread calling x8_event_run.
+ *             A timer handler runs once per wake. Periods that passed
+ *             without it, because the loop was late, are counted in missed.
+ *             Sources live in a fixed table, nothing is allocated.
+ * @example    x8_event_init(&loop);
+ *             x8_event_add_fd(&loop, bus.fd, m_can_ready, &bus);
+ *             x8_event_add_timer(&loop, 1000, m_tick, NULL);
+ *             for (;;) x8_event_run(&loop, -1);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_EVENT_H
+#define __X8_EVENT_H
+
+/* Includes ----------------------------------------------------------- */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Public defines ----------------------------------------------------- */
+#define X8_EVENT_SOURCES          (16)
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Socket or timer
+ */
+typedef struct
+{
+  int       fd;
+  bool      timer;                  // fd is a timerfd owned by the loop
+  void    (*handler) (void *context);
+  void     *context;
+  uint32_t  missed;                 // Timer periods without handler call
+}
+x8_event_source_t;
+
+/**
+ * @brief Event loop
+ */
+typedef struct
+{
+  int               epoll_fd;
+  x8_event_source_t source[X8_EVENT_SOURCES];
+  uint8_t           sources;
+  uint32_t          waits;          // epoll_wait calls
+}
+x8_event_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Create an empty loop
+ *
+ * @param[in]   me            Pointer to loop
+ *
+ * @attention   None
+ *
+ * @return      false if epoll cannot be created
+ */
+bool x8_event_init(x8_event_t *me);
+
+/**
+ * @brief       Close the loop and its timers
+ *
+ * @param[in]   me            Pointer to loop
+ *
+ * @attention   Sockets are left open
+ *
+ * @return      None
+ */
+void x8_event_close(x8_event_t *me);
+
+/**
+ * @brief       Call a handler when a socket can be read
+ *
+ * @param[in]   me            Pointer to loop
+ * @param[in]   fd            Socket, eventfd ...
+ * @param[in]   handler       Handler, reads until nothing is left
+ * @param[in]   context       Passed to handler
+ *
+ * @attention   Level triggered: unread data wakes the next wait again
+ *
+ * @return      Source, NULL if the table is full or epoll refused it
+ */
+x8_event_source_t *x8_event_add_fd(x8_event_t *me, int fd, void (*handler) (void *context), void *context);
+
+/**
+ * @brief       Call a handler periodically
+ *
+ * @param[in]   me            Pointer to loop
+ * @param[in]   period_us     Period (us), first call one period from now
+ * @param[in]   handler       Handler
+ * @param[in]   context       Passed to handler
+ *
+ * @attention   None
+ *
+ * @return      Source, NULL if the table is full or no timer can be created
+ */
+x8_event_source_t *x8_event_add_timer(x8_event_t *me, uint32_t period_us, void (*handler) (void *context), void *context);
+
+/**
+ * @brief       Wait once and call the handlers of the sources ready
+ *
+ * @param[in]   me            Pointer to loop
+ * @param[in]   timeout_ms    Time to wait, 0 => do not wait, -1 => until a source is ready
+ *
+ * @attention   None
+ *
+ * @return      Number of handlers called, -1 on error
+ */
+int x8_event_run(x8_event_t *me, int timeout_ms);
+
+#endif // __X8_EVENT_H
+
+/* End of file -------------------------------------------------------- */
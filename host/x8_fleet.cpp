@@ -0,0 +1,247 @@
+/**
+ * @file       x8_fleet.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Status polling of motors on several buses through the gateway
+ * @note       Every cycle a 0x9C status read goes to each motor of each bus.
+ *             Replies per second are printed once a second, per bus and in
+ *             total, with the frames lost in the gateway rings and the
+ *             syscalls per cycle of each worker.
+ *             Usage: x8_fleet [-r rate (Hz)] [-s seconds] [-c first core] <ifname>:<first id>-<last id> ...
+ *             Worker of bus n runs on core first core + n, -c -1 => not pinned.
+ * @example    ./x8_fleet -r 1000 -s 10 can0:1-16 can1:1-16 can2:1-16 can3:1-16
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_gateway.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private defines ---------------------------------------------------- */
+#define X8_FLEET_RATE_HZ          (1000)
+#define X8_FLEET_SECONDS          (10)
+#define X8_FLEET_FIRST_CPU        (1)         // Core 0 left to the application
+#define X8_FLEET_REPORT_US        (1000000)
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static x8_gateway_t m_gateway;
+static x8_can_t m_x8_can[X8_GATEWAY_BUSES * RMD_X8_MOTOR_ID_MAX];
+static uint16_t m_num_of_motors = 0;
+static uint32_t m_replies[X8_GATEWAY_BUSES];
+static uint32_t m_syscalls[X8_GATEWAY_BUSES];
+static uint32_t m_cycles = 0;
+
+/* Private function prototypes ---------------------------------------- */
+static bool m_add_bus(const char *arg, int cpu);
+static void m_received(uint8_t bus, x8_can_t *motor, const x8_can_frame_t *frame);
+static void m_report(double sec);
+static uint32_t m_worker_syscalls(uint8_t bus);
+
+/* Function definitions ----------------------------------------------- */
+int main(int argc, char **argv)
+{
+  uint32_t rate = X8_FLEET_RATE_HZ;
+  uint32_t seconds = X8_FLEET_SECONDS;
+  int first_cpu = X8_FLEET_FIRST_CPU;
+  uint32_t period_us, start_us, cycle_us, report_us, now_us;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "r:s:c:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'r': rate      = (uint32_t)atol(optarg); break;
+    case 's': seconds   = (uint32_t)atol(optarg); break;
+    case 'c': first_cpu = atoi(optarg);           break;
+    default:
+      optind = argc + 1;
+      break;
+    }
+  }
+
+  if ((optind >= argc) || (rate == 0))
+  {
+    fprintf(stderr, "Usage: %s [-r rate (Hz)] [-s seconds] [-c first core] <ifname>:<first id>-<last id> ...\n", argv[0]);
+    return 1;
+  }
+
+  x8_gateway_init(&m_gateway, m_received);
+
+  for (int i = optind; i < argc; i++)
+  {
+    if (!m_add_bus(argv[i], (first_cpu < 0) ? -1 : first_cpu + (i - optind)))
+    {
+      x8_gateway_stop(&m_gateway);
+      return 1;
+    }
+  }
+
+  if (!x8_gateway_start(&m_gateway))
+  {
+    perror("Start workers");
+    x8_gateway_stop(&m_gateway);
+    return 1;
+  }
+
+  period_us = 1000000 / rate;
+  start_us  = x8_socketcan_now_us();
+  cycle_us  = start_us;
+  report_us = start_us;
+
+  do
+  {
+    for (uint16_t i = 0; i < m_num_of_motors; i++)
+    {
+      x8_can_send_get_motor_status(&m_x8_can[i]);
+    }
+    x8_gateway_flush(&m_gateway);
+    m_cycles++;
+
+    // Replies until the next cycle
+    cycle_us += period_us;
+    do
+    {
+      x8_gateway_poll(&m_gateway);
+      usleep(50);
+      now_us = x8_socketcan_now_us();
+    }
+    while ((int32_t)(now_us - cycle_us) < 0);
+
+    if ((uint32_t)(now_us - report_us) >= X8_FLEET_REPORT_US)
+    {
+      m_report((now_us - report_us) / 1000000.0);
+      report_us = now_us;
+    }
+  }
+  while ((uint32_t)(now_us - start_us) < seconds * 1000000);
+
+  x8_gateway_stop(&m_gateway);
+
+  return 0;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Open a bus and add its motors
+ *
+ * @param[in]   arg           <ifname>:<first id>-<last id>
+ * @param[in]   cpu           Core of its worker, -1 => not pinned
+ *
+ * @attention   None
+ *
+ * @return      false on error, printed
+ */
+static bool m_add_bus(const char *arg, int cpu)
+{
+  char ifname[32];
+  int first_id, last_id, bus;
+  const char *colon = strchr(arg, ':');
+
+  if ((colon == NULL) || ((size_t)(colon - arg) >= sizeof(ifname)) ||
+      (sscanf(colon + 1, "%d-%d", &first_id, &last_id) != 2) ||
+      (first_id < RMD_X8_MOTOR_ID_MIN) || (last_id > RMD_X8_MOTOR_ID_MAX) || (first_id > last_id))
+  {
+    fprintf(stderr, "Bad bus %s, <ifname>:<first id>-<last id>\n", arg);
+    return false;
+  }
+
+  memcpy(ifname, arg, colon - arg);
+  ifname[colon - arg] = '\0';
+
+  bus = x8_gateway_add_bus(&m_gateway, ifname, cpu);
+  if (bus < 0)
+  {
+    perror(ifname);
+    return false;
+  }
+
+  for (int motor_id = first_id; motor_id <= last_id; motor_id++)
+  {
+    x8_can_t *me = &m_x8_can[m_num_of_motors++];
+
+    me->motor_id = (uint8_t)motor_id;
+    x8_gateway_add(&m_gateway, me, (uint8_t)bus);
+  }
+
+  printf("Bus %d %s: motors %d ... %d, core %d\n", bus, ifname, first_id, last_id, cpu);
+
+  return true;
+}
+
+/**
+ * @brief       Count the status replies of each bus
+ *
+ * @param[in]   bus           Bus index
+ * @param[in]   motor         Motor that sent the frame, NULL => none
+ * @param[in]   frame         Frame
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_received(uint8_t bus, x8_can_t *motor, const x8_can_frame_t *frame)
+{
+  if ((motor != NULL) && (frame->data[0] == RMD_X8_READ_MOTOR_STATUS_2_CMD))
+  {
+    m_replies[bus]++;
+  }
+}
+
+/**
+ * @brief       Syscalls of the worker of a bus so far
+ *
+ * @param[in]   bus           Bus index
+ *
+ * @attention   Read while the worker runs, good enough for a report
+ *
+ * @return      sendmmsg, recvmmsg and epoll_wait calls
+ */
+static uint32_t m_worker_syscalls(uint8_t bus)
+{
+  x8_gateway_bus_t *me = &m_gateway.bus[bus];
+
+  return me->can.tx_calls + me->can.rx_calls + me->loop.waits;
+}
+
+/**
+ * @brief       Print replies per second since the last report
+ *
+ * @param[in]   sec           Time since the last report (s)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_report(double sec)
+{
+  uint32_t total = 0;
+  uint16_t tx_overrun, rx_overrun;
+  uint32_t syscalls;
+
+  for (uint8_t i = 0; i < m_gateway.buses; i++)
+  {
+    x8_gateway_overrun(&m_gateway, i, &tx_overrun, &rx_overrun);
+    syscalls = m_worker_syscalls(i);
+    printf("bus %u %.0f rps, %.1f syscalls/cycle (tx overrun %u, rx overrun %u)  ", i, m_replies[i] / sec,
+           (double)(syscalls - m_syscalls[i]) / (m_cycles ? m_cycles : 1), tx_overrun, rx_overrun);
+    total        += m_replies[i];
+    m_replies[i]  = 0;
+    m_syscalls[i] = syscalls;
+  }
+  m_cycles = 0;
+
+  printf("total %.0f rps\n", total / sec);
+  fflush(stdout);
+}
+
+/* End of file -------------------------------------------------------- */
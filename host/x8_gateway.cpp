@@ -0,0 +1,362 @@
+/**
+ * @file       x8_gateway.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Motors on several SocketCAN buses, one I/O thread per bus
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_gateway.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/* Private defines ---------------------------------------------------- */
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static x8_gateway_t *m_x8_gateway = NULL;
+
+/* Private function prototypes ---------------------------------------- */
+static void *m_x8_gateway_worker(void *arg);
+static void m_x8_gateway_can_ready(void *context);
+static void m_x8_gateway_wake(void *context);
+static void m_x8_gateway_queue(x8_gateway_bus_t *bus, uint16_t msg_id, const uint8_t *buffer);
+
+/**
+ * @brief       x8_can_t::cansend of a bus
+ */
+template <uint8_t BUS>
+static void m_x8_gateway_cansend(uint16_t msg_id, uint8_t *buffer)
+{
+  m_x8_gateway_queue(&m_x8_gateway->bus[BUS], msg_id, buffer);
+}
+
+static void (*const M_X8_GATEWAY_CANSEND[]) (uint16_t msg_id, uint8_t *buffer) =
+{
+  m_x8_gateway_cansend<0>, m_x8_gateway_cansend<1>, m_x8_gateway_cansend<2>, m_x8_gateway_cansend<3>,
+  m_x8_gateway_cansend<4>, m_x8_gateway_cansend<5>, m_x8_gateway_cansend<6>, m_x8_gateway_cansend<7>
+};
+
+static_assert(sizeof(M_X8_GATEWAY_CANSEND) / sizeof(M_X8_GATEWAY_CANSEND[0]) == X8_GATEWAY_BUSES,
+              "One cansend per bus");
+
+/* Function definitions ----------------------------------------------- */
+void x8_gateway_init(x8_gateway_t *me, void (*received) (uint8_t bus, x8_can_t *motor, const x8_can_frame_t *frame))
+{
+  me->received = received;
+  me->buses    = 0;
+  me->run.store(false, std::memory_order_relaxed);
+
+  m_x8_gateway = me;
+}
+
+int x8_gateway_add_bus(x8_gateway_t *me, const char *ifname, int cpu)
+{
+  x8_gateway_bus_t *bus;
+
+  if ((me->buses >= X8_GATEWAY_BUSES) || me->run.load(std::memory_order_acquire))
+    return -1;
+
+  bus = &me->bus[me->buses];
+  if (!x8_socketcan_open(&bus->can, ifname))
+    return -1;
+
+  bus->wake_fd = eventfd(0, EFD_NONBLOCK);
+  if (bus->wake_fd < 0)
+  {
+    x8_socketcan_close(&bus->can);
+    return -1;
+  }
+
+  if (!x8_event_init(&bus->loop) ||
+      (x8_event_add_fd(&bus->loop, bus->can.fd, m_x8_gateway_can_ready, bus) == NULL) ||
+      (x8_event_add_fd(&bus->loop, bus->wake_fd, m_x8_gateway_wake, bus) == NULL))
+  {
+    x8_event_close(&bus->loop);
+    close(bus->wake_fd);
+    x8_socketcan_close(&bus->can);
+    return -1;
+  }
+
+  bus->cpu       = cpu;
+  bus->tx_frames.store(0, std::memory_order_relaxed);
+  bus->rx_frames.store(0, std::memory_order_relaxed);
+  x8_can_registry_init(&bus->registry);
+  x8_can_rx_ring_init(&bus->tx);
+  x8_can_rx_ring_init(&bus->rx);
+
+  return me->buses++;
+}
+
+bool x8_gateway_add(x8_gateway_t *me, x8_can_t *motor, uint8_t bus)
+{
+  if (bus >= me->buses)
+    return false;
+
+  if (!x8_can_registry_add(&me->bus[bus].registry, motor))
+    return false;
+
+  motor->cansend = M_X8_GATEWAY_CANSEND[bus];
+
+  return true;
+}
+
+x8_can_t *x8_gateway_get(x8_gateway_t *me, uint16_t id)
+{
+  if ((id == 0) || (X8_GATEWAY_BUS_OF(id) >= me->buses))
+    return NULL;
+
+  return x8_can_registry_get(&me->bus[X8_GATEWAY_BUS_OF(id)].registry, X8_GATEWAY_MOTOR_ID_OF(id));
+}
+
+void (*x8_gateway_cansend(uint8_t bus)) (uint16_t msg_id, uint8_t *buffer)
+{
+  return (bus < X8_GATEWAY_BUSES) ? M_X8_GATEWAY_CANSEND[bus] : NULL;
+}
+
+bool x8_gateway_start(x8_gateway_t *me)
+{
+  pthread_attr_t attr;
+  int err = 0;
+
+  // Workers see the rings and buses set up before this
+  me->run.store(true, std::memory_order_release);
+
+  for (uint8_t i = 0; i < me->buses; i++)
+  {
+    x8_gateway_bus_t *bus = &me->bus[i];
+
+    err = pthread_attr_init(&attr);
+    if (err == 0)
+    {
+      if (bus->cpu >= 0)
+      {
+        cpu_set_t cpus;
+
+        // Pinned from its first instruction, never runs on another core
+        CPU_ZERO(&cpus);
+        CPU_SET(bus->cpu, &cpus);
+        err = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+      }
+
+      if (err == 0)
+      {
+        err = pthread_create(&bus->thread, &attr, m_x8_gateway_worker, bus);
+      }
+
+      pthread_attr_destroy(&attr);
+    }
+
+    if (err != 0)
+    {
+      // Stop the ones started
+      me->run.store(false, std::memory_order_release);
+      while (i-- > 0)
+      {
+        eventfd_write(me->bus[i].wake_fd, 1);
+        pthread_join(me->bus[i].thread, NULL);
+      }
+
+      errno = err;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void x8_gateway_stop(x8_gateway_t *me)
+{
+  bool running = me->run.exchange(false, std::memory_order_acq_rel);
+
+  for (uint8_t i = 0; i < me->buses; i++)
+  {
+    if (running)
+    {
+      eventfd_write(me->bus[i].wake_fd, 1);
+      pthread_join(me->bus[i].thread, NULL);
+    }
+
+    x8_event_close(&me->bus[i].loop);
+    x8_socketcan_close(&me->bus[i].can);
+    close(me->bus[i].wake_fd);
+  }
+
+  me->buses = 0;
+}
+
+void x8_gateway_flush(x8_gateway_t *me)
+{
+  for (uint8_t i = 0; i < me->buses; i++)
+  {
+    if (x8_can_rx_ring_count(&me->bus[i].tx) != 0)
+    {
+      eventfd_write(me->bus[i].wake_fd, 1);
+    }
+  }
+}
+
+uint32_t x8_gateway_poll(x8_gateway_t *me)
+{
+  x8_can_frame_t *frame;
+  x8_can_t *motor;
+  uint32_t count = 0;
+
+  for (uint8_t i = 0; i < me->buses; i++)
+  {
+    x8_gateway_bus_t *bus = &me->bus[i];
+
+    while ((frame = x8_can_rx_ring_peek(&bus->rx)) != NULL)
+    {
+      motor = x8_can_registry_receive(&bus->registry, frame->msg_id, frame->data);
+      if (me->received != NULL)
+      {
+        me->received(i, motor, frame);
+      }
+
+      x8_can_rx_ring_pop(&bus->rx);
+      count++;
+    }
+  }
+
+  return count;
+}
+
+void x8_gateway_overrun(x8_gateway_t *me, uint8_t bus, uint16_t *tx_overrun, uint16_t *rx_overrun)
+{
+  *tx_overrun = x8_can_rx_ring_overrun(&me->bus[bus].tx);
+  *rx_overrun = x8_can_rx_ring_overrun(&me->bus[bus].rx);
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Worker of a bus
+ *
+ * @param[in]   arg           Pointer to bus
+ *
+ * @attention   Sleeps until a frame comes, x8_gateway_flush wakes it or
+ *              X8_GATEWAY_IDLE_MS passed
+ *
+ * @return      NULL
+ */
+static void *m_x8_gateway_worker(void *arg)
+{
+  x8_gateway_bus_t *bus = (x8_gateway_bus_t *)arg;
+
+  while (m_x8_gateway->run.load(std::memory_order_acquire))
+  {
+    if (x8_event_run(&bus->loop, X8_GATEWAY_IDLE_MS) < 0)
+      break;
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief       Queue the frames received on a bus for the application
+ *
+ * @param[in]   context       Pointer to bus
+ *
+ * @attention   Worker only
+ *
+ * @return      None
+ */
+static void m_x8_gateway_can_ready(void *context)
+{
+  x8_gateway_bus_t *bus = (x8_gateway_bus_t *)context;
+  x8_can_frame_t received[X8_SOCKETCAN_BATCH];
+  x8_can_frame_t *frame;
+  int count;
+
+  do
+  {
+    count = x8_socketcan_receive_batch(&bus->can, received, X8_SOCKETCAN_BATCH);
+
+    for (int i = 0; i < count; i++)
+    {
+      frame = x8_can_rx_ring_claim(&bus->rx);
+      if (frame == NULL)
+        continue;
+
+      *frame = received[i];
+      x8_can_rx_ring_publish(&bus->rx);
+    }
+
+    if (count > 0)
+    {
+      bus->rx_frames.fetch_add(count, std::memory_order_relaxed);
+    }
+  }
+  while (count == X8_SOCKETCAN_BATCH);
+}
+
+/**
+ * @brief       Send the frames the application queued on a bus
+ *
+ * @param[in]   context       Pointer to bus
+ *
+ * @attention   Worker only
+ *
+ * @return      None
+ */
+static void m_x8_gateway_wake(void *context)
+{
+  x8_gateway_bus_t *bus = (x8_gateway_bus_t *)context;
+  x8_can_frame_t *frame;
+  eventfd_t wakes;
+
+  eventfd_read(bus->wake_fd, &wakes);
+
+  while ((frame = x8_can_rx_ring_peek(&bus->tx)) != NULL)
+  {
+    x8_socketcan_queue(&bus->can, frame->msg_id, frame->data);
+    x8_can_rx_ring_pop(&bus->tx);
+  }
+
+  bus->tx_frames.fetch_add(x8_socketcan_flush(&bus->can), std::memory_order_relaxed);
+
+  // Frames the interface did not take stay queued, come back for them
+  if (bus->can.queued != 0)
+  {
+    eventfd_write(bus->wake_fd, 1);
+  }
+}
+
+/**
+ * @brief       Queue a frame for the worker of a bus
+ *
+ * @param[in]   bus           Pointer to bus
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   buffer        Pointer to can data (8 bytes)
+ *
+ * @attention   Application thread only, dropped and counted when the ring is full
+ *
+ * @return      None
+ */
+static void m_x8_gateway_queue(x8_gateway_bus_t *bus, uint16_t msg_id, const uint8_t *buffer)
+{
+  x8_can_frame_t *frame = x8_can_rx_ring_claim(&bus->tx);
+
+  if (frame == NULL)
+    return;
+
+  frame->timestamp_us = x8_socketcan_now_us();
+  frame->msg_id       = msg_id;
+  frame->dlc          = 8;
+  frame->flags        = X8_CAN_FRAME_TX;
+  memcpy(frame->data, buffer, 8);
+
+  x8_can_rx_ring_publish(&bus->tx);
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,218 @@
+/**
+ * @file       x8_gateway.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Motors on several SocketCAN buses, one I/O thread per bus
+ * @note       Every bus has a worker thread, pinned to a core, that alone
+ *             touches its socket. The application thread and the workers
+ *             only share two lock-free rings per bus (x8_can_rx_ring_t,
+ *             single producer, single consumer):
+ *             - tx: filled by x8_can_t::cansend of the motors on the bus,
+ *               sent by the worker after x8_gateway_flush, one sendmmsg
+ *             - rx: filled by the worker, decoded into the motors by
+ *               x8_gateway_poll, one recvmmsg per X8_SOCKETCAN_BATCH frames
+ *             A worker waits on its socket and wake eventfd in one epoll
+ *             set (x8_event.h).
+ *             Buses share nothing else, so the frame rate grows with their
+ *             number as long as there are cores for the workers. The run
+ *             flag is stored with release and loaded with acquire, the frame
+ *             counters are relaxed atomics read for reports only.
+ *             Gateway ids number the motors of all buses: bus b, motor id m
+ *             => X8_GATEWAY_ID(b, m), bus 0 keeps the motor ids.
+ *             One gateway per process, cansend has no context to find it.
+ *             Build with -pthread and host/x8_event.cpp.
+ * @example    x8_gateway_init(&gw, NULL);
+ *             bus = x8_gateway_add_bus(&gw, "can0", 1);
+ *             motor.motor_id = 1;
+ *             x8_gateway_add(&gw, &motor, bus);
+ *             x8_gateway_start(&gw);
+ *             loop: x8_can_send_get_motor_status(&motor); x8_gateway_flush(&gw); x8_gateway_poll(&gw);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_GATEWAY_H
+#define __X8_GATEWAY_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_rx.h"
+#include "x8_socketcan.h"
+#include "x8_event.h"
+
+#include <pthread.h>
+#include <atomic>
+
+/* Public defines ----------------------------------------------------- */
+#define X8_GATEWAY_BUSES                (8)
+#define X8_GATEWAY_IDLE_MS              (10)    // Longest sleep of an idle worker
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Bus and its worker
+ */
+typedef struct
+{
+  x8_socketcan_t     can;                   // Worker only once started
+  int                wake_fd;               // eventfd, written by x8_gateway_flush
+  int                cpu;                   // Core of the worker, -1 => not pinned
+  x8_event_t         loop;                  // Socket and wake_fd, worker only
+  pthread_t          thread;
+  x8_can_registry_t  registry;              // Motors of the bus, application only
+
+  x8_can_rx_ring_t   tx;                    // Application => worker
+  x8_can_rx_ring_t   rx;                    // Worker => application
+
+  std::atomic<uint32_t> tx_frames;          // Written by the worker only
+  std::atomic<uint32_t> rx_frames;
+}
+x8_gateway_bus_t;
+
+/**
+ * @brief Gateway
+ */
+typedef struct
+{
+  // Called by x8_gateway_poll for every frame after decoding, motor NULL if not added
+  void (*received) (uint8_t bus, x8_can_t *motor, const x8_can_frame_t *frame);
+
+  x8_gateway_bus_t   bus[X8_GATEWAY_BUSES];
+  uint8_t            buses;
+  std::atomic<bool>  run;                   // Workers loop while set
+}
+x8_gateway_t;
+
+/* Public macros ------------------------------------------------------ */
+#define X8_GATEWAY_ID(bus, motor_id)    ((uint16_t)((bus) * RMD_X8_MOTOR_ID_MAX + (motor_id)))
+#define X8_GATEWAY_BUS_OF(id)           ((uint8_t)(((id) - 1) / RMD_X8_MOTOR_ID_MAX))
+#define X8_GATEWAY_MOTOR_ID_OF(id)      ((uint8_t)(((id) - 1) % RMD_X8_MOTOR_ID_MAX + 1))
+
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init a gateway without bus
+ *
+ * @param[in]   me            Pointer to gateway
+ * @param[in]   received      Frame callback, NULL => none
+ *
+ * @attention   Only one gateway per process
+ *
+ * @return      None
+ */
+void x8_gateway_init(x8_gateway_t *me, void (*received) (uint8_t bus, x8_can_t *motor, const x8_can_frame_t *frame));
+
+/**
+ * @brief       Open a bus
+ *
+ * @param[in]   me            Pointer to gateway
+ * @param[in]   ifname        Interface name (e.g. "can0")
+ * @param[in]   cpu           Core of its worker, -1 => not pinned
+ *
+ * @attention   Before x8_gateway_start
+ *
+ * @return      Bus index, -1 if it cannot be opened or X8_GATEWAY_BUSES are open
+ */
+int x8_gateway_add_bus(x8_gateway_t *me, const char *ifname, int cpu);
+
+/**
+ * @brief       Attach a motor to a bus
+ *
+ * @param[in]   me            Pointer to gateway
+ * @param[in]   motor         Pointer to can handler, motor_id set
+ * @param[in]   bus           Bus index
+ *
+ * @attention   Sets motor->cansend
+ *
+ * @return      false if the bus does not exist or the motor id is taken on it
+ */
+bool x8_gateway_add(x8_gateway_t *me, x8_can_t *motor, uint8_t bus);
+
+/**
+ * @brief       Motor of a gateway id
+ *
+ * @param[in]   me            Pointer to gateway
+ * @param[in]   id            X8_GATEWAY_ID(bus, motor id)
+ *
+ * @attention   None
+ *
+ * @return      Pointer to can handler, NULL if none
+ */
+x8_can_t *x8_gateway_get(x8_gateway_t *me, uint16_t id);
+
+/**
+ * @brief       x8_can_t::cansend queuing on a bus, for frames of no motor (0x280)
+ *
+ * @param[in]   bus           Bus index
+ *
+ * @attention   None
+ *
+ * @return      CAN send function
+ */
+void (*x8_gateway_cansend(uint8_t bus)) (uint16_t msg_id, uint8_t *buffer);
+
+/**
+ * @brief       Start the workers
+ *
+ * @param[in]   me            Pointer to gateway
+ *
+ * @attention   A worker is pinned before it starts, a core that does not
+ *              exist or is not allowed fails the start
+ *
+ * @return      false if a thread cannot be pinned or created, none is
+ *              running then, errno holds the error
+ */
+bool x8_gateway_start(x8_gateway_t *me);
+
+/**
+ * @brief       Stop the workers and close the buses
+ *
+ * @param[in]   me            Pointer to gateway
+ *
+ * @attention   Frames still queued are dropped
+ *
+ * @return      None
+ */
+void x8_gateway_stop(x8_gateway_t *me);
+
+/**
+ * @brief       Wake the workers of the buses with queued frames
+ *
+ * @param[in]   me            Pointer to gateway
+ *
+ * @attention   Call once per cycle after the sends of the cycle, frames are
+ *              only sent after it
+ *
+ * @return      None
+ */
+void x8_gateway_flush(x8_gateway_t *me);
+
+/**
+ * @brief       Decode the received frames into their motors
+ *
+ * @param[in]   me            Pointer to gateway
+ *
+ * @attention   None
+ *
+ * @return      Number of frames
+ */
+uint32_t x8_gateway_poll(x8_gateway_t *me);
+
+/**
+ * @brief       Frames lost in the rings
+ *
+ * @param[in]   me            Pointer to gateway
+ * @param[in]   bus           Bus index
+ * @param[out]  tx_overrun    Sends dropped because the tx ring was full
+ * @param[out]  rx_overrun    Received frames dropped because the rx ring was full
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_gateway_overrun(x8_gateway_t *me, uint8_t bus, uint16_t *tx_overrun, uint16_t *rx_overrun);
+
+#endif // __X8_GATEWAY_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,226 @@
+/**
+ * @file       x8_record.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Write CAN traffic to a capture file
+ * @note       1. -i: record the frames of a SocketCAN interface until Ctrl-C
+ *                or -n frames. Frames sent by other programs of this host
+ *                are flagged X8_CAN_FRAME_TX.
+ *             2. -t: convert the "X8 ..." lines printed by the RC command of
+ *                the sketch ("-" => stdin), other lines are skipped.
+ *             Usage: x8_record (-i ifname [-n frames] | -t dump) -o capture
+ * @example    ./x8_record -i can0 -o incident.x8c
+ *             ./x8_record -t serial.log -o incident.x8c
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_capture.h"
+#include "x8_socketcan.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Private defines ---------------------------------------------------- */
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static volatile sig_atomic_t m_stop = 0;
+static x8_socketcan_t m_bus;
+static x8_capture_t m_capture;
+
+/* Private function prototypes ---------------------------------------- */
+static void m_signal(int sig);
+static int m_record(const char *ifname, uint32_t frames);
+static int m_convert(const char *dump);
+static bool m_parse(const char *line, x8_can_frame_t *frame);
+
+/* Function definitions ----------------------------------------------- */
+int main(int argc, char **argv)
+{
+  const char *ifname = NULL;
+  const char *dump   = NULL;
+  const char *output = NULL;
+  uint32_t frames    = 0;
+  int opt, ret;
+
+  while ((opt = getopt(argc, argv, "i:n:t:o:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'i': ifname = optarg;                     break;
+    case 'n': frames = (uint32_t)atol(optarg);     break;
+    case 't': dump   = optarg;                     break;
+    case 'o': output = optarg;                     break;
+    default:
+      output = NULL;
+      break;
+    }
+  }
+
+  if ((output == NULL) || ((ifname == NULL) == (dump == NULL)))
+  {
+    fprintf(stderr, "Usage: %s (-i ifname [-n frames] | -t dump) -o capture\n", argv[0]);
+    return 1;
+  }
+
+  if (!x8_capture_create(&m_capture, output))
+  {
+    perror(output);
+    return 1;
+  }
+
+  ret = (ifname != NULL) ? m_record(ifname, frames) : m_convert(dump);
+
+  printf("%u frames written to %s\n", x8_capture_count(&m_capture), output);
+
+  if (!x8_capture_close(&m_capture))
+  {
+    perror(output);
+    return 1;
+  }
+
+  return ret;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Stop recording
+ *
+ * @param[in]   sig           Signal number
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_signal(int sig)
+{
+  (void)sig;
+  m_stop = 1;
+}
+
+/**
+ * @brief       Record the frames of an interface
+ *
+ * @param[in]   ifname        Interface name
+ * @param[in]   frames        Frames to record, 0 => until Ctrl-C
+ *
+ * @attention   None
+ *
+ * @return      Exit code
+ */
+static int m_record(const char *ifname, uint32_t frames)
+{
+  x8_can_frame_t frame;
+  int ret;
+
+  if (!x8_socketcan_open(&m_bus, ifname))
+  {
+    perror(ifname);
+    return 1;
+  }
+
+  signal(SIGINT, m_signal);
+  signal(SIGTERM, m_signal);
+
+  while (!m_stop && ((frames == 0) || (x8_capture_count(&m_capture) < frames)))
+  {
+    // Wake up now and then to see the stop request
+    ret = x8_socketcan_receive(&m_bus, &frame, 100);
+    if (ret < 0)
+      continue;
+
+    if ((ret == 1) && !x8_capture_append(&m_capture, &frame))
+    {
+      perror("Capture full");
+      break;
+    }
+  }
+
+  x8_socketcan_close(&m_bus);
+
+  return 0;
+}
+
+/**
+ * @brief       Convert a recorder dump of the sketch
+ *
+ * @param[in]   dump          Text file path, "-" => stdin
+ *
+ * @attention   None
+ *
+ * @return      Exit code
+ */
+static int m_convert(const char *dump)
+{
+  FILE *file = (strcmp(dump, "-") == 0) ? stdin : fopen(dump, "r");
+  x8_can_frame_t frame;
+  char line[128];
+
+  if (file == NULL)
+  {
+    perror(dump);
+    return 1;
+  }
+
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    if (m_parse(line, &frame) && !x8_capture_append(&m_capture, &frame))
+    {
+      perror("Capture full");
+      break;
+    }
+  }
+
+  if (file != stdin)
+  {
+    fclose(file);
+  }
+
+  return 0;
+}
+
+/**
+ * @brief       Parse a "X8 <time> <id> <flags> <dlc> <data>" line
+ *
+ * @param[in]   line          Text line
+ * @param[out]  frame         Frame
+ *
+ * @attention   None
+ *
+ * @return      false if the line is not a recorded frame
+ */
+static bool m_parse(const char *line, x8_can_frame_t *frame)
+{
+  unsigned int timestamp_us, msg_id, flags, dlc;
+  char data[17];
+
+  if (sscanf(line, "X8 %8x %3x %2x %1x %16[0-9A-Fa-f]",
+             &timestamp_us, &msg_id, &flags, &dlc, data) != 5)
+    return false;
+
+  if ((dlc > sizeof(frame->data)) || (strlen(data) != 2 * sizeof(frame->data)))
+    return false;
+
+  frame->timestamp_us = timestamp_us;
+  frame->msg_id       = (uint16_t)msg_id;
+  frame->flags        = (uint8_t)flags;
+  frame->dlc          = (uint8_t)dlc;
+
+  for (uint8_t i = 0; i < sizeof(frame->data); i++)
+  {
+    char byte[3] = { data[2 * i], data[2 * i + 1], 0 };
+
+    frame->data[i] = (uint8_t)strtoul(byte, NULL, 16);
+  }
+
+  return true;
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,377 @@
+/**
+ * @file       x8_replay.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Play a capture file back
+ * @note       1. Without -i the received frames go through
+ *                x8_can_registry_receive into handlers of motors 1 ... 32,
+ *                the decoded values are printed with -v and the decode time
+ *                per frame is reported.
+ *             2. With -i the frames are sent on a SocketCAN interface, -s
+ *                sends only the frames the recorder sent (X8_CAN_FRAME_TX),
+ *                e.g. to drive x8_emulate or real motors like the recorded
+ *                controller did.
+ *             3. With -b the whole capture is decoded into columns by
+ *                x8_can_batch_decode, the decode time per frame is reported.
+ *             Frames keep their recorded spacing unless -f is given, -r plays
+ *             the capture several times.
+ *             Usage: x8_replay [-i ifname] [-s] [-f] [-v] [-b] [-r repeat] capture
+ * @example    ./x8_replay -v incident.x8c
+ *             ./x8_replay -f -r 100 traffic.x8c
+ *             ./x8_replay -b -r 100 traffic.x8c
+ *             ./x8_replay -i vcan0 -s incident.x8c
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_batch.h"
+#include "x8_capture.h"
+#include "x8_socketcan.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private defines ---------------------------------------------------- */
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static x8_capture_t m_capture;
+static x8_socketcan_t m_bus;
+static x8_can_t m_x8_can[RMD_X8_MOTOR_ID_MAX];
+static x8_can_registry_t m_x8_registry;
+
+/* Private function prototypes ---------------------------------------- */
+static uint64_t m_now_ns(void);
+static void m_sleep_until(uint64_t time_ns);
+static void m_sink_send(uint16_t msg_id, uint8_t *buffer);
+static void m_print(const x8_can_frame_t *frame, x8_can_t *motor);
+static void m_batch(uint32_t repeat);
+
+/* Function definitions ----------------------------------------------- */
+int main(int argc, char **argv)
+{
+  const char *ifname = NULL;
+  bool sent_only     = false;
+  bool fast          = false;
+  bool verbose       = false;
+  bool batch         = false;
+  uint32_t repeat    = 1;
+  uint32_t played = 0, decoded = 0, tx_error = 0;
+  uint64_t start_ns, play_ns, elapsed_ns;
+  uint32_t last_us = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "i:sfvbr:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'i': ifname    = optarg;                     break;
+    case 's': sent_only = true;                       break;
+    case 'f': fast      = true;                       break;
+    case 'v': verbose   = true;                       break;
+    case 'b': batch     = true;                       break;
+    case 'r': repeat    = (uint32_t)atol(optarg);     break;
+    default:
+      optind = argc + 1;
+      break;
+    }
+  }
+
+  if (optind != argc - 1)
+  {
+    fprintf(stderr, "Usage: %s [-i ifname] [-s] [-f] [-v] [-b] [-r repeat] capture\n", argv[0]);
+    return 1;
+  }
+
+  if (!x8_capture_open(&m_capture, argv[optind]))
+  {
+    fprintf(stderr, "%s: not a capture file\n", argv[optind]);
+    return 1;
+  }
+
+  if (batch)
+  {
+    m_batch(repeat);
+    x8_capture_close(&m_capture);
+    return 0;
+  }
+
+  if (ifname != NULL)
+  {
+    if (!x8_socketcan_open(&m_bus, ifname))
+    {
+      perror(ifname);
+      return 1;
+    }
+  }
+  else
+  {
+    x8_can_registry_init(&m_x8_registry);
+
+    for (uint8_t i = 0; i < RMD_X8_MOTOR_ID_MAX; i++)
+    {
+      memset(&m_x8_can[i], 0, sizeof(m_x8_can[i]));
+      m_x8_can[i].cansend  = m_sink_send;
+      m_x8_can[i].motor_id = RMD_X8_MOTOR_ID_MIN + i;
+      x8_can_registry_add(&m_x8_registry, &m_x8_can[i]);
+    }
+  }
+
+  start_ns = m_now_ns();
+  play_ns  = start_ns;
+
+  for (uint32_t r = 0; r < repeat; r++)
+  {
+    uint32_t count = x8_capture_count(&m_capture);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+      const x8_can_frame_t *frame = x8_capture_frame(&m_capture, i);
+      int32_t delta_us = (int32_t)(frame->timestamp_us - last_us);
+      uint8_t data[8];
+
+      // Recorded spacing, wrap safe like the recorded clock. Receive times
+      // come from the interrupt, so a frame may be stamped before the one
+      // recorded ahead of it: it goes out at once.
+      if ((i == 0) || (delta_us > 0))
+      {
+        if (!fast && (i > 0))
+        {
+          play_ns += (uint64_t)delta_us * 1000u;
+          m_sleep_until(play_ns);
+        }
+
+        last_us = frame->timestamp_us;
+      }
+
+      if (ifname != NULL)
+      {
+        if (sent_only && !(frame->flags & X8_CAN_FRAME_TX))
+          continue;
+
+        if (!x8_socketcan_send(&m_bus, frame->msg_id, frame->data))
+        {
+          tx_error++;
+        }
+      }
+      else
+      {
+        x8_can_t *motor;
+
+        // Requests of the recorder are not replies to decode
+        if (frame->flags & X8_CAN_FRAME_TX)
+          continue;
+
+        memcpy(data, frame->data, sizeof(data));
+        motor = x8_can_registry_receive(&m_x8_registry, frame->msg_id, data);
+        if (motor != NULL)
+        {
+          decoded++;
+        }
+
+        if (verbose)
+        {
+          m_print(frame, motor);
+        }
+      }
+
+      played++;
+    }
+
+    play_ns = m_now_ns();
+  }
+
+  elapsed_ns = m_now_ns() - start_ns;
+
+  printf("Frames played : %u in %.3f s\n", played, elapsed_ns / 1e9);
+  if (ifname != NULL)
+  {
+    printf("Send errors   : %u\n", tx_error);
+    x8_socketcan_close(&m_bus);
+  }
+  else
+  {
+    printf("Frames decoded: %u\n", decoded);
+    if (fast && !verbose && (played != 0))
+    {
+      printf("Decode        : %.2f ns/frame\n", (double)elapsed_ns / played);
+    }
+  }
+
+  x8_capture_close(&m_capture);
+
+  return 0;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Monotonic time
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      Time (ns)
+ */
+static uint64_t m_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief       Sleep until a monotonic time
+ *
+ * @param[in]   time_ns       Time (ns)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_sleep_until(uint64_t time_ns)
+{
+  struct timespec ts;
+
+  ts.tv_sec  = (time_t)(time_ns / 1000000000u);
+  ts.tv_nsec = (long)(time_ns % 1000000000u);
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+  {
+  }
+}
+
+/**
+ * @brief       x8_can_t::cansend of the decode handlers, nothing is sent
+ *
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   buffer        Pointer to can data
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_sink_send(uint16_t msg_id, uint8_t *buffer)
+{
+  (void)msg_id;
+  (void)buffer;
+}
+
+/**
+ * @brief       Print a frame and what it decoded to
+ *
+ * @param[in]   frame         Pointer to frame
+ * @param[in]   motor         Handler that decoded it, NULL if none
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_print(const x8_can_frame_t *frame, x8_can_t *motor)
+{
+  printf("%10u %03X %u", frame->timestamp_us, frame->msg_id, frame->dlc);
+  for (uint8_t i = 0; i < sizeof(frame->data); i++)
+  {
+    printf(" %02X", frame->data[i]);
+  }
+
+  if (motor == NULL)
+  {
+    printf("\n");
+    return;
+  }
+
+  switch (frame->data[0])
+  {
+  case RMD_X8_READ_MULTI_TURNS_ANGLE_CMD:
+    printf("  angle %lld\n", (long long)motor->multi_turn_angle);
+    break;
+
+  case RMD_X8_READ_PID_DATA_CMD:
+    printf("  pid %u %u %u %u %u %u\n", motor->pid.angle_kp, motor->pid.angle_ki,
+           motor->pid.speed_kp, motor->pid.speed_ki, motor->pid.torque_kp, motor->pid.torque_ki);
+    break;
+
+  case RMD_X8_READ_MOTOR_STATUS_2_CMD:
+  case RMD_X8_TORQUE_CLOSED_LOOP_CMD:
+  case RMD_X8_SPEED_CLOSED_LOOP_CMD:
+  case RMD_X8_POSITION_CTRL_1_CMD:
+  case RMD_X8_POSITION_CTRL_2_CMD:
+  case RMD_X8_POSITION_CTRL_3_CMD:
+  case RMD_X8_POSITION_CTRL_4_CMD:
+    printf("  temp %d current %d speed %d encoder %u\n", motor->status.temperature,
+           motor->status.torque_current, motor->status.speed, motor->status.encoder);
+    break;
+
+  default:
+    printf("\n");
+    break;
+  }
+}
+
+/**
+ * @brief       Decode the capture into columns and report the time per frame
+ *
+ * @param[in]   repeat        Number of passes
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_batch(uint32_t repeat)
+{
+  uint32_t count = x8_capture_count(&m_capture);
+  uint32_t kinds[X8_CAN_BATCH_ANGLE + 1] = { 0 };
+  x8_can_batch_t out;
+  uint64_t start_ns, elapsed_ns;
+
+  memset(&out, 0, sizeof(out));
+  out.timestamp_us     = (uint32_t *)malloc(count * sizeof(*out.timestamp_us) + 1);
+  out.motor_id         = (uint8_t *)malloc(count * sizeof(*out.motor_id) + 1);
+  out.kind             = (uint8_t *)malloc(count * sizeof(*out.kind) + 1);
+  out.temperature      = (int8_t *)malloc(count * sizeof(*out.temperature) + 1);
+  out.torque_current   = (int16_t *)malloc(count * sizeof(*out.torque_current) + 1);
+  out.speed            = (int16_t *)malloc(count * sizeof(*out.speed) + 1);
+  out.encoder          = (uint16_t *)malloc(count * sizeof(*out.encoder) + 1);
+  out.multi_turn_angle = (int64_t *)malloc(count * sizeof(*out.multi_turn_angle) + 1);
+
+  start_ns = m_now_ns();
+  for (uint32_t r = 0; r < repeat; r++)
+  {
+    x8_can_batch_decode(x8_capture_frame(&m_capture, 0), count, &out);
+  }
+  elapsed_ns = m_now_ns() - start_ns;
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    kinds[out.kind[i]]++;
+  }
+
+  printf("Frames        : %u x %u\n", count, repeat);
+  printf("Status rows   : %u\n", kinds[X8_CAN_BATCH_STATUS]);
+  printf("Angle rows    : %u\n", kinds[X8_CAN_BATCH_ANGLE]);
+  if ((count != 0) && (repeat != 0))
+  {
+    printf("Batch decode  : %.2f ns/frame\n", (double)elapsed_ns / ((double)count * repeat));
+  }
+
+  free(out.timestamp_us);
+  free(out.motor_id);
+  free(out.kind);
+  free(out.temperature);
+  free(out.torque_current);
+  free(out.speed);
+  free(out.encoder);
+  free(out.multi_turn_angle);
+}
+
+/* End of file -------------------------------------------------------- */
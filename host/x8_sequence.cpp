@@ -0,0 +1,167 @@
+/**
+ * @file       x8_sequence.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Concurrent per-motor command sequences as coroutines, one thread
+ * @note       Each sequence, -c times: read PID, write the speed kp back one
+ *             higher, read status, move to a position, sleep 1 ms. -n
+ *             sequences run on every motor at once. Prints sequences done
+ *             and failed, awaited commands per second, timeouts and syscalls.
+ *             Usage: x8_sequence [-n sequences per motor] [-c cycles] <ifname> <first id>-<last id>
+ * @example    ./x8_sequence -n 8 -c 100 vcan0 1-32
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_coro.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* Private defines ---------------------------------------------------- */
+#define X8_SEQUENCE_PER_MOTOR     (1)
+#define X8_SEQUENCE_CYCLES        (10)
+#define X8_SEQUENCE_SPEED_LIMIT   (360)       // dps
+#define X8_SEQUENCE_SLEEP_US      (1000)
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static x8_socketcan_t m_bus;
+static x8_coro_executor_t m_executor;
+static x8_can_t m_x8_can[RMD_X8_MOTOR_ID_MAX];
+static uint32_t m_done = 0;
+static uint32_t m_failed = 0;
+
+/* Private function prototypes ---------------------------------------- */
+static x8_coro_task_t m_sequence(x8_coro_motor_t motor, uint32_t cycles);
+
+/* Function definitions ----------------------------------------------- */
+int main(int argc, char **argv)
+{
+  uint32_t per_motor = X8_SEQUENCE_PER_MOTOR;
+  uint32_t cycles = X8_SEQUENCE_CYCLES;
+  uint32_t start_us, calls;
+  int first_id, last_id, opt;
+  double sec;
+
+  while ((opt = getopt(argc, argv, "n:c:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'n': per_motor = (uint32_t)atol(optarg); break;
+    case 'c': cycles    = (uint32_t)atol(optarg); break;
+    default:
+      optind = argc + 1;
+      break;
+    }
+  }
+
+  if ((optind + 2 != argc) || (sscanf(argv[optind + 1], "%d-%d", &first_id, &last_id) != 2) ||
+      (first_id < RMD_X8_MOTOR_ID_MIN) || (last_id > RMD_X8_MOTOR_ID_MAX) || (first_id > last_id))
+  {
+    fprintf(stderr, "Usage: %s [-n sequences per motor] [-c cycles] <ifname> <first id>-<last id>\n", argv[0]);
+    return 1;
+  }
+
+  if (!x8_socketcan_open(&m_bus, argv[optind]))
+  {
+    perror(argv[optind]);
+    return 1;
+  }
+
+  if (!x8_coro_init(&m_executor, &m_bus))
+  {
+    perror("epoll");
+    return 1;
+  }
+
+  for (int motor_id = first_id; motor_id <= last_id; motor_id++)
+  {
+    x8_can_t *me = &m_x8_can[motor_id - 1];
+
+    me->motor_id = (uint8_t)motor_id;
+    x8_coro_add(&m_executor, me);
+
+    for (uint32_t i = 0; i < per_motor; i++)
+    {
+      x8_coro_spawn(&m_executor, m_sequence(x8_coro_motor(&m_executor, me), cycles));
+    }
+  }
+
+  printf("%u sequences on motors %d ... %d, %u cycles each\n",
+         per_motor * (last_id - first_id + 1), first_id, last_id, cycles);
+
+  start_us = x8_socketcan_now_us();
+  if (!x8_coro_run(&m_executor))
+  {
+    perror("epoll_wait");
+    return 1;
+  }
+
+  sec   = (x8_socketcan_now_us() - start_us) / 1000000.0;
+  calls = m_bus.tx_calls + m_bus.rx_calls + m_executor.loop.waits;
+
+  printf("%u done, %u failed in %.3f s: %.0f commands/s, %u timeouts, %.0f syscalls/s\n",
+         m_done, m_failed, sec, m_executor.replies / sec, m_executor.timeouts, calls / sec);
+
+  x8_coro_close(&m_executor);
+  x8_socketcan_close(&m_bus);
+
+  return (m_failed == 0) ? 0 : 1;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Tune and move one motor
+ *
+ * @param[in]   motor         Motor handle
+ * @param[in]   cycles        Times to run the sequence
+ *
+ * @attention   Arguments by value, they live in the coroutine frame
+ *
+ * @return      Coroutine
+ */
+static x8_coro_task_t m_sequence(x8_coro_motor_t motor, uint32_t cycles)
+{
+  x8_motor_pid_data_t pid;
+  bool ok = true;
+
+  for (uint32_t i = 0; ok && (i < cycles); i++)
+  {
+    ok = co_await motor.read_pid();
+    if (!ok)
+      break;
+
+    pid           = motor.can->pid;
+    pid.speed_kp += 1;
+    ok = co_await motor.write_pid(&pid, false);
+    if (!ok)
+      break;
+
+    ok = co_await motor.read_status();
+    if (!ok)
+      break;
+
+    ok = co_await motor.position((int32_t)(i % 2) * 36000, X8_SEQUENCE_SPEED_LIMIT);
+    if (!ok)
+      break;
+
+    co_await x8_coro_sleep(motor.executor, X8_SEQUENCE_SLEEP_US);
+  }
+
+  if (ok)
+  {
+    m_done++;
+  }
+  else
+  {
+    m_failed++;
+  }
+}
+
+/* End of file -------------------------------------------------------- */
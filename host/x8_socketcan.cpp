@@ -0,0 +1,399 @@
+/**
+ * @file       x8_socketcan.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Linux SocketCAN transport for the x8_can library
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_socketcan.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+/* Private defines ---------------------------------------------------- */
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static x8_socketcan_t *m_x8_socketcan_bound = NULL;
+
+/* Private function prototypes ---------------------------------------- */
+static void m_x8_socketcan_frame(const struct can_frame *can_frame, int msg_flags, x8_can_frame_t *frame);
+static bool m_x8_socketcan_tx_wait(x8_socketcan_t *me, uint32_t start_us);
+
+/* Function definitions ----------------------------------------------- */
+bool x8_socketcan_open(x8_socketcan_t *me, const char *ifname)
+{
+  struct sockaddr_can addr;
+  struct ifreq ifr;
+  struct can_filter filter[2];
+
+  me->fd       = -1;
+  me->tx_error   = 0;
+  me->tx_dropped = 0;
+  me->rx_error = 0;
+  me->tx_calls = 0;
+  me->rx_calls = 0;
+  me->queued   = 0;
+
+  if (strlen(ifname) >= sizeof(ifr.ifr_name))
+    return false;
+
+  me->fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (me->fd < 0)
+    return false;
+
+  // Motor ids 0x140 ... 0x17F and the multi motor command, standard data
+  // frames only: an extended or remote frame with the same low bits is dropped
+  filter[0].can_id   = RMD_X8_CAN_MSG_ID_BASE;
+  filter[0].can_mask = (CAN_SFF_MASK & ~0x3F) | CAN_EFF_FLAG | CAN_RTR_FLAG;
+  filter[1].can_id   = RMD_X8_CAN_MULTI_TORQUE_MSG_ID;
+  filter[1].can_mask = CAN_SFF_MASK | CAN_EFF_FLAG | CAN_RTR_FLAG;
+  if (setsockopt(me->fd, SOL_CAN_RAW, CAN_RAW_FILTER, filter, sizeof(filter)) < 0)
+  {
+    x8_socketcan_close(me);
+    return false;
+  }
+
+  memset(&ifr, 0, sizeof(ifr));
+  strcpy(ifr.ifr_name, ifname);
+  if (ioctl(me->fd, SIOCGIFINDEX, &ifr) < 0)
+  {
+    x8_socketcan_close(me);
+    return false;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.can_family  = AF_CAN;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  if (bind(me->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+  {
+    x8_socketcan_close(me);
+    return false;
+  }
+
+  return true;
+}
+
+void x8_socketcan_close(x8_socketcan_t *me)
+{
+  if (me->fd >= 0)
+  {
+    close(me->fd);
+    me->fd = -1;
+  }
+
+  if (m_x8_socketcan_bound == me)
+  {
+    m_x8_socketcan_bound = NULL;
+  }
+}
+
+bool x8_socketcan_send(x8_socketcan_t *me, uint16_t msg_id, const uint8_t *buffer)
+{
+  struct can_frame frame;
+  uint32_t start_us = x8_socketcan_now_us();
+
+  memset(&frame, 0, sizeof(frame));
+  frame.can_id  = msg_id;
+  frame.can_dlc = 8;
+  memcpy(frame.data, buffer, 8);
+
+  while (true)
+  {
+    me->tx_calls++;
+    if (write(me->fd, &frame, sizeof(frame)) == (ssize_t)sizeof(frame))
+      return true;
+
+    if (errno == EINTR)
+      continue;
+
+    if ((errno != ENOBUFS) && (errno != EAGAIN))
+    {
+      me->tx_error++;
+      return false;
+    }
+
+    if (!m_x8_socketcan_tx_wait(me, start_us))
+    {
+      me->tx_dropped++;
+      return false;
+    }
+  }
+}
+
+void x8_socketcan_queue(x8_socketcan_t *me, uint16_t msg_id, const uint8_t *buffer)
+{
+  x8_can_frame_t *frame;
+
+  if (me->queued >= X8_SOCKETCAN_BATCH)
+  {
+    x8_socketcan_flush(me);
+  }
+
+  // Still full, the interface did not take the frames of the last flush
+  if (me->queued >= X8_SOCKETCAN_BATCH)
+  {
+    me->tx_dropped++;
+    return;
+  }
+
+  frame         = &me->queue[me->queued++];
+  frame->msg_id = msg_id;
+  memcpy(frame->data, buffer, 8);
+}
+
+uint8_t x8_socketcan_flush(x8_socketcan_t *me)
+{
+  struct can_frame can_frame[X8_SOCKETCAN_BATCH];
+  struct iovec iov[X8_SOCKETCAN_BATCH];
+  struct mmsghdr msg[X8_SOCKETCAN_BATCH];
+  uint8_t sent = 0, at = 0;
+  uint32_t start_us = x8_socketcan_now_us();
+  int ret;
+
+  if (me->queued == 0)
+    return 0;
+
+  memset(can_frame, 0, me->queued * sizeof(can_frame[0]));
+  memset(msg, 0, me->queued * sizeof(msg[0]));
+  for (uint8_t i = 0; i < me->queued; i++)
+  {
+    can_frame[i].can_id  = me->queue[i].msg_id;
+    can_frame[i].can_dlc = 8;
+    memcpy(can_frame[i].data, me->queue[i].data, 8);
+
+    iov[i].iov_base           = &can_frame[i];
+    iov[i].iov_len            = sizeof(can_frame[i]);
+    msg[i].msg_hdr.msg_iov    = &iov[i];
+    msg[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  // sendmmsg stops at the first frame refused: on a full interface tx queue
+  // it is tried again and kept for the next flush, else that one is dropped
+  while (at < me->queued)
+  {
+    me->tx_calls++;
+    ret = sendmmsg(me->fd, &msg[at], me->queued - at, 0);
+    if (ret < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      if ((errno == ENOBUFS) || (errno == EAGAIN))
+      {
+        if (m_x8_socketcan_tx_wait(me, start_us))
+          continue;
+
+        break;
+      }
+
+      me->tx_error++;
+      at++;
+      continue;
+    }
+
+    sent += (uint8_t)ret;
+    at   += (uint8_t)ret;
+  }
+
+  // Frames not sent move to the front, in order
+  me->queued -= at;
+  memmove(&me->queue[0], &me->queue[at], me->queued * sizeof(me->queue[0]));
+
+  return sent;
+}
+
+int x8_socketcan_receive(x8_socketcan_t *me, x8_can_frame_t *frame, int timeout_ms)
+{
+  struct can_frame can_frame;
+  struct iovec iov;
+  struct msghdr msg;
+  struct pollfd pfd;
+  ssize_t len;
+  int ret;
+
+  pfd.fd     = me->fd;
+  pfd.events = POLLIN;
+
+  do
+  {
+    ret = poll(&pfd, 1, timeout_ms);
+    me->rx_calls++;
+  }
+  while ((ret < 0) && (errno == EINTR));
+
+  if (ret <= 0)
+    return ret;
+
+  iov.iov_base = &can_frame;
+  iov.iov_len  = sizeof(can_frame);
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov    = &iov;
+  msg.msg_iovlen = 1;
+
+  me->rx_calls++;
+  len = recvmsg(me->fd, &msg, 0);
+  if (len != (ssize_t)sizeof(can_frame))
+  {
+    me->rx_error++;
+    return -1;
+  }
+
+  m_x8_socketcan_frame(&can_frame, msg.msg_flags, frame);
+
+  return 1;
+}
+
+int x8_socketcan_receive_batch(x8_socketcan_t *me, x8_can_frame_t *frame, uint8_t max)
+{
+  struct can_frame can_frame[X8_SOCKETCAN_BATCH];
+  struct iovec iov[X8_SOCKETCAN_BATCH];
+  struct mmsghdr msg[X8_SOCKETCAN_BATCH];
+  int ret, count = 0;
+
+  if (max > X8_SOCKETCAN_BATCH)
+  {
+    max = X8_SOCKETCAN_BATCH;
+  }
+
+  memset(msg, 0, max * sizeof(msg[0]));
+  for (uint8_t i = 0; i < max; i++)
+  {
+    iov[i].iov_base           = &can_frame[i];
+    iov[i].iov_len            = sizeof(can_frame[i]);
+    msg[i].msg_hdr.msg_iov    = &iov[i];
+    msg[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  do
+  {
+    ret = recvmmsg(me->fd, msg, max, MSG_DONTWAIT, NULL);
+    me->rx_calls++;
+  }
+  while ((ret < 0) && (errno == EINTR));
+
+  if (ret < 0)
+  {
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+      return 0;
+
+    me->rx_error++;
+    return -1;
+  }
+
+  for (int i = 0; i < ret; i++)
+  {
+    if (msg[i].msg_len != sizeof(can_frame[i]))
+    {
+      me->rx_error++;
+      continue;
+    }
+
+    m_x8_socketcan_frame(&can_frame[i], msg[i].msg_hdr.msg_flags, &frame[count++]);
+  }
+
+  return count;
+}
+
+void x8_socketcan_bind(x8_socketcan_t *me)
+{
+  m_x8_socketcan_bound = me;
+}
+
+void x8_socketcan_cansend(uint16_t msg_id, uint8_t *buffer)
+{
+  if (m_x8_socketcan_bound != NULL)
+  {
+    x8_socketcan_send(m_x8_socketcan_bound, msg_id, buffer);
+  }
+}
+
+void x8_socketcan_cansend_queued(uint16_t msg_id, uint8_t *buffer)
+{
+  if (m_x8_socketcan_bound != NULL)
+  {
+    x8_socketcan_queue(m_x8_socketcan_bound, msg_id, buffer);
+  }
+}
+
+uint32_t x8_socketcan_now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u);
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Convert a received frame
+ *
+ * @param[in]   can_frame     SocketCAN frame
+ * @param[in]   msg_flags     Flags of its msghdr
+ * @param[out]  frame         Frame, timestamp from x8_socketcan_now_us()
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_socketcan_frame(const struct can_frame *can_frame, int msg_flags, x8_can_frame_t *frame)
+{
+  frame->timestamp_us = x8_socketcan_now_us();
+  frame->msg_id       = (uint16_t)(can_frame->can_id & CAN_SFF_MASK);
+  frame->dlc          = can_frame->can_dlc;
+  frame->flags        = (msg_flags & MSG_DONTROUTE) ? X8_CAN_FRAME_TX : 0;
+  memset(frame->data, 0, sizeof(frame->data));
+  memcpy(frame->data, can_frame->data, can_frame->can_dlc > 8 ? 8 : can_frame->can_dlc);
+}
+
+/**
+ * @brief       Wait before sending again on a full interface tx queue
+ *
+ * @param[in]   me            Pointer to bus
+ * @param[in]   start_us      Time of the first try
+ *
+ * @attention   POLLOUT only covers the socket buffer, ENOBUFS comes from the
+ *              interface queue which poll does not see, so the wait also
+ *              sleeps X8_SOCKETCAN_TX_RETRY_US
+ *
+ * @return      false once X8_SOCKETCAN_TX_WAIT_US passed since start_us
+ */
+static bool m_x8_socketcan_tx_wait(x8_socketcan_t *me, uint32_t start_us)
+{
+  struct pollfd pfd;
+  struct timespec retry;
+  uint32_t waited_us = x8_socketcan_now_us() - start_us;
+
+  if (waited_us >= X8_SOCKETCAN_TX_WAIT_US)
+    return false;
+
+  pfd.fd     = me->fd;
+  pfd.events = POLLOUT;
+  me->tx_calls++;
+  poll(&pfd, 1, (X8_SOCKETCAN_TX_WAIT_US - waited_us + 999) / 1000);
+
+  retry.tv_sec  = 0;
+  retry.tv_nsec = X8_SOCKETCAN_TX_RETRY_US * 1000;
+  nanosleep(&retry, NULL);
+
+  return true;
+}
+
+/* End of file -------------------------------------------------------- */
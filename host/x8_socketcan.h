@@ -0,0 +1,200 @@
+/**
+ * @file       x8_socketcan.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Linux SocketCAN transport for the x8_can library
+ * @note       Works with real interfaces (can0) and virtual ones (vcan0).
+ *             Frames go one syscall each (x8_socketcan_send,
+ *             x8_socketcan_receive) or in batches: x8_socketcan_queue and
+ *             x8_socketcan_cansend_queued collect the frames of a cycle,
+ *             x8_socketcan_flush sends them with one sendmmsg and
+ *             x8_socketcan_receive_batch drains up to X8_SOCKETCAN_BATCH
+ *             frames with one recvmmsg. tx_calls and rx_calls count the
+ *             syscalls either way.
+ * @example    x8_socketcan_open(&bus, "vcan0");
+ *             x8_socketcan_bind(&bus);
+ *             motor.cansend = x8_socketcan_cansend;
+ *             batched: motor.cansend = x8_socketcan_cansend_queued;
+ *                      each cycle: sends, then x8_socketcan_flush(&bus);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_SOCKETCAN_H
+#define __X8_SOCKETCAN_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+
+/* Public defines ----------------------------------------------------- */
+#define X8_SOCKETCAN_BATCH        (64)    // Frames per sendmmsg or recvmmsg
+#define X8_SOCKETCAN_TX_WAIT_US   (10000) // Longest wait for room in the interface tx queue
+#define X8_SOCKETCAN_TX_RETRY_US  (130)   // Wait between tries, about one frame at 1 Mbit/s
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief SocketCAN bus
+ */
+typedef struct
+{
+  int             fd;
+  uint32_t        tx_error;           // Frames the kernel refused
+  uint32_t        tx_dropped;         // Frames given up, interface tx queue full too long
+  uint32_t        rx_error;           // Failed reads
+  uint32_t        tx_calls;           // Send syscalls, poll included
+  uint32_t        rx_calls;           // Receive syscalls, poll included
+
+  x8_can_frame_t  queue[X8_SOCKETCAN_BATCH];  // Frames for x8_socketcan_flush
+  uint8_t         queued;
+}
+x8_socketcan_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Open raw CAN socket on an interface
+ *
+ * @param[in]   me            Pointer to bus
+ * @param[in]   ifname        Interface name (e.g. "can0", "vcan0")
+ *
+ * @attention   Only standard data frames of motor IDs 0x140 ... 0x17F and
+ *              0x280 are received
+ *
+ * @return      true if opened
+ */
+bool x8_socketcan_open(x8_socketcan_t *me, const char *ifname);
+
+/**
+ * @brief       Close socket
+ *
+ * @param[in]   me            Pointer to bus
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_socketcan_close(x8_socketcan_t *me);
+
+/**
+ * @brief       Send a frame of 8 bytes
+ *
+ * @param[in]   me            Pointer to bus
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   buffer        Pointer to can data (8 bytes)
+ *
+ * @attention   CAN_RAW does not block on a full interface tx queue, it
+ *              fails with ENOBUFS. The send is tried again every
+ *              X8_SOCKETCAN_TX_RETRY_US for up to X8_SOCKETCAN_TX_WAIT_US,
+ *              then the frame is counted in tx_dropped. Other failures are
+ *              counted in tx_error.
+ *
+ * @return      true if sent
+ */
+bool x8_socketcan_send(x8_socketcan_t *me, uint16_t msg_id, const uint8_t *buffer);
+
+/**
+ * @brief       Queue a frame for x8_socketcan_flush
+ *
+ * @param[in]   me            Pointer to bus
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   buffer        Pointer to can data (8 bytes)
+ *
+ * @attention   A full queue is flushed first. If the flush leaves it full,
+ *              the frame is counted in tx_dropped and dropped.
+ *
+ * @return      None
+ */
+void x8_socketcan_queue(x8_socketcan_t *me, uint16_t msg_id, const uint8_t *buffer);
+
+/**
+ * @brief       Send the queued frames, X8_SOCKETCAN_BATCH per sendmmsg
+ *
+ * @param[in]   me            Pointer to bus
+ *
+ * @attention   On ENOBUFS the send is tried again as x8_socketcan_send.
+ *              Frames still not sent after X8_SOCKETCAN_TX_WAIT_US stay
+ *              queued, in order, for the next flush. A frame refused for
+ *              another reason is counted in tx_error and dropped.
+ *
+ * @return      Number of frames sent, queued tells how many are left
+ */
+uint8_t x8_socketcan_flush(x8_socketcan_t *me);
+
+/**
+ * @brief       Receive a frame
+ *
+ * @param[in]   me            Pointer to bus
+ * @param[out]  frame         Received frame, timestamp from x8_socketcan_now_us(),
+ *                            X8_CAN_FRAME_TX if another socket of this host sent it
+ * @param[in]   timeout_ms    Time to wait, 0 => do not wait, -1 => forever
+ *
+ * @attention   None
+ *
+ * @return      1 if a frame was received, 0 on timeout, -1 on error
+ */
+int x8_socketcan_receive(x8_socketcan_t *me, x8_can_frame_t *frame, int timeout_ms);
+
+/**
+ * @brief       Receive the frames waiting, without waiting
+ *
+ * @param[in]   me            Pointer to bus
+ * @param[out]  frame         Received frames, as x8_socketcan_receive
+ * @param[in]   max           Size of frame, at most X8_SOCKETCAN_BATCH are taken
+ *
+ * @attention   One recvmmsg, call again while it returns max
+ *
+ * @return      Number of frames, 0 if none waits, -1 on error
+ */
+int x8_socketcan_receive_batch(x8_socketcan_t *me, x8_can_frame_t *frame, uint8_t max);
+
+/**
+ * @brief       Use bus for x8_socketcan_cansend()
+ *
+ * @param[in]   me            Pointer to bus
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_socketcan_bind(x8_socketcan_t *me);
+
+/**
+ * @brief       x8_can_t::cansend sending on the bus given to x8_socketcan_bind()
+ *
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   buffer        Pointer to can data (8 bytes)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_socketcan_cansend(uint16_t msg_id, uint8_t *buffer);
+
+/**
+ * @brief       x8_can_t::cansend queuing on the bus given to x8_socketcan_bind()
+ *
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   buffer        Pointer to can data (8 bytes)
+ *
+ * @attention   Sent by the next x8_socketcan_flush
+ *
+ * @return      None
+ */
+void x8_socketcan_cansend_queued(uint16_t msg_id, uint8_t *buffer);
+
+/**
+ * @brief       Monotonic time
+ *
+ * @param[in]   None
+ *
+ * @attention   Wraps like Arduino micros()
+ *
+ * @return      Time (us)
+ */
+uint32_t x8_socketcan_now_us(void);
+
+#endif // __X8_SOCKETCAN_H
+
+/* End of file -------------------------------------------------------- */
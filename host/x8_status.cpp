@@ -0,0 +1,143 @@
+/**
+ * @file       x8_status.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Read motor status over SocketCAN
+ * @note       Usage: x8_status <ifname> [motor_id ...]
+ * @example    ./x8_status can0 1 2
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_socketcan.h"
+#include "x8_can_request.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Private defines ---------------------------------------------------- */
+#define X8_STATUS_TIMEOUT_US    (100000)
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static x8_socketcan_t m_bus;
+static x8_can_t m_x8_can[RMD_X8_MOTOR_ID_MAX];
+static x8_can_registry_t m_x8_registry;
+static x8_can_request_table_t m_x8_requests;
+
+/* Private function prototypes ---------------------------------------- */
+static uint8_t m_status_request(uint8_t index, uint8_t motor_id);
+static void m_status_done(x8_can_request_t *req, void *context);
+
+/* Function definitions ----------------------------------------------- */
+int main(int argc, char **argv)
+{
+  x8_can_frame_t frame;
+  uint8_t num_of_motors = 0;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <ifname> [motor_id ...]\n", argv[0]);
+    return 1;
+  }
+
+  if (!x8_socketcan_open(&m_bus, argv[1]))
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  x8_socketcan_bind(&m_bus);
+  x8_can_registry_init(&m_x8_registry);
+  x8_can_request_init(&m_x8_requests);
+
+  for (int i = 2; i < argc; i++)
+  {
+    num_of_motors += m_status_request(num_of_motors, (uint8_t)atoi(argv[i]));
+  }
+
+  if (argc == 2)
+  {
+    num_of_motors += m_status_request(num_of_motors, RMD_X8_MOTOR_ID_MIN);
+  }
+
+  while (x8_can_request_pending(&m_x8_requests) != 0)
+  {
+    if (x8_socketcan_receive(&m_bus, &frame, 10) == 1)
+    {
+      x8_can_registry_receive(&m_x8_registry, frame.msg_id, frame.data);
+      x8_can_request_receive(&m_x8_requests, frame.msg_id, frame.data);
+    }
+
+    x8_can_request_expire(&m_x8_requests, x8_socketcan_now_us());
+  }
+
+  x8_socketcan_close(&m_bus);
+
+  return 0;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Register a motor and request its status
+ *
+ * @param[in]   index         Free slot in m_x8_can
+ * @param[in]   motor_id      Motor ID
+ *
+ * @attention   None
+ *
+ * @return      1 if the motor was registered, 0 otherwise
+ */
+static uint8_t m_status_request(uint8_t index, uint8_t motor_id)
+{
+  x8_can_t *me;
+
+  if (index >= RMD_X8_MOTOR_ID_MAX)
+    return 0;
+
+  me           = &m_x8_can[index];
+  me->cansend  = x8_socketcan_cansend;
+  me->motor_id = motor_id;
+
+  if (!x8_can_registry_add(&m_x8_registry, me))
+  {
+    fprintf(stderr, "Invalid motor id %u\n", motor_id);
+    return 0;
+  }
+
+  x8_can_request_send(&m_x8_requests, me, RMD_X8_READ_MOTOR_STATUS_2_CMD,
+                      x8_socketcan_now_us(), X8_STATUS_TIMEOUT_US, m_status_done, me);
+
+  return 1;
+}
+
+/**
+ * @brief       Print status of a motor
+ *
+ * @param[in]   req           Completed request
+ * @param[in]   context       Motor
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_status_done(x8_can_request_t *req, void *context)
+{
+  x8_can_t *me = (x8_can_t *)context;
+
+  if (req->state != X8_CAN_REQUEST_DONE)
+  {
+    printf("Motor %u: timeout\n", me->motor_id);
+    return;
+  }
+
+  printf("Motor %u: temperature %d C, torque current %d, speed %d rpm, encoder %u\n",
+         me->motor_id, me->status.temperature, me->status.torque_current,
+         me->status.speed, me->status.encoder);
+}
+
+/* End of file -------------------------------------------------------- */
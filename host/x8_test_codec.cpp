@@ -0,0 +1,259 @@
+/**
+ * @file       x8_test_codec.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Tests of the compile-time frame layouts (x8_can_codec.h)
+ * @note       Checks the bytes of each encoder against the RMD X8 PRO
+ *             protocol, decodes them back through the field of the layout,
+ *             and decodes replies built by hand. Returns 1 if a check fails.
+ * @example    ./x8_test_codec
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_codec.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines ---------------------------------------------------- */
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+#define CHECK(cond)                                                       \
+  do                                                                      \
+  {                                                                       \
+    m_checks++;                                                           \
+    if (!(cond))                                                          \
+    {                                                                     \
+      m_failed++;                                                         \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    }                                                                     \
+  }                                                                       \
+  while (0)
+
+#define CHECK_BYTES(data, ...)                                            \
+  do                                                                      \
+  {                                                                       \
+    const uint8_t expect[8] = { __VA_ARGS__ };                            \
+    CHECK(memcmp((data), expect, 8) == 0);                                \
+  }                                                                       \
+  while (0)
+
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static uint32_t m_checks = 0;
+static uint32_t m_failed = 0;
+
+/* Private function prototypes ---------------------------------------- */
+static void m_test_commands(void);
+static void m_test_setpoints(void);
+static void m_test_round_trips(void);
+static void m_test_replies(void);
+
+/* Function definitions ----------------------------------------------- */
+int main(void)
+{
+  m_test_commands();
+  m_test_setpoints();
+  m_test_round_trips();
+  m_test_replies();
+
+  printf("x8_test_codec: %u checks, %u failed\n", m_checks, m_failed);
+
+  return (m_failed == 0) ? 0 : 1;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Commands without payload and PID writes
+ *
+ * @param[in]   None
+ *
+ * @attention   Stale bytes in the buffer must be cleared by the encoder
+ *
+ * @return      None
+ */
+static void m_test_commands(void)
+{
+  x8_motor_pid_data_t pid = { 10, 20, 30, 40, 50, 60 };
+  uint8_t data[8];
+
+  memset(data, 0xEE, sizeof(data));
+  x8_can_encode_cmd(data, RMD_X8_READ_MOTOR_STATUS_2_CMD);
+  CHECK_BYTES(data, 0x9C, 0, 0, 0, 0, 0, 0, 0);
+
+  memset(data, 0xEE, sizeof(data));
+  x8_can_layout_motor_stop::encode(data);
+  CHECK_BYTES(data, 0x81, 0, 0, 0, 0, 0, 0, 0);
+
+  memset(data, 0xEE, sizeof(data));
+  x8_can_encode_write_pid_cmd(data, &pid, false);
+  CHECK_BYTES(data, 0x31, 0, 10, 20, 30, 40, 50, 60);
+
+  x8_can_encode_write_pid_cmd(data, &pid, true);
+  CHECK_BYTES(data, 0x32, 0, 10, 20, 30, 40, 50, 60);
+
+  memset(data, 0xEE, sizeof(data));
+  x8_can_encode_acceleration_cmd(data, -2);
+  CHECK_BYTES(data, 0x34, 0, 0, 0, 0xFE, 0xFF, 0xFF, 0xFF);
+
+  x8_can_encode_encoder_offset_cmd(data, 0x1234);
+  CHECK_BYTES(data, 0x91, 0, 0, 0, 0, 0, 0x34, 0x12);
+}
+
+/**
+ * @brief       Control setpoints, scaled and signed
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_test_setpoints(void)
+{
+  const int16_t torque[4] = { 1, -1, 2000, -2000 };
+  uint8_t data[8];
+
+  memset(data, 0xEE, sizeof(data));
+  x8_can_encode_torque_close_loop_cmd(data, -2000);
+  CHECK_BYTES(data, 0xA1, 0, 0, 0, 0x30, 0xF8, 0, 0);
+
+  // 100 rpm => 60000 (0.01 dps)
+  x8_can_encode_speed_close_loop_cmd(data, 100);
+  CHECK_BYTES(data, 0xA2, 0, 0, 0, 0x60, 0xEA, 0, 0);
+
+  x8_can_encode_speed_close_loop_cmd(data, -100);
+  CHECK_BYTES(data, 0xA2, 0, 0, 0, 0xA0, 0x15, 0xFF, 0xFF);
+
+  // 90 degree => 54000 (0.01 degree)
+  x8_can_encode_position_ctrl_1_cmd(data, 90);
+  CHECK_BYTES(data, 0xA3, 0, 0, 0, 0xF0, 0xD2, 0, 0);
+
+  // 100 rpm => 600 dps, above the 16 bit overflow of the old encoder
+  x8_can_encode_position_ctrl_2_cmd(data, 100, -90);
+  CHECK_BYTES(data, 0xA4, 0, 0x58, 0x02, 0x10, 0x2D, 0xFF, 0xFF);
+
+  x8_can_encode_position_ctrl_3_cmd(data, 30, X8_COUNTER_CLOCKWISE);
+  CHECK_BYTES(data, 0xA5, 1, 0, 0, 0x50, 0x46, 0, 0);
+
+  x8_can_encode_position_ctrl_4_cmd(data, 30, 10, X8_CLOCKWISE);
+  CHECK_BYTES(data, 0xA6, 0, 0x3C, 0, 0x50, 0x46, 0, 0);
+
+  // No command byte on 0x280
+  x8_can_encode_multi_torque_cmd(data, torque);
+  CHECK_BYTES(data, 0x01, 0x00, 0xFF, 0xFF, 0xD0, 0x07, 0x30, 0xF8);
+}
+
+/**
+ * @brief       Encode then decode through the fields of each layout
+ *
+ * @param[in]   None
+ *
+ * @attention   Values are whole units, the scales divide them exactly
+ *
+ * @return      None
+ */
+static void m_test_round_trips(void)
+{
+  // Fields of the command layouts
+  typedef x8_can_field<1, 1, false>       dir_t;
+  typedef x8_can_field<2, 2, false, 6>    speed_limited_t;
+  typedef x8_can_field<4, 2, true>        torque_t;
+  typedef x8_can_field<4, 4, true, 600>   speed_t;
+  typedef x8_can_field<4, 4, true, 600>   position_t;
+  typedef x8_can_field<4, 2, false, 600>  position_16_t;
+  uint8_t data[8];
+
+  for (int32_t value = -100000; value <= 100000; value += 997)
+  {
+    x8_can_encode_speed_close_loop_cmd(data, value);
+    CHECK(speed_t::decode(data) == value);
+
+    x8_can_encode_position_ctrl_1_cmd(data, value);
+    CHECK(position_t::decode(data) == value);
+
+    x8_can_encode_acceleration_cmd(data, value * 1000);
+    CHECK(x8_can_layout_acceleration::acceleration::decode(data) == value * 1000);
+  }
+
+  for (int32_t torque = -2000; torque <= 2000; torque += 7)
+  {
+    x8_can_encode_torque_close_loop_cmd(data, (int16_t)torque);
+    CHECK(torque_t::decode(data) == torque);
+  }
+
+  for (uint16_t speed = 0; speed <= 10000; speed += 101)
+  {
+    x8_can_encode_position_ctrl_2_cmd(data, speed, -(int32_t)speed);
+    CHECK(speed_limited_t::decode(data) == speed);
+    CHECK(position_t::decode(data) == -(int32_t)speed);
+  }
+
+  // 0 ... 35999 (0.01 degree of motor shaft)
+  for (uint16_t pos = 0; pos * 600 <= 35999; pos++)
+  {
+    x8_can_encode_position_ctrl_4_cmd(data, pos, 100, X8_COUNTER_CLOCKWISE);
+    CHECK(dir_t::decode(data) == X8_COUNTER_CLOCKWISE);
+    CHECK(speed_limited_t::decode(data) == 100);
+    CHECK(position_16_t::decode(data) == pos);
+  }
+}
+
+/**
+ * @brief       Replies built by hand
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_test_replies(void)
+{
+  x8_motor_status_t status;
+  x8_motor_pid_data_t pid;
+  x8_motor_error_t error;
+  int64_t angle;
+
+  // -5 C, iq -100, 600 dps => 100 rpm, encoder 0xBEEF
+  uint8_t status_2[8] = { 0x9C, 0xFB, 0x9C, 0xFF, 0x58, 0x02, 0xEF, 0xBE };
+  x8_can_get_motor_status(status_2, &status);
+  CHECK(status.temperature == -5);
+  CHECK(status.torque_current == -100);
+  CHECK(status.speed == 100);
+  CHECK(status.encoder == 0xBEEF);
+
+  // Status speed above 546 dps, which overflowed in 16 bits
+  status_2[4] = 0x30;
+  status_2[5] = 0x75;
+  x8_can_get_motor_status(status_2, &status);
+  CHECK(status.speed == 30000 / 6);
+
+  // -1 degree => -600, sign extended from 56 bits
+  uint8_t multi_turn[8] = { 0x92, 0xA8, 0xFD, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  x8_can_get_motor_multi_turn_angle(multi_turn, &angle);
+  CHECK(angle == -1);
+
+  // Largest positive 56 bit angle, byte 7 is not a sign copy
+  uint8_t multi_turn_max[8] = { 0x92, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F };
+  x8_can_get_motor_multi_turn_angle(multi_turn_max, &angle);
+  CHECK(angle == 0x7FFFFFFFFFFFFFLL / 600);
+
+  uint8_t pid_reply[8] = { 0x30, 0, 1, 2, 3, 4, 5, 255 };
+  x8_can_get_pid_data(pid_reply, &pid);
+  CHECK((pid.angle_kp == 1) && (pid.angle_ki == 2) && (pid.speed_kp == 3));
+  CHECK((pid.speed_ki == 4) && (pid.torque_kp == 5) && (pid.torque_ki == 255));
+
+  // 25 C, 24.0 V, under voltage and over temperature
+  uint8_t status_1[8] = { 0x9A, 25, 0, 0xF0, 0x00, 0, 0, 0x09 };
+  x8_can_get_motor_error(status_1, &error);
+  CHECK(error.temperature == 25);
+  CHECK(error.voltage == 240);
+  CHECK(error.error_state == 0x09);
+}
+
+/* End of file -------------------------------------------------------- */
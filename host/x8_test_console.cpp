@@ -0,0 +1,352 @@
+/**
+ * @file       x8_test_console.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Tests of the console dispatch table (x8_console.h)
+ * @note       Builds the table of the sketch codes at compile time, checks
+ *             each code has its own slot, then runs every two character
+ *             code through x8_console_execute: only the codes of the table
+ *             may reach a handler, also those hashed to a taken slot.
+ *             Checks argument parsing and the line reader. Returns 1 if a
+ *             check fails.
+ * @example    ./x8_test_console
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_console.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines ---------------------------------------------------- */
+#define NO_CALL                 (0xFF)
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+#define CHECK(cond)                                                       \
+  do                                                                      \
+  {                                                                       \
+    m_checks++;                                                           \
+    if (!(cond))                                                          \
+    {                                                                     \
+      m_failed++;                                                         \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    }                                                                     \
+  }                                                                       \
+  while (0)
+
+/* Private function prototypes ---------------------------------------- */
+static void m_cmd(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_test_table(void);
+static void m_test_dispatch(void);
+static void m_test_args(void);
+static void m_test_reader(void);
+static x8_console_result_t m_execute(const char *line);
+static x8_console_result_t m_receive(const char *text);
+
+/* Private variables -------------------------------------------------- */
+// Codes of the sketch, param is the index to tell which one ran
+static constexpr x8_console_cmd_t CMD[] X8_PGM =
+{
+  { X8_CONSOLE_CODE('S', 'P'), m_cmd, 0  },
+  { X8_CONSOLE_CODE('T', 'L'), m_cmd, 1  },
+  { X8_CONSOLE_CODE('T', 'R'), m_cmd, 2  },
+  { X8_CONSOLE_CODE('I', 'D'), m_cmd, 3  },
+  { X8_CONSOLE_CODE('T', 'M'), m_cmd, 4  },
+  { X8_CONSOLE_CODE('S', 'T'), m_cmd, 5  },
+  { X8_CONSOLE_CODE('L', 'T'), m_cmd, 6  },
+  { X8_CONSOLE_CODE('R', 'C'), m_cmd, 7  },
+  { X8_CONSOLE_CODE('P', 'R'), m_cmd, 8  },
+  { X8_CONSOLE_CODE('P', 'W'), m_cmd, 9  },
+  { X8_CONSOLE_CODE('A', 'C'), m_cmd, 10 },
+  { X8_CONSOLE_CODE('E', 'O'), m_cmd, 11 },
+  { X8_CONSOLE_CODE('L', 'G'), m_cmd, 12 },
+  { X8_CONSOLE_CODE('C', 'T'), m_cmd, 13 },
+  { X8_CONSOLE_CODE('M', 'Q'), m_cmd, 14 },
+  { X8_CONSOLE_CODE('M', 'T'), m_cmd, 15 },
+  { X8_CONSOLE_CODE('R', 'P'), m_cmd, 16 },
+  { X8_CONSOLE_CODE('R', 'E'), m_cmd, 17 },
+  { X8_CONSOLE_CODE('R', 'T'), m_cmd, 18 },
+  { X8_CONSOLE_CODE('A', 'P'), m_cmd, 19 },
+  { X8_CONSOLE_CODE('A', 'I'), m_cmd, 20 },
+  { X8_CONSOLE_CODE('V', 'P'), m_cmd, 21 },
+  { X8_CONSOLE_CODE('V', 'I'), m_cmd, 22 },
+  { X8_CONSOLE_CODE('T', 'P'), m_cmd, 23 },
+  { X8_CONSOLE_CODE('T', 'I'), m_cmd, 24 }
+};
+
+static constexpr x8_console_table_t TABLE X8_PGM = x8_console_table(CMD);
+
+static_assert(TABLE.mul != 0, "No perfect hash for the sketch codes");
+static_assert((TABLE.mul & 1) == 1, "Multiplier not odd");
+static_assert(TABLE.slot[x8_console_hash(X8_CONSOLE_CODE('S', 'P'), TABLE.mul)] == 0, "SP not in its slot");
+static_assert(TABLE.slot[x8_console_hash(X8_CONSOLE_CODE('T', 'I'), TABLE.mul)] == 24, "TI not in its slot");
+
+// Same code twice, no multiplier can separate them
+static constexpr x8_console_cmd_t CMD_DUP[] =
+{
+  { X8_CONSOLE_CODE('S', 'P'), m_cmd, 0 },
+  { X8_CONSOLE_CODE('T', 'L'), m_cmd, 1 },
+  { X8_CONSOLE_CODE('S', 'P'), m_cmd, 2 }
+};
+
+static_assert(x8_console_table(CMD_DUP).mul == 0, "Duplicate codes given a perfect hash");
+
+static uint32_t m_checks = 0;
+static uint32_t m_failed = 0;
+static uint8_t  m_called;                       // param of the last call, NO_CALL => none
+static int32_t  m_arg[X8_CONSOLE_ARGS];
+static uint8_t  m_argc;
+static x8_console_t m_console;
+
+/* Function definitions ----------------------------------------------- */
+int main(void)
+{
+  x8_console_init(&m_console, &TABLE);
+
+  m_test_table();
+  m_test_dispatch();
+  m_test_args();
+  m_test_reader();
+
+  printf("x8_test_console: %u checks, %u failed\n", m_checks, m_failed);
+
+  return (m_failed == 0) ? 0 : 1;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Handler of every test command, keeps its call
+ *
+ * @param[in]   param         Index of the command
+ * @param[in]   arg           Integers
+ * @param[in]   argc          Number of integers given
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_cmd(uint8_t param, const int32_t *arg, uint8_t argc)
+{
+  m_called = param;
+  m_argc   = argc;
+  memcpy(m_arg, arg, sizeof(m_arg));
+}
+
+/**
+ * @brief       Slots of the table built at compile time
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_test_table(void)
+{
+  uint8_t taken = 0;
+
+  CHECK(TABLE.count == sizeof(CMD) / sizeof(CMD[0]));
+
+  // Each code in its own slot, pointing back at it
+  for (uint8_t i = 0; i < TABLE.count; i++)
+  {
+    CHECK(TABLE.slot[x8_console_hash(CMD[i].code, TABLE.mul)] == i);
+  }
+
+  for (uint8_t s = 0; s < X8_CONSOLE_SLOTS; s++)
+  {
+    if (TABLE.slot[s] != X8_CONSOLE_NO_SLOT)
+    {
+      CHECK(TABLE.slot[s] < TABLE.count);
+      taken++;
+    }
+  }
+
+  CHECK(taken == TABLE.count);
+
+  // No smaller odd multiplier separates the codes
+  for (uint16_t mul = 1; mul < TABLE.mul; mul += 2)
+  {
+    CHECK(!x8_console_is_perfect(CMD, TABLE.count, 0, (uint8_t)mul));
+  }
+}
+
+/**
+ * @brief       Every two character code
+ *
+ * @param[in]   None
+ *
+ * @attention   Codes of the table run their own command, the others none
+ *
+ * @return      None
+ */
+static void m_test_dispatch(void)
+{
+  uint16_t foreign_in_taken_slot = 0;
+  char line[3] = { 0, 0, 0 };
+
+  for (uint16_t a = 0x21; a < 0x7F; a++)
+  {
+    for (uint16_t b = 0x21; b < 0x7F; b++)
+    {
+      uint16_t code = X8_CONSOLE_CODE(a, b);
+      uint8_t index = NO_CALL;
+
+      for (uint8_t i = 0; i < TABLE.count; i++)
+      {
+        if (CMD[i].code == code)
+        {
+          index = i;
+        }
+      }
+
+      line[0] = (char)a;
+      line[1] = (char)b;
+
+      if (index != NO_CALL)
+      {
+        CHECK(m_execute(line) == X8_CONSOLE_DONE);
+        CHECK(m_called == CMD[index].param);
+        CHECK(m_argc == 0);
+      }
+      else
+      {
+        CHECK(m_execute(line) == X8_CONSOLE_UNKNOWN);
+        CHECK(m_called == NO_CALL);
+
+        if (TABLE.slot[x8_console_hash(code, TABLE.mul)] != X8_CONSOLE_NO_SLOT)
+        {
+          foreign_in_taken_slot++;
+        }
+      }
+    }
+  }
+
+  // The compare after the hash was needed
+  CHECK(foreign_in_taken_slot > 0);
+
+  CHECK(m_execute("") == X8_CONSOLE_EMPTY);
+  CHECK(m_execute("S") == X8_CONSOLE_UNKNOWN);
+  CHECK(m_execute("sp") == X8_CONSOLE_UNKNOWN);
+  CHECK(m_called == NO_CALL);
+}
+
+/**
+ * @brief       Integers after the code
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_test_args(void)
+{
+  CHECK(m_execute("PR_100_50_40_30_60_30") == X8_CONSOLE_DONE);
+  CHECK(m_called == 8);
+  CHECK(m_argc == 6);
+  CHECK((m_arg[0] == 100) && (m_arg[1] == 50) && (m_arg[2] == 40));
+  CHECK((m_arg[3] == 30) && (m_arg[4] == 60) && (m_arg[5] == 30));
+
+  // Any run of separators, negative values, missing ones are 0
+  CHECK(m_execute("SP, -7 __,8") == X8_CONSOLE_DONE);
+  CHECK(m_called == 0);
+  CHECK(m_argc == 2);
+  CHECK((m_arg[0] == -7) && (m_arg[1] == 8) && (m_arg[2] == 0));
+
+  CHECK(m_execute("SP___") == X8_CONSOLE_DONE);
+  CHECK(m_argc == 0);
+
+  CHECK(m_execute("SP5") == X8_CONSOLE_BAD_ARG);
+  CHECK(m_execute("SP_5x") == X8_CONSOLE_BAD_ARG);
+  CHECK(m_execute("SP_x") == X8_CONSOLE_BAD_ARG);
+  CHECK(m_execute("SP_-") == X8_CONSOLE_BAD_ARG);
+  CHECK(m_execute("SP_1_2_3_4_5_6_7") == X8_CONSOLE_BAD_ARG);
+  CHECK(m_called == NO_CALL);
+}
+
+/**
+ * @brief       Line reader
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_test_reader(void)
+{
+  char line[X8_CONSOLE_LINE_MAX + 3];
+
+  CHECK(m_receive("TL_42\r\n") == X8_CONSOLE_DONE);
+  CHECK(m_called == 1);
+  CHECK((m_argc == 1) && (m_arg[0] == 42));
+
+  CHECK(m_receive("\r\n") == X8_CONSOLE_EMPTY);
+  CHECK(m_receive("XX_1\n") == X8_CONSOLE_UNKNOWN);
+
+  // X8_CONSOLE_LINE_MAX characters still fit
+  memset(line, ' ', sizeof(line));
+  line[0] = 'T';
+  line[1] = 'R';
+  line[X8_CONSOLE_LINE_MAX - 1] = '9';
+  line[X8_CONSOLE_LINE_MAX]     = '\n';
+  line[X8_CONSOLE_LINE_MAX + 1] = '\0';
+  CHECK(m_receive(line) == X8_CONSOLE_DONE);
+  CHECK((m_called == 2) && (m_argc == 1) && (m_arg[0] == 9));
+
+  // One more is dropped, the next line is read again
+  line[X8_CONSOLE_LINE_MAX]     = '9';
+  line[X8_CONSOLE_LINE_MAX + 1] = '\n';
+  line[X8_CONSOLE_LINE_MAX + 2] = '\0';
+  CHECK(m_receive(line) == X8_CONSOLE_TOO_LONG);
+  CHECK(m_called == NO_CALL);
+
+  CHECK(m_receive("ID_3\n") == X8_CONSOLE_DONE);
+  CHECK((m_called == 3) && (m_arg[0] == 3));
+}
+
+/**
+ * @brief       Run a line
+ *
+ * @param[in]   line          NUL terminated line
+ *
+ * @attention   None
+ *
+ * @return      x8_console_result_t
+ */
+static x8_console_result_t m_execute(const char *line)
+{
+  m_called = NO_CALL;
+
+  return x8_console_execute(&m_console, line);
+}
+
+/**
+ * @brief       Feed characters to the line reader
+ *
+ * @param[in]   text          NUL terminated characters
+ *
+ * @attention   None
+ *
+ * @return      Result of the last character
+ */
+static x8_console_result_t m_receive(const char *text)
+{
+  x8_console_result_t result = X8_CONSOLE_PENDING;
+
+  m_called = NO_CALL;
+
+  for (uint8_t i = 0; text[i] != '\0'; i++)
+  {
+    result = x8_console_receive(&m_console, text[i]);
+  }
+
+  return result;
+}
+
+/* End of file -------------------------------------------------------- */
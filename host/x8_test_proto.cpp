@@ -0,0 +1,702 @@
+/**
+ * @file       x8_test_proto.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Tests of the binary host protocol framing (x8_host_proto.h)
+ * @note       Checks x8_host_proto_pack against a plain COBS encoder and
+ *             CRC-16/CCITT-FALSE written here, then feeds frames to
+ *             x8_host_proto_receive: round trips of every packet type,
+ *             packets of the largest size, and frames with a bad CRC, bad
+ *             COBS, a count above the limit or too many bytes, each followed
+ *             by a good frame the decoder must still take. Returns 1 if a
+ *             check fails.
+ * @example    ./x8_test_proto
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_host_proto.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines ---------------------------------------------------- */
+#define GUARD                   (0xA5)    // Fills the bytes after a frame buffer
+#define GUARD_LEN               (8)
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+#define CHECK(cond)                                                       \
+  do                                                                      \
+  {                                                                       \
+    m_checks++;                                                           \
+    if (!(cond))                                                          \
+    {                                                                     \
+      m_failed++;                                                         \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    }                                                                     \
+  }                                                                       \
+  while (0)
+
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static uint32_t m_checks = 0;
+static uint32_t m_failed = 0;
+
+/* Private function prototypes ---------------------------------------- */
+static void m_test_known_frame(void);
+static void m_test_round_trips(void);
+static void m_test_max_length(void);
+static void m_test_pack_rejects(void);
+static void m_test_receive_rejects(void);
+static void m_test_text(void);
+static void m_check_pack(const x8_host_proto_msg_t *msg);
+static uint8_t m_feed(x8_host_proto_rx_t *rx, const uint8_t *frame, uint16_t len, x8_host_proto_msg_t *msg);
+static uint16_t m_frame_of(const uint8_t *packet, uint8_t len, uint8_t *frame);
+static uint16_t m_crc(const uint8_t *data, uint16_t len);
+static uint16_t m_cobs_encode(const uint8_t *data, uint16_t len, uint8_t *out);
+static uint8_t m_cobs_decode(const uint8_t *data, uint8_t len, uint8_t *out);
+static void m_fill(x8_host_proto_msg_t *msg, uint8_t type, uint8_t seed);
+
+/* Function definitions ----------------------------------------------- */
+int main(void)
+{
+  m_test_known_frame();
+  m_test_round_trips();
+  m_test_max_length();
+  m_test_pack_rejects();
+  m_test_receive_rejects();
+  m_test_text();
+
+  printf("x8_test_proto: %u checks, %u failed\n", m_checks, m_failed);
+
+  return (m_failed == 0) ? 0 : 1;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Bytes of one frame worked out by hand
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_test_known_frame(void)
+{
+  // COMMAND motor 1 MOTOR_OFF: packet 04 01 00, CRC 0x236D
+  const uint8_t expect[] = { 0x00, 0x03, 0x04, 0x01, 0x03, 0x6D, 0x23, 0x00 };
+  const uint8_t check[]  = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+  x8_host_proto_msg_t msg;
+  uint8_t frame[X8_HOST_PROTO_FRAME_MAX];
+  uint8_t len;
+
+  // Check value of CRC-16/CCITT-FALSE
+  CHECK(m_crc(check, sizeof(check)) == 0x29B1);
+
+  memset(&msg, 0, sizeof(msg));
+  msg.type     = X8_HOST_PROTO_COMMAND;
+  msg.motor_id = 1;
+  msg.command  = MOTOR_OFF;
+
+  len = x8_host_proto_pack(&msg, frame);
+  CHECK(len == sizeof(expect));
+  CHECK(memcmp(frame, expect, sizeof(expect)) == 0);
+}
+
+/**
+ * @brief       Pack and receive every packet type
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_test_round_trips(void)
+{
+  const uint8_t types[] =
+  {
+    X8_HOST_PROTO_SPEED, X8_HOST_PROTO_POSITION, X8_HOST_PROTO_TORQUE, X8_HOST_PROTO_COMMAND,
+    X8_HOST_PROTO_SETPOINTS, X8_HOST_PROTO_READ, X8_HOST_PROTO_WAYPOINTS, X8_HOST_PROTO_TRAJECTORY,
+    X8_HOST_PROTO_VALUE, X8_HOST_PROTO_ERROR, X8_HOST_PROTO_LOG, X8_HOST_PROTO_TRAJ_STATE
+  };
+  x8_host_proto_msg_t msg;
+
+  for (uint8_t i = 0; i < sizeof(types); i++)
+  {
+    // Seeds 0 and 255 put runs of 0x00 and 0xFF in the payload
+    for (uint16_t seed = 0; seed < 256; seed += 15)
+    {
+      m_fill(&msg, types[i], (uint8_t)seed);
+      m_check_pack(&msg);
+    }
+  }
+}
+
+/**
+ * @brief       Packets of the largest size of their type
+ *
+ * @param[in]   None
+ *
+ * @attention   SETPOINTS of X8_HOST_PROTO_SETPOINTS_MAX fills the frame buffer
+ *
+ * @return      None
+ */
+static void m_test_max_length(void)
+{
+  x8_host_proto_msg_t msg;
+  uint8_t frame[X8_HOST_PROTO_FRAME_MAX + GUARD_LEN];
+
+  m_fill(&msg, X8_HOST_PROTO_SETPOINTS, 1);
+  msg.setpoints.count = X8_HOST_PROTO_SETPOINTS_MAX;
+
+  memset(frame, GUARD, sizeof(frame));
+  CHECK(x8_host_proto_pack(&msg, frame) == X8_HOST_PROTO_FRAME_MAX);
+  for (uint8_t i = X8_HOST_PROTO_FRAME_MAX; i < sizeof(frame); i++)
+  {
+    CHECK(frame[i] == GUARD);
+  }
+
+  // All zero, one COBS block per byte
+  memset(&msg.setpoints.motor_id, 0, sizeof(msg.setpoints.motor_id));
+  memset(&msg.setpoints.value, 0, sizeof(msg.setpoints.value));
+  m_check_pack(&msg);
+
+  // No zero, one COBS block for the whole packet
+  memset(&msg.setpoints.motor_id, 0x11, sizeof(msg.setpoints.motor_id));
+  memset(&msg.setpoints.value, 0x22, sizeof(msg.setpoints.value));
+  m_check_pack(&msg);
+
+  m_fill(&msg, X8_HOST_PROTO_WAYPOINTS, 7);
+  msg.waypoints.count = X8_HOST_PROTO_WAYPOINTS_MAX;
+  m_check_pack(&msg);
+
+  m_fill(&msg, X8_HOST_PROTO_LOG, 9);
+  msg.log.count = X8_HOST_PROTO_LOG_VALUES;
+  m_check_pack(&msg);
+}
+
+/**
+ * @brief       Packets x8_host_proto_pack must refuse
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_test_pack_rejects(void)
+{
+  x8_host_proto_msg_t msg;
+  uint8_t frame[X8_HOST_PROTO_FRAME_MAX + GUARD_LEN];
+
+  memset(frame, GUARD, sizeof(frame));
+
+  m_fill(&msg, X8_HOST_PROTO_SETPOINTS, 3);
+  msg.setpoints.count = X8_HOST_PROTO_SETPOINTS_MAX + 1;
+  CHECK(x8_host_proto_pack(&msg, frame) == 0);
+
+  m_fill(&msg, X8_HOST_PROTO_WAYPOINTS, 3);
+  msg.waypoints.count = X8_HOST_PROTO_WAYPOINTS_MAX + 1;
+  CHECK(x8_host_proto_pack(&msg, frame) == 0);
+
+  m_fill(&msg, X8_HOST_PROTO_LOG, 3);
+  msg.log.count = X8_HOST_PROTO_LOG_VALUES + 1;
+  CHECK(x8_host_proto_pack(&msg, frame) == 0);
+
+  m_fill(&msg, X8_HOST_PROTO_SPEED, 3);
+  msg.type = 0x7F;
+  CHECK(x8_host_proto_pack(&msg, frame) == 0);
+
+  for (uint8_t i = X8_HOST_PROTO_FRAME_MAX; i < sizeof(frame); i++)
+  {
+    CHECK(frame[i] == GUARD);
+  }
+}
+
+/**
+ * @brief       Frames x8_host_proto_receive must drop, each followed by a good one
+ *
+ * @param[in]   None
+ *
+ * @attention   A dropped frame must not keep the next one from decoding
+ *
+ * @return      None
+ */
+static void m_test_receive_rejects(void)
+{
+  x8_host_proto_rx_t rx;
+  x8_host_proto_msg_t msg, good, out;
+  uint8_t bad[X8_HOST_PROTO_FRAME_MAX];
+  uint8_t good_frame[X8_HOST_PROTO_FRAME_MAX];
+  uint8_t frame[2 * X8_HOST_PROTO_FRAME_MAX];
+  uint8_t packet[2 * X8_HOST_PROTO_PACKET_MAX];
+  uint8_t good_len, len, at;
+  uint16_t frame_len;
+
+  m_fill(&good, X8_HOST_PROTO_SPEED, 42);
+  good_len = x8_host_proto_pack(&good, good_frame);
+
+  x8_host_proto_rx_init(&rx);
+
+  // Bad CRC, every bit of the CRC and of one payload byte
+  m_fill(&msg, X8_HOST_PROTO_TORQUE, 5);
+  len = x8_host_proto_pack(&msg, frame);
+  for (uint8_t bit = 0; bit < 24; bit++)
+  {
+    memcpy(bad, frame, len);
+    at = (uint8_t)(len - 2 - bit / 8);
+    bad[at] ^= (uint8_t)(1 << (bit % 8));
+    if (bad[at] == 0)
+      continue;
+
+    CHECK(m_feed(&rx, bad, len, &out) == 0);
+    CHECK(m_feed(&rx, good_frame, good_len, &out) == 1);
+    CHECK(out.type == X8_HOST_PROTO_SPEED && out.speed == good.speed);
+  }
+
+  // SETPOINTS count above the limit with the bytes for it and a good CRC
+  len = 0;
+  packet[len++] = X8_HOST_PROTO_SETPOINTS;
+  packet[len++] = 1;
+  packet[len++] = X8_HOST_PROTO_SPEED;
+  packet[len++] = X8_HOST_PROTO_SETPOINTS_MAX + 1;
+  for (uint8_t i = 0; i < 5 * (X8_HOST_PROTO_SETPOINTS_MAX + 1); i++)
+  {
+    packet[len++] = (uint8_t)(i + 1);
+  }
+  frame_len = m_frame_of(packet, len, frame);
+  CHECK(frame_len > X8_HOST_PROTO_FRAME_MAX);
+  CHECK(m_feed(&rx, frame, frame_len, &out) == 0);
+  CHECK(m_feed(&rx, good_frame, good_len, &out) == 1);
+
+  // Count above the limit, frame short enough for the buffer
+  packet[3] = X8_HOST_PROTO_SETPOINTS_MAX + 1;
+  frame_len = m_frame_of(packet, 4 + 5 * 2, frame);
+  CHECK(m_feed(&rx, frame, frame_len, &out) == 0);
+  CHECK(m_feed(&rx, good_frame, good_len, &out) == 1);
+
+  // Count not matching the length
+  packet[3] = 3;
+  frame_len = m_frame_of(packet, 4 + 5 * 2, frame);
+  CHECK(m_feed(&rx, frame, frame_len, &out) == 0);
+  CHECK(m_feed(&rx, good_frame, good_len, &out) == 1);
+
+  // Same for LOG and WAYPOINTS
+  len = 0;
+  packet[len++] = X8_HOST_PROTO_LOG;
+  packet[len++] = 0;
+  packet[len++] = 1;
+  packet[len++] = 2;
+  packet[len++] = X8_HOST_PROTO_LOG_VALUES + 1;
+  for (uint8_t i = 0; i < 4 * (X8_HOST_PROTO_LOG_VALUES + 1); i++)
+  {
+    packet[len++] = (uint8_t)(i + 1);
+  }
+  frame_len = m_frame_of(packet, len, frame);
+  CHECK(m_feed(&rx, frame, frame_len, &out) == 0);
+  CHECK(m_feed(&rx, good_frame, good_len, &out) == 1);
+
+  len = 0;
+  packet[len++] = X8_HOST_PROTO_WAYPOINTS;
+  packet[len++] = 1;
+  packet[len++] = X8_HOST_PROTO_WAYPOINTS_MAX + 1;
+  for (uint8_t i = 0; i < 8 * (X8_HOST_PROTO_WAYPOINTS_MAX + 1); i++)
+  {
+    packet[len++] = (uint8_t)(i + 1);
+  }
+  frame_len = m_frame_of(packet, len, frame);
+  CHECK(m_feed(&rx, frame, frame_len, &out) == 0);
+  CHECK(m_feed(&rx, good_frame, good_len, &out) == 1);
+
+  // Fixed size type one byte short and one byte long
+  packet[0] = X8_HOST_PROTO_SPEED;
+  frame_len = m_frame_of(packet, 2 + 3, frame);
+  CHECK(m_feed(&rx, frame, frame_len, &out) == 0);
+  frame_len = m_frame_of(packet, 2 + 5, frame);
+  CHECK(m_feed(&rx, frame, frame_len, &out) == 0);
+  CHECK(m_feed(&rx, good_frame, good_len, &out) == 1);
+
+  // Unknown type
+  packet[0] = 0x7F;
+  frame_len = m_frame_of(packet, 2 + 4, frame);
+  CHECK(m_feed(&rx, frame, frame_len, &out) == 0);
+  CHECK(m_feed(&rx, good_frame, good_len, &out) == 1);
+
+  // COBS code running past the end of the frame
+  memcpy(frame, good_frame, good_len);
+  frame[1] = (uint8_t)(good_len + 5);
+  CHECK(m_feed(&rx, frame, good_len, &out) == 0);
+  CHECK(m_feed(&rx, good_frame, good_len, &out) == 1);
+
+  // Too short for a header and a CRC
+  frame[0] = 0x00;
+  frame[1] = 0x03;
+  frame[2] = 0x04;
+  frame[3] = 0x01;
+  frame[4] = 0x00;
+  CHECK(m_feed(&rx, frame, 5, &out) == 0);
+  CHECK(m_feed(&rx, good_frame, good_len, &out) == 1);
+
+  // Bytes past the buffer, without delimiter
+  memset(frame, 0x55, sizeof(frame));
+  frame[0] = 0x00;
+  frame[sizeof(frame) - 1] = 0x00;
+  CHECK(m_feed(&rx, frame, sizeof(frame), &out) == 0);
+  CHECK(m_feed(&rx, good_frame, good_len, &out) == 1);
+
+  CHECK(rx.errors > 0);
+}
+
+/**
+ * @brief       Text bytes outside frames
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_test_text(void)
+{
+  const char text[] = "Speed: 100\r\n";
+  x8_host_proto_rx_t rx;
+  x8_host_proto_msg_t msg, out;
+  uint8_t frame[X8_HOST_PROTO_FRAME_MAX];
+  uint8_t len;
+
+  x8_host_proto_rx_init(&rx);
+
+  for (uint8_t i = 0; text[i] != '\0'; i++)
+  {
+    CHECK(!x8_host_proto_is_frame_byte(&rx, (uint8_t)text[i]));
+  }
+
+  m_fill(&msg, X8_HOST_PROTO_VALUE, 77);
+  len = x8_host_proto_pack(&msg, frame);
+  CHECK(m_feed(&rx, frame, len, &out) == 1);
+
+  // Back outside the frame after it
+  CHECK(!x8_host_proto_is_frame_byte(&rx, (uint8_t)'S'));
+}
+
+/**
+ * @brief       Pack a packet, compare with the reference encoder, receive it back
+ *
+ * @param[in]   msg           Packet
+ *
+ * @attention   The frame buffer holds stale bytes, the packet is built in it
+ *
+ * @return      None
+ */
+static void m_check_pack(const x8_host_proto_msg_t *msg)
+{
+  x8_host_proto_rx_t rx;
+  x8_host_proto_msg_t out;
+  uint8_t frame[X8_HOST_PROTO_FRAME_MAX + GUARD_LEN];
+  uint8_t again[X8_HOST_PROTO_FRAME_MAX];
+  uint8_t expect[2 * X8_HOST_PROTO_FRAME_MAX];
+  uint8_t packet[X8_HOST_PROTO_FRAME_MAX];
+  uint8_t len, packet_len;
+
+  memset(frame, GUARD, sizeof(frame));
+  len = x8_host_proto_pack(msg, frame);
+  CHECK(len > 0);
+  CHECK(len <= X8_HOST_PROTO_FRAME_MAX);
+
+  // Delimiters only at both ends
+  CHECK(frame[0] == 0x00);
+  CHECK(frame[len - 1] == 0x00);
+  for (uint8_t i = 1; i < len - 1; i++)
+  {
+    CHECK(frame[i] != 0x00);
+  }
+
+  for (uint8_t i = len; i < sizeof(frame); i++)
+  {
+    CHECK(frame[i] == GUARD);
+  }
+
+  // CRC of the packet, then the same bytes as the reference encoder
+  packet_len = m_cobs_decode(&frame[1], len - 2, packet);
+  CHECK(packet_len >= 4);
+  CHECK(packet[0] == msg->type);
+  CHECK(packet[1] == msg->motor_id);
+  CHECK(m_crc(packet, packet_len - 2) == (uint16_t)(packet[packet_len - 2] | (packet[packet_len - 1] << 8)));
+  CHECK(m_frame_of(packet, packet_len - 2, expect) == len);
+  CHECK(memcmp(frame, expect, len) == 0);
+
+  x8_host_proto_rx_init(&rx);
+  CHECK(m_feed(&rx, frame, len, &out) == 1);
+  CHECK(rx.errors == 0);
+
+  // Packed again from the decoded packet, same bytes
+  CHECK(x8_host_proto_pack(&out, again) == len);
+  CHECK(memcmp(again, frame, len) == 0);
+}
+
+/**
+ * @brief       Feed bytes to the decoder
+ *
+ * @param[in]   rx            Pointer to decoder
+ * @param[in]   frame         Bytes
+ * @param[in]   len           Number of bytes
+ * @param[out]  msg           Last decoded packet
+ *
+ * @attention   None
+ *
+ * @return      Number of packets decoded
+ */
+static uint8_t m_feed(x8_host_proto_rx_t *rx, const uint8_t *frame, uint16_t len, x8_host_proto_msg_t *msg)
+{
+  uint8_t count = 0;
+
+  for (uint16_t i = 0; i < len; i++)
+  {
+    if (x8_host_proto_is_frame_byte(rx, frame[i]) && x8_host_proto_receive(rx, frame[i], msg))
+    {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+/**
+ * @brief       Reference frame of a packet: CRC appended, COBS, delimiters
+ *
+ * @param[in]   packet        Header and payload
+ * @param[in]   len           Number of bytes
+ * @param[out]  frame         Frame, up to 2 * X8_HOST_PROTO_FRAME_MAX bytes
+ *
+ * @attention   Builds frames longer than the protocol allows too
+ *
+ * @return      Frame length
+ */
+static uint16_t m_frame_of(const uint8_t *packet, uint8_t len, uint8_t *frame)
+{
+  uint8_t data[2 * X8_HOST_PROTO_PACKET_MAX];
+  uint16_t crc = m_crc(packet, len);
+  uint16_t n;
+
+  memcpy(data, packet, len);
+  data[len]     = (uint8_t)crc;
+  data[len + 1] = (uint8_t)(crc >> 8);
+
+  frame[0] = 0x00;
+  n = 1 + m_cobs_encode(data, len + 2, &frame[1]);
+  frame[n++] = 0x00;
+
+  return n;
+}
+
+/**
+ * @brief       CRC-16/CCITT-FALSE, written from its definition
+ *
+ * @param[in]   data          Pointer to bytes
+ * @param[in]   len           Number of bytes
+ *
+ * @attention   None
+ *
+ * @return      CRC
+ */
+static uint16_t m_crc(const uint8_t *data, uint16_t len)
+{
+  uint16_t crc = 0xFFFF;
+
+  for (uint16_t i = 0; i < len; i++)
+  {
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      bool in  = (data[i] >> (7 - bit)) & 1;
+      bool top = (crc >> 15) & 1;
+
+      crc = (uint16_t)(crc << 1);
+      if (in != top)
+      {
+        crc ^= 0x1021;
+      }
+    }
+  }
+
+  return crc;
+}
+
+/**
+ * @brief       COBS encode into a separate buffer
+ *
+ * @param[in]   data          Pointer to bytes
+ * @param[in]   len           Number of bytes, below 254 per block
+ * @param[out]  out           Encoded bytes, len + 1 of them
+ *
+ * @attention   None
+ *
+ * @return      Encoded length
+ */
+static uint16_t m_cobs_encode(const uint8_t *data, uint16_t len, uint8_t *out)
+{
+  uint16_t code_at = 0, n = 1;
+  uint8_t code = 1;
+
+  for (uint16_t i = 0; i < len; i++)
+  {
+    if (data[i] == 0)
+    {
+      out[code_at] = code;
+      code_at      = n++;
+      code         = 1;
+    }
+    else
+    {
+      out[n++] = data[i];
+      code++;
+    }
+  }
+
+  out[code_at] = code;
+
+  return n;
+}
+
+/**
+ * @brief       COBS decode into a separate buffer
+ *
+ * @param[in]   data          Encoded bytes, without delimiters
+ * @param[in]   len           Number of bytes
+ * @param[out]  out           Decoded bytes
+ *
+ * @attention   Only for frames the encoder made
+ *
+ * @return      Decoded length
+ */
+static uint8_t m_cobs_decode(const uint8_t *data, uint8_t len, uint8_t *out)
+{
+  uint8_t in = 0, n = 0, code;
+
+  while (in < len)
+  {
+    code = data[in++];
+    for (uint8_t i = 1; i < code; i++)
+    {
+      out[n++] = data[in++];
+    }
+
+    if (in < len)
+    {
+      out[n++] = 0;
+    }
+  }
+
+  return n;
+}
+
+/**
+ * @brief       Fill a packet of a type with values from a seed
+ *
+ * @param[out]  msg           Packet
+ * @param[in]   type          x8_host_proto_type_t
+ * @param[in]   seed          0 gives all zero values, 255 all 0xFF bytes
+ *
+ * @attention   Counts are between 1 and their limit
+ *
+ * @return      None
+ */
+static void m_fill(x8_host_proto_msg_t *msg, uint8_t type, uint8_t seed)
+{
+  uint32_t word = (seed == 0xFF) ? 0xFFFFFFFFu : (uint32_t)seed * 0x01010101u ^ 0x00FF00FFu * (seed & 1);
+
+  memset(msg, 0, sizeof(*msg));
+  msg->type     = type;
+  msg->motor_id = seed;
+
+  switch (type)
+  {
+  case X8_HOST_PROTO_SPEED:
+    msg->speed = (int32_t)word;
+    break;
+
+  case X8_HOST_PROTO_POSITION:
+    msg->position.max_speed = (uint16_t)word;
+    msg->position.angle     = (int32_t)~word;
+    break;
+
+  case X8_HOST_PROTO_TORQUE:
+    msg->torque = (int16_t)word;
+    break;
+
+  case X8_HOST_PROTO_COMMAND:
+    msg->command = seed;
+    break;
+
+  case X8_HOST_PROTO_SETPOINTS:
+    msg->setpoints.mode  = X8_HOST_PROTO_POSITION;
+    msg->setpoints.count = 1 + seed % X8_HOST_PROTO_SETPOINTS_MAX;
+    for (uint8_t i = 0; i < msg->setpoints.count; i++)
+    {
+      msg->setpoints.motor_id[i] = (uint8_t)(seed + i);
+      msg->setpoints.value[i]    = (int32_t)(word * (i + 1));
+    }
+    break;
+
+  case X8_HOST_PROTO_READ:
+  case X8_HOST_PROTO_VALUE:
+    msg->read.item = seed % X8_HOST_PROTO_ITEMS;
+    msg->read.tag  = seed;
+    if (type == X8_HOST_PROTO_READ)
+    {
+      msg->read.max_age_ms = (uint16_t)word;
+    }
+    else
+    {
+      msg->read.value = (int64_t)(((uint64_t)word << 32) | (uint32_t)~word);
+    }
+    break;
+
+  case X8_HOST_PROTO_ERROR:
+    msg->error.code = X8_HOST_PROTO_ERR_BUSY;
+    msg->error.tag  = seed;
+    msg->error.type = X8_HOST_PROTO_READ;
+    break;
+
+  case X8_HOST_PROTO_LOG:
+    msg->log.level = seed & 3;
+    msg->log.event = seed;
+    msg->log.count = seed % (X8_HOST_PROTO_LOG_VALUES + 1);
+    for (uint8_t i = 0; i < msg->log.count; i++)
+    {
+      msg->log.value[i] = (int32_t)(word - i);
+    }
+    break;
+
+  case X8_HOST_PROTO_WAYPOINTS:
+    msg->waypoints.count = 1 + seed % X8_HOST_PROTO_WAYPOINTS_MAX;
+    for (uint8_t i = 0; i < msg->waypoints.count; i++)
+    {
+      msg->waypoints.t_ms[i]     = word + 50 * i;
+      msg->waypoints.position[i] = (int32_t)(word ^ i);
+    }
+    break;
+
+  case X8_HOST_PROTO_TRAJECTORY:
+    msg->trajectory.action = seed & 1;
+    msg->trajectory.mode   = seed % 3;
+    msg->trajectory.interp = seed % 2;
+    break;
+
+  case X8_HOST_PROTO_TRAJ_STATE:
+    msg->traj_state.state   = seed % 4;
+    msg->traj_state.space   = (uint16_t)word;
+    msg->traj_state.starved = (uint16_t)(word >> 8);
+    msg->traj_state.missed  = (uint16_t)(word >> 16);
+    break;
+
+  default:
+    break;
+  }
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,502 @@
+/**
+ * @file       x8_uart.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Drive the controller sketch with the binary host protocol
+ * @note       Text the sketch prints between frames and LOG packets go to stderr.
+ *             Usage: x8_uart <tty> [-b baud] <command>
+ *               speed <motor> <speed>
+ *               torque <motor> <iq>
+ *               position <motor> <max speed> <angle>
+ *               off|stop|run <motor>
+ *               read <motor> <item 0 ... 9> [max age ms] cached value up to max age old, else from the motor
+ *               stream <motors> <rate (Hz)> <seconds>    speed setpoints to motors 1 ... n
+ *               trajectory <motor> <amplitude> <seconds> 1 Hz sine of waypoints, cubic
+ * @example    ./x8_uart /dev/ttyACM0 read 1 9
+ *             ./x8_uart /dev/ttyACM0 -b 115200 stream 4 500 10
+ *             ./x8_uart /dev/ttyACM0 trajectory 1 90 10
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_trajectory.h"
+#include "x8_host_proto.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private defines ---------------------------------------------------- */
+#define X8_UART_BAUD              (115200)
+#define X8_UART_READ_TIMEOUT_MS   (1000)
+#define X8_UART_WAYPOINT_MS       (50)      // Waypoint spacing of the trajectory command
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static int m_fd = -1;
+static x8_host_proto_rx_t m_rx;
+
+/* Private function prototypes ---------------------------------------- */
+static bool m_open(const char *path, long baud);
+static bool m_send(const x8_host_proto_msg_t *msg);
+static bool m_receive(x8_host_proto_msg_t *msg, int timeout_ms);
+static int m_read(uint8_t motor_id, uint8_t item, uint16_t max_age_ms);
+static int m_stream(uint8_t motors, uint32_t rate, uint32_t seconds);
+static int m_trajectory(uint8_t motor_id, int32_t amplitude, uint32_t seconds);
+static bool m_trajectory_send(x8_host_proto_msg_t *msg);
+static uint64_t m_now_us(void);
+
+/* Function definitions ----------------------------------------------- */
+int main(int argc, char **argv)
+{
+  x8_host_proto_msg_t msg;
+  long baud = X8_UART_BAUD;
+  const char *cmd;
+  int arg = 2;
+
+  if ((argc > 3) && (strcmp(argv[2], "-b") == 0))
+  {
+    baud = atol(argv[3]);
+    arg  = 4;
+  }
+
+  if (argc < arg + 2)
+  {
+    fprintf(stderr, "Usage: %s <tty> [-b baud] speed|torque|position|off|stop|run|read|stream|trajectory ...\n", argv[0]);
+    return 1;
+  }
+
+  if (!m_open(argv[1], baud))
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  x8_host_proto_rx_init(&m_rx);
+  memset(&msg, 0, sizeof(msg));
+  cmd          = argv[arg];
+  msg.motor_id = (uint8_t)atoi(argv[arg + 1]);
+
+  if ((strcmp(cmd, "speed") == 0) && (argc > arg + 2))
+  {
+    msg.type  = X8_HOST_PROTO_SPEED;
+    msg.speed = (int32_t)atol(argv[arg + 2]);
+  }
+  else if ((strcmp(cmd, "torque") == 0) && (argc > arg + 2))
+  {
+    msg.type   = X8_HOST_PROTO_TORQUE;
+    msg.torque = (int16_t)atoi(argv[arg + 2]);
+  }
+  else if ((strcmp(cmd, "position") == 0) && (argc > arg + 3))
+  {
+    msg.type               = X8_HOST_PROTO_POSITION;
+    msg.position.max_speed = (uint16_t)atoi(argv[arg + 2]);
+    msg.position.angle     = (int32_t)atol(argv[arg + 3]);
+  }
+  else if ((strcmp(cmd, "off") == 0) || (strcmp(cmd, "stop") == 0) || (strcmp(cmd, "run") == 0))
+  {
+    msg.type    = X8_HOST_PROTO_COMMAND;
+    msg.command = (cmd[0] == 'o') ? MOTOR_OFF : ((cmd[1] == 't') ? MOTOR_STOP : MOTOR_RUN);
+  }
+  else if ((strcmp(cmd, "read") == 0) && (argc > arg + 2))
+  {
+    return m_read(msg.motor_id, (uint8_t)atoi(argv[arg + 2]), (argc > arg + 3) ? (uint16_t)atoi(argv[arg + 3]) : 0);
+  }
+  else if ((strcmp(cmd, "stream") == 0) && (argc > arg + 3))
+  {
+    return m_stream(msg.motor_id, (uint32_t)atol(argv[arg + 2]), (uint32_t)atol(argv[arg + 3]));
+  }
+  else if ((strcmp(cmd, "trajectory") == 0) && (argc > arg + 3))
+  {
+    return m_trajectory(msg.motor_id, (int32_t)atol(argv[arg + 2]), (uint32_t)atol(argv[arg + 3]));
+  }
+  else
+  {
+    fprintf(stderr, "Unknown command or missing argument: %s\n", cmd);
+    return 1;
+  }
+
+  if (!m_send(&msg))
+    return 1;
+
+  // Errors come back at once, no answer means the setpoint was queued
+  if (m_receive(&msg, 100) && (msg.type == X8_HOST_PROTO_ERROR))
+  {
+    fprintf(stderr, "Error %u\n", msg.error.code);
+    return 1;
+  }
+
+  return 0;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Open the serial port raw, 8N1
+ *
+ * @param[in]   path          Device path
+ * @param[in]   baud          Baud rate
+ *
+ * @attention   None
+ *
+ * @return      true if opened
+ */
+static bool m_open(const char *path, long baud)
+{
+  static const struct
+  {
+    long    baud;
+    speed_t speed;
+  }
+  M_BAUD[] =
+  {
+    { 9600, B9600 }, { 57600, B57600 }, { 115200, B115200 }, { 230400, B230400 },
+    { 460800, B460800 }, { 500000, B500000 }, { 1000000, B1000000 }, { 2000000, B2000000 }
+  };
+
+  struct termios tio;
+  speed_t speed = 0;
+
+  for (size_t i = 0; i < sizeof(M_BAUD) / sizeof(M_BAUD[0]); i++)
+  {
+    if (M_BAUD[i].baud == baud)
+    {
+      speed = M_BAUD[i].speed;
+    }
+  }
+
+  m_fd = open(path, O_RDWR | O_NOCTTY);
+  if ((m_fd < 0) || (speed == 0) || (tcgetattr(m_fd, &tio) < 0))
+    return false;
+
+  cfmakeraw(&tio);
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  tio.c_cc[VMIN]  = 0;
+  tio.c_cc[VTIME] = 0;
+
+  return tcsetattr(m_fd, TCSANOW, &tio) == 0;
+}
+
+/**
+ * @brief       Send a packet
+ *
+ * @param[in]   msg           Packet
+ *
+ * @attention   None
+ *
+ * @return      true if written
+ */
+static bool m_send(const x8_host_proto_msg_t *msg)
+{
+  uint8_t frame[X8_HOST_PROTO_FRAME_MAX];
+  uint8_t len = x8_host_proto_pack(msg, frame);
+
+  return (len != 0) && (write(m_fd, frame, len) == (ssize_t)len);
+}
+
+/**
+ * @brief       Wait for a packet, text and LOG packets in between go to stderr
+ *
+ * @param[out]  msg           Packet
+ * @param[in]   timeout_ms    Time to wait for each byte
+ *
+ * @attention   None
+ *
+ * @return      true if a packet was received
+ */
+static bool m_receive(x8_host_proto_msg_t *msg, int timeout_ms)
+{
+  struct pollfd pfd;
+  uint8_t byte;
+
+  pfd.fd     = m_fd;
+  pfd.events = POLLIN;
+
+  while ((poll(&pfd, 1, timeout_ms) > 0) && (read(m_fd, &byte, 1) == 1))
+  {
+    if (!x8_host_proto_is_frame_byte(&m_rx, byte))
+    {
+      fputc(byte, stderr);
+      continue;
+    }
+
+    if (!x8_host_proto_receive(&m_rx, byte, msg))
+      continue;
+
+    // Machine mode log records (LG_<level>_1)
+    if (msg->type == X8_HOST_PROTO_LOG)
+    {
+      fprintf(stderr, "log level %u event %u motor %u:", msg->log.level, msg->log.event, msg->motor_id);
+      for (uint8_t i = 0; i < msg->log.count; i++)
+      {
+        fprintf(stderr, " %d", msg->log.value[i]);
+      }
+      fputc('\n', stderr);
+      continue;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief       Read a value and print it
+ *
+ * @param[in]   motor_id      Motor id
+ * @param[in]   item          x8_host_proto_item_t
+ * @param[in]   max_age_ms    Oldest cached value taken (ms), 0 => read the motor
+ *
+ * @attention   None
+ *
+ * @return      Exit code
+ */
+static int m_read(uint8_t motor_id, uint8_t item, uint16_t max_age_ms)
+{
+  x8_host_proto_msg_t msg;
+  uint8_t tag = (uint8_t)getpid();
+
+  memset(&msg, 0, sizeof(msg));
+  msg.type      = X8_HOST_PROTO_READ;
+  msg.motor_id  = motor_id;
+  msg.read.item       = item;
+  msg.read.tag        = tag;
+  msg.read.max_age_ms = max_age_ms;
+
+  if (!m_send(&msg))
+    return 1;
+
+  while (m_receive(&msg, X8_UART_READ_TIMEOUT_MS))
+  {
+    if ((msg.type == X8_HOST_PROTO_VALUE) && (msg.read.tag == tag))
+    {
+      printf("%lld\n", (long long)msg.read.value);
+      return 0;
+    }
+
+    if ((msg.type == X8_HOST_PROTO_ERROR) && (msg.error.tag == tag))
+    {
+      fprintf(stderr, "Error %u\n", msg.error.code);
+      return 1;
+    }
+  }
+
+  fprintf(stderr, "No answer\n");
+
+  return 1;
+}
+
+/**
+ * @brief       Stream speed setpoints, one SETPOINTS packet per period
+ *
+ * @param[in]   motors        Motors 1 ... motors
+ * @param[in]   rate          Packets per second
+ * @param[in]   seconds       Duration
+ *
+ * @attention   Speeds follow a sine of 1 Hz, each motor shifted in phase
+ *
+ * @return      Exit code
+ */
+static int m_stream(uint8_t motors, uint32_t rate, uint32_t seconds)
+{
+  x8_host_proto_msg_t msg, reply;
+  uint64_t start_us, next_us, elapsed_us;
+  uint32_t packets = 0;
+  uint64_t bytes = 0;
+
+  if ((motors < 1) || (motors > X8_HOST_PROTO_SETPOINTS_MAX) || (rate < 1))
+  {
+    fprintf(stderr, "motors 1 ... %d, rate > 0\n", X8_HOST_PROTO_SETPOINTS_MAX);
+    return 1;
+  }
+
+  memset(&msg, 0, sizeof(msg));
+  msg.type            = X8_HOST_PROTO_SETPOINTS;
+  msg.setpoints.mode  = X8_HOST_PROTO_SPEED;
+  msg.setpoints.count = motors;
+
+  start_us = m_now_us();
+  next_us  = start_us;
+
+  while (next_us - start_us < (uint64_t)seconds * 1000000u)
+  {
+    uint8_t frame[X8_HOST_PROTO_FRAME_MAX];
+    double t = (double)(next_us - start_us) / 1e6;
+    uint8_t len;
+
+    for (uint8_t i = 0; i < motors; i++)
+    {
+      msg.setpoints.motor_id[i] = RMD_X8_MOTOR_ID_MIN + i;
+      msg.setpoints.value[i]    = (int32_t)(36000 * sin(2 * M_PI * (t + (double)i / motors)));
+    }
+
+    len = x8_host_proto_pack(&msg, frame);
+    if (write(m_fd, frame, len) != (ssize_t)len)
+    {
+      perror("write");
+      return 1;
+    }
+    packets++;
+    bytes += len;
+
+    // Errors of earlier packets, text goes to stderr
+    while (m_receive(&reply, 0))
+    {
+      if (reply.type == X8_HOST_PROTO_ERROR)
+      {
+        fprintf(stderr, "Error %u\n", reply.error.code);
+      }
+    }
+
+    next_us += 1000000u / rate;
+    while (m_now_us() < next_us)
+    {
+      usleep(100);
+    }
+  }
+
+  tcdrain(m_fd);
+  elapsed_us = m_now_us() - start_us;
+
+  printf("Packets  : %u in %.2f s\n", packets, elapsed_us / 1e6);
+  printf("Setpoints: %.0f /s\n", (double)packets * motors * 1e6 / elapsed_us);
+  printf("Bytes    : %.0f /s\n", (double)bytes * 1e6 / elapsed_us);
+
+  return 0;
+}
+
+/**
+ * @brief       Stream a trajectory, keeping the waypoint buffer of the sketch full
+ *
+ * @param[in]   motor_id      Motor id
+ * @param[in]   amplitude     Amplitude (position unit)
+ * @param[in]   seconds       Duration
+ *
+ * @attention   Position mode, cubic, a sine of 1 Hz. The last waypoint is held.
+ *
+ * @return      Exit code
+ */
+static int m_trajectory(uint8_t motor_id, int32_t amplitude, uint32_t seconds)
+{
+  x8_host_proto_msg_t msg;
+  uint32_t total = seconds * 1000 / X8_UART_WAYPOINT_MS + 1;
+  uint32_t sent = 0;
+  uint16_t space;
+  bool started = false;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.type              = X8_HOST_PROTO_TRAJECTORY;
+  msg.motor_id          = motor_id;
+  msg.trajectory.action = X8_HOST_PROTO_TRAJ_CLEAR;
+  msg.trajectory.mode   = X8_CAN_TRAJECTORY_POSITION;
+  msg.trajectory.interp = X8_CAN_TRAJECTORY_CUBIC;
+
+  if (!m_trajectory_send(&msg))
+    return 1;
+  space = msg.traj_state.space;
+
+  while ((sent < total) || !started)
+  {
+    msg.motor_id = motor_id;
+
+    if (((sent > 1) || (sent == total)) && !started)
+    {
+      // Start once a few waypoints are buffered
+      msg.type              = X8_HOST_PROTO_TRAJECTORY;
+      msg.trajectory.action = X8_HOST_PROTO_TRAJ_START;
+      started               = true;
+    }
+    else
+    {
+      // An empty WAYPOINTS only asks for the state
+      msg.type            = X8_HOST_PROTO_WAYPOINTS;
+      msg.waypoints.count = 0;
+      while ((sent < total) && (msg.waypoints.count < space) &&
+             (msg.waypoints.count < X8_HOST_PROTO_WAYPOINTS_MAX))
+      {
+        uint32_t t_ms = sent * X8_UART_WAYPOINT_MS;
+
+        msg.waypoints.t_ms[msg.waypoints.count]     = t_ms;
+        msg.waypoints.position[msg.waypoints.count] = (int32_t)(amplitude * sin(2 * M_PI * t_ms / 1000.0));
+        msg.waypoints.count++;
+        sent++;
+      }
+
+      if (msg.waypoints.count == 0)
+      {
+        usleep(X8_UART_WAYPOINT_MS * 1000);
+      }
+    }
+
+    if (!m_trajectory_send(&msg))
+      return 1;
+    space = msg.traj_state.space;
+  }
+
+  printf("Waypoints: %u\n", sent);
+  printf("Starved  : %u\n", msg.traj_state.starved);
+  printf("Missed   : %u\n", msg.traj_state.missed);
+
+  return 0;
+}
+
+/**
+ * @brief       Send a WAYPOINTS or TRAJECTORY packet and wait for TRAJ_STATE
+ *
+ * @param[in]   msg           Packet, TRAJ_STATE on return
+ *
+ * @attention   Errors are printed, the state follows them
+ *
+ * @return      true if the state came
+ */
+static bool m_trajectory_send(x8_host_proto_msg_t *msg)
+{
+  if (!m_send(msg))
+    return false;
+
+  while (m_receive(msg, X8_UART_READ_TIMEOUT_MS))
+  {
+    if (msg->type == X8_HOST_PROTO_TRAJ_STATE)
+      return true;
+
+    if (msg->type == X8_HOST_PROTO_ERROR)
+    {
+      fprintf(stderr, "Error %u\n", msg->error.code);
+    }
+  }
+
+  fprintf(stderr, "No answer\n");
+
+  return false;
+}
+
+/**
+ * @brief       Monotonic time
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      Time (us)
+ */
+static uint64_t m_now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/* End of file -------------------------------------------------------- */
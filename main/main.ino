@@ -13,6 +13,21 @@
 
 /* Includes ----------------------------------------------------------- */
 #include "x8_can.h"
+#include "x8_can_request.h"
+#include "x8_can_latency.h"
+#include "x8_can_group.h"
+#include "x8_can_shadow.h"
+#include "x8_can_recorder.h"
+#include "x8_can_rx.h"
+#include "x8_can_stats.h"
+#include "x8_can_telemetry.h"
+#include "x8_can_trajectory.h"
+#include "x8_can_tx.h"
+#include "x8_console.h"
+#include "x8_host_proto.h"
+#include "x8_log.h"
+#include "x8_pgm.h"
+#include "x8_tick.h"
 #include <mcp_can.h>
 #include <SPI.h>
 
@@ -35,67 +50,255 @@
 #define LED3                    (7)
 #define STEP_VALUE              (50)
 #define SPI_CS_PIN              (10)
+#define CAN_INT_PIN             (2)
+#define CAN_RX_BATCH            (8)     // Frames handled per tick
+#define PRINT_LINES_PER_PASS    (2)     // Printout lines queued per loop
+#define CONTROL_TICK_US         (1000)  // Control tick, 1 kHz
+#define CAN_BITRATE             (1000000UL)
+#define CAN_TX_BUF_URGENT       (2)     // MCP2515 sends TXB2 first at equal priority, kept for off and stop
+#define CAN_TX_ABORT_US         (200)   // Longest wait for a frame on the bus to end after an abort
+
+// MCP2515 registers, for aborting TXB0 and TXB1 ahead of an urgent frame
+#define MCP2515_SPI_CLOCK       (10000000UL)
+#define MCP2515_READ            (0x03)
+#define MCP2515_BIT_MODIFY      (0x05)
+#define MCP2515_TXBCTRL(n)      (0x30 + ((n) << 4))
+#define MCP2515_TXBCTRL_TXREQ   (0x08)
+#define MCP2515_TXBCTRL_ABTF    (0x40)
 
 #define RMD_X8_SPEED_LIMITED    (514)
+#define RMD_X8_NUM_OF_MOTORS    (1)     // Motors 1 ... RMD_X8_NUM_OF_MOTORS on the bus
+#define RMD_X8_READ_TIMEOUT_US  (100000)
+#define READ_MAX_AGE_MS         (20)            // Console reads without age print cached values up to this old
+#define SHADOW_EXPIRE_US        (60000000UL)    // Cached values not refreshed for a minute are dropped
+
+// Telemetry, temperature comes with status 2
+#define TELEMETRY_BUDGET        (50)        // Percent of the bus
+#define TELEMETRY_STATUS_US     (2000)      // 500 Hz
+#define TELEMETRY_ANGLE_US      (10000)     // 100 Hz
+#define TELEMETRY_PID_US        (1000000)   // 1 Hz
+#define TELEMETRY_PER_MOTOR     (3)         // Status 2, multi turn angle, PID
 
 /* Private enumerate/structure ---------------------------------------- */
+/**
+ * @brief Value printed when a read reply arrives
+ */
+typedef enum
+{
+  READ_ANGLE_KP,
+  READ_ANGLE_KI,
+  READ_SPEED_KP,
+  READ_SPEED_KI,
+  READ_TORQUE_KP,
+  READ_TORQUE_KI,
+  READ_SPEED,
+  READ_ENCODER,
+  READ_TEMP,
+  READ_MULTI_TURN_ANGLE
+}
+read_item_t;
+
+/**
+ * @brief Read command and label of a read item, in flash
+ */
+typedef struct
+{
+  uint8_t     cmd_byte;
+  const char *label;                    // In flash
+}
+read_request_t;
+
+/**
+ * @brief Printout line builder: the line of the next row from *row on, false when done
+ */
+typedef bool (*print_fn_t) (uint16_t *row, x8_log_line_t *line);
+
+/**
+ * @brief Log events, the id of LOG packets in machine mode
+ */
+typedef enum
+{
+  LOG_CAN_INIT,                 // 1 => ok, 0 => failed
+  LOG_CAN_RX,                   // CAN ID, command byte of a reply completing a read
+  LOG_CAN_OVERRUN,              // Frames lost so far
+  LOG_CONSOLE,                  // Console answer
+  LOG_CONSOLE_ERROR,            // Unknown command, bad argument
+  LOG_READ_BUSY,                // Too many reads waiting
+  LOG_READ_TIMEOUT,             // read_item_t
+  LOG_READ                      // LOG_READ + read_item_t: value
+}
+log_event_t;
+
 /* Private macros ----------------------------------------------------- */
 /* Public variables --------------------------------------------------- */
 /* Private constan ---------------------------------------------------- */
-static const String SET_SPEED_CMD               = "SP";
-static const String CLOCKWISE_CMD               = "TL";
-static const String COUNTER_CLOCKWISE_CMD       = "TR";
-static const String READ_MULTI_TURN_ANGLE_CMD   = "MT";
-
-static const String READ_SPEED_CMD              = "RP";
-static const String READ_ENCODER_CMD            = "RE";
-static const String READ_TEMP_CMD               = "RT";
-
-static const String READ_ANGLE_KP_CMD           = "AP";
-static const String READ_ANGLE_KI_CMD           = "AI";
-static const String READ_SPEED_KP_CMD           = "VP";
-static const String READ_SPEED_KI_CMD           = "VI";
-static const String READ_TORQUE_KP_CMD          = "TP";
-static const String READ_TORQUE_KI_CMD          = "TI";
+static_assert((int)READ_MULTI_TURN_ANGLE == (int)X8_HOST_PROTO_MULTI_TURN_ANGLE, "read_item_t must follow x8_host_proto_item_t");
+static_assert(CONTROL_TICK_US == X8_CAN_TRAJECTORY_PERIOD_US, "Trajectories move one X8_CAN_TRAJECTORY_PERIOD_US per control tick");
+static_assert(RMD_X8_NUM_OF_MOTORS * TELEMETRY_PER_MOTOR <= X8_CAN_TELEMETRY_STREAMS, "X8_CAN_TELEMETRY_STREAMS too small for the motors");
+static_assert(RMD_X8_NUM_OF_MOTORS <= X8_CAN_REGISTRY_MOTORS, "X8_CAN_REGISTRY_MOTORS too small for the motors");
+
+// Labels and table in flash, read with x8_pgm_read_*
+static const char READ_LABEL_ANGLE_KP[]         X8_PGM = "Angle kp  :";
+static const char READ_LABEL_ANGLE_KI[]         X8_PGM = "Angle ki  :";
+static const char READ_LABEL_SPEED_KP[]         X8_PGM = "Speed kp  :";
+static const char READ_LABEL_SPEED_KI[]         X8_PGM = "Speed ki  :";
+static const char READ_LABEL_TORQUE_KP[]        X8_PGM = "Torque kp :";
+static const char READ_LABEL_TORQUE_KI[]        X8_PGM = "Torque ki :";
+static const char READ_LABEL_SPEED[]            X8_PGM = "Speed rpm :";
+static const char READ_LABEL_ENCODER[]          X8_PGM = "Encoder   :";
+static const char READ_LABEL_TEMP[]             X8_PGM = "Temperature:";
+static const char READ_LABEL_MULTI_TURN_ANGLE[] X8_PGM = "Multi turn angle:";
+
+// Indexed by read_item_t and x8_host_proto_item_t
+static const read_request_t READ_REQUEST[] X8_PGM =
+{
+  { RMD_X8_READ_PID_DATA_CMD,          READ_LABEL_ANGLE_KP         },
+  { RMD_X8_READ_PID_DATA_CMD,          READ_LABEL_ANGLE_KI         },
+  { RMD_X8_READ_PID_DATA_CMD,          READ_LABEL_SPEED_KP         },
+  { RMD_X8_READ_PID_DATA_CMD,          READ_LABEL_SPEED_KI         },
+  { RMD_X8_READ_PID_DATA_CMD,          READ_LABEL_TORQUE_KP        },
+  { RMD_X8_READ_PID_DATA_CMD,          READ_LABEL_TORQUE_KI        },
+  { RMD_X8_READ_MOTOR_STATUS_2_CMD,    READ_LABEL_SPEED            },
+  { RMD_X8_READ_MOTOR_STATUS_2_CMD,    READ_LABEL_ENCODER          },
+  { RMD_X8_READ_MOTOR_STATUS_2_CMD,    READ_LABEL_TEMP             },
+  { RMD_X8_READ_MULTI_TURNS_ANGLE_CMD, READ_LABEL_MULTI_TURN_ANGLE }
+};
 
 /* Private variables -------------------------------------------------- */
 MCP_CAN CAN(SPI_CS_PIN);
-static x8_can_t m_x8_can;
+static x8_can_t m_x8_can[RMD_X8_NUM_OF_MOTORS];
+static x8_can_registry_t m_x8_registry;
+static x8_can_request_table_t m_x8_requests;
+static x8_can_rx_ring_t m_can_rx_ring;
+static x8_can_tx_t m_x8_tx;
+static x8_can_tx_entry_t m_can_tx_loaded[CAN_TX_BUF_URGENT];   // Frames handed to TXB0 and TXB1
+static uint8_t m_can_tx_loaded_mask     = 0;              // Bit n => TXBn took m_can_tx_loaded[n]
+static uint8_t m_can_tx_newest          = 0;              // TXBn loaded last
+static x8_can_telemetry_t m_x8_telemetry;
+static x8_can_stats_t m_x8_stats;
+static x8_can_latency_t m_x8_latency;
+static x8_can_shadow_t m_x8_shadow;
+static x8_can_group_t m_x8_group;                          // Motors 1 ... 4, broadcast torque
+#if (X8_CAN_RECORDER_SIZE > 0)
+static x8_can_recorder_t m_x8_recorder;
+#endif
+static x8_can_trajectory_t m_x8_trajectory[RMD_X8_NUM_OF_MOTORS];
+static x8_host_proto_rx_t m_proto_rx;
+static x8_host_proto_msg_t m_proto_msg;
+static uint8_t m_proto_frame[X8_HOST_PROTO_FRAME_MAX];        // Packed by m_proto_send, off the stack of the CAN receive path
+static uint8_t m_proto_tag[X8_CAN_REQUEST_TABLE_SIZE];        // Tag of the host READ waiting in each request slot
+static uint16_t m_can_rx_overrun        = 0;
+static uint32_t m_shadow_expire_us      = 0;
+static x8_can_t *m_x8_motor             = &m_x8_can[0];   // Motor addressed by UART commands
+static x8_console_t m_console;
+static x8_log_t m_log;
+static x8_tick_t m_tick;
+static print_fn_t m_print               = NULL;           // Printout going out, NULL => none
+static uint16_t m_print_row             = 0;
 static long     m_rmd_x8_postion        = 0;
-static String   m_uart_data_receive     = "";
-static String   m_uart_cmd              = "";
-static String   m_uart_data             = "";
-static boolean  m_uart_string_complete  = false;
-static float    m_float_data_value      = 0;
-static float    m_motor_speed           = 10;
-
-static bool     m_get_angle_kp          = false;
-static bool     m_get_angle_ki          = false;
-static bool     m_get_speed_kp          = false;
-static bool     m_get_speed_ki          = false;
-static bool     m_get_torque_kp         = false;
-static bool     m_get_torque_ki         = false;
-
-static bool     m_get_speed             = false;
-static bool     m_get_encoder           = false;
-static bool     m_get_temp              = false;
+static int32_t  m_motor_speed           = 10;
 
 /* Private function prototypes ---------------------------------------- */
 static void uart_receive_and_execute(void);
 static void bsp_x8_can_send(uint16_t msg_id, uint8_t *buffer);
+static bool bsp_x8_can_transmit(uint16_t msg_id, uint8_t *buffer, bool urgent);
+static void m_can_tx_abort(void);
+static uint8_t m_mcp2515_read(uint8_t addr);
+static void m_mcp2515_bit_modify(uint8_t addr, uint8_t mask, uint8_t data);
 static void x8_can_init(void);
 static void btn_check(void);
 static void m_can_receive(void);
+static void m_can_isr(void);
+static void m_cmd_turn(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_cmd_speed(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_cmd_select(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_cmd_telemetry(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_cmd_stats(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_cmd_latency(uint8_t param, const int32_t *arg, uint8_t argc);
+#if (X8_CAN_RECORDER_SIZE > 0)
+static void m_cmd_recorder(uint8_t param, const int32_t *arg, uint8_t argc);
+#endif
+static void m_cmd_read(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_cmd_pid(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_cmd_acceleration(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_cmd_encoder_offset(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_cmd_log(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_cmd_tick(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_cmd_multi_torque(uint8_t param, const int32_t *arg, uint8_t argc);
+static void m_read(read_item_t item, uint32_t max_age_us);
+static void m_read_done(x8_can_request_t *req, void *context);
+static bool m_read_value(x8_can_request_t *req, read_item_t item, int64_t *value);
+static bool m_item_value(const x8_can_t *motor, read_item_t item, int64_t *value);
+static bool m_read_cached(x8_can_t *motor, read_item_t item, uint32_t max_age_us, int64_t *value);
+static void m_proto_execute(x8_host_proto_msg_t *msg);
+static void m_proto_setpoint(uint8_t mode, uint8_t motor_id, int32_t value);
+static void m_proto_read_done(x8_can_request_t *req, void *context);
+static void m_proto_error(uint8_t code, uint8_t tag, uint8_t type);
+static void m_proto_send(const x8_host_proto_msg_t *msg);
+static void m_proto_trajectory(x8_host_proto_msg_t *msg, x8_can_trajectory_t *traj);
+static bool m_print_start(print_fn_t print);
+static void m_print_poll(void);
+static bool m_stats_print(uint16_t *row, x8_log_line_t *line);
+static bool m_latency_print(uint16_t *row, x8_log_line_t *line);
+static bool m_tick_print(uint16_t *row, x8_log_line_t *line);
+static bool m_group_print(uint16_t *row, x8_log_line_t *line);
+static void m_tick_timer_start(void);
+static uint32_t m_micros(void);
+#if (X8_CAN_RECORDER_SIZE > 0)
+static bool m_recorder_print(uint16_t *row, x8_log_line_t *line);
+#endif
+static uint16_t m_log_room(void);
+static void m_log_write(const uint8_t *data, uint16_t len);
+
+// Console commands in flash, after the prototypes of their handlers
+static constexpr x8_console_cmd_t CONSOLE_CMD[] X8_PGM =
+{
+  { X8_CONSOLE_CODE('S', 'P'), m_cmd_speed,           0                     },
+  { X8_CONSOLE_CODE('T', 'L'), m_cmd_turn,            X8_CLOCKWISE          },
+  { X8_CONSOLE_CODE('T', 'R'), m_cmd_turn,            X8_COUNTER_CLOCKWISE  },
+  { X8_CONSOLE_CODE('I', 'D'), m_cmd_select,          0                     },
+  { X8_CONSOLE_CODE('T', 'M'), m_cmd_telemetry,       0                     },
+  { X8_CONSOLE_CODE('S', 'T'), m_cmd_stats,           0                     },
+  { X8_CONSOLE_CODE('L', 'T'), m_cmd_latency,         0                     },
+#if (X8_CAN_RECORDER_SIZE > 0)
+  { X8_CONSOLE_CODE('R', 'C'), m_cmd_recorder,        0                     },
+#endif
+  { X8_CONSOLE_CODE('P', 'R'), m_cmd_pid,             false                 },
+  { X8_CONSOLE_CODE('P', 'W'), m_cmd_pid,             true                  },
+  { X8_CONSOLE_CODE('A', 'C'), m_cmd_acceleration,    0                     },
+  { X8_CONSOLE_CODE('E', 'O'), m_cmd_encoder_offset,  0                     },
+  { X8_CONSOLE_CODE('L', 'G'), m_cmd_log,             0                     },
+  { X8_CONSOLE_CODE('C', 'T'), m_cmd_tick,            0                     },
+  { X8_CONSOLE_CODE('M', 'Q'), m_cmd_multi_torque,    0                     },
+  { X8_CONSOLE_CODE('M', 'T'), m_cmd_read,            READ_MULTI_TURN_ANGLE },
+  { X8_CONSOLE_CODE('R', 'P'), m_cmd_read,            READ_SPEED            },
+  { X8_CONSOLE_CODE('R', 'E'), m_cmd_read,            READ_ENCODER          },
+  { X8_CONSOLE_CODE('R', 'T'), m_cmd_read,            READ_TEMP             },
+  { X8_CONSOLE_CODE('A', 'P'), m_cmd_read,            READ_ANGLE_KP         },
+  { X8_CONSOLE_CODE('A', 'I'), m_cmd_read,            READ_ANGLE_KI         },
+  { X8_CONSOLE_CODE('V', 'P'), m_cmd_read,            READ_SPEED_KP         },
+  { X8_CONSOLE_CODE('V', 'I'), m_cmd_read,            READ_SPEED_KI         },
+  { X8_CONSOLE_CODE('T', 'P'), m_cmd_read,            READ_TORQUE_KP        },
+  { X8_CONSOLE_CODE('T', 'I'), m_cmd_read,            READ_TORQUE_KI        }
+};
+
+static constexpr x8_console_table_t CONSOLE_TABLE X8_PGM = x8_console_table(CONSOLE_CMD);
+
+static_assert(CONSOLE_TABLE.mul != 0, "Console codes without perfect hash, duplicate code or X8_CONSOLE_SLOTS too small");
 
 /* Function definitions ----------------------------------------------- */
 void setup()
 {
   SERIAL.begin(115200);
   delay(1000);
+  x8_log_init(&m_log, m_log_room, m_log_write);
 
   // Init CAN BUS
   x8_can_init();
 
+  x8_tick_init(&m_tick, CONTROL_TICK_US, micros());
+  m_tick_timer_start();
+
   // Pin settings
   pinMode(UP, INPUT);
   pinMode(DOWN, INPUT);
@@ -111,10 +314,38 @@ void setup()
 
 void loop()
 {
-  uart_receive_and_execute();
-  m_can_receive();
+#if !defined(__AVR__)
+  x8_tick_poll(&m_tick, micros());
+#endif
+
+  // Control: replies in, setpoints out, once per tick
+  if (x8_tick_begin(&m_tick, micros()))
+  {
+    m_can_receive();
+    x8_can_request_expire(&m_x8_requests, micros());
+    for (uint8_t i = 0; i < RMD_X8_NUM_OF_MOTORS; i++)
+    {
+      x8_can_trajectory_tick(&m_x8_trajectory[i], m_tick.periods);
+    }
+    x8_can_telemetry_poll(&m_x8_telemetry, micros());
+    x8_can_tx_poll(&m_x8_tx);
+    x8_tick_end(&m_tick, micros());
+  }
 
+  // Background, in the time left. The TX poll sends what did not fit the
+  // MCP2515 buffers at the tick.
+  uart_receive_and_execute();
   btn_check();
+  x8_can_tx_poll(&m_x8_tx);
+  m_print_poll();
+  x8_log_flush(&m_log);
+
+  // Cached values not refreshed are dropped before their age wraps
+  if (micros() - m_shadow_expire_us >= SHADOW_EXPIRE_US)
+  {
+    m_shadow_expire_us += SHADOW_EXPIRE_US;
+    x8_can_shadow_expire(&m_x8_shadow, SHADOW_EXPIRE_US);
+  }
 }
 
 /* Private function definitions --------------------------------------- */
@@ -129,312 +360,1581 @@ void loop()
  */
 static void uart_receive_and_execute(void)
 {
-  while (SERIAL.available()) // Receive data from computer
+  // Receive data from computer, giving way to the control tick
+  while (SERIAL.available() && !x8_tick_pending(&m_tick))
   {
     char data = (char)SERIAL.read();
-    m_uart_data_receive += data;
 
-    if (data == '\n')
+    // Binary frames of the host protocol share the port with the text commands
+    if (x8_host_proto_is_frame_byte(&m_proto_rx, (uint8_t)data))
     {
-      m_uart_string_complete = true;
+      if (x8_host_proto_receive(&m_proto_rx, (uint8_t)data, &m_proto_msg))
+      {
+        m_proto_execute(&m_proto_msg);
+      }
+      continue;
     }
 
-    if (m_uart_string_complete)
+    switch (x8_console_receive(&m_console, data))
     {
-      m_uart_string_complete = false;
-      SERIAL.println(m_uart_data_receive);
+    case X8_CONSOLE_UNKNOWN:
+      X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Unknown command");
+      break;
 
-      m_uart_cmd = m_uart_data_receive.substring(0, 2);
-      m_uart_data = m_uart_data_receive.substring(3);
-      m_float_data_value = m_uart_data.toFloat();
-      SERIAL.println(m_uart_cmd);
-      SERIAL.println(m_uart_data);
-      SERIAL.println(m_float_data_value);
+    case X8_CONSOLE_BAD_ARG:
+      X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Bad argument");
+      break;
 
-      if (CLOCKWISE_CMD == m_uart_cmd)
-      {
-        SERIAL.println("Set motor run clockwise");
-        x8_can_send_position_ctrl_2_cmd(&m_x8_can, (uint16_t)m_motor_speed, m_float_data_value);
-      }
-      else if (COUNTER_CLOCKWISE_CMD == m_uart_cmd)
-      {
-        SERIAL.println("Set motor run counter clockwise");
-        x8_can_send_position_ctrl_2_cmd(&m_x8_can, (uint16_t)m_motor_speed, -(int32_t)m_float_data_value);
-      }
-      else if (SET_SPEED_CMD == m_uart_cmd)
-      {
-        SERIAL.println("Set speed for motor run");
-        m_motor_speed = m_float_data_value;
-        x8_can_send_speed_close_loop_cmd(&m_x8_can, (int32_t)m_motor_speed);
-      } 
-      else if (READ_MULTI_TURN_ANGLE_CMD == m_uart_cmd)
-      {
-        SERIAL.println("Get motor multi turns angle");
-        x8_can_send_get_motor_multi_turn_angle(&m_x8_can);
-      }
-      else if (READ_ANGLE_KP_CMD == m_uart_cmd)
-      {
-        m_get_angle_kp = true;
-        SERIAL.println("Get angle kp");
-        x8_can_send_get_pid_data(&m_x8_can);
-      }
-      else if (READ_ANGLE_KI_CMD == m_uart_cmd)
-      {
-        m_get_angle_ki = true;
-        SERIAL.println("Get angle ki");
-        x8_can_send_get_pid_data(&m_x8_can);
-      }
-      else if (READ_SPEED_KP_CMD == m_uart_cmd)
-      {
-        m_get_speed_kp = true;
-        SERIAL.println("Get speed kp");
-        x8_can_send_get_pid_data(&m_x8_can);
-      }
-      else if (READ_SPEED_KI_CMD == m_uart_cmd)
-      {
-        m_get_speed_ki = true;
-        SERIAL.println("Get speed ki");
-        x8_can_send_get_pid_data(&m_x8_can);
-      }
-      else if (READ_TORQUE_KP_CMD == m_uart_cmd)
-      {
-        m_get_torque_kp = true;
-        SERIAL.println("Get torque kp");
-        x8_can_send_get_pid_data(&m_x8_can);
-      }
-      else if (READ_TORQUE_KI_CMD == m_uart_cmd)
-      {
-        m_get_torque_ki = true;
-        SERIAL.println("Get torque ki");
-        x8_can_send_get_pid_data(&m_x8_can);
-      }
-      else if (READ_SPEED_CMD == m_uart_cmd)
-      {
-        m_get_speed = true;
-        SERIAL.println("Get speed");
-        x8_can_send_get_motor_status(&m_x8_can);
-      }
-      else if (READ_ENCODER_CMD == m_uart_cmd)
-      {
-        m_get_encoder = true;
-        SERIAL.println("Get encoder");
-        x8_can_send_get_motor_status(&m_x8_can);
-      }
-      else if (READ_TEMP_CMD == m_uart_cmd)
-      {
-        m_get_temp = true;
-        SERIAL.println("Get temperature");
-        x8_can_send_get_motor_status(&m_x8_can);
-      }
+    case X8_CONSOLE_TOO_LONG:
+      X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Line too long");
+      break;
 
-      m_uart_data_receive = "";
+    default:
+      break;
     }
   }
 }
 
 /**
- * @brief       CAN receive data
+ * @brief       Console TL, TR: turn to an angle with the speed of SP
  *
- * @param[in]   None
+ * @param[in]   param     X8_CLOCKWISE or X8_COUNTER_CLOCKWISE
+ * @param[in]   arg       Angle (degree)
+ * @param[in]   argc      Number of arguments
  *
  * @attention   None
  *
  * @return      None
  */
-static void m_can_receive(void)
+static void m_cmd_turn(uint8_t param, const int32_t *arg, uint8_t argc)
 {
-  uint8_t can_rx_len = 0;
-  uint8_t can_rx_data[8];
-  int64_t motor_multi_angle = 0;
-  x8_motor_status_t motor_status;
-  x8_motor_pid_data_t motor_pid;
+  (void)argc;
 
-  // Check CAN data comming
-  if (CAN_MSGAVAIL == CAN.checkReceive())
+  if (param == X8_CLOCKWISE)
+  {
+    X8_LOG_INFO(&m_log, LOG_CONSOLE, m_x8_motor->motor_id, "Set motor run clockwise", arg[0]);
+    x8_can_send_position_ctrl_2_cmd(m_x8_motor, (uint16_t)m_motor_speed, arg[0]);
+  }
+  else
   {
-    SERIAL.println("Can msg receive");
+    X8_LOG_INFO(&m_log, LOG_CONSOLE, m_x8_motor->motor_id, "Set motor run counter clockwise", arg[0]);
+    x8_can_send_position_ctrl_2_cmd(m_x8_motor, (uint16_t)m_motor_speed, -arg[0]);
+  }
+}
 
-    // Read data and length
-    CAN.readMsgBuf(&can_rx_len, can_rx_data);
+/**
+ * @brief       Console SP: run at a speed, also the speed limit of TL and TR
+ *
+ * @param[in]   param     Unused
+ * @param[in]   arg       Speed (rpm)
+ * @param[in]   argc      Number of arguments
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_cmd_speed(uint8_t param, const int32_t *arg, uint8_t argc)
+{
+  (void)param;
+  (void)argc;
 
-    switch (can_rx_data[0])
-    {
-    case RMD_X8_READ_MOTOR_STATUS_2_CMD:
-    //  case RMD_X8_TORQUE_CLOSED_LOOP_CMD:
-    //  case RMD_X8_SPEED_CLOSED_LOOP_CMD:
-    // case RMD_X8_POSITION_CTRL_1_CMD:
-    // case RMD_X8_POSITION_CTRL_2_CMD:
-    // case RMD_X8_POSITION_CTRL_3_CMD:
-    // case RMD_X8_POSITION_CTRL_4_CMD:
-    {
-      // Get motor status
-      x8_can_get_motor_status(can_rx_data, &motor_status);
+  m_motor_speed = arg[0];
+  X8_LOG_INFO(&m_log, LOG_CONSOLE, m_x8_motor->motor_id, "Set speed for motor run", m_motor_speed);
+  x8_can_send_speed_close_loop_cmd(m_x8_motor, m_motor_speed);
+}
 
-      if (m_get_temp)
-      {
-       SERIAL.print("Motor temperature: ");
-       SERIAL.println(motor_status.temperature);
-      }
+/**
+ * @brief       Console ID: select the motor of the next commands
+ *
+ * @param[in]   param     Unused
+ * @param[in]   arg       Motor id
+ * @param[in]   argc      Number of arguments
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_cmd_select(uint8_t param, const int32_t *arg, uint8_t argc)
+{
+  x8_can_t *motor = x8_can_registry_get(&m_x8_registry, (uint8_t)arg[0]);
 
-      if (m_get_speed)
-      {
-        SERIAL.print("Motor speed rpm: ");
-        SERIAL.println(motor_status.speed);
-      }
+  (void)param;
+  (void)argc;
 
-      if (m_get_encoder)
-      {
-        SERIAL.print("Motor encoder: ");
-        SERIAL.println(motor_status.encoder);
-      }
-      m_get_temp    = false;
-      m_get_speed   = false;
-      m_get_encoder = false;
+  if (motor == NULL)
+  {
+    X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Motor not found", arg[0]);
+    return;
+  }
 
-      break;
-    }
+  m_x8_motor = motor;
+  X8_LOG_INFO(&m_log, LOG_CONSOLE, m_x8_motor->motor_id, "Selected");
+}
 
-    case RMD_X8_READ_MULTI_TURNS_ANGLE_CMD:
-    {
-      x8_can_get_motor_multi_turn_angle(can_rx_data, &motor_multi_angle);
-      SERIAL.print("Motor multi turn angle:");
-      SERIAL.println((int)motor_multi_angle);
-      break;
-    }
+/**
+ * @brief       Console TM: start (TM_1) or stop (TM_0) telemetry reads
+ *
+ * @param[in]   param     Unused
+ * @param[in]   arg       0 => stop
+ * @param[in]   argc      Number of arguments
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_cmd_telemetry(uint8_t param, const int32_t *arg, uint8_t argc)
+{
+  (void)param;
+  (void)argc;
 
-    case RMD_X8_READ_PID_DATA_CMD:
-    {
-      x8_can_get_pid_data(can_rx_data, &motor_pid);
+  if (arg[0] != 0)
+  {
+    X8_LOG_INFO(&m_log, LOG_CONSOLE, 0, "Telemetry on");
+    x8_can_telemetry_start(&m_x8_telemetry, micros());
+  }
+  else
+  {
+    X8_LOG_INFO(&m_log, LOG_CONSOLE, 0, "Telemetry off");
+    x8_can_telemetry_stop(&m_x8_telemetry);
+  }
+}
 
-      if (m_get_angle_kp)
-      {
-        SERIAL.print("Angle kp  :");
-        SERIAL.println(motor_pid.angle_kp);
-      }
+/**
+ * @brief       Console ST: print frame rates
+ *
+ * @param[in]   param     Unused
+ * @param[in]   arg       Unused
+ * @param[in]   argc      Unused
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_cmd_stats(uint8_t param, const int32_t *arg, uint8_t argc)
+{
+  (void)param;
+  (void)arg;
+  (void)argc;
 
-      if (m_get_angle_ki)
-      {
-        SERIAL.print("Angle ki  :");
-        SERIAL.println(motor_pid.angle_ki);
-      }
+  m_print_start(m_stats_print);
+}
 
-      if (m_get_speed_kp)
-      {
-        SERIAL.print("Speed kp  :");
-        SERIAL.println(motor_pid.speed_kp);
-      }
+/**
+ * @brief       Console LT: print read latency
+ *
+ * @param[in]   param     Unused
+ * @param[in]   arg       Unused
+ * @param[in]   argc      Unused
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_cmd_latency(uint8_t param, const int32_t *arg, uint8_t argc)
+{
+  (void)param;
+  (void)arg;
+  (void)argc;
 
-      if (m_get_speed_ki)
-      {
-        SERIAL.print("Speed ki  :");
-        SERIAL.println(motor_pid.speed_ki);
-      }
+  m_print_start(m_latency_print);
+}
 
-      if (m_get_torque_kp)
-      {
-        SERIAL.print("Torque kp :");
-        SERIAL.println(motor_pid.torque_kp);
-      }
+#if (X8_CAN_RECORDER_SIZE > 0)
+/**
+ * @brief       Console RC: freeze the recorder (RC_1), or print and restart it
+ *
+ * @param[in]   param     Unused
+ * @param[in]   arg       Non 0 => freeze
+ * @param[in]   argc      Number of arguments
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_cmd_recorder(uint8_t param, const int32_t *arg, uint8_t argc)
+{
+  (void)param;
+  (void)argc;
 
-      if (m_get_torque_ki)
-      {
-        SERIAL.print("Torque ki :");
-        SERIAL.println(motor_pid.torque_ki);
-      }
+  if (arg[0] != 0)
+  {
+    X8_LOG_INFO(&m_log, LOG_CONSOLE, 0, "Recorder frozen");
+    x8_can_recorder_freeze(&m_x8_recorder, true);
+    return;
+  }
 
-      m_get_angle_kp  = false;
-      m_get_angle_ki  = false;
-      m_get_speed_kp  = false;
-      m_get_speed_ki  = false;
-      m_get_torque_kp = false;
-      m_get_torque_ki = false;
+  // Frozen while printed, cleared and restarted after the last frame
+  if (m_print_start(m_recorder_print))
+  {
+    x8_can_recorder_freeze(&m_x8_recorder, true);
+  }
+}
+#endif
 
-      break;
-    }
+/**
+ * @brief       Console reads (MT, RP, RE, RT, AP ... TI)
+ *
+ * @param[in]   param     read_item_t
+ * @param[in]   arg       Oldest cached value taken (ms), 0 => read the motor
+ * @param[in]   argc      Number of arguments, 0 => READ_MAX_AGE_MS
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_cmd_read(uint8_t param, const int32_t *arg, uint8_t argc)
+{
+  int32_t max_age_ms = (argc > 0) ? arg[0] : READ_MAX_AGE_MS;
 
-    default:
-      break;
-    }
+  if ((max_age_ms < 0) || (max_age_ms > 0xFFFF))
+  {
+    X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Max age 0 ... 65535 ms");
+    return;
   }
+
+  m_read((read_item_t)param, (uint32_t)max_age_ms * 1000);
 }
 
 /**
- * @brief       Button check
+ * @brief       Console PR, PW: write angle, speed and torque kp/ki
  *
- * @param[in]   None
+ * @param[in]   param     true => ROM (PW), false => RAM (PR)
+ * @param[in]   arg       Angle kp, angle ki, speed kp, speed ki, torque kp, torque ki
+ * @param[in]   argc      Number of arguments
  *
- * @attention   None
+ * @attention   The reply updates the pid of the motor handler
  *
  * @return      None
  */
-static void btn_check(void)
+static void m_cmd_pid(uint8_t param, const int32_t *arg, uint8_t argc)
 {
-  if (digitalRead(UP) == LOW)
+  x8_motor_pid_data_t pid;
+
+  if (argc != 6)
   {
-    m_rmd_x8_postion += STEP_VALUE;
-    if (m_rmd_x8_postion > 35999)
-    {
-      m_rmd_x8_postion = max(m_rmd_x8_postion - 35999, 0);
-    }
-    if (m_rmd_x8_postion < 0)
-    {
-      m_rmd_x8_postion = 0;
-    }
-    x8_can_send_position_ctrl_4_cmd(&m_x8_can, m_rmd_x8_postion, RMD_X8_SPEED_LIMITED, X8_CLOCKWISE);
+    X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Usage: PR_<angle kp>_<angle ki>_<speed kp>_<speed ki>_<torque kp>_<torque ki>");
+    return;
   }
 
-  if (digitalRead(DOWN) == LOW)
+  for (uint8_t i = 0; i < 6; i++)
   {
-    m_rmd_x8_postion -= STEP_VALUE;
-    if (m_rmd_x8_postion >= 36000)
+    if ((arg[i] < 0) || (arg[i] > 0xFF))
     {
-      m_rmd_x8_postion = 35999;
-    }
-    if (m_rmd_x8_postion < 0)
-    {
-      m_rmd_x8_postion = max(m_rmd_x8_postion + 35999, 35999);
+      X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "PID values 0 ... 255");
+      return;
     }
-    x8_can_send_position_ctrl_4_cmd(&m_x8_can, m_rmd_x8_postion, RMD_X8_SPEED_LIMITED, X8_COUNTER_CLOCKWISE);
   }
-}
 
+  pid.angle_kp  = (uint8_t)arg[0];
+  pid.angle_ki  = (uint8_t)arg[1];
+  pid.speed_kp  = (uint8_t)arg[2];
+  pid.speed_ki  = (uint8_t)arg[3];
+  pid.torque_kp = (uint8_t)arg[4];
+  pid.torque_ki = (uint8_t)arg[5];
+
+  if (param)
+  {
+    X8_LOG_INFO(&m_log, LOG_CONSOLE, m_x8_motor->motor_id, "Write pid to ROM");
+  }
+  else
+  {
+    X8_LOG_INFO(&m_log, LOG_CONSOLE, m_x8_motor->motor_id, "Write pid to RAM");
+  }
+  x8_can_send_write_pid_cmd(m_x8_motor, &pid, param != 0);
+}
 
 /**
- * @brief       Can message send
+ * @brief       Console AC: write acceleration
  *
- * @param[in]   msg_id   Message id
- *              buffer   Pointer to buffer
+ * @param[in]   param     Unused
+ * @param[in]   arg       Acceleration (dps/s)
+ * @param[in]   argc      Number of arguments
  *
  * @attention   None
  *
  * @return      None
  */
-static void bsp_x8_can_send(uint16_t msg_id, uint8_t *buffer)
+static void m_cmd_acceleration(uint8_t param, const int32_t *arg, uint8_t argc)
 {
-  CAN.sendMsgBuf(msg_id, 0, 8, buffer);
+  (void)param;
+
+  if (argc != 1)
+  {
+    X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Usage: AC_<dps/s>");
+    return;
+  }
+
+  X8_LOG_INFO(&m_log, LOG_CONSOLE, m_x8_motor->motor_id, "Write acceleration", arg[0]);
+  x8_can_send_acceleration_cmd(m_x8_motor, arg[0]);
 }
 
 /**
- * @brief       Can message init
+ * @brief       Console EO: write encoder offset
  *
- * @param[in]   None
+ * @param[in]   param     Unused
+ * @param[in]   arg       Encoder offset
+ * @param[in]   argc      Number of arguments
  *
  * @attention   None
  *
  * @return      None
  */
-static void x8_can_init(void)
+static void m_cmd_encoder_offset(uint8_t param, const int32_t *arg, uint8_t argc)
 {
-  m_x8_can.cansend = bsp_x8_can_send;
+  (void)param;
 
-  if (CAN_OK != CAN.begin(CAN_1000KBPS))
+  if ((argc != 1) || (arg[0] < 0) || (arg[0] > 0xFFFF))
   {
-    SERIAL.println("Init CAN BUS failed");
+    X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Usage: EO_<0 ... 65535>");
+    return;
   }
-  else
+
+  X8_LOG_INFO(&m_log, LOG_CONSOLE, m_x8_motor->motor_id, "Write encoder offset", arg[0]);
+  x8_can_send_encoder_offset_cmd(m_x8_motor, (uint16_t)arg[0]);
+}
+
+/**
+ * @brief       Console LG: set log level (0 ... 4) and mode (1 => LOG packets)
+ *
+ * @param[in]   param     Unused
+ * @param[in]   arg       Level, mode
+ * @param[in]   argc      Number of arguments
+ *
+ * @attention   Levels above X8_LOG_LEVEL are not compiled in
+ *
+ * @return      None
+ */
+static void m_cmd_log(uint8_t param, const int32_t *arg, uint8_t argc)
+{
+  (void)param;
+
+  if ((argc < 1) || (arg[0] < X8_LOG_LEVEL_NONE) || (arg[0] > X8_LOG_LEVEL_DEBUG))
   {
-    SERIAL.println("Init CAN BUS successfull");
+    X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Usage: LG_<level 0 ... 4>[_<1 => machine>]");
+    return;
   }
+
+  x8_log_set(&m_log, (uint8_t)arg[0], arg[1] != 0);
+  X8_LOG_INFO(&m_log, LOG_CONSOLE, 0, "Log level", m_log.level);
 }
 
+/**
+ * @brief       Console CT: print control tick counters and start a new window
+ *
+ * @param[in]   param     Unused
+ * @param[in]   arg       Unused
+ * @param[in]   argc      Number of arguments
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_cmd_tick(uint8_t param, const int32_t *arg, uint8_t argc)
+{
+  (void)param;
+  (void)arg;
+  (void)argc;
+
+  m_print_start(m_tick_print);
+}
+
+/**
+ * @brief       Console MQ: torque of motors 1 ... 4 in one frame (MQ_iq1_iq2_iq3_iq4),
+ *              or print the last replies (MQ)
+ *
+ * @param[in]   param     Unused
+ * @param[in]   arg       Torque of motors 1 ... 4, -2000 ... 2000
+ * @param[in]   argc      Number of arguments
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_cmd_multi_torque(uint8_t param, const int32_t *arg, uint8_t argc)
+{
+  int16_t torque[RMD_X8_MULTI_TORQUE_MOTORS];
+
+  (void)param;
+
+  if (argc == 0)
+  {
+    m_print_start(m_group_print);
+    return;
+  }
+
+  if (argc != RMD_X8_MULTI_TORQUE_MOTORS)
+  {
+    X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Usage: MQ_<iq1>_<iq2>_<iq3>_<iq4>");
+    return;
+  }
+
+  for (uint8_t i = 0; i < RMD_X8_MULTI_TORQUE_MOTORS; i++)
+  {
+    if ((arg[i] < -2000) || (arg[i] > 2000))
+    {
+      X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Torque -2000 ... 2000");
+      return;
+    }
+    torque[i] = (int16_t)arg[i];
+  }
+
+  X8_LOG_INFO(&m_log, LOG_CONSOLE, 0, "Multi torque", arg[0], arg[1], arg[2], arg[3]);
+  x8_can_group_send_torque(&m_x8_group, torque);
+}
+
+/**
+ * @brief       CAN receive data
+ *
+ * @param[in]   None
+ *
+ * @attention   Frames are read by m_can_isr, this drains them in batches
+ *
+ * @return      None
+ */
+static void m_can_receive(void)
+{
+  x8_can_frame_t *frame;
+  uint8_t count = x8_can_rx_ring_count(&m_can_rx_ring);
+  uint16_t overrun;
+
+  if (count > CAN_RX_BATCH)
+  {
+    count = CAN_RX_BATCH;
+  }
+
+  while (count--)
+  {
+    frame = x8_can_rx_ring_peek(&m_can_rx_ring);
+#if (X8_CAN_RECORDER_SIZE > 0)
+    x8_can_recorder_put(&m_x8_recorder, frame->timestamp_us, frame->msg_id, frame->dlc, frame->data, 0);
+#endif
+
+    // Decode into the motor that sent it and complete the read waiting for it,
+    // telemetry replies only update the motor
+    if (NULL != x8_can_registry_receive_at(&m_x8_registry, frame->msg_id, frame->data, frame->timestamp_us))
+    {
+      if (x8_can_request_receive(&m_x8_requests, frame->msg_id, frame->data))
+      {
+        X8_LOG_DEBUG(&m_log, LOG_CAN_RX, 0, "Can msg receive", frame->msg_id, frame->data[0]);
+      }
+    }
+
+    x8_can_rx_ring_pop(&m_can_rx_ring);
+  }
+
+  // Report frames lost because the loop did not keep up
+  overrun = x8_can_rx_ring_overrun(&m_can_rx_ring);
+  if (overrun != m_can_rx_overrun)
+  {
+    x8_can_stats_rx_overrun(&m_x8_stats, (uint16_t)(overrun - m_can_rx_overrun));
+    m_can_rx_overrun = overrun;
+    X8_LOG_WARN(&m_log, LOG_CAN_OVERRUN, 0, "Can rx overrun:", m_can_rx_overrun);
+  }
+}
+
+/**
+ * @brief       CAN interrupt, move every received frame into the rx ring
+ *
+ * @param[in]   None
+ *
+ * @attention   Runs on falling edge of MCP2515 INT
+ *
+ * @return      None
+ */
+static void m_can_isr(void)
+{
+  unsigned long can_rx_id;
+  x8_can_frame_t dropped;
+  x8_can_frame_t *frame;
+
+  while (CAN_MSGAVAIL == CAN.checkReceive())
+  {
+    // Still read the frame when the ring is full, to release the MCP2515 buffer
+    frame = x8_can_rx_ring_claim(&m_can_rx_ring);
+    if (frame == NULL)
+    {
+      frame = &dropped;
+    }
+
+    CAN.readMsgBufID(&can_rx_id, &frame->dlc, frame->data);
+    frame->msg_id       = (uint16_t)can_rx_id;
+    frame->timestamp_us = micros();
+    frame->flags        = 0;
+
+    if (frame != &dropped)
+    {
+      x8_can_rx_ring_publish(&m_can_rx_ring);
+    }
+  }
+}
+
+/**
+ * @brief       Read a value of the selected motor, printed when the reply arrives
+ *
+ * @param[in]   item        Read item
+ * @param[in]   max_age_us  Oldest cached value printed at once instead (us), 0 => none
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_read(read_item_t item, uint32_t max_age_us)
+{
+  int64_t value;
+
+  if (m_read_cached(m_x8_motor, item, max_age_us, &value))
+  {
+    X8_LOG_INFO_P(&m_log, LOG_READ + item, m_x8_motor->motor_id,
+                  (const char *)x8_pgm_read_ptr(&READ_REQUEST[item].label), (int32_t)value);
+    return;
+  }
+
+  if (NULL == x8_can_request_send(&m_x8_requests, m_x8_motor, x8_pgm_read_byte(&READ_REQUEST[item].cmd_byte),
+                                  micros(), RMD_X8_READ_TIMEOUT_US,
+                                  m_read_done, (void *)&READ_REQUEST[item]))
+  {
+    X8_LOG_WARN(&m_log, LOG_READ_BUSY, 0, "Too many pending reads");
+  }
+}
+
+/**
+ * @brief       Print the value of a completed read
+ *
+ * @param[in]   req       Completed request
+ * @param[in]   context   Pointer to read request of READ_REQUEST
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_read_done(x8_can_request_t *req, void *context)
+{
+  const read_request_t *read = (const read_request_t *)context;
+  read_item_t item = (read_item_t)(read - READ_REQUEST);
+  int64_t value;
+
+  if (req->state == X8_CAN_REQUEST_TIMEOUT)
+  {
+    X8_LOG_WARN(&m_log, LOG_READ_TIMEOUT, req->motor_id, "Read timeout", item);
+    return;
+  }
+
+  if (m_read_value(req, item, &value))
+  {
+    X8_LOG_INFO_P(&m_log, LOG_READ + item, req->motor_id, (const char *)x8_pgm_read_ptr(&read->label), (int32_t)value);
+  }
+}
+
+/**
+ * @brief       Value of a read item from a completed read
+ *
+ * @param[in]   req       Completed request
+ * @param[in]   item      Read item
+ * @param[out]  value     Value
+ *
+ * @attention   None
+ *
+ * @return      false if the reply does not carry the item
+ */
+static bool m_read_value(x8_can_request_t *req, read_item_t item, int64_t *value)
+{
+  x8_can_t reply;
+
+  switch (req->cmd_byte)
+  {
+  case RMD_X8_READ_MOTOR_STATUS_2_CMD:
+    x8_can_get_motor_status(req->can_rx_data, &reply.status);
+    break;
+
+  case RMD_X8_READ_PID_DATA_CMD:
+    x8_can_get_pid_data(req->can_rx_data, &reply.pid);
+    break;
+
+  case RMD_X8_READ_MULTI_TURNS_ANGLE_CMD:
+    x8_can_get_motor_multi_turn_angle(req->can_rx_data, &reply.multi_turn_angle);
+    break;
+
+  default:
+    return false;
+  }
+
+  return m_item_value(&reply, item, value);
+}
+
+/**
+ * @brief       Value of a read item from the values decoded into a motor handler
+ *
+ * @param[in]   motor     Pointer to can handler
+ * @param[in]   item      Read item
+ * @param[out]  value     Value
+ *
+ * @attention   Only the values of the reply of the item are used
+ *
+ * @return      false if the item is unknown
+ */
+static bool m_item_value(const x8_can_t *motor, read_item_t item, int64_t *value)
+{
+  switch (item)
+  {
+  case READ_ANGLE_KP:         *value = motor->pid.angle_kp;         break;
+  case READ_ANGLE_KI:         *value = motor->pid.angle_ki;         break;
+  case READ_SPEED_KP:         *value = motor->pid.speed_kp;         break;
+  case READ_SPEED_KI:         *value = motor->pid.speed_ki;         break;
+  case READ_TORQUE_KP:        *value = motor->pid.torque_kp;        break;
+  case READ_TORQUE_KI:        *value = motor->pid.torque_ki;        break;
+  case READ_SPEED:            *value = motor->status.speed;         break;
+  case READ_ENCODER:          *value = motor->status.encoder;       break;
+  case READ_TEMP:             *value = motor->status.temperature;   break;
+  case READ_MULTI_TURN_ANGLE: *value = motor->multi_turn_angle;     break;
+  default:
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief       Value of a read item cached in a motor handler, if fresh enough
+ *
+ * @param[in]   motor       Pointer to can handler
+ * @param[in]   item        Read item
+ * @param[in]   max_age_us  Oldest receive time accepted (us), 0 => none
+ * @param[out]  value       Value
+ *
+ * @attention   Counted as hit or miss of the shadow cache
+ *
+ * @return      false if the read has to go to the motor
+ */
+static bool m_read_cached(x8_can_t *motor, read_item_t item, uint32_t max_age_us, int64_t *value)
+{
+  uint8_t cached = x8_can_shadow_item(x8_pgm_read_byte(&READ_REQUEST[item].cmd_byte));
+
+  if (!x8_can_shadow_fresh(&m_x8_shadow, motor->motor_id, cached, max_age_us))
+    return false;
+
+  return m_item_value(motor, item, value);
+}
+
+/**
+ * @brief       Execute a packet of the host protocol
+ *
+ * @param[in]   msg       Decoded packet
+ *
+ * @attention   Setpoints are only queued, nothing is answered but reads,
+ *              trajectory packets and errors
+ *
+ * @return      None
+ */
+static void m_proto_execute(x8_host_proto_msg_t *msg)
+{
+  x8_can_request_t *req;
+  x8_can_t *motor = x8_can_registry_get(&m_x8_registry, msg->motor_id);
+
+  if ((motor == NULL) && (msg->type != X8_HOST_PROTO_SETPOINTS))
+  {
+    m_proto_error(X8_HOST_PROTO_ERR_MOTOR, (msg->type == X8_HOST_PROTO_READ) ? msg->read.tag : 0, msg->type);
+    return;
+  }
+
+  switch (msg->type)
+  {
+  case X8_HOST_PROTO_SPEED:
+  case X8_HOST_PROTO_TORQUE:
+    m_proto_setpoint(msg->type, msg->motor_id, (msg->type == X8_HOST_PROTO_SPEED) ? msg->speed : msg->torque);
+    break;
+
+  case X8_HOST_PROTO_POSITION:
+    x8_can_send_position_ctrl_2_cmd(motor, msg->position.max_speed, msg->position.angle);
+    break;
+
+  case X8_HOST_PROTO_COMMAND:
+    if (msg->command > MOTOR_RUN)
+    {
+      m_proto_error(X8_HOST_PROTO_ERR_PACKET, 0, msg->type);
+      break;
+    }
+    x8_can_send_motor_command(motor, (x8_motor_command_t)msg->command);
+    break;
+
+  case X8_HOST_PROTO_SETPOINTS:
+    for (uint8_t i = 0; i < msg->setpoints.count; i++)
+    {
+      m_proto_setpoint(msg->setpoints.mode, msg->setpoints.motor_id[i], msg->setpoints.value[i]);
+    }
+    break;
+
+  case X8_HOST_PROTO_READ:
+    if (msg->read.item >= X8_HOST_PROTO_ITEMS)
+    {
+      m_proto_error(X8_HOST_PROTO_ERR_PACKET, msg->read.tag, msg->type);
+      break;
+    }
+
+    if (m_read_cached(motor, (read_item_t)msg->read.item, (uint32_t)msg->read.max_age_ms * 1000, &msg->read.value))
+    {
+      msg->type = X8_HOST_PROTO_VALUE;
+      m_proto_send(msg);
+      break;
+    }
+
+    req = x8_can_request_send(&m_x8_requests, motor, x8_pgm_read_byte(&READ_REQUEST[msg->read.item].cmd_byte),
+                              micros(), RMD_X8_READ_TIMEOUT_US,
+                              m_proto_read_done, (void *)&READ_REQUEST[msg->read.item]);
+    if (req == NULL)
+    {
+      m_proto_error(X8_HOST_PROTO_ERR_BUSY, msg->read.tag, msg->type);
+      break;
+    }
+    m_proto_tag[req - m_x8_requests.request] = msg->read.tag;
+    break;
+
+  case X8_HOST_PROTO_WAYPOINTS:
+  case X8_HOST_PROTO_TRAJECTORY:
+    m_proto_trajectory(msg, &m_x8_trajectory[motor - m_x8_can]);
+    break;
+
+  default:
+    m_proto_error(X8_HOST_PROTO_ERR_PACKET, 0, msg->type);
+    break;
+  }
+}
+
+/**
+ * @brief       Execute a WAYPOINTS or TRAJECTORY packet, answer TRAJ_STATE
+ *
+ * @param[in]   msg       Decoded packet
+ * @param[in]   traj      Trajectory of the motor of the packet
+ *
+ * @attention   Waypoints after a rejected one are dropped
+ *
+ * @return      None
+ */
+static void m_proto_trajectory(x8_host_proto_msg_t *msg, x8_can_trajectory_t *traj)
+{
+  if (msg->type == X8_HOST_PROTO_WAYPOINTS)
+  {
+    for (uint8_t i = 0; i < msg->waypoints.count; i++)
+    {
+      if (!x8_can_trajectory_push(traj, msg->waypoints.t_ms[i], msg->waypoints.position[i]))
+      {
+        m_proto_error(X8_HOST_PROTO_ERR_WAYPOINT, 0, msg->type);
+        break;
+      }
+    }
+  }
+  else if ((msg->trajectory.action == X8_HOST_PROTO_TRAJ_CLEAR) &&
+           (msg->trajectory.mode <= X8_CAN_TRAJECTORY_SPEED) &&
+           (msg->trajectory.interp <= X8_CAN_TRAJECTORY_CUBIC))
+  {
+    x8_can_trajectory_stop(traj);
+    x8_can_trajectory_init(traj, traj->motor, msg->trajectory.mode, msg->trajectory.interp);
+  }
+  else if (msg->trajectory.action == X8_HOST_PROTO_TRAJ_START)
+  {
+    if (!x8_can_trajectory_start(traj))
+    {
+      m_proto_error(X8_HOST_PROTO_ERR_WAYPOINT, 0, msg->type);
+    }
+  }
+  else
+  {
+    m_proto_error(X8_HOST_PROTO_ERR_PACKET, 0, msg->type);
+  }
+
+  msg->type               = X8_HOST_PROTO_TRAJ_STATE;
+  msg->traj_state.state   = traj->state;
+  msg->traj_state.space   = x8_can_trajectory_space(traj);
+  msg->traj_state.starved = traj->starved;
+  msg->traj_state.missed  = traj->missed;
+
+  m_proto_send(msg);
+}
+
+/**
+ * @brief       Queue a setpoint of a SPEED, TORQUE or SETPOINTS packet
+ *
+ * @param[in]   mode      X8_HOST_PROTO_SPEED, X8_HOST_PROTO_TORQUE or X8_HOST_PROTO_POSITION
+ * @param[in]   motor_id  Motor id
+ * @param[in]   value     Speed, torque current or angle
+ *
+ * @attention   The TX scheduler keeps the latest setpoint of each motor
+ *
+ * @return      None
+ */
+static void m_proto_setpoint(uint8_t mode, uint8_t motor_id, int32_t value)
+{
+  x8_can_t *motor = x8_can_registry_get(&m_x8_registry, motor_id);
+
+  if (motor == NULL)
+  {
+    m_proto_error(X8_HOST_PROTO_ERR_MOTOR, 0, X8_HOST_PROTO_SETPOINTS);
+    return;
+  }
+
+  switch (mode)
+  {
+  case X8_HOST_PROTO_SPEED:     x8_can_send_speed_close_loop_cmd(motor, value);             break;
+  case X8_HOST_PROTO_TORQUE:    x8_can_send_torque_close_loop_cmd(motor, (int16_t)value);   break;
+  case X8_HOST_PROTO_POSITION:  x8_can_send_position_ctrl_1_cmd(motor, value);              break;
+  default:
+    m_proto_error(X8_HOST_PROTO_ERR_PACKET, 0, X8_HOST_PROTO_SETPOINTS);
+    break;
+  }
+}
+
+/**
+ * @brief       Answer a host READ when its reply arrives
+ *
+ * @param[in]   req       Completed request
+ * @param[in]   context   Pointer to read request of READ_REQUEST
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_proto_read_done(x8_can_request_t *req, void *context)
+{
+  const read_request_t *read = (const read_request_t *)context;
+  x8_host_proto_msg_t msg;
+  uint8_t tag = m_proto_tag[req - m_x8_requests.request];
+
+  if (req->state == X8_CAN_REQUEST_TIMEOUT)
+  {
+    m_proto_error(X8_HOST_PROTO_ERR_TIMEOUT, tag, X8_HOST_PROTO_READ);
+    return;
+  }
+
+  msg.type      = X8_HOST_PROTO_VALUE;
+  msg.motor_id  = req->motor_id;
+  msg.read.item = (uint8_t)(read - READ_REQUEST);
+  msg.read.tag  = tag;
+
+  if (m_read_value(req, (read_item_t)msg.read.item, &msg.read.value))
+  {
+    m_proto_send(&msg);
+  }
+}
+
+/**
+ * @brief       Send an ERROR packet
+ *
+ * @param[in]   code      x8_host_proto_error_t
+ * @param[in]   tag       Tag of the READ, else 0
+ * @param[in]   type      Type of the packet in error
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_proto_error(uint8_t code, uint8_t tag, uint8_t type)
+{
+  x8_host_proto_msg_t msg;
+
+  msg.type       = X8_HOST_PROTO_ERROR;
+  msg.motor_id   = 0;
+  msg.error.code = code;
+  msg.error.tag  = tag;
+  msg.error.type = type;
+
+  m_proto_send(&msg);
+}
+
+/**
+ * @brief       Send a packet to the host
+ *
+ * @param[in]   msg       Packet
+ *
+ * @attention   Main loop only, the frame buffer is shared
+ *
+ * @return      None
+ */
+static void m_proto_send(const x8_host_proto_msg_t *msg)
+{
+  uint8_t len = x8_host_proto_pack(msg, m_proto_frame);
+
+  // Through the log ring, so frames never land inside a log record
+  x8_log_put(&m_log, m_proto_frame, len);
+}
+
+/**
+ * @brief       Start a printout, its lines go out from m_print_poll()
+ *
+ * @param[in]   print     Line builder of the printout
+ *
+ * @attention   One printout at a time
+ *
+ * @return      false if a printout is still going out
+ */
+static bool m_print_start(print_fn_t print)
+{
+  if (m_print != NULL)
+  {
+    X8_LOG_WARN(&m_log, LOG_CONSOLE_ERROR, 0, "Printout busy");
+    return false;
+  }
+
+  m_print     = print;
+  m_print_row = 0;
+
+  return true;
+}
+
+/**
+ * @brief       Queue the next lines of the printout in progress
+ *
+ * @param[in]   None
+ *
+ * @attention   At most PRINT_LINES_PER_PASS lines, each one only when the
+ *              log ring has room for a full line, so the loop never waits
+ *              on the serial port
+ *
+ * @return      None
+ */
+static void m_print_poll(void)
+{
+  x8_log_line_t line;
+
+  for (uint8_t i = 0; (m_print != NULL) && (i < PRINT_LINES_PER_PASS); i++)
+  {
+    if (x8_log_free(&m_log) < X8_LOG_LINE_MAX)
+      return;
+
+    x8_log_line_init(&line);
+    if (!m_print(&m_print_row, &line))
+    {
+      m_print = NULL;
+      return;
+    }
+
+    x8_log_line_put(&m_log, &line);
+  }
+}
+
+/**
+ * @brief       Frame rates since the last printout, then start a new window
+ *
+ * @param[in]   row       Next row, advanced past the line built
+ * @param[out]  line      Line
+ *
+ * @attention   Rates use every frame costed at worst case bit stuffing, each
+ *              line over the window up to the time it is built
+ *
+ * @return      false when done
+ */
+static bool m_stats_print(uint16_t *row, x8_log_line_t *line)
+{
+  x8_can_stats_snapshot_t snap;
+  uint32_t elapsed_us = micros() - m_x8_stats.start_us;
+  uint16_t i;
+
+  while (true)
+  {
+    i = (*row)++;
+
+    if (i < 2)
+    {
+      x8_can_stats_snapshot(&m_x8_stats, micros(), CAN_BITRATE, &snap);
+
+      if (i == 0)
+      {
+        x8_log_line_text(line, X8_PSTR("Bus tx fps: "));
+        x8_log_line_uint(line, snap.tx_fps);
+        x8_log_line_text(line, X8_PSTR(" rx fps: "));
+        x8_log_line_uint(line, snap.rx_fps);
+        x8_log_line_text(line, X8_PSTR(" load permille: "));
+        x8_log_line_uint(line, snap.load_permille);
+      }
+      else
+      {
+        x8_log_line_text(line, X8_PSTR("Bus tx fail: "));
+        x8_log_line_uint(line, snap.tx_fail);
+        x8_log_line_text(line, X8_PSTR(" rx overrun: "));
+        x8_log_line_uint(line, snap.rx_overrun);
+      }
+      return true;
+    }
+    i -= 2;
+
+    if (i < X8_CAN_STATS_CMDS)
+    {
+      if ((m_x8_stats.tx_cmd[i] == 0) && (m_x8_stats.rx_cmd[i] == 0))
+        continue;
+
+      x8_log_line_text(line, X8_PSTR("Cmd 0x"));
+      x8_log_line_hex(line, x8_can_stats_cmd_byte((uint8_t)i), 2);
+      x8_log_line_text(line, X8_PSTR(" tx fps: "));
+      x8_log_line_uint(line, x8_can_stats_rate(m_x8_stats.tx_cmd[i], elapsed_us));
+      x8_log_line_text(line, X8_PSTR(" rx fps: "));
+      x8_log_line_uint(line, x8_can_stats_rate(m_x8_stats.rx_cmd[i], elapsed_us));
+      return true;
+    }
+    i -= X8_CAN_STATS_CMDS;
+
+    if (i < X8_CAN_STATS_MOTORS)
+    {
+      if ((m_x8_stats.tx_motor[i] == 0) && (m_x8_stats.rx_motor[i] == 0))
+        continue;
+
+      x8_log_line_text(line, X8_PSTR("Motor "));
+      x8_log_line_uint(line, i + 1);
+      x8_log_line_text(line, X8_PSTR(" tx fps: "));
+      x8_log_line_uint(line, x8_can_stats_rate(m_x8_stats.tx_motor[i], elapsed_us));
+      x8_log_line_text(line, X8_PSTR(" rx fps: "));
+      x8_log_line_uint(line, x8_can_stats_rate(m_x8_stats.rx_motor[i], elapsed_us));
+      return true;
+    }
+    i -= X8_CAN_STATS_MOTORS;
+
+    if (i == 0)
+    {
+      x8_log_line_text(line, X8_PSTR("Reads cached: "));
+      x8_log_line_uint(line, m_x8_shadow.hits);
+      x8_log_line_text(line, X8_PSTR(" from motor: "));
+      x8_log_line_uint(line, m_x8_shadow.misses);
+      return true;
+    }
+
+    m_x8_shadow.hits   = 0;
+    m_x8_shadow.misses = 0;
+    x8_can_stats_reset(&m_x8_stats, micros());
+    return false;
+  }
+}
+
+/**
+ * @brief       Read latency of all motors since the last printout, then clear it
+ *
+ * @param[in]   row       Next row, advanced past the line built
+ * @param[out]  line      Line
+ *
+ * @attention   None
+ *
+ * @return      false when done
+ */
+static bool m_latency_print(uint16_t *row, x8_log_line_t *line)
+{
+  static const uint8_t CMD[] X8_PGM = { RMD_X8_READ_MOTOR_STATUS_2_CMD, RMD_X8_READ_MULTI_TURNS_ANGLE_CMD, RMD_X8_READ_PID_DATA_CMD };
+  uint16_t i = (*row)++;
+  uint8_t cmd;
+
+  if (i < sizeof(CMD))
+  {
+    cmd = x8_pgm_read_byte(&CMD[i]);
+
+    x8_log_line_text(line, X8_PSTR("Cmd 0x"));
+    x8_log_line_hex(line, cmd, 2);
+    x8_log_line_text(line, X8_PSTR(" n: "));
+    x8_log_line_uint(line, x8_can_latency_count(&m_x8_latency, cmd, 0));
+    x8_log_line_text(line, X8_PSTR(" p50 us: "));
+    x8_log_line_uint(line, x8_can_latency_percentile(&m_x8_latency, cmd, 0, 500));
+    x8_log_line_text(line, X8_PSTR(" p99 us: "));
+    x8_log_line_uint(line, x8_can_latency_percentile(&m_x8_latency, cmd, 0, 990));
+    x8_log_line_text(line, X8_PSTR(" max us: "));
+    x8_log_line_uint(line, x8_can_latency_percentile(&m_x8_latency, cmd, 0, 1000));
+    return true;
+  }
+
+  if (i == sizeof(CMD))
+  {
+    x8_log_line_text(line, X8_PSTR("Lost: "));
+    x8_log_line_uint(line, m_x8_latency.lost);
+    return true;
+  }
+
+  x8_can_latency_reset(&m_x8_latency);
+  return false;
+}
+
+/**
+ * @brief       Control tick counters since the last printout, then start a new window
+ *
+ * @param[in]   row       Next row, advanced past the line built
+ * @param[out]  line      Line
+ *
+ * @attention   None
+ *
+ * @return      false when done
+ */
+static bool m_tick_print(uint16_t *row, x8_log_line_t *line)
+{
+  switch ((*row)++)
+  {
+  case 0:
+  {
+    x8_log_line_text(line, X8_PSTR("Tick us: "));
+    x8_log_line_uint(line, m_tick.period_us);
+    x8_log_line_text(line, X8_PSTR(" n: "));
+    x8_log_line_uint(line, m_tick.ticks);
+    x8_log_line_text(line, X8_PSTR(" missed: "));
+    x8_log_line_uint(line, m_tick.missed);
+    x8_log_line_text(line, X8_PSTR(" overruns: "));
+    x8_log_line_uint(line, m_tick.overruns);
+    return true;
+  }
+
+  case 1:
+  {
+    x8_log_line_text(line, X8_PSTR("Jitter us mean: "));
+    x8_log_line_uint(line, (m_tick.ticks > 1) ? m_tick.jitter_sum_us / (m_tick.ticks - 1) : 0);
+    x8_log_line_text(line, X8_PSTR(" max: "));
+    x8_log_line_uint(line, m_tick.jitter_max_us);
+    x8_log_line_text(line, X8_PSTR(" work max us: "));
+    x8_log_line_uint(line, m_tick.work_max_us);
+    return true;
+  }
+
+  default:
+    x8_tick_reset(&m_tick);
+    return false;
+  }
+}
+
+/**
+ * @brief       Last torque replies of the group and its counters
+ *
+ * @param[in]   row       Next row, advanced past the line built
+ * @param[out]  line      Line
+ *
+ * @attention   None
+ *
+ * @return      false when done
+ */
+static bool m_group_print(uint16_t *row, x8_log_line_t *line)
+{
+  uint16_t i;
+
+  while (true)
+  {
+    i = (*row)++;
+
+    if (i < RMD_X8_NUM_OF_MOTORS)
+    {
+      if (m_x8_can[i].group != &m_x8_group)
+        continue;
+
+      x8_log_line_text(line, X8_PSTR("Motor "));
+      x8_log_line_uint(line, m_x8_can[i].motor_id);
+      x8_log_line_text(line, X8_PSTR(" current: "));
+      x8_log_line_int(line, m_x8_can[i].status.torque_current);
+      x8_log_line_text(line, X8_PSTR(" speed: "));
+      x8_log_line_int(line, m_x8_can[i].status.speed);
+      x8_log_line_text(line, X8_PSTR(" encoder: "));
+      x8_log_line_uint(line, m_x8_can[i].status.encoder);
+      return true;
+    }
+
+    if (i == RMD_X8_NUM_OF_MOTORS)
+    {
+      x8_log_line_text(line, X8_PSTR("Sent: "));
+      x8_log_line_uint(line, m_x8_group.sent);
+      x8_log_line_text(line, X8_PSTR(" complete: "));
+      x8_log_line_uint(line, m_x8_group.complete);
+      x8_log_line_text(line, X8_PSTR(" missing: "));
+      x8_log_line_uint(line, m_x8_group.missing);
+      return true;
+    }
+
+    return false;
+  }
+}
+
+/**
+ * @brief       Time source of the latency histograms
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      Time (us)
+ */
+static uint32_t m_micros(void)
+{
+  return micros();
+}
+
+#if (X8_CAN_RECORDER_SIZE > 0)
+/**
+ * @brief       Recorded frames, oldest first, then clear and restart the recorder
+ *
+ * @param[in]   row       Next row, advanced past the line built
+ * @param[out]  line      Line
+ *
+ * @attention   One "X8 <time> <id> <flags> <dlc> <data>" line of hex per
+ *              frame, host/x8_record -t turns them into a capture file.
+ *              The recorder stays frozen until the last line.
+ *
+ * @return      false when done
+ */
+static bool m_recorder_print(uint16_t *row, x8_log_line_t *line)
+{
+  const x8_can_frame_t *frame;
+  uint16_t i = (*row)++;
+
+  if (i == 0)
+  {
+    x8_log_line_text(line, X8_PSTR("Recorded frames: "));
+    x8_log_line_uint(line, x8_can_recorder_count(&m_x8_recorder));
+    x8_log_line_text(line, X8_PSTR(" of "));
+    x8_log_line_uint(line, m_x8_recorder.total);
+    return true;
+  }
+
+  frame = x8_can_recorder_get(&m_x8_recorder, i - 1);
+  if (frame == NULL)
+  {
+    x8_can_recorder_clear(&m_x8_recorder);
+    x8_can_recorder_freeze(&m_x8_recorder, false);
+    return false;
+  }
+
+  x8_log_line_text(line, X8_PSTR("X8 "));
+  x8_log_line_hex(line, frame->timestamp_us, 8);
+  x8_log_line_text(line, X8_PSTR(" "));
+  x8_log_line_hex(line, frame->msg_id, 3);
+  x8_log_line_text(line, X8_PSTR(" "));
+  x8_log_line_hex(line, frame->flags, 2);
+  x8_log_line_text(line, X8_PSTR(" "));
+  x8_log_line_hex(line, frame->dlc, 1);
+  x8_log_line_text(line, X8_PSTR(" "));
+
+  for (uint8_t j = 0; j < sizeof(frame->data); j++)
+  {
+    x8_log_line_hex(line, frame->data[j], 2);
+  }
+
+  return true;
+}
+#endif
+
+/**
+ * @brief       Bytes the serial port takes without waiting
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      Free bytes of the UART TX buffer
+ */
+static uint16_t m_log_room(void)
+{
+  return (uint16_t)SERIAL.availableForWrite();
+}
+
+/**
+ * @brief       Hand log bytes to the serial port
+ *
+ * @param[in]   data      Bytes
+ * @param[in]   len       Number of bytes, at most m_log_room()
+ *
+ * @attention   The UART interrupt sends them
+ *
+ * @return      None
+ */
+static void m_log_write(const uint8_t *data, uint16_t len)
+{
+  SERIAL.write(data, len);
+}
+
+/**
+ * @brief       Button check
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void btn_check(void)
+{
+  if (digitalRead(UP) == LOW)
+  {
+    m_rmd_x8_postion += STEP_VALUE;
+    if (m_rmd_x8_postion > 35999)
+    {
+      m_rmd_x8_postion = max(m_rmd_x8_postion - 35999, 0);
+    }
+    if (m_rmd_x8_postion < 0)
+    {
+      m_rmd_x8_postion = 0;
+    }
+    x8_can_send_position_ctrl_4_cmd(m_x8_motor, m_rmd_x8_postion, RMD_X8_SPEED_LIMITED, X8_CLOCKWISE);
+  }
+
+  if (digitalRead(DOWN) == LOW)
+  {
+    m_rmd_x8_postion -= STEP_VALUE;
+    if (m_rmd_x8_postion >= 36000)
+    {
+      m_rmd_x8_postion = 35999;
+    }
+    if (m_rmd_x8_postion < 0)
+    {
+      m_rmd_x8_postion = max(m_rmd_x8_postion + 35999, 35999);
+    }
+    x8_can_send_position_ctrl_4_cmd(m_x8_motor, m_rmd_x8_postion, RMD_X8_SPEED_LIMITED, X8_COUNTER_CLOCKWISE);
+  }
+}
+
+
+/**
+ * @brief       Can message send
+ *
+ * @param[in]   msg_id   Message id
+ *              buffer   Pointer to buffer
+ *
+ * @attention   Frame is queued, it goes out from x8_can_tx_poll()
+ *
+ * @return      None
+ */
+static void bsp_x8_can_send(uint16_t msg_id, uint8_t *buffer)
+{
+  if (!x8_can_tx_enqueue(&m_x8_tx, msg_id, buffer))
+  {
+    x8_can_stats_tx_fail(&m_x8_stats, 1);
+  }
+}
+
+/**
+ * @brief       Can message transmit without waiting
+ *
+ * @param[in]   msg_id   Message id
+ *              buffer   Pointer to buffer
+ *              urgent   Motor off or stop
+ *
+ * @attention   Urgent frames only go to TXB2, which the MCP2515 sends ahead
+ *              of TXB0 and TXB1 when they wait together. Other frames only
+ *              go to TXB0 and TXB1, so TXB2 is free for an off or stop.
+ *              Frames still waiting in TXB0 and TXB1 are aborted before an
+ *              urgent frame and given back to the scheduler, so a setpoint
+ *              or multi motor torque handed over earlier does not follow a
+ *              stop on the bus. Counters and the recorder already saw them.
+ *
+ * @return      false if the TX buffers for the frame are busy
+ */
+static bool bsp_x8_can_transmit(uint16_t msg_id, uint8_t *buffer, bool urgent)
+{
+  uint8_t txb;
+
+  if (urgent)
+  {
+    m_can_tx_abort();
+
+    if (CAN_OK != CAN.trySendMsgBuf(msg_id, 0, 0, 8, buffer, CAN_TX_BUF_URGENT))
+      return false;
+  }
+  else
+  {
+    for (txb = 0; txb < CAN_TX_BUF_URGENT; txb++)
+    {
+      if (CAN_OK == CAN.trySendMsgBuf(msg_id, 0, 0, 8, buffer, txb))
+        break;
+    }
+
+    if (txb == CAN_TX_BUF_URGENT)
+      return false;
+
+    // Kept to be given back if an urgent frame aborts it
+    m_can_tx_loaded[txb].msg_id = msg_id;
+    memcpy(m_can_tx_loaded[txb].data, buffer, 8);
+    m_can_tx_loaded_mask |= (1 << txb);
+    m_can_tx_newest       = txb;
+  }
+
+  x8_can_stats_tx(&m_x8_stats, msg_id, buffer);
+  x8_can_group_transmitted(&m_x8_group, msg_id, buffer);
+  if (msg_id != RMD_X8_CAN_MULTI_TORQUE_MSG_ID)
+  {
+    x8_can_latency_sent(&m_x8_latency, RMD_X8_MOTOR_ID_OF(msg_id), buffer[0]);
+  }
+#if (X8_CAN_RECORDER_SIZE > 0)
+  x8_can_recorder_put(&m_x8_recorder, micros(), msg_id, 8, buffer, X8_CAN_FRAME_TX);
+#endif
+
+  return true;
+}
+
+/**
+ * @brief       Abort the frames waiting in TXB0 and TXB1, give them back to the scheduler
+ *
+ * @param[in]   None
+ *
+ * @attention   A frame on the bus when TXREQ is cleared is still sent, only
+ *              a frame with ABTF set is given back. The newest goes back
+ *              first, so the queue keeps the order they were handed over.
+ *
+ * @return      None
+ */
+static void m_can_tx_abort(void)
+{
+  uint8_t  txb = m_can_tx_newest;
+  uint8_t  ctrl;
+  uint32_t start_us;
+
+  for (uint8_t i = 0; i < CAN_TX_BUF_URGENT; i++, txb = (txb + 1) % CAN_TX_BUF_URGENT)
+  {
+    if (!(m_can_tx_loaded_mask & (1 << txb)))
+      continue;
+
+    m_can_tx_loaded_mask &= ~(1 << txb);
+    m_mcp2515_bit_modify(MCP2515_TXBCTRL(txb), MCP2515_TXBCTRL_TXREQ, 0);
+
+    // TXREQ stays set until a frame already on the bus ends
+    start_us = micros();
+    do
+    {
+      ctrl = m_mcp2515_read(MCP2515_TXBCTRL(txb));
+    }
+    while ((ctrl & MCP2515_TXBCTRL_TXREQ) && ((uint32_t)(micros() - start_us) < CAN_TX_ABORT_US));
+
+    if (ctrl & MCP2515_TXBCTRL_ABTF)
+    {
+      x8_can_tx_requeue(&m_x8_tx, m_can_tx_loaded[txb].msg_id, m_can_tx_loaded[txb].data);
+    }
+  }
+}
+
+/**
+ * @brief       Read a MCP2515 register
+ *
+ * @param[in]   addr     Register address
+ *
+ * @attention   Shares the SPI bus and chip select with the CAN library
+ *
+ * @return      Register value
+ */
+static uint8_t m_mcp2515_read(uint8_t addr)
+{
+  uint8_t value;
+
+  SPI.beginTransaction(SPISettings(MCP2515_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+  digitalWrite(SPI_CS_PIN, LOW);
+  SPI.transfer(MCP2515_READ);
+  SPI.transfer(addr);
+  value = SPI.transfer(0x00);
+  digitalWrite(SPI_CS_PIN, HIGH);
+  SPI.endTransaction();
+
+  return value;
+}
+
+/**
+ * @brief       Change bits of a MCP2515 register
+ *
+ * @param[in]   addr     Register address
+ *              mask     Bits to change
+ *              data     New value of the bits
+ *
+ * @attention   Shares the SPI bus and chip select with the CAN library
+ *
+ * @return      None
+ */
+static void m_mcp2515_bit_modify(uint8_t addr, uint8_t mask, uint8_t data)
+{
+  SPI.beginTransaction(SPISettings(MCP2515_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+  digitalWrite(SPI_CS_PIN, LOW);
+  SPI.transfer(MCP2515_BIT_MODIFY);
+  SPI.transfer(addr);
+  SPI.transfer(mask);
+  SPI.transfer(data);
+  digitalWrite(SPI_CS_PIN, HIGH);
+  SPI.endTransaction();
+}
+
+/**
+ * @brief       Can message init
+ *
+ * @param[in]   None
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void x8_can_init(void)
+{
+  x8_can_registry_init(&m_x8_registry);
+  x8_can_request_init(&m_x8_requests);
+  x8_can_rx_ring_init(&m_can_rx_ring);
+  x8_can_tx_init(&m_x8_tx, bsp_x8_can_transmit);
+  x8_can_telemetry_init(&m_x8_telemetry, CAN_BITRATE, TELEMETRY_BUDGET);
+  x8_can_stats_init(&m_x8_stats, micros());
+  x8_can_latency_init(&m_x8_latency, m_micros);
+#if (X8_CAN_RECORDER_SIZE > 0)
+  x8_can_recorder_init(&m_x8_recorder);
+#endif
+  x8_can_shadow_init(&m_x8_shadow, m_micros);
+  x8_can_group_init(&m_x8_group, bsp_x8_can_send);
+  x8_host_proto_rx_init(&m_proto_rx);
+  x8_console_init(&m_console, &CONSOLE_TABLE);
+
+  for (uint8_t i = 0; i < RMD_X8_NUM_OF_MOTORS; i++)
+  {
+    m_x8_can[i].cansend  = bsp_x8_can_send;
+    m_x8_can[i].motor_id = RMD_X8_MOTOR_ID_MIN + i;
+    m_x8_can[i].stats    = &m_x8_stats;
+    m_x8_can[i].latency  = &m_x8_latency;
+    m_x8_can[i].shadow   = &m_x8_shadow;
+    x8_can_registry_add(&m_x8_registry, &m_x8_can[i]);
+    x8_can_group_add(&m_x8_group, &m_x8_can[i]);
+    x8_can_trajectory_init(&m_x8_trajectory[i], &m_x8_can[i], X8_CAN_TRAJECTORY_POSITION, X8_CAN_TRAJECTORY_CUBIC);
+
+    if (!x8_can_telemetry_add(&m_x8_telemetry, &m_x8_can[i], RMD_X8_READ_MOTOR_STATUS_2_CMD, TELEMETRY_STATUS_US, 0) ||
+        !x8_can_telemetry_add(&m_x8_telemetry, &m_x8_can[i], RMD_X8_READ_MULTI_TURNS_ANGLE_CMD, TELEMETRY_ANGLE_US, 1) ||
+        !x8_can_telemetry_add(&m_x8_telemetry, &m_x8_can[i], RMD_X8_READ_PID_DATA_CMD, TELEMETRY_PID_US, 2))
+    {
+      X8_LOG_ERROR(&m_log, LOG_CAN_INIT, m_x8_can[i].motor_id, "Telemetry table full", 0);
+    }
+  }
+
+  if (CAN_OK != CAN.begin(CAN_1000KBPS))
+  {
+    X8_LOG_ERROR(&m_log, LOG_CAN_INIT, 0, "Init CAN BUS failed", 0);
+  }
+  else
+  {
+    X8_LOG_INFO(&m_log, LOG_CAN_INIT, 0, "Init CAN BUS successfull", 1);
+  }
+
+  // Receive on MCP2515 INT, SPI transactions of the main loop mask it
+  pinMode(CAN_INT_PIN, INPUT);
+  SPI.usingInterrupt(digitalPinToInterrupt(CAN_INT_PIN));
+  attachInterrupt(digitalPinToInterrupt(CAN_INT_PIN), m_can_isr, FALLING);
+
+  x8_can_telemetry_start(&m_x8_telemetry, micros());
+}
+
+/**
+ * @brief       Start the timer raising the control tick
+ *
+ * @param[in]   None
+ *
+ * @attention   AVR Timer1 in CTC mode, clk / 8. Other boards raise the tick
+ *              from the loop (x8_tick_poll).
+ *
+ * @return      None
+ */
+static void m_tick_timer_start(void)
+{
+#if defined(__AVR__)
+  static_assert((F_CPU / 8 / 1000000UL) * CONTROL_TICK_US - 1 <= 0xFFFF, "CONTROL_TICK_US too long for Timer1 at clk / 8");
+
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = bit(WGM12) | bit(CS11);
+  TCNT1  = 0;
+  OCR1A  = (uint16_t)((F_CPU / 8 / 1000000UL) * CONTROL_TICK_US - 1);
+  TIMSK1 |= bit(OCIE1A);
+  interrupts();
+#endif
+}
+
+#if defined(__AVR__)
+/**
+ * @brief       Timer1 compare match, raise the control tick
+ */
+ISR(TIMER1_COMPA_vect)
+{
+  x8_tick_raise(&m_tick);
+}
+#endif
+
 /* End of file -------------------------------------------------------- */
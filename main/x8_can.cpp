@@ -13,579 +13,418 @@
 
 /* Includes ----------------------------------------------------------- */
 #include "x8_can.h"
-#include "Arduino.h"
+#include "x8_can_codec.h"
+#include "x8_can_stats.h"
+#include "x8_can_latency.h"
+#include "x8_can_group.h"
+#include "x8_can_shadow.h"
 
 /* Private defines ---------------------------------------------------- */
+static_assert(X8_CAN_REGISTRY_MOTORS <= RMD_X8_MOTOR_ID_MAX, "X8_CAN_REGISTRY_MOTORS above motor id range");
+
 /* Private enumerate/structure ---------------------------------------- */
 /* Private macros ----------------------------------------------------- */
 /* Public variables --------------------------------------------------- */
 /* Private variables -------------------------------------------------- */
-static uint8_t can_tx_data[8];
-static uint8_t can_rx_data[8];
-
-// Can send message structure
-static x8_can_msg_write_encode_offset_cmd_t msg_write_encode_offset_cmd;
-static x8_can_msg_speed_close_loop_cmd_t    msg_speed_close_loop_cmd;
-static x8_can_msg_torque_close_loop_cmd_t   msg_torque_close_loop_cmd;
-static x8_can_msg_position_ctrl_1_cmd_t     msg_position_ctrl_1_cmd;
-static x8_can_msg_position_ctrl_2_cmd_t     msg_position_ctrl_2_cmd;
-static x8_can_msg_position_ctrl_3_cmd_t     msg_position_ctrl_3_cmd;
-static x8_can_msg_position_ctrl_4_cmd_t     msg_position_ctrl_4_cmd;
-
-// Can receive message structure
-static x8_can_receive_msg_motor_status_t      msg_receive_motor_status;
-static x8_can_receive_msg_multi_turn_angle_t  msg_receive_multi_turn_angle;
-static x8_can_receive_msg_pid_t               msg_receive_pid;
-
-
 /* Private function prototypes ---------------------------------------- */
-// Can pack transmit message
-static void m_x8_can_pack_msg_encode_offset_cmd(uint8_t *can_data);
-static void m_x8_can_pack_msg_speed_close_loop_cmd(uint8_t *can_data);
-static void m_x8_can_pack_msg_torque_close_loop_cmd(uint8_t *can_data);
-static void m_x8_can_pack_msg_position_ctrl_1_cmd(uint8_t *can_data);
-static void m_x8_can_pack_msg_position_ctrl_2_cmd(uint8_t *can_data);
-static void m_x8_can_pack_msg_position_ctrl_3_cmd(uint8_t *can_data);
-static void m_x8_can_pack_msg_position_ctrl_4_cmd(uint8_t *can_data);
-
-// Can unpack receive message
-static void m_x8_can_unpack_msg_receive_motor_status(uint8_t *can_data);
-static void m_x8_can_unpack_msg_receive_multi_turn_angle(uint8_t *can_data);
-static void m_x8_can_unpack_msg_receive_pid(uint8_t *can_data);
-
-static void m_x8_can_send_msg(x8_can_t *me, x8_can_msg_handler_send_type_t msg_handler);
+static void m_x8_can_clear(uint8_t *can_data, uint8_t cmd_byte);
+static void m_x8_can_send_msg(x8_can_t *me, uint8_t *can_tx_data);
 
 /* Function definitions ----------------------------------------------- */
-void x8_can_send_encoder_offset_cmd(x8_can_t *me , uint16_t encoder_offset)
+void x8_can_encode_cmd(uint8_t *can_data, uint8_t cmd_byte)
 {
-  // Encoder offset
-  msg_write_encode_offset_cmd.encode_offset_low  = encoder_offset;
-  msg_write_encode_offset_cmd.encode_offset_high = encoder_offset >> 8;
+  m_x8_can_clear(can_data, cmd_byte);
+}
 
-  // Can send message
-  m_x8_can_send_msg(me, X8_MSG_WRITE_ENCODER_OFFSET_CMD);
+void x8_can_encode_write_pid_cmd(uint8_t *can_data, const x8_motor_pid_data_t *pid, bool rom)
+{
+  if (rom)
+  {
+    x8_can_layout_write_pid_to_rom::encode(can_data, pid->angle_kp, pid->angle_ki, pid->speed_kp,
+                                           pid->speed_ki, pid->torque_kp, pid->torque_ki);
+  }
+  else
+  {
+    x8_can_layout_write_pid_to_ram::encode(can_data, pid->angle_kp, pid->angle_ki, pid->speed_kp,
+                                           pid->speed_ki, pid->torque_kp, pid->torque_ki);
+  }
 }
 
-void x8_can_send_torque_close_loop_cmd(x8_can_t *me , int16_t torque)
+void x8_can_encode_acceleration_cmd(uint8_t *can_data, int32_t acceleration)
 {
-  // Torque close loop
-  msg_torque_close_loop_cmd.torque_current_low   = torque;
-  msg_torque_close_loop_cmd.torque_current_high  = torque >> 8;
+  x8_can_layout_write_acceleration::encode(can_data, acceleration);
+}
 
-  // Can send message
-  m_x8_can_send_msg(me, X8_MSG_TORQUE_CLOSED_LOOP_CMD);
+void x8_can_encode_encoder_offset_cmd(uint8_t *can_data, uint16_t encoder_offset)
+{
+  x8_can_layout_write_encoder_offset::encode(can_data, encoder_offset);
 }
 
-void x8_can_send_speed_close_loop_cmd(x8_can_t *me , int32_t speed)
+void x8_can_encode_torque_close_loop_cmd(uint8_t *can_data, int16_t torque)
 {
-  // Cover rpm to dps
-  speed = speed * 360;
-  speed = speed / 60;
+  x8_can_layout_torque_close_loop::encode(can_data, torque);
+}
 
-  // Cover 1dsp/LSB to 0.01dsp/LSB
-  speed = speed * 100;
+void x8_can_encode_multi_torque_cmd(uint8_t *can_data, const int16_t *torque)
+{
+  x8_can_layout_multi_torque::encode(can_data, torque[0], torque[1], torque[2], torque[3]);
+}
 
-  // Speed close loop
-  msg_speed_close_loop_cmd.speed_ctrl_lowest   = speed;
-  msg_speed_close_loop_cmd.speed_ctrl_low      = speed >> 8;
-  msg_speed_close_loop_cmd.speed_ctrl_high     = speed >> 16;
-  msg_speed_close_loop_cmd.speed_ctrl_highest  = speed >> 24;
+void x8_can_encode_speed_close_loop_cmd(uint8_t *can_data, int32_t speed)
+{
+  x8_can_layout_speed_close_loop::encode(can_data, speed);
+}
 
-  // Can send message
-  m_x8_can_send_msg(me, X8_MSG_SPEED_CLOSED_LOOP_CMD);
+void x8_can_encode_position_ctrl_1_cmd(uint8_t *can_data, int32_t pos_ctrl)
+{
+  x8_can_layout_position_ctrl_1::encode(can_data, pos_ctrl);
 }
 
-void x8_can_send_position_ctrl_1_cmd(x8_can_t *me , int32_t pos_ctrl)
+void x8_can_encode_position_ctrl_2_cmd(uint8_t *can_data, uint16_t speed_limited, int32_t pos_ctrl)
 {
-  // Convert 1degree/LSB to 0.01degree/LSB
-  pos_ctrl = pos_ctrl * 100;
-  pos_ctrl = pos_ctrl * 6;
+  x8_can_layout_position_ctrl_2::encode(can_data, speed_limited, pos_ctrl);
+}
 
-  // Motor positon control
-  msg_position_ctrl_1_cmd.pos_ctrl_lowest   = pos_ctrl;
-  msg_position_ctrl_1_cmd.pos_ctrl_low      = pos_ctrl >> 8;
-  msg_position_ctrl_1_cmd.pos_ctrl_high     = pos_ctrl >> 16;
-  msg_position_ctrl_1_cmd.pos_ctrl_highest  = pos_ctrl >> 24;
+void x8_can_encode_position_ctrl_3_cmd(uint8_t *can_data, uint16_t pos_ctrl, x8_motor_dir_type_t dir)
+{
+  x8_can_layout_position_ctrl_3::encode(can_data, dir, pos_ctrl);
+}
 
-  // Can send message
-  m_x8_can_send_msg(me, X8_MSG_POSITION_CTRL_1_CMD);
+void x8_can_encode_position_ctrl_4_cmd(uint8_t *can_data, uint16_t pos_ctrl, uint16_t speed_limited, x8_motor_dir_type_t dir)
+{
+  x8_can_layout_position_ctrl_4::encode(can_data, dir, speed_limited, pos_ctrl);
 }
 
-void x8_can_send_position_ctrl_2_cmd(x8_can_t *me , uint16_t speed_limited, int32_t pos_ctrl)
+void x8_can_send_write_pid_cmd(x8_can_t *me, const x8_motor_pid_data_t *pid, bool rom)
 {
-  // Cover rpm to dps
-  speed_limited = speed_limited * 360;
-  speed_limited = speed_limited / 60;
+  uint8_t can_tx_data[8];
 
-  // Convert 1degree/LSB to 0.01degree/LSB
-  pos_ctrl = pos_ctrl * 100;
-  pos_ctrl = pos_ctrl * 6;
+  x8_can_encode_write_pid_cmd(can_tx_data, pid, rom);
+  m_x8_can_send_msg(me, can_tx_data);
+}
 
-  // Motor speed limited
-  msg_position_ctrl_2_cmd.speed_limited_low  = speed_limited;
-  msg_position_ctrl_2_cmd.speed_limited_high = speed_limited >> 8;
-  
-  // Motor positon control
-  msg_position_ctrl_2_cmd.pos_ctrl_lowest   = *(uint8_t *)(&pos_ctrl);
-  msg_position_ctrl_2_cmd.pos_ctrl_low      = *((uint8_t *)(&pos_ctrl) + 1);
-  msg_position_ctrl_2_cmd.pos_ctrl_high     = *((uint8_t *)(&pos_ctrl) + 2);
-  msg_position_ctrl_2_cmd.pos_ctrl_highest  = *((uint8_t *)(&pos_ctrl) + 3);
+void x8_can_send_acceleration_cmd(x8_can_t *me, int32_t acceleration)
+{
+  uint8_t can_tx_data[8];
 
-  // Can send message
-  m_x8_can_send_msg(me, X8_MSG_POSITION_CTRL_2_CMD);
+  x8_can_encode_acceleration_cmd(can_tx_data, acceleration);
+  m_x8_can_send_msg(me, can_tx_data);
 }
 
-void x8_can_send_position_ctrl_3_cmd(x8_can_t *me , uint16_t pos_ctrl, x8_motor_dir_type_t dir)
+void x8_can_send_encoder_offset_cmd(x8_can_t *me , uint16_t encoder_offset)
 {
-  // Convert 1degree/LSB to 0.01degree/LSB
-  pos_ctrl = pos_ctrl * 100;
-  pos_ctrl = pos_ctrl * 6;
+  uint8_t can_tx_data[8];
 
-  // Motor direction
-  msg_position_ctrl_3_cmd.spin_dir = dir;
-  
-  // Motor positon control
-  msg_position_ctrl_3_cmd.pos_ctrl_low      = pos_ctrl;
-  msg_position_ctrl_3_cmd.pos_ctrl_high     = pos_ctrl >> 8;
+  x8_can_encode_encoder_offset_cmd(can_tx_data, encoder_offset);
+  m_x8_can_send_msg(me, can_tx_data);
+}
 
-  // Can send message
-  m_x8_can_send_msg(me, X8_MSG_POSITION_CTRL_3_CMD);
+void x8_can_send_torque_close_loop_cmd(x8_can_t *me , int16_t torque)
+{
+  uint8_t can_tx_data[8];
+
+  x8_can_encode_torque_close_loop_cmd(can_tx_data, torque);
+  m_x8_can_send_msg(me, can_tx_data);
 }
 
-void x8_can_send_position_ctrl_4_cmd(x8_can_t *me , uint16_t pos_ctrl, uint16_t speed_limited, x8_motor_dir_type_t dir)
+void x8_can_send_speed_close_loop_cmd(x8_can_t *me , int32_t speed)
+{
+  uint8_t can_tx_data[8];
+
+  x8_can_encode_speed_close_loop_cmd(can_tx_data, speed);
+  m_x8_can_send_msg(me, can_tx_data);
+}
+
+void x8_can_send_position_ctrl_1_cmd(x8_can_t *me , int32_t pos_ctrl)
 {
-  // Cover rpm to dps
-  speed_limited = speed_limited * 360;
-  speed_limited = speed_limited  / 60;
+  uint8_t can_tx_data[8];
 
-  // Convert 1degree/LSB to 0.01degree/LSB
-  pos_ctrl = pos_ctrl * 100;
-  pos_ctrl = pos_ctrl * 6;
+  x8_can_encode_position_ctrl_1_cmd(can_tx_data, pos_ctrl);
+  m_x8_can_send_msg(me, can_tx_data);
+}
 
-  // Motor direction
-  msg_position_ctrl_4_cmd.spin_dir = dir;
+void x8_can_send_position_ctrl_2_cmd(x8_can_t *me , uint16_t speed_limited, int32_t pos_ctrl)
+{
+  uint8_t can_tx_data[8];
 
-  // Motor speed limited
-  msg_position_ctrl_4_cmd.speed_limited_low  = speed_limited;
-  msg_position_ctrl_4_cmd.speed_limited_high = speed_limited >> 8;
+  x8_can_encode_position_ctrl_2_cmd(can_tx_data, speed_limited, pos_ctrl);
+  m_x8_can_send_msg(me, can_tx_data);
+}
 
-  // Motor positon control
-  msg_position_ctrl_4_cmd.pos_ctrl_low  = pos_ctrl;
-  msg_position_ctrl_4_cmd.pos_ctrl_high = pos_ctrl >> 8;
+void x8_can_send_position_ctrl_3_cmd(x8_can_t *me , uint16_t pos_ctrl, x8_motor_dir_type_t dir)
+{
+  uint8_t can_tx_data[8];
 
-  // Can send message
-  m_x8_can_send_msg(me, X8_MSG_POSITION_CTRL_4_CMD);
+  x8_can_encode_position_ctrl_3_cmd(can_tx_data, pos_ctrl, dir);
+  m_x8_can_send_msg(me, can_tx_data);
 }
 
+void x8_can_send_position_ctrl_4_cmd(x8_can_t *me , uint16_t pos_ctrl, uint16_t speed_limited, x8_motor_dir_type_t dir)
+{
+  uint8_t can_tx_data[8];
+
+  x8_can_encode_position_ctrl_4_cmd(can_tx_data, pos_ctrl, speed_limited, dir);
+  m_x8_can_send_msg(me, can_tx_data);
+}
 
 void x8_can_send_motor_command(x8_can_t *me, x8_motor_command_t command)
 {
-  // Can send message
+  uint8_t can_tx_data[8];
+
   switch (command)
   {
   case MOTOR_OFF:
   {
-    m_x8_can_send_msg(me, X8_MSG_MOTOR_OFF_CMD);
+    x8_can_encode_cmd(can_tx_data, RMD_X8_MOTOR_OFF_CMD);
     break;
   }
 
   case MOTOR_RUN:
   {
-    m_x8_can_send_msg(me, X8_MSG_MOTOR_RUNNING_CMD);
+    x8_can_encode_cmd(can_tx_data, RMD_X8_MOTOR_RUNNING_CMD);
     break;
   }
 
   case MOTOR_STOP:
   {
-    m_x8_can_send_msg(me, X8_MSG_MOTOR_STOP_CMD);
+    x8_can_encode_cmd(can_tx_data, RMD_X8_MOTOR_STOP_CMD);
     break;
   }
 
   default:
-    break;
+    return;
   }
-}
-
-void x8_can_send_get_motor_status(x8_can_t *me)
-{
-  // Can send message
-  m_x8_can_send_msg(me, X8_MSG_READ_MOTOR_STATUS_2_CMD);
-}
 
-void x8_can_send_get_motor_multi_turn_angle(x8_can_t *me)
-{
-  // Can send message
-  m_x8_can_send_msg(me, X8_MSG_READ_MULTI_TURNS_ANGLE_CMD);
-}
-
-void x8_can_send_get_pid_data(x8_can_t *me)
-{
   // Can send message
-  m_x8_can_send_msg(me, X8_MSG_READ_PID_DATA_CMD);
+  m_x8_can_send_msg(me, can_tx_data);
 }
 
-void x8_can_get_motor_status(uint8_t *can_rx_data, x8_motor_status_t *motor_status)
-{
-  // Unpack CAN data
-  m_x8_can_unpack_msg_receive_motor_status(can_rx_data);
-
-  // Get motor temperature
-  motor_status->temperature =  (int8_t)msg_receive_motor_status.temperature;
-
-  // Get motor torque current
-  motor_status->torque_current = (int16_t(msg_receive_motor_status.iq_high) << 8) |
-                                           msg_receive_motor_status.iq_low;
-
-  // Get motor speed
-  motor_status->speed = (int16_t(msg_receive_motor_status.speed_high) << 8) |
-                                  msg_receive_motor_status.speed_low;
-
-  // Get motor encoder
-  motor_status->encoder = (uint16_t(msg_receive_motor_status.encoder_high) << 8) |
-                                    msg_receive_motor_status.encoder_low;
-
-  // Cover dps to rpm
-  motor_status->speed =  motor_status->speed * 60;
-  motor_status->speed =  motor_status->speed / 360;
-}
-
-void x8_can_get_motor_multi_turn_angle(uint8_t *can_rx_data, int64_t *multi_turn_angle)
-{
-  // Unpack CAN data
-  m_x8_can_unpack_msg_receive_multi_turn_angle(can_rx_data);
-
-  // Get multi angle turn
-  *multi_turn_angle =  (int64_t(msg_receive_multi_turn_angle.motor_angle_7) << 56) |
-                       (int64_t(msg_receive_multi_turn_angle.motor_angle_7) << 48) |
-                       (int64_t(msg_receive_multi_turn_angle.motor_angle_6) << 40) |
-                       (int64_t(msg_receive_multi_turn_angle.motor_angle_5) << 32) |
-                       (int64_t(msg_receive_multi_turn_angle.motor_angle_4) << 24) |
-                       (int64_t(msg_receive_multi_turn_angle.motor_angle_3) << 16) |
-                       (int64_t(msg_receive_multi_turn_angle.motor_angle_2) << 8 ) |
-                                 msg_receive_multi_turn_angle.motor_angle_low_1;
-
-  // Convert 0.01degree/LSB to 1degree/LSB
-  *multi_turn_angle = *multi_turn_angle / 100;
-  *multi_turn_angle = *multi_turn_angle / 6;
-}
-
-void x8_can_get_pid_data(uint8_t *can_rx_data, x8_motor_pid_data_t *motor_pid)
+void x8_can_send_cmd(x8_can_t *me, uint8_t cmd_byte)
 {
-  // Unpack CAN data
-  m_x8_can_unpack_msg_receive_pid(can_rx_data);
+  uint8_t can_tx_data[8];
 
-  // Get motor pid data
-  motor_pid->angle_kp   =  (uint8_t)msg_receive_pid.angle_kp;
-  motor_pid->angle_ki   =  (uint8_t)msg_receive_pid.angle_ki;
-  motor_pid->speed_kp   =  (uint8_t)msg_receive_pid.speed_kp;
-  motor_pid->speed_ki   =  (uint8_t)msg_receive_pid.speed_ki;
-  motor_pid->torque_kp  =  (uint8_t)msg_receive_pid.torque_kp;
-  motor_pid->torque_ki  =  (uint8_t)msg_receive_pid.torque_ki;
+  x8_can_encode_cmd(can_tx_data, cmd_byte);
+  m_x8_can_send_msg(me, can_tx_data);
 }
 
-
-/* Private function definitions --------------------------------------- */
-/**
- * @brief       Can pack message encode offset command
- *
- * @param[in]   can_tx_data   Pointer to can tx data
- *
- * @attention   None
- *
- * @return      None
- */
-static void m_x8_can_pack_msg_encode_offset_cmd(uint8_t *can_data)
+void x8_can_send_get_motor_status(x8_can_t *me)
 {
-  can_data[0] = msg_write_encode_offset_cmd.cmd_byte = RMD_X8_WRITE_ENCODER_OFFSET_CMD;
-  can_data[1] = msg_write_encode_offset_cmd.data1;
-  can_data[2] = msg_write_encode_offset_cmd.data2;
-  can_data[3] = msg_write_encode_offset_cmd.data3;
-  can_data[4] = msg_write_encode_offset_cmd.data4;
-  can_data[5] = msg_write_encode_offset_cmd.data5;
-  can_data[6] = msg_write_encode_offset_cmd.encode_offset_low;
-  can_data[7] = msg_write_encode_offset_cmd.encode_offset_high;
+  x8_can_send_cmd(me, RMD_X8_READ_MOTOR_STATUS_2_CMD);
 }
 
-/**
- * @brief       Can pack message torque close loop command
- *
- * @param[in]   can_tx_data   Pointer to can tx data
- *
- * @attention   None
- *
- * @return      None
- */
-static void m_x8_can_pack_msg_torque_close_loop_cmd(uint8_t *can_data)
+void x8_can_send_get_motor_multi_turn_angle(x8_can_t *me)
 {
-  can_data[0] = msg_torque_close_loop_cmd.cmd_byte = RMD_X8_TORQUE_CLOSED_LOOP_CMD;
-  can_data[1] = msg_torque_close_loop_cmd.data1;
-  can_data[2] = msg_torque_close_loop_cmd.data2;
-  can_data[3] = msg_torque_close_loop_cmd.data3;
-  can_data[4] = msg_torque_close_loop_cmd.torque_current_low;
-  can_data[5] = msg_torque_close_loop_cmd.torque_current_high;
-  can_data[6] = msg_torque_close_loop_cmd.data6;
-  can_data[7] = msg_torque_close_loop_cmd.data7;
+  x8_can_send_cmd(me, RMD_X8_READ_MULTI_TURNS_ANGLE_CMD);
 }
 
-/**
- * @brief       Can pack message speed close loop command
- *
- * @param[in]   can_tx_data   Pointer to can tx data
- *
- * @attention   None
- *
- * @return      None
- */
-static void m_x8_can_pack_msg_speed_close_loop_cmd(uint8_t *can_data)
+void x8_can_send_get_pid_data(x8_can_t *me)
 {
-  can_data[0] = msg_speed_close_loop_cmd.cmd_byte = RMD_X8_SPEED_CLOSED_LOOP_CMD;
-  can_data[1] = msg_speed_close_loop_cmd.data1;
-  can_data[2] = msg_speed_close_loop_cmd.data2;
-  can_data[3] = msg_speed_close_loop_cmd.data3;
-  can_data[4] = msg_speed_close_loop_cmd.speed_ctrl_lowest;
-  can_data[5] = msg_speed_close_loop_cmd.speed_ctrl_low;
-  can_data[6] = msg_speed_close_loop_cmd.speed_ctrl_high;
-  can_data[7] = msg_speed_close_loop_cmd.speed_ctrl_highest;
+  x8_can_send_cmd(me, RMD_X8_READ_PID_DATA_CMD);
 }
 
-/**
- * @brief       Can pack message position control command 1
- *
- * @param[in]   can_tx_data   Pointer to can tx data
- *
- * @attention   None
- *
- * @return      None
- */
-static void m_x8_can_pack_msg_position_ctrl_1_cmd(uint8_t *can_data)
+void x8_can_get_motor_status(uint8_t *can_rx_data, x8_motor_status_t *motor_status)
 {
-  can_data[0] = msg_position_ctrl_1_cmd.cmd_byte = RMD_X8_POSITION_CTRL_1_CMD;
-  can_data[1] = msg_position_ctrl_1_cmd.data1;
-  can_data[2] = msg_position_ctrl_1_cmd.data2;
-  can_data[3] = msg_position_ctrl_1_cmd.data3;
-  can_data[4] = msg_position_ctrl_1_cmd.pos_ctrl_lowest;
-  can_data[5] = msg_position_ctrl_1_cmd.pos_ctrl_low;
-  can_data[6] = msg_position_ctrl_1_cmd.pos_ctrl_high;
-  can_data[7] = msg_position_ctrl_1_cmd.pos_ctrl_highest;
-}
+  typedef x8_can_layout_motor_status_2 layout;
 
-/**
- * @brief       Can pack message position control command 2
- *
- * @param[in]   can_tx_data   Pointer to can tx data
- *
- * @attention   None
- *
- * @return      None
- */
-static void m_x8_can_pack_msg_position_ctrl_2_cmd(uint8_t *can_data)
-{
-  can_data[0] = msg_position_ctrl_2_cmd.cmd_byte = RMD_X8_POSITION_CTRL_2_CMD;
-  can_data[1] = msg_position_ctrl_2_cmd.data1;
-  can_data[2] = msg_position_ctrl_2_cmd.speed_limited_low;
-  can_data[3] = msg_position_ctrl_2_cmd.speed_limited_high;
-  can_data[4] = msg_position_ctrl_2_cmd.pos_ctrl_lowest;
-  can_data[5] = msg_position_ctrl_2_cmd.pos_ctrl_low;
-  can_data[6] = msg_position_ctrl_2_cmd.pos_ctrl_high;
-  can_data[7] = msg_position_ctrl_2_cmd.pos_ctrl_highest;
+  motor_status->temperature    = layout::temperature::decode(can_rx_data);
+  motor_status->torque_current = layout::torque_current::decode(can_rx_data);
+  motor_status->speed          = layout::speed::decode(can_rx_data);
+  motor_status->encoder        = layout::encoder::decode(can_rx_data);
 }
 
-/**
- * @brief       Can pack message position control command 3
- *
- * @param[in]   can_tx_data   Pointer to can tx data
- *
- * @attention   None
- *
- * @return      None
- */
-static void m_x8_can_pack_msg_position_ctrl_3_cmd(uint8_t *can_data)
+void x8_can_get_motor_multi_turn_angle(uint8_t *can_rx_data, int64_t *multi_turn_angle)
 {
-  can_data[0] = msg_position_ctrl_3_cmd.cmd_byte = RMD_X8_POSITION_CTRL_3_CMD;
-  can_data[1] = msg_position_ctrl_3_cmd.spin_dir;
-  can_data[2] = msg_position_ctrl_3_cmd.data2;
-  can_data[3] = msg_position_ctrl_3_cmd.data3;
-  can_data[4] = msg_position_ctrl_3_cmd.pos_ctrl_low;
-  can_data[5] = msg_position_ctrl_3_cmd.pos_ctrl_high;
-  can_data[6] = msg_position_ctrl_3_cmd.data6;
-  can_data[7] = msg_position_ctrl_3_cmd.data7;
+  *multi_turn_angle = x8_can_layout_multi_turn_angle::angle::decode(can_rx_data);
 }
 
-/**
- * @brief       Can pack message position control command 4
- *
- * @param[in]   can_tx_data   Pointer to can tx data
- *
- * @attention   None
- *
- * @return      None
- */
-static void m_x8_can_pack_msg_position_ctrl_4_cmd(uint8_t *can_data)
+void x8_can_get_pid_data(uint8_t *can_rx_data, x8_motor_pid_data_t *motor_pid)
 {
-  can_data[0] = msg_position_ctrl_4_cmd.cmd_byte = RMD_X8_POSITION_CTRL_4_CMD;
-  can_data[1] = msg_position_ctrl_4_cmd.spin_dir;
-  can_data[2] = msg_position_ctrl_4_cmd.speed_limited_low;
-  can_data[3] = msg_position_ctrl_4_cmd.speed_limited_high;
-  can_data[4] = msg_position_ctrl_4_cmd.pos_ctrl_low;
-  can_data[5] = msg_position_ctrl_4_cmd.pos_ctrl_high;
-  can_data[6] = msg_position_ctrl_4_cmd.data6;
-  can_data[7] = msg_position_ctrl_4_cmd.data7;
+  typedef x8_can_layout_pid layout;
+
+  motor_pid->angle_kp   = layout::angle_kp::decode(can_rx_data);
+  motor_pid->angle_ki   = layout::angle_ki::decode(can_rx_data);
+  motor_pid->speed_kp   = layout::speed_kp::decode(can_rx_data);
+  motor_pid->speed_ki   = layout::speed_ki::decode(can_rx_data);
+  motor_pid->torque_kp  = layout::torque_kp::decode(can_rx_data);
+  motor_pid->torque_ki  = layout::torque_ki::decode(can_rx_data);
 }
 
-/**
- * @brief       Can unpack message position control command 4
- *
- * @param[in]   can_tx_data   Pointer to can tx data
- *
- * @attention   None
- *
- * @return      None
- */
-static void m_x8_can_unpack_msg_receive_motor_status(uint8_t *can_data)
+void x8_can_get_motor_error(uint8_t *can_rx_data, x8_motor_error_t *motor_error)
 {
-  msg_receive_motor_status.cmd_byte     = can_data[0];
-  msg_receive_motor_status.temperature  = can_data[1];
-  msg_receive_motor_status.iq_low       = can_data[2];
-  msg_receive_motor_status.iq_high      = can_data[3];
-  msg_receive_motor_status.speed_low    = can_data[4];
-  msg_receive_motor_status.speed_high   = can_data[5];
-  msg_receive_motor_status.encoder_low  = can_data[6];
-  msg_receive_motor_status.encoder_high = can_data[7];
-}
+  typedef x8_can_layout_motor_status_1 layout;
 
-/**
- * @brief       Can unpack message multi turn angle
- *
- * @param[in]   can_tx_data   Pointer to can tx data
- *
- * @attention   None
- *
- * @return      None
- */
-static void m_x8_can_unpack_msg_receive_multi_turn_angle(uint8_t *can_data)
-{
-  msg_receive_multi_turn_angle.cmd_byte          = can_data[0];
-  msg_receive_multi_turn_angle.motor_angle_low_1 = can_data[1];
-  msg_receive_multi_turn_angle.motor_angle_2     = can_data[2];
-  msg_receive_multi_turn_angle.motor_angle_3     = can_data[3];
-  msg_receive_multi_turn_angle.motor_angle_4     = can_data[4];
-  msg_receive_multi_turn_angle.motor_angle_5     = can_data[5];
-  msg_receive_multi_turn_angle.motor_angle_6     = can_data[6];
-  msg_receive_multi_turn_angle.motor_angle_7     = can_data[7];
+  motor_error->temperature = layout::temperature::decode(can_rx_data);
+  motor_error->voltage     = layout::voltage::decode(can_rx_data);
+  motor_error->error_state = layout::error_state::decode(can_rx_data);
 }
 
-/**
- * @brief       Can unpack message pid
- *
- * @param[in]   can_tx_data   Pointer to can tx data
- *
- * @attention   None
- *
- * @return      None
- */
-static void m_x8_can_unpack_msg_receive_pid(uint8_t *can_data)
+void x8_can_receive(x8_can_t *me, uint8_t *can_rx_data)
 {
-  msg_receive_pid.cmd_byte     = can_data[0];
-  msg_receive_pid.data1        = can_data[1];
-  msg_receive_pid.angle_kp     = can_data[2];
-  msg_receive_pid.angle_ki     = can_data[3];
-  msg_receive_pid.speed_kp     = can_data[4];
-  msg_receive_pid.speed_ki     = can_data[5];
-  msg_receive_pid.torque_kp    = can_data[6];
-  msg_receive_pid.torque_ki    = can_data[7];
+  x8_can_receive_at(me, can_rx_data, (me->shadow != NULL) ? me->shadow->clock() : 0);
 }
 
-
-/**
- * @brief       Can send msg
- *
- * @param[in]   msg_handler   Message handler
- *
- * @attention   None
- *
- * @return      None
- */
-static void m_x8_can_send_msg(x8_can_t *me, x8_can_msg_handler_send_type_t msg_handler)
+void x8_can_receive_at(x8_can_t *me, uint8_t *can_rx_data, uint32_t rx_us)
 {
-  switch (msg_handler)
+  if (me->stats != NULL)
   {
-  case X8_MSG_WRITE_ENCODER_OFFSET_CMD:
-  {
-    m_x8_can_pack_msg_encode_offset_cmd(can_tx_data);
-    break;
+    x8_can_stats_rx(me->stats, RMD_X8_CAN_MSG_ID_OF(me->motor_id), can_rx_data);
   }
 
-  case X8_MSG_SPEED_CLOSED_LOOP_CMD:
+  if (me->latency != NULL)
   {
-    m_x8_can_pack_msg_speed_close_loop_cmd(can_tx_data);
-    break;
+    x8_can_latency_received(me->latency, me->motor_id, can_rx_data[0]);
   }
 
-  case X8_MSG_POSITION_CTRL_1_CMD:
+  if ((me->group != NULL) && (can_rx_data[0] == RMD_X8_TORQUE_CLOSED_LOOP_CMD))
   {
-    m_x8_can_pack_msg_position_ctrl_1_cmd(can_tx_data);
-    break;
+    x8_can_group_received(me->group, me->motor_id);
   }
 
-  case X8_MSG_POSITION_CTRL_2_CMD:
+  if (me->shadow != NULL)
   {
-    m_x8_can_pack_msg_position_ctrl_2_cmd(can_tx_data);
-    break;
+    x8_can_shadow_received(me->shadow, me->motor_id, can_rx_data[0], rx_us);
   }
 
-  case X8_MSG_POSITION_CTRL_3_CMD:
+  switch (can_rx_data[0])
+  {
+  // Control commands are answered with status 2, feedback comes without polling
+  case RMD_X8_READ_MOTOR_STATUS_2_CMD:
+  case RMD_X8_TORQUE_CLOSED_LOOP_CMD:
+  case RMD_X8_SPEED_CLOSED_LOOP_CMD:
+  case RMD_X8_POSITION_CTRL_1_CMD:
+  case RMD_X8_POSITION_CTRL_2_CMD:
+  case RMD_X8_POSITION_CTRL_3_CMD:
+  case RMD_X8_POSITION_CTRL_4_CMD:
   {
-    m_x8_can_pack_msg_position_ctrl_3_cmd(can_tx_data);
+    x8_can_get_motor_status(can_rx_data, &me->status);
     break;
   }
 
-  case X8_MSG_POSITION_CTRL_4_CMD:
+  case RMD_X8_READ_MULTI_TURNS_ANGLE_CMD:
   {
-    m_x8_can_pack_msg_position_ctrl_4_cmd(can_tx_data);
+    x8_can_get_motor_multi_turn_angle(can_rx_data, &me->multi_turn_angle);
     break;
   }
 
-  case X8_MSG_READ_MOTOR_STATUS_2_CMD:
+  // Writes are answered with the values taken
+  case RMD_X8_READ_PID_DATA_CMD:
+  case RMD_X8_WRITE_PID_TO_RAM_CMD:
+  case RMD_X8_WRITE_PID_TO_ROM_CMD:
   {
-    can_tx_data[0] = RMD_X8_READ_MOTOR_STATUS_2_CMD;
+    x8_can_get_pid_data(can_rx_data, &me->pid);
     break;
   }
 
-  case X8_MSG_READ_MULTI_TURNS_ANGLE_CMD:
+  // Clearing the errors is answered with what is left
+  case RMD_X8_READ_MOTOR_STATUS_CMD:
+  case RMD_X8_CLEAR_MOTOR_ERROR_FLAG_CMD:
   {
-    can_tx_data[0] = RMD_X8_READ_MULTI_TURNS_ANGLE_CMD;
+    x8_can_get_motor_error(can_rx_data, &me->error);
     break;
   }
 
-  case X8_MSG_READ_PID_DATA_CMD:
-  {
-    can_tx_data[0] = RMD_X8_READ_PID_DATA_CMD;
+  default:
     break;
   }
+}
 
-  case X8_MSG_MOTOR_OFF_CMD:
+void x8_can_registry_init(x8_can_registry_t *reg)
+{
+  for (uint8_t i = 0; i < X8_CAN_REGISTRY_MOTORS; i++)
   {
-    can_tx_data[0] = RMD_X8_MOTOR_OFF_CMD;
-    break;
+    reg->motor[i] = NULL;
   }
+}
+
+bool x8_can_registry_add(x8_can_registry_t *reg, x8_can_t *me)
+{
+  if ((me->motor_id < RMD_X8_MOTOR_ID_MIN) || (me->motor_id > X8_CAN_REGISTRY_MOTORS))
+    return false;
+
+  if (reg->motor[me->motor_id - 1] != NULL)
+    return false;
 
-  case X8_MSG_MOTOR_STOP_CMD:
+  reg->motor[me->motor_id - 1] = me;
+
+  return true;
+}
+
+x8_can_t *x8_can_registry_get(x8_can_registry_t *reg, uint8_t motor_id)
+{
+  if ((motor_id < RMD_X8_MOTOR_ID_MIN) || (motor_id > X8_CAN_REGISTRY_MOTORS))
+    return NULL;
+
+  return reg->motor[motor_id - 1];
+}
+
+x8_can_t *x8_can_registry_receive(x8_can_registry_t *reg, uint16_t msg_id, uint8_t *can_rx_data)
+{
+  x8_can_t *me = x8_can_registry_route(reg, msg_id);
+
+  if (me != NULL)
   {
-    can_tx_data[0] = RMD_X8_MOTOR_STOP_CMD;
-    break;
+    x8_can_receive(me, can_rx_data);
   }
 
-  case X8_MSG_MOTOR_RUNNING_CMD:
+  return me;
+}
+
+x8_can_t *x8_can_registry_receive_at(x8_can_registry_t *reg, uint16_t msg_id, uint8_t *can_rx_data, uint32_t rx_us)
+{
+  x8_can_t *me = x8_can_registry_route(reg, msg_id);
+
+  if (me != NULL)
   {
-    can_tx_data[0] = RMD_X8_MOTOR_RUNNING_CMD;
-    break;
+    x8_can_receive_at(me, can_rx_data, rx_us);
   }
 
-  default:
-    break;
+  return me;
+}
+
+x8_can_t *x8_can_registry_route(x8_can_registry_t *reg, uint16_t msg_id)
+{
+  // Motor replies come back on the same CAN ID the motor listens on
+  if ((msg_id < RMD_X8_CAN_MSG_ID_OF(RMD_X8_MOTOR_ID_MIN)) || (msg_id > RMD_X8_CAN_MSG_ID_OF(X8_CAN_REGISTRY_MOTORS)))
+    return NULL;
+
+  return reg->motor[RMD_X8_MOTOR_ID_OF(msg_id) - 1];
+}
+
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Clear can data and set command byte
+ *
+ * @param[in]   can_data      Pointer to can data (8 bytes)
+ * @param[in]   cmd_byte      Command byte
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_can_clear(uint8_t *can_data, uint8_t cmd_byte)
+{
+  can_data[0] = cmd_byte;
+
+  for (uint8_t i = 1; i < 8; i++)
+  {
+    can_data[i] = 0;
   }
+}
 
-  me->cansend(RMD_X8_CAN_MSG_ID, can_tx_data);
+/**
+ * @brief       Can send msg
+ *
+ * @param[in]   me            Pointer to can handler
+ * @param[in]   can_tx_data   Pointer to encoded can tx data
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_can_send_msg(x8_can_t *me, uint8_t *can_tx_data)
+{
+  me->cansend(RMD_X8_CAN_MSG_ID_OF(me->motor_id), can_tx_data);
 }
 
 /* End of file -------------------------------------------------------- */
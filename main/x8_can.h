@@ -17,9 +17,25 @@
 
 /* Includes ----------------------------------------------------------- */
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "x8_can_config.h"
 
 /* Public defines ----------------------------------------------------- */
+#define RMD_X8_CAN_MSG_ID_BASE                  (0x140)
 #define RMD_X8_CAN_MSG_ID                       (0x141)
+#define RMD_X8_CAN_MULTI_TORQUE_MSG_ID          (0x280)   // Torque of motors 1 ... 4 in one frame
+#define RMD_X8_MULTI_TORQUE_MOTORS              (4)
+
+#define RMD_X8_MOTOR_ID_MIN                     (1)
+#define RMD_X8_MOTOR_ID_MAX                     (32)
+
+// Bus time of one 8 byte standard frame, worst case bit stuffing and interframe space
+#define RMD_X8_CAN_FRAME_BITS                   (135)
+
+// x8_can_frame_t::flags
+#define X8_CAN_FRAME_TX                         (0x01)  // Sent by this node, else received
 
 #define RMD_X8_READ_PID_DATA_CMD                (0x30)
 #define RMD_X8_WRITE_PID_TO_RAM_CMD             (0x31)
@@ -46,50 +62,6 @@
 #define RMD_X8_POSITION_CTRL_4_CMD              (0xA6)
 
 /* Public enumerate/structure ----------------------------------------- */
-/**
- * @brief Can message handler enum
- */
-typedef struct x8_can
-{
-  void (*cansend) (uint16_t msg_id, uint8_t * buffer);
-}
-x8_can_t;
-
-/**
- * @brief Can message handler enum
- */
-typedef enum
-{
-  X8_MSG_READ_PID_DATA_CMD,
-  X8_MSG_WRITE_PID_TO_RAM_CMD,
-  X8_MSG_WRITE_PID_TO_ROM_CMD,
-  X8_MSG_READ_ACCELERATION_CMD,
-  X8_MSG_WRITE_ACCELERATION_CMD,
-  X8_MSG_READ_ENCODE_DATA_CMD,
-  X8_MSG_WRITE_ENCODER_OFFSET_CMD,
-  X8_MSG_WRITE_CURRENT_POSITION_CMD,
-  X8_MSG_READ_MULTI_TURNS_ANGLE_CMD,
-  X8_MSG_READ_SINGLE_CIRCLE_ANGLE_CMD,
-  X8_MSG_READ_MOTOR_STATUS_CMD,
-  X8_MSG_CLEAR_MOTOR_ERROR_FLAG_CMD,
-  X8_MSG_READ_MOTOR_STATUS_2_CMD,
-  X8_MSG_READ_MOTOR_STATUS_3_CMD,
-  X8_MSG_MOTOR_OFF_CMD,
-  X8_MSG_MOTOR_STOP_CMD,
-  X8_MSG_MOTOR_RUNNING_CMD,
-  X8_MSG_TORQUE_CLOSED_LOOP_CMD,
-  X8_MSG_SPEED_CLOSED_LOOP_CMD,
-  X8_MSG_POSITION_CTRL_1_CMD,
-  X8_MSG_POSITION_CTRL_2_CMD,
-  X8_MSG_POSITION_CTRL_3_CMD,
-  X8_MSG_POSITION_CTRL_4_CMD,
-
-  /*----------------------------------------------------------------- */
-  X8_NUM_OF_SEND_MSG /* Do not insert elements behind this line !     */
-  /*----------------------------------------------------------------- */
-}
-x8_can_msg_handler_send_type_t;
-
 /**
  * @brief Motor direction enum
  */
@@ -123,6 +95,17 @@ typedef struct
 }
 x8_motor_status_t;
 
+/**
+ * @brief Motor status 1, voltage and errors
+ */
+typedef struct
+{
+  int8_t    temperature;
+  uint16_t  voltage;                    // 0.1 V
+  uint8_t   error_state;                // Bit 0 under voltage, bit 3 over temperature
+}
+x8_motor_error_t;
+
 /**
  * @brief Motor pid data
  */
@@ -138,167 +121,217 @@ typedef struct
 x8_motor_pid_data_t;
 
 /**
- * @brief Can message encode offset command
+ * @brief Raw CAN frame with receive or send time
  */
 typedef struct
 {
-  uint8_t cmd_byte;
-  uint8_t data1;
-  uint8_t data2;
-  uint8_t data3;
-  uint8_t data4;
-  uint8_t data5;
-  uint8_t encode_offset_low;
-  uint8_t encode_offset_high;
+  uint32_t  timestamp_us;
+  uint16_t  msg_id;
+  uint8_t   dlc;
+  uint8_t   flags;                      // X8_CAN_FRAME_TX
+  uint8_t   data[8];
 }
-x8_can_msg_write_encode_offset_cmd_t;
+x8_can_frame_t;
 
 /**
- * @brief Can message torque close loop command
+ * @brief Can handler of one motor on the bus
  */
-typedef struct
+typedef struct x8_can
 {
-  uint8_t cmd_byte;
-  uint8_t data1;
-  uint8_t data2;
-  uint8_t data3;
-  uint8_t torque_current_low;
-  uint8_t torque_current_high;
-  uint8_t data6;
-  uint8_t data7;
+  void (*cansend) (uint16_t msg_id, uint8_t * buffer);
+
+  uint8_t             motor_id;           // 1 => CAN ID 0x141 ... 32 => CAN ID 0x160
+
+  // Last values decoded from this motor replies
+  x8_motor_status_t   status;
+  int64_t             multi_turn_angle;
+  x8_motor_pid_data_t pid;
+  x8_motor_error_t    error;
+
+  struct x8_can_stats *stats;             // Received frame counters (x8_can_stats.h), NULL => not counted
+  struct x8_can_latency *latency;         // Read latency replies (x8_can_latency.h), NULL => not timed
+  struct x8_can_group *group;             // Broadcast torque group (x8_can_group.h), NULL => none
+  struct x8_can_shadow *shadow;           // Receive time of the values above (x8_can_shadow.h), NULL => none
 }
-x8_can_msg_torque_close_loop_cmd_t;
+x8_can_t;
 
 /**
- * @brief Can message speed close loop command
+ * @brief Registry of motors sharing one CAN bus, indexed by motor id
  */
 typedef struct
 {
-  uint8_t cmd_byte;
-  uint8_t data1;
-  uint8_t data2;
-  uint8_t data3;
-  uint8_t speed_ctrl_lowest;
-  uint8_t speed_ctrl_low;
-  uint8_t speed_ctrl_high;
-  uint8_t speed_ctrl_highest;
+  x8_can_t *motor[X8_CAN_REGISTRY_MOTORS];  // Motors 1 ... X8_CAN_REGISTRY_MOTORS
 }
-x8_can_msg_speed_close_loop_cmd_t;
+x8_can_registry_t;
 
+/* Public macros ------------------------------------------------------ */
+#define RMD_X8_CAN_MSG_ID_OF(motor_id)          (RMD_X8_CAN_MSG_ID_BASE + (motor_id))
+#define RMD_X8_MOTOR_ID_OF(msg_id)              ((msg_id) - RMD_X8_CAN_MSG_ID_BASE)
+
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
 /**
- * @brief Can message position control command 1
+ * @brief       Encode a command without payload (read, motor off/stop/run)
+ *
+ * @param[out]  can_data        Pointer to can data (8 bytes)
+ * @param[in]   cmd_byte        Command byte
+ *
+ * @attention   Encoders only write to can_data, they are reentrant
+ *
+ * @return      None
  */
-typedef struct
-{
-  uint8_t cmd_byte;
-  uint8_t data1;
-  uint8_t data2;
-  uint8_t data3;
-  uint8_t pos_ctrl_lowest;
-  uint8_t pos_ctrl_low;
-  uint8_t pos_ctrl_high;
-  uint8_t pos_ctrl_highest;
-}
-x8_can_msg_position_ctrl_1_cmd_t;
+void x8_can_encode_cmd(uint8_t *can_data, uint8_t cmd_byte);
+
 /**
- * @brief Can message position control command 2
+ * @brief       Encode write pid cmd
+ *
+ * @param[out]  can_data        Pointer to can data (8 bytes)
+ * @param[in]   pid             Kp/Ki of angle, speed and torque loop
+ *              rom             true => kept after power off (0x32), false => RAM (0x31)
+ *
+ * @attention   Every ROM write wears the motor flash, tune in RAM first
+ *
+ * @return      None
  */
-typedef struct
-{
-  uint8_t cmd_byte;
-  uint8_t data1;
-  uint8_t speed_limited_low;
-  uint8_t speed_limited_high;
-  uint8_t pos_ctrl_lowest;
-  uint8_t pos_ctrl_low;
-  uint8_t pos_ctrl_high;
-  uint8_t pos_ctrl_highest;
-}
-x8_can_msg_position_ctrl_2_cmd_t;
+void x8_can_encode_write_pid_cmd(uint8_t *can_data, const x8_motor_pid_data_t *pid, bool rom);
 
 /**
- * @brief Can message position control command 3
+ * @brief       Encode write acceleration cmd
+ *
+ * @param[out]  can_data        Pointer to can data (8 bytes)
+ * @param[in]   acceleration    Acceleration (1 => 1 dps/s)
+ *
+ * @attention   None
+ *
+ * @return      None
  */
-typedef struct
-{
-  uint8_t cmd_byte;
-  uint8_t spin_dir;
-  uint8_t data2;
-  uint8_t data3;
-  uint8_t pos_ctrl_low;
-  uint8_t pos_ctrl_high;
-  uint8_t data6;
-  uint8_t data7;
-}
-x8_can_msg_position_ctrl_3_cmd_t;
+void x8_can_encode_acceleration_cmd(uint8_t *can_data, int32_t acceleration);
 
 /**
- * @brief Can message position control command 4
+ * @brief       Encode encoder offset cmd
+ *
+ * @param[out]  can_data        Pointer to can data (8 bytes)
+ * @param[in]   encoder_offset  Encoder offset
+ *
+ * @attention   None
+ *
+ * @return      None
  */
-typedef struct
-{
-  uint8_t cmd_byte;
-  uint8_t spin_dir;
-  uint8_t speed_limited_low;
-  uint8_t speed_limited_high;
-  uint8_t pos_ctrl_low;
-  uint8_t pos_ctrl_high;
-  uint8_t data6;
-  uint8_t data7;
-}
-x8_can_msg_position_ctrl_4_cmd_t;
+void x8_can_encode_encoder_offset_cmd(uint8_t *can_data, uint16_t encoder_offset);
 
 /**
- * @brief Can receive message motor status
+ * @brief       Encode torque close loop cmd
+ *
+ * @param[out]  can_data        Pointer to can data (8 bytes)
+ * @param[in]   torque          Torque
+ *
+ * @attention   None
+ *
+ * @return      None
  */
-typedef struct
-{
-  uint8_t cmd_byte;
-  uint8_t temperature;
-  uint8_t iq_low;
-  uint8_t iq_high;
-  uint8_t speed_low;
-  uint8_t speed_high;
-  uint8_t encoder_low;
-  uint8_t encoder_high;
-}
-x8_can_receive_msg_motor_status_t;
+void x8_can_encode_torque_close_loop_cmd(uint8_t *can_data, int16_t torque);
 
 /**
- * @brief Can receive message multi turn angle command
+ * @brief       Encode multi motor torque cmd, sent on RMD_X8_CAN_MULTI_TORQUE_MSG_ID
+ *
+ * @param[out]  can_data        Pointer to can data (8 bytes)
+ * @param[in]   torque          Torque of motors 1 ... RMD_X8_MULTI_TORQUE_MOTORS
+ *
+ * @attention   No command byte, each motor answers like 0xA1
+ *
+ * @return      None
  */
-typedef struct
-{
-  uint8_t cmd_byte;
-  uint8_t motor_angle_low_1;
-  uint8_t motor_angle_2;
-  uint8_t motor_angle_3;
-  uint8_t motor_angle_4;
-  uint8_t motor_angle_5;
-  uint8_t motor_angle_6;
-  uint8_t motor_angle_7;
-}
-x8_can_receive_msg_multi_turn_angle_t;
+void x8_can_encode_multi_torque_cmd(uint8_t *can_data, const int16_t *torque);
 
 /**
- * @brief Can receive message pid data
+ * @brief       Encode speed close loop cmd
+ *
+ * @param[out]  can_data        Pointer to can data (8 bytes)
+ * @param[in]   speed           Speed (1 => 1 rpm)
+ *
+ * @attention   None
+ *
+ * @return      None
  */
-typedef struct
-{
-  uint8_t cmd_byte;
-  uint8_t data1;
-  uint8_t angle_kp;
-  uint8_t angle_ki;
-  uint8_t speed_kp;
-  uint8_t speed_ki;
-  uint8_t torque_kp;
-  uint8_t torque_ki;
-}
-x8_can_receive_msg_pid_t;
+void x8_can_encode_speed_close_loop_cmd(uint8_t *can_data, int32_t speed);
+
+/**
+ * @brief       Encode position control cmd 1
+ *
+ * @param[out]  can_data        Pointer to can data (8 bytes)
+ * @param[in]   pos_ctrl        Position control
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_encode_position_ctrl_1_cmd(uint8_t *can_data, int32_t pos_ctrl);
+
+/**
+ * @brief       Encode position control cmd 2
+ *
+ * @param[out]  can_data        Pointer to can data (8 bytes)
+ * @param[in]   speed_limited   Speed limited
+ *              pos_ctrl        Position control (1=> 1 degree; 360 => 360 degree (1 circle))
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_encode_position_ctrl_2_cmd(uint8_t *can_data, uint16_t speed_limited, int32_t pos_ctrl);
+
+/**
+ * @brief       Encode position control cmd 3
+ *
+ * @param[out]  can_data        Pointer to can data (8 bytes)
+ * @param[in]   pos_ctrl        Position control (1=> 1 degree; 360 => 360 degree (1 circle))
+ *              dir             Direction
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_encode_position_ctrl_3_cmd(uint8_t *can_data, uint16_t pos_ctrl, x8_motor_dir_type_t dir);
+
+/**
+ * @brief       Encode position control cmd 4
+ *
+ * @param[out]  can_data        Pointer to can data (8 bytes)
+ * @param[in]   pos_ctrl        Position control
+ *              speed_limited   Speed limited
+ *              dir             Direction
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_encode_position_ctrl_4_cmd(uint8_t *can_data, uint16_t pos_ctrl, uint16_t speed_limited, x8_motor_dir_type_t dir);
+
+/**
+ * @brief       Can send write pid cmd
+ *
+ * @param[in]   me              Pointer to can handler
+ *              pid             Kp/Ki of angle, speed and torque loop
+ *              rom             true => kept after power off (0x32), false => RAM (0x31)
+ *
+ * @attention   Every ROM write wears the motor flash, tune in RAM first
+ *
+ * @return      None
+ */
+void x8_can_send_write_pid_cmd(x8_can_t *me, const x8_motor_pid_data_t *pid, bool rom);
+
+/**
+ * @brief       Can send write acceleration cmd
+ *
+ * @param[in]   me              Pointer to can handler
+ *              acceleration    Acceleration (1 => 1 dps/s)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_send_acceleration_cmd(x8_can_t *me, int32_t acceleration);
 
-/* Public macros ------------------------------------------------------ */
-/* Public variables --------------------------------------------------- */
-/* Public function prototypes ----------------------------------------- */
 /**
  * @brief       Can send encoder offset cmd
  *
@@ -387,6 +420,18 @@ void x8_can_send_position_ctrl_3_cmd(x8_can_t *me , uint16_t pos_ctrl,  x8_motor
  */
 void x8_can_send_position_ctrl_4_cmd(x8_can_t *me ,uint16_t pos_ctrl, uint16_t speed_limited, x8_motor_dir_type_t dir);
 
+/**
+ * @brief       Can send command without payload (read, motor off/stop/run)
+ *
+ * @param[in]   me              Pointer to can handler
+ *              cmd_byte        Command byte
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_send_cmd(x8_can_t *me, uint8_t cmd_byte);
+
 /**
  * @brief       Can send get motor status
  *
@@ -421,12 +466,12 @@ void x8_can_send_get_motor_multi_turn_angle(x8_can_t *me);
 void x8_can_send_get_pid_data(x8_can_t *me);
 
 /**
- * @brief       Get motor status
+ * @brief       Get motor status from a 0x9C or 0xA1 ... 0xA6 reply
  *
  * @param[in]   can_rx_data       Pointer to can rx data
  *              motor_status      Pointer to motor status structure
  *
- * @attention   None
+ * @attention   Decoders only read can_rx_data, they are reentrant
  *
  * @return      None
  */
@@ -456,6 +501,18 @@ void x8_can_get_motor_multi_turn_angle(uint8_t *can_rx_data, int64_t *multi_turn
  */
 void x8_can_get_pid_data(uint8_t *can_rx_data, x8_motor_pid_data_t *motor_pid);
 
+/**
+ * @brief       Get motor status 1, reply of 0x9A and 0x9B
+ *
+ * @param[in]   can_rx_data       Pointer to can rx data
+ * @param[in]   motor_error       Pointer to motor error structure
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_get_motor_error(uint8_t *can_rx_data, x8_motor_error_t *motor_error);
+
 /**
  * @brief       Send motor command
  *
@@ -468,6 +525,108 @@ void x8_can_get_pid_data(uint8_t *can_rx_data, x8_motor_pid_data_t *motor_pid);
  */
 void x8_can_send_motor_command(x8_can_t *me, x8_motor_command_t command);
 
+/**
+ * @brief       Decode a reply frame of this motor into its handler
+ *
+ * @param[in]   me                Pointer to can handler
+ * @param[in]   can_rx_data       Pointer to can rx data
+ *
+ * @attention   Frame must come from CAN ID RMD_X8_CAN_MSG_ID_OF(me->motor_id).
+ *              Replies of 0xA1 ... 0xA6 update status like 0x9C. The shadow
+ *              is stamped with the time of the call, x8_can_receive_at takes
+ *              the receive time of the frame.
+ *
+ * @return      None
+ */
+void x8_can_receive(x8_can_t *me, uint8_t *can_rx_data);
+
+/**
+ * @brief       Decode a reply frame of this motor received at a given time
+ *
+ * @param[in]   me                Pointer to can handler
+ * @param[in]   can_rx_data       Pointer to can rx data
+ * @param[in]   rx_us             Receive time of the frame (us), clock of x8_can_t::shadow
+ *
+ * @attention   As x8_can_receive
+ *
+ * @return      None
+ */
+void x8_can_receive_at(x8_can_t *me, uint8_t *can_rx_data, uint32_t rx_us);
+
+/**
+ * @brief       Clear all motors of registry
+ *
+ * @param[in]   reg               Pointer to registry
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_registry_init(x8_can_registry_t *reg);
+
+/**
+ * @brief       Add motor to registry
+ *
+ * @param[in]   reg               Pointer to registry
+ * @param[in]   me                Pointer to can handler, motor_id must be set
+ *
+ * @attention   None
+ *
+ * @return      true if added, false if motor id is invalid or already used
+ */
+bool x8_can_registry_add(x8_can_registry_t *reg, x8_can_t *me);
+
+/**
+ * @brief       Find motor by motor id
+ *
+ * @param[in]   reg               Pointer to registry
+ * @param[in]   motor_id          Motor id (1 ... 32)
+ *
+ * @attention   None
+ *
+ * @return      Pointer to can handler, NULL if not registered
+ */
+x8_can_t *x8_can_registry_get(x8_can_registry_t *reg, uint8_t motor_id);
+
+/**
+ * @brief       Route a received frame to its motor and decode it
+ *
+ * @param[in]   reg               Pointer to registry
+ * @param[in]   msg_id            CAN ID of received frame
+ * @param[in]   can_rx_data       Pointer to can rx data
+ *
+ * @attention   None
+ *
+ * @return      Pointer to can handler that received the frame, NULL if none
+ */
+x8_can_t *x8_can_registry_receive(x8_can_registry_t *reg, uint16_t msg_id, uint8_t *can_rx_data);
+
+/**
+ * @brief       Route a frame received at a given time to its motor and decode it
+ *
+ * @param[in]   reg               Pointer to registry
+ * @param[in]   msg_id            CAN ID of received frame
+ * @param[in]   can_rx_data       Pointer to can rx data
+ * @param[in]   rx_us             Receive time of the frame (us), e.g. x8_can_frame_t::timestamp_us
+ *
+ * @attention   None
+ *
+ * @return      Pointer to can handler that received the frame, NULL if none
+ */
+x8_can_t *x8_can_registry_receive_at(x8_can_registry_t *reg, uint16_t msg_id, uint8_t *can_rx_data, uint32_t rx_us);
+
+/**
+ * @brief       Motor a frame comes from, without decoding it
+ *
+ * @param[in]   reg               Pointer to registry
+ * @param[in]   msg_id            CAN ID of received frame
+ *
+ * @attention   None
+ *
+ * @return      Pointer to can handler, NULL if none
+ */
+x8_can_t *x8_can_registry_route(x8_can_registry_t *reg, uint16_t msg_id);
+
 #endif // __X8_CAN_H
 
 /* End of file -------------------------------------------------------- */
@@ -0,0 +1,99 @@
+/**
+ * @file       x8_can_batch.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Decode arrays of frames into column arrays
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_batch.h"
+#include "x8_can_codec.h"
+
+/* Private defines ---------------------------------------------------- */
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static inline uint8_t m_x8_can_batch_motor_id(const x8_can_frame_t *frame);
+
+/* Function definitions ----------------------------------------------- */
+void x8_can_batch_decode(const x8_can_frame_t *frame, uint32_t count, x8_can_batch_t *out)
+{
+  typedef x8_can_layout_motor_status_2 status;
+  typedef x8_can_layout_multi_turn_angle angle;
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    const uint8_t *can_data = frame[i].data;
+    uint8_t kind = x8_can_batch_kind(&frame[i]);
+
+    // All ones on rows of the kind, else 0: values are masked, not branched on
+    int16_t status_mask = (int16_t)-(int16_t)(kind == X8_CAN_BATCH_STATUS);
+    int64_t angle_mask  = (int64_t)-(int64_t)(kind == X8_CAN_BATCH_ANGLE);
+
+    // Column tests are the same on every row, they are always predicted
+    if (out->timestamp_us != NULL)
+      out->timestamp_us[i] = frame[i].timestamp_us;
+
+    if (out->motor_id != NULL)
+      out->motor_id[i] = m_x8_can_batch_motor_id(&frame[i]);
+
+    if (out->kind != NULL)
+      out->kind[i] = kind;
+
+    if (out->temperature != NULL)
+      out->temperature[i] = (int8_t)(status::temperature::decode(can_data) & status_mask);
+
+    if (out->torque_current != NULL)
+      out->torque_current[i] = (int16_t)(status::torque_current::decode(can_data) & status_mask);
+
+    if (out->speed != NULL)
+      out->speed[i] = (int16_t)(status::speed::decode(can_data) & status_mask);
+
+    if (out->encoder != NULL)
+      out->encoder[i] = (uint16_t)(status::encoder::decode(can_data) & (uint16_t)status_mask);
+
+    if (out->multi_turn_angle != NULL)
+      out->multi_turn_angle[i] = angle::angle::decode(can_data) & angle_mask;
+  }
+}
+
+uint8_t x8_can_batch_kind(const x8_can_frame_t *frame)
+{
+  uint8_t cmd_byte = frame->data[0];
+
+  // Bitwise operators instead of && and || keep the decode loop branch free
+  uint8_t reply  = (uint8_t)(((frame->flags & X8_CAN_FRAME_TX) == 0) & (m_x8_can_batch_motor_id(frame) != 0));
+  uint8_t status = (uint8_t)((cmd_byte == RMD_X8_READ_MOTOR_STATUS_2_CMD) |
+                             ((uint8_t)(cmd_byte - RMD_X8_TORQUE_CLOSED_LOOP_CMD) <=
+                              (uint8_t)(RMD_X8_POSITION_CTRL_4_CMD - RMD_X8_TORQUE_CLOSED_LOOP_CMD)));
+  uint8_t angle  = (uint8_t)(cmd_byte == RMD_X8_READ_MULTI_TURNS_ANGLE_CMD);
+
+  return (uint8_t)(reply * (status * X8_CAN_BATCH_STATUS + angle * X8_CAN_BATCH_ANGLE));
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Motor id of a frame
+ *
+ * @param[in]   frame         Pointer to frame
+ *
+ * @attention   None
+ *
+ * @return      1 ... RMD_X8_MOTOR_ID_MAX, 0 if the ID is not a motor ID
+ */
+static inline uint8_t m_x8_can_batch_motor_id(const x8_can_frame_t *frame)
+{
+  uint16_t motor_id = (uint16_t)RMD_X8_MOTOR_ID_OF(frame->msg_id);
+  uint8_t  valid    = (uint8_t)((uint16_t)(motor_id - RMD_X8_MOTOR_ID_MIN) < RMD_X8_MOTOR_ID_MAX);
+
+  return (uint8_t)(motor_id & -(int16_t)valid);
+}
+
+/* End of file -------------------------------------------------------- */
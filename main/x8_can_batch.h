@@ -0,0 +1,90 @@
+/**
+ * @file       x8_can_batch.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Decode arrays of frames into column arrays
+ * @note       Row i of every column belongs to frame i. Frames are decoded in
+ *             one pass without a branch on the frame content: every row is
+ *             decoded as each reply kind and the values masked, so mixed
+ *             traffic costs no branch misses and no call per frame. Columns
+ *             left NULL are not decoded.
+ *             Values of a row that is not a reply of that kind are 0, the
+ *             kind column tells them apart from real zeros. Frames flagged
+ *             X8_CAN_FRAME_TX are requests and have no kind.
+ * @example    x8_can_batch_t out = { 0 };
+ *             out.kind  = kind;
+ *             out.speed = speed;
+ *             x8_can_batch_decode(frames, count, &out);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_BATCH_H
+#define __X8_CAN_BATCH_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Reply kind of a row
+ */
+typedef enum
+{
+  X8_CAN_BATCH_OTHER,           // Request, unknown ID or a reply without columns
+  X8_CAN_BATCH_STATUS,          // 0x9C or 0xA1 ... 0xA6 reply: temperature, torque_current, speed, encoder
+  X8_CAN_BATCH_ANGLE            // 0x92 reply: multi_turn_angle
+}
+x8_can_batch_kind_t;
+
+/**
+ * @brief Column arrays, NULL => column not wanted
+ */
+typedef struct
+{
+  uint32_t *timestamp_us;
+  uint8_t  *motor_id;           // 0 for IDs outside the motor range
+  uint8_t  *kind;               // x8_can_batch_kind_t
+
+  int8_t   *temperature;        // 1 degC
+  int16_t  *torque_current;     // Iq, -2048 ... 2048 => -33 A ... 33 A
+  int16_t  *speed;              // 1 rpm
+  uint16_t *encoder;            // 0 ... 65535
+  int64_t  *multi_turn_angle;   // 1 deg of the output shaft (wire 0.01 deg / 600)
+}
+x8_can_batch_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Decode frames into columns
+ *
+ * @param[in]   frame         Pointer to frames
+ * @param[in]   count         Number of frames
+ * @param[out]  out           Columns, each non-NULL one holds count values
+ *
+ * @attention   Same units as x8_can_get_motor_status() and
+ *              x8_can_get_motor_multi_turn_angle()
+ *
+ * @return      None
+ */
+void x8_can_batch_decode(const x8_can_frame_t *frame, uint32_t count, x8_can_batch_t *out);
+
+/**
+ * @brief       Reply kind of a frame
+ *
+ * @param[in]   frame         Pointer to frame
+ *
+ * @attention   None
+ *
+ * @return      x8_can_batch_kind_t
+ */
+uint8_t x8_can_batch_kind(const x8_can_frame_t *frame);
+
+#endif // __X8_CAN_BATCH_H
+
+/* End of file -------------------------------------------------------- */
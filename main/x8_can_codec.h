@@ -0,0 +1,358 @@
+/**
+ * @file       x8_can_codec.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Compile-time frame layouts of the RMD X8 PRO CAN protocol
+ * @note       Each command is described once as a type. Encoders and decoders
+ *             are generated from the layout and inline to plain shifts and
+ *             stores, an unused layout costs no flash.
+ * @example    x8_can_layout_speed_close_loop::encode(can_data, 100);
+ *             speed = x8_can_layout_motor_status_2::speed::decode(can_data);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_CODEC_H
+#define __X8_CAN_CODEC_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Compile-time type selection (no <type_traits> on AVR)
+ */
+template <bool COND, typename T, typename F>
+struct x8_can_select
+{
+  typedef T type;
+};
+
+template <typename T, typename F>
+struct x8_can_select<false, T, F>
+{
+  typedef F type;
+};
+
+/**
+ * @brief Little endian bytes [OFFSET, OFFSET + WIDTH) of can data
+ */
+template <uint8_t OFFSET, uint8_t WIDTH>
+struct x8_can_bytes
+{
+  template <typename T>
+  static inline void put(uint8_t *can_data, T value)
+  {
+    can_data[OFFSET] = (uint8_t)value;
+    x8_can_bytes<OFFSET + 1, WIDTH - 1>::put(can_data, (T)(value >> 8));
+  }
+
+  template <typename T>
+  static inline T get(const uint8_t *can_data)
+  {
+    return (T)((T)can_data[OFFSET] | (T)(x8_can_bytes<OFFSET + 1, WIDTH - 1>::template get<T>(can_data) << 8));
+  }
+};
+
+template <uint8_t OFFSET>
+struct x8_can_bytes<OFFSET, 0>
+{
+  template <typename T>
+  static inline void put(uint8_t *, T)
+  {
+  }
+
+  template <typename T>
+  static inline T get(const uint8_t *)
+  {
+    return 0;
+  }
+};
+
+/**
+ * @brief Field of a frame
+ *
+ * @tparam OFFSET   First byte of the field in can data (1 ... 7, 0 in frames without command byte)
+ * @tparam WIDTH    Number of bytes, little endian (1 ... 7)
+ * @tparam SIGNED   Two's complement field
+ * @tparam SCALE    Wire value = API value * SCALE (e.g. 600 => 1 degree to 0.01 degree of motor shaft)
+ */
+template <uint8_t OFFSET, uint8_t WIDTH, bool SIGNED, int32_t SCALE = 1>
+struct x8_can_field
+{
+  enum
+  {
+    offset = OFFSET,
+    width  = WIDTH,
+    mask   = ((1u << WIDTH) - 1u) << OFFSET     // Bytes covered by the field
+  };
+
+  // Unsigned type holding the wire bytes
+  typedef typename x8_can_select<(WIDTH <= 2), uint16_t,
+          typename x8_can_select<(WIDTH <= 4), uint32_t, uint64_t>::type>::type wire_t;
+
+  // Signed counterpart of the wire type
+  typedef typename x8_can_select<(WIDTH <= 2), int16_t,
+          typename x8_can_select<(WIDTH <= 4), int32_t, int64_t>::type>::type swire_t;
+
+  // Type seen by the API
+  typedef typename x8_can_select<(WIDTH > 4), int64_t,
+          typename x8_can_select<((SCALE == 1) && (WIDTH <= 2)),
+                                 typename x8_can_select<SIGNED, int16_t, uint16_t>::type,
+                                 int32_t>::type>::type value_t;
+
+  // Unsigned type the scaling is done in, wraps instead of overflowing
+  typedef typename x8_can_select<(WIDTH > 4), uint64_t,
+          typename x8_can_select<(SCALE == 1), wire_t, uint32_t>::type>::type calc_t;
+
+  static inline void encode(uint8_t *can_data, value_t value)
+  {
+    x8_can_bytes<OFFSET, WIDTH>::put(can_data, (wire_t)((calc_t)value * (calc_t)SCALE));
+  }
+
+  static inline value_t decode(const uint8_t *can_data)
+  {
+    wire_t raw = x8_can_bytes<OFFSET, WIDTH>::template get<wire_t>(can_data);
+
+    if (SIGNED)
+    {
+      // Sign extend WIDTH bytes to the wire type
+      const wire_t sign = (wire_t)((wire_t)1 << (8 * WIDTH - 1));
+      raw = (wire_t)((raw ^ sign) - sign);
+
+      return (value_t)((value_t)(swire_t)raw / SCALE);
+    }
+
+    return (value_t)((value_t)raw / SCALE);
+  }
+};
+
+/**
+ * @brief Zero the bytes 1 ... 7 not covered by MASK
+ */
+template <uint16_t MASK, uint8_t INDEX = 1>
+struct x8_can_pad
+{
+  static inline void put(uint8_t *can_data)
+  {
+    if (!(MASK & (1u << INDEX)))
+    {
+      can_data[INDEX] = 0;
+    }
+    x8_can_pad<MASK, INDEX + 1>::put(can_data);
+  }
+};
+
+template <uint16_t MASK>
+struct x8_can_pad<MASK, 8>
+{
+  static inline void put(uint8_t *)
+  {
+  }
+};
+
+/**
+ * @brief Union of the byte masks of FIELDS
+ */
+template <typename... FIELDS>
+struct x8_can_mask;
+
+template <>
+struct x8_can_mask<>
+{
+  enum { value = 0 };
+};
+
+template <typename FIELD, typename... FIELDS>
+struct x8_can_mask<FIELD, FIELDS...>
+{
+  enum { value = (int)FIELD::mask | (int)x8_can_mask<FIELDS...>::value };
+};
+
+/**
+ * @brief Command frame: command byte followed by FIELDS, encode() takes one value per field
+ */
+template <uint8_t CMD, typename... FIELDS>
+struct x8_can_msg
+{
+  enum { cmd_byte = CMD };
+
+  static_assert((x8_can_mask<FIELDS...>::value & 0x01) == 0, "Field overlaps command byte");
+  static_assert((x8_can_mask<FIELDS...>::value & ~0xFF) == 0, "Field beyond 8 bytes");
+
+  static inline void encode(uint8_t *can_data, typename FIELDS::value_t... values)
+  {
+    int unused[] = { 0, (FIELDS::encode(can_data, values), 0)... };
+
+    (void)unused;
+    can_data[0] = CMD;
+    x8_can_pad<x8_can_mask<FIELDS...>::value>::put(can_data);
+  }
+};
+
+/* Command layouts ---------------------------------------------------- */
+typedef x8_can_msg<RMD_X8_READ_PID_DATA_CMD>              x8_can_layout_read_pid;
+typedef x8_can_msg<RMD_X8_READ_ACCELERATION_CMD>          x8_can_layout_read_acceleration;
+typedef x8_can_msg<RMD_X8_READ_ENCODE_DATA_CMD>           x8_can_layout_read_encoder;
+typedef x8_can_msg<RMD_X8_WRITE_CURRENT_POSITION_CMD>     x8_can_layout_write_current_position;
+typedef x8_can_msg<RMD_X8_READ_MULTI_TURNS_ANGLE_CMD>     x8_can_layout_read_multi_turn_angle;
+typedef x8_can_msg<RMD_X8_READ_SINGLE_CIRCLE_ANGLE_CMD>   x8_can_layout_read_single_circle_angle;
+typedef x8_can_msg<RMD_X8_READ_MOTOR_STATUS_CMD>          x8_can_layout_read_motor_status_1;
+typedef x8_can_msg<RMD_X8_CLEAR_MOTOR_ERROR_FLAG_CMD>     x8_can_layout_clear_motor_error;
+typedef x8_can_msg<RMD_X8_READ_MOTOR_STATUS_2_CMD>        x8_can_layout_read_motor_status_2;
+typedef x8_can_msg<RMD_X8_READ_MOTOR_STATUS_3_CMD>        x8_can_layout_read_motor_status_3;
+typedef x8_can_msg<RMD_X8_MOTOR_OFF_CMD>                  x8_can_layout_motor_off;
+typedef x8_can_msg<RMD_X8_MOTOR_STOP_CMD>                 x8_can_layout_motor_stop;
+typedef x8_can_msg<RMD_X8_MOTOR_RUNNING_CMD>              x8_can_layout_motor_run;
+
+// Kp/Ki of angle, speed and torque loop
+typedef x8_can_msg<RMD_X8_WRITE_PID_TO_RAM_CMD,
+                   x8_can_field<2, 1, false>, x8_can_field<3, 1, false>,
+                   x8_can_field<4, 1, false>, x8_can_field<5, 1, false>,
+                   x8_can_field<6, 1, false>, x8_can_field<7, 1, false> >  x8_can_layout_write_pid_to_ram;
+
+typedef x8_can_msg<RMD_X8_WRITE_PID_TO_ROM_CMD,
+                   x8_can_field<2, 1, false>, x8_can_field<3, 1, false>,
+                   x8_can_field<4, 1, false>, x8_can_field<5, 1, false>,
+                   x8_can_field<6, 1, false>, x8_can_field<7, 1, false> >  x8_can_layout_write_pid_to_rom;
+
+// Acceleration (1 dps/s)
+typedef x8_can_msg<RMD_X8_WRITE_ACCELERATION_CMD,
+                   x8_can_field<4, 4, true> >                               x8_can_layout_write_acceleration;
+
+// Encoder offset
+typedef x8_can_msg<RMD_X8_WRITE_ENCODER_OFFSET_CMD,
+                   x8_can_field<6, 2, false> >                              x8_can_layout_write_encoder_offset;
+
+// Torque current (-2000 ... 2000)
+typedef x8_can_msg<RMD_X8_TORQUE_CLOSED_LOOP_CMD,
+                   x8_can_field<4, 2, true> >                               x8_can_layout_torque_close_loop;
+
+// Speed (1 rpm => 0.01 dps)
+typedef x8_can_msg<RMD_X8_SPEED_CLOSED_LOOP_CMD,
+                   x8_can_field<4, 4, true, 600> >                          x8_can_layout_speed_close_loop;
+
+// Position (1 degree => 0.01 degree of motor shaft)
+typedef x8_can_msg<RMD_X8_POSITION_CTRL_1_CMD,
+                   x8_can_field<4, 4, true, 600> >                          x8_can_layout_position_ctrl_1;
+
+// Speed limited (1 rpm => 1 dps), position (1 degree => 0.01 degree of motor shaft)
+typedef x8_can_msg<RMD_X8_POSITION_CTRL_2_CMD,
+                   x8_can_field<2, 2, false, 6>,
+                   x8_can_field<4, 4, true, 600> >                          x8_can_layout_position_ctrl_2;
+
+// Direction, position (1 degree => 0.01 degree of motor shaft)
+typedef x8_can_msg<RMD_X8_POSITION_CTRL_3_CMD,
+                   x8_can_field<1, 1, false>,
+                   x8_can_field<4, 2, false, 600> >                         x8_can_layout_position_ctrl_3;
+
+// Direction, speed limited (1 rpm => 1 dps), position (1 degree => 0.01 degree of motor shaft)
+typedef x8_can_msg<RMD_X8_POSITION_CTRL_4_CMD,
+                   x8_can_field<1, 1, false>,
+                   x8_can_field<2, 2, false, 6>,
+                   x8_can_field<4, 2, false, 600> >                         x8_can_layout_position_ctrl_4;
+
+/**
+ * @brief Torque current (-2000 ... 2000) of motors 1 ... 4 on CAN ID 0x280, no command byte
+ */
+struct x8_can_layout_multi_torque
+{
+  typedef x8_can_field<0, 2, true>   torque_1;
+  typedef x8_can_field<2, 2, true>   torque_2;
+  typedef x8_can_field<4, 2, true>   torque_3;
+  typedef x8_can_field<6, 2, true>   torque_4;
+
+  static inline void encode(uint8_t *can_data, int16_t t1, int16_t t2, int16_t t3, int16_t t4)
+  {
+    torque_1::encode(can_data, t1);
+    torque_2::encode(can_data, t2);
+    torque_3::encode(can_data, t3);
+    torque_4::encode(can_data, t4);
+  }
+};
+
+/* Reply layouts ------------------------------------------------------ */
+/**
+ * @brief Reply of 0x30, 0x31, 0x32
+ */
+struct x8_can_layout_pid
+{
+  typedef x8_can_field<2, 1, false>  angle_kp;
+  typedef x8_can_field<3, 1, false>  angle_ki;
+  typedef x8_can_field<4, 1, false>  speed_kp;
+  typedef x8_can_field<5, 1, false>  speed_ki;
+  typedef x8_can_field<6, 1, false>  torque_kp;
+  typedef x8_can_field<7, 1, false>  torque_ki;
+};
+
+/**
+ * @brief Reply of 0x33, 0x34
+ */
+struct x8_can_layout_acceleration
+{
+  typedef x8_can_field<4, 4, true>   acceleration;
+};
+
+/**
+ * @brief Reply of 0x90, 0x91 and 0x19 (offset only)
+ */
+struct x8_can_layout_encoder
+{
+  typedef x8_can_field<2, 2, false>  encoder;
+  typedef x8_can_field<4, 2, false>  encoder_raw;
+  typedef x8_can_field<6, 2, false>  encoder_offset;
+};
+
+/**
+ * @brief Reply of 0x92, 56 bit angle (0.01 degree of motor shaft => 1 degree)
+ */
+struct x8_can_layout_multi_turn_angle
+{
+  typedef x8_can_field<1, 7, true, 600> angle;
+};
+
+/**
+ * @brief Reply of 0x94 (0.01 degree, 0 ... 35999)
+ */
+struct x8_can_layout_single_circle_angle
+{
+  typedef x8_can_field<6, 2, false>  circle_angle;
+};
+
+/**
+ * @brief Reply of 0x9A, 0x9B
+ */
+struct x8_can_layout_motor_status_1
+{
+  typedef x8_can_field<1, 1, true>   temperature;
+  typedef x8_can_field<3, 2, false>  voltage;         // 0.1 V
+  typedef x8_can_field<7, 1, false>  error_state;
+};
+
+/**
+ * @brief Reply of 0x9C and of the 0xA1 ... 0xA6 control commands
+ */
+struct x8_can_layout_motor_status_2
+{
+  typedef x8_can_field<1, 1, true>   temperature;
+  typedef x8_can_field<2, 2, true>   torque_current;
+  typedef x8_can_field<4, 2, true, 6> speed;          // 1 dps => 1 rpm
+  typedef x8_can_field<6, 2, false>  encoder;
+};
+
+/**
+ * @brief Reply of 0x9D
+ */
+struct x8_can_layout_motor_status_3
+{
+  typedef x8_can_field<1, 1, true>   temperature;
+  typedef x8_can_field<2, 2, true>   phase_a_current;
+  typedef x8_can_field<4, 2, true>   phase_b_current;
+  typedef x8_can_field<6, 2, true>   phase_c_current;
+};
+
+#endif // __X8_CAN_CODEC_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,175 @@
+/**
+ * @file       x8_can_config.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Sizing of the x8_can library tables
+ * @note       Every value can be overridden from the compiler command line.
+ *             The AVR values are sized for the sketch on an ATmega328P (Uno,
+ *             Nano, 2 KB): RMD_X8_NUM_OF_MOTORS and the multi torque group of
+ *             motors 1 ... 4. Check the RAM left for the stack with avr-size
+ *             after raising any of them.
+ * @example    None
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_CONFIG_H
+#define __X8_CAN_CONFIG_H
+
+/* Public defines ----------------------------------------------------- */
+// Motors 1 ... N can be added to a registry, frames of the others are not routed
+#ifndef X8_CAN_REGISTRY_MOTORS
+#if defined(__AVR__)
+#define X8_CAN_REGISTRY_MOTORS                  (4)
+#else
+#define X8_CAN_REGISTRY_MOTORS                  (32)
+#endif
+#endif
+
+// Number of reads that can be in flight at the same time, all motors included
+#ifndef X8_CAN_REQUEST_TABLE_SIZE
+#if defined(__AVR__)
+#define X8_CAN_REQUEST_TABLE_SIZE               (4)
+#else
+#define X8_CAN_REQUEST_TABLE_SIZE               (64)
+#endif
+#endif
+
+// Number of received frames buffered between CAN interrupt and main loop (power of 2, <= 128)
+#ifndef X8_CAN_RX_RING_SIZE
+#if defined(__AVR__)
+#define X8_CAN_RX_RING_SIZE                     (8)
+#else
+#define X8_CAN_RX_RING_SIZE                     (128)
+#endif
+#endif
+
+// Motors 1 ... N get a latest-wins setpoint slot in the tx scheduler, others are queued
+#ifndef X8_CAN_TX_SETPOINT_MOTORS
+#if defined(__AVR__)
+#define X8_CAN_TX_SETPOINT_MOTORS               (4)
+#else
+#define X8_CAN_TX_SETPOINT_MOTORS               (32)
+#endif
+#endif
+
+// Number of queued frames other than stop/off and setpoints (power of 2, <= 128)
+#ifndef X8_CAN_TX_QUEUE_SIZE
+#if defined(__AVR__)
+#define X8_CAN_TX_QUEUE_SIZE                    (4)
+#else
+#define X8_CAN_TX_QUEUE_SIZE                    (64)
+#endif
+#endif
+
+// Number of periodic telemetry streams, one per motor and command
+#ifndef X8_CAN_TELEMETRY_STREAMS
+#if defined(__AVR__)
+#define X8_CAN_TELEMETRY_STREAMS                (4)
+#else
+#define X8_CAN_TELEMETRY_STREAMS                (128)
+#endif
+#endif
+
+// Longest period a telemetry stream is slowed down to before it is suspended (us)
+#ifndef X8_CAN_TELEMETRY_PERIOD_MAX_US
+#define X8_CAN_TELEMETRY_PERIOD_MAX_US          (10000000UL)
+#endif
+
+// Motors 1 ... N get their own frame counters
+#ifndef X8_CAN_STATS_MOTORS
+#if defined(__AVR__)
+#define X8_CAN_STATS_MOTORS                     (4)
+#else
+#define X8_CAN_STATS_MOTORS                     (32)
+#endif
+#endif
+
+// Per command and per motor frame counter, saturates: read and reset (ST) before it fills
+#ifndef X8_CAN_STATS_COUNTER
+#if defined(__AVR__)
+#define X8_CAN_STATS_COUNTER                    uint16_t
+#else
+#define X8_CAN_STATS_COUNTER                    uint32_t
+#endif
+#endif
+
+// Motors 1 ... N get latency histograms of their 0x9C, 0x92 and 0x30 reads
+#ifndef X8_CAN_LATENCY_MOTORS
+#if defined(__AVR__)
+#define X8_CAN_LATENCY_MOTORS                   (1)
+#else
+#define X8_CAN_LATENCY_MOTORS                   (32)
+#endif
+#endif
+
+// Latency histogram resolution: 2^N buckets per power of 2 (bucket width <= 1 / 2^N of its value)
+#ifndef X8_CAN_LATENCY_SUB_BITS
+#if defined(__AVR__)
+#define X8_CAN_LATENCY_SUB_BITS                 (0)
+#else
+#define X8_CAN_LATENCY_SUB_BITS                 (3)
+#endif
+#endif
+
+// Latency histogram range: 0 ... 2^(N + 1) us, longer samples land in the last bucket
+#ifndef X8_CAN_LATENCY_MAX_LOG2
+#if defined(__AVR__)
+#define X8_CAN_LATENCY_MAX_LOG2                 (17)
+#else
+#define X8_CAN_LATENCY_MAX_LOG2                 (20)
+#endif
+#endif
+
+// Histogram bucket counter, saturates
+#ifndef X8_CAN_LATENCY_COUNTER
+#if defined(__AVR__)
+#define X8_CAN_LATENCY_COUNTER                  uint16_t
+#else
+#define X8_CAN_LATENCY_COUNTER                  uint32_t
+#endif
+#endif
+
+// A read not answered within this time is counted lost (us)
+#ifndef X8_CAN_LATENCY_TIMEOUT_US
+#define X8_CAN_LATENCY_TIMEOUT_US               (100000UL)
+#endif
+
+// Motors 1 ... N get receive times of their status, angle, pid and errors
+#ifndef X8_CAN_SHADOW_MOTORS
+#if defined(__AVR__)
+#define X8_CAN_SHADOW_MOTORS                    (4)
+#else
+#define X8_CAN_SHADOW_MOTORS                    (32)
+#endif
+#endif
+
+// Frames kept by the recorder, the oldest are overwritten (power of 2), 0 => no recorder.
+// None on AVR: a ring long enough to hold an incident (16 bytes per frame) does not fit 2 KB.
+#ifndef X8_CAN_RECORDER_SIZE
+#if defined(__AVR__)
+#define X8_CAN_RECORDER_SIZE                    (0)
+#else
+#define X8_CAN_RECORDER_SIZE                    (4096)
+#endif
+#endif
+
+// Waypoints buffered per trajectory (power of 2)
+#ifndef X8_CAN_TRAJECTORY_POINTS
+#if defined(__AVR__)
+#define X8_CAN_TRAJECTORY_POINTS                (8)
+#else
+#define X8_CAN_TRAJECTORY_POINTS                (256)
+#endif
+#endif
+
+// Setpoint period of a trajectory, 1 kHz, the period of the tick driving it
+#ifndef X8_CAN_TRAJECTORY_PERIOD_US
+#define X8_CAN_TRAJECTORY_PERIOD_US             (1000UL)
+#endif
+
+#endif // __X8_CAN_CONFIG_H
+
+/* End of file -------------------------------------------------------- */
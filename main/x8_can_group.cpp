@@ -0,0 +1,163 @@
+/**
+ * @file       x8_can_group.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Torque of motors 1 ... 4 in one broadcast frame
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_group.h"
+
+/* Private defines ---------------------------------------------------- */
+static_assert(X8_CAN_GROUP_EXPECT <= 8, "X8_CAN_GROUP_EXPECT above the bits of x8_can_group_t::expect");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static void m_x8_can_group_expect(x8_can_group_t *me, uint8_t index, bool broadcast);
+
+/* Function definitions ----------------------------------------------- */
+void x8_can_group_init(x8_can_group_t *me, void (*cansend) (uint16_t msg_id, uint8_t * buffer))
+{
+  me->cansend  = cansend;
+  me->members  = 0;
+  me->pending  = 0;
+  for (uint8_t i = 0; i < RMD_X8_MULTI_TORQUE_MOTORS; i++)
+  {
+    me->expect[i]       = 0;
+    me->expect_count[i] = 0;
+  }
+  me->sent     = 0;
+  me->complete = 0;
+  me->missing  = 0;
+}
+
+bool x8_can_group_add(x8_can_group_t *me, x8_can_t *motor)
+{
+  if ((motor->motor_id < RMD_X8_MOTOR_ID_MIN) || (motor->motor_id > RMD_X8_MULTI_TORQUE_MOTORS))
+    return false;
+
+  me->members  |= (uint8_t)(1u << (motor->motor_id - 1));
+  motor->group  = me;
+
+  return true;
+}
+
+void x8_can_group_send_torque(x8_can_group_t *me, const int16_t *torque)
+{
+  uint8_t can_tx_data[8];
+
+  x8_can_encode_multi_torque_cmd(can_tx_data, torque);
+
+  me->cansend(RMD_X8_CAN_MULTI_TORQUE_MSG_ID, can_tx_data);
+}
+
+void x8_can_group_transmitted(x8_can_group_t *me, uint16_t msg_id, const uint8_t *buffer)
+{
+  uint8_t bit;
+
+  if (msg_id == RMD_X8_CAN_MULTI_TORQUE_MSG_ID)
+  {
+    for (uint8_t i = 0; i < RMD_X8_MULTI_TORQUE_MOTORS; i++)
+    {
+      bit = (uint8_t)(1u << i);
+      if ((me->members & bit) == 0)
+        continue;
+
+      // Reply of the last broadcast missing, what this member still owed is stale
+      if (me->pending & bit)
+      {
+        me->missing++;
+        me->expect_count[i] = 0;
+      }
+
+      m_x8_can_group_expect(me, i, true);
+    }
+
+    me->pending = me->members;
+    me->sent++;
+    return;
+  }
+
+  if ((msg_id >= RMD_X8_CAN_MSG_ID_OF(RMD_X8_MOTOR_ID_MIN)) &&
+      (msg_id <= RMD_X8_CAN_MSG_ID_OF(RMD_X8_MULTI_TORQUE_MOTORS)) &&
+      (buffer[0] == RMD_X8_TORQUE_CLOSED_LOOP_CMD) &&
+      (me->members & (1u << (RMD_X8_MOTOR_ID_OF(msg_id) - 1))))
+  {
+    m_x8_can_group_expect(me, (uint8_t)(RMD_X8_MOTOR_ID_OF(msg_id) - 1), false);
+  }
+}
+
+bool x8_can_group_complete(const x8_can_group_t *me)
+{
+  return me->pending == 0;
+}
+
+void x8_can_group_received(x8_can_group_t *me, uint8_t motor_id)
+{
+  uint8_t index, bit;
+  bool broadcast;
+
+  if ((motor_id < RMD_X8_MOTOR_ID_MIN) || (motor_id > RMD_X8_MULTI_TORQUE_MOTORS))
+    return;
+
+  // The reply answers the oldest torque command of the member
+  index = motor_id - 1;
+  if (me->expect_count[index] == 0)
+    return;
+
+  broadcast                  = (me->expect[index] & 1u) != 0;
+  me->expect[index]        >>= 1;
+  me->expect_count[index]--;
+
+  bit = (uint8_t)(1u << index);
+  if (!broadcast || ((me->pending & bit) == 0))
+    return;
+
+  me->pending &= (uint8_t)~bit;
+  if (me->pending == 0)
+  {
+    me->complete++;
+  }
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Queue a torque command awaiting the reply of a member
+ *
+ * @param[in]   me            Pointer to group
+ * @param[in]   index         Member, motor id - 1
+ * @param[in]   broadcast     true => broadcast, false => own 0xA1
+ *
+ * @attention   A full queue forgets its oldest command
+ *
+ * @return      None
+ */
+static void m_x8_can_group_expect(x8_can_group_t *me, uint8_t index, bool broadcast)
+{
+  if (me->expect_count[index] >= X8_CAN_GROUP_EXPECT)
+  {
+    me->expect[index] >>= 1;
+    me->expect_count[index]--;
+  }
+
+  if (broadcast)
+  {
+    me->expect[index] |= (uint8_t)(1u << me->expect_count[index]);
+  }
+  else
+  {
+    me->expect[index] &= (uint8_t)~(1u << me->expect_count[index]);
+  }
+
+  me->expect_count[index]++;
+}
+
+/* End of file -------------------------------------------------------- */
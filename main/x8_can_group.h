@@ -0,0 +1,138 @@
+/**
+ * @file       x8_can_group.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Torque of motors 1 ... 4 in one broadcast frame
+ * @note       One RMD_X8_CAN_MULTI_TORQUE_MSG_ID frame carries the torque of
+ *             motors 1 ... RMD_X8_MULTI_TORQUE_MOTORS, each motor answers on
+ *             its own CAN ID like 0xA1. Members are attached with
+ *             x8_can_t::group, their replies are decoded into their own
+ *             status by x8_can_receive as usual and ticked off here.
+ *             The transport reports every frame the controller takes with
+ *             x8_can_group_transmitted: a broadcast is armed then, not when
+ *             queued, and each member keeps the order of its torque
+ *             commands, broadcast or its own 0xA1, up to
+ *             X8_CAN_GROUP_EXPECT. A 0xA1 reply answers the oldest one, so
+ *             the reply to a member's own 0xA1 is not taken for the group.
+ *             A broadcast armed while replies are still missing counts them
+ *             as missing and forgets the commands that member still owed,
+ *             so one broadcast is gathered per cycle.
+ * @example    x8_can_group_init(&group, bsp_x8_can_send);
+ *             x8_can_group_add(&group, &motor[0]);
+ *             x8_can_group_send_torque(&group, torque);
+ *             transmit: if (sent) x8_can_group_transmitted(&group, msg_id, buffer);
+ *             loop: if (x8_can_group_complete(&group)) { use motor[i].status }
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_GROUP_H
+#define __X8_CAN_GROUP_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+
+/* Public defines ----------------------------------------------------- */
+#define X8_CAN_GROUP_EXPECT             (8)     // Torque commands awaiting a reply per member
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Broadcast torque group
+ */
+typedef struct x8_can_group
+{
+  void (*cansend) (uint16_t msg_id, uint8_t * buffer);
+
+  uint8_t             members;            // Bit motor_id - 1 => attached
+  uint8_t             pending;            // Bit motor_id - 1 => reply of the last send waiting
+  uint8_t             expect[RMD_X8_MULTI_TORQUE_MOTORS];       // Per member, bit n => n-th oldest command awaiting a reply is the broadcast
+  uint8_t             expect_count[RMD_X8_MULTI_TORQUE_MOTORS]; // Per member, commands awaiting a reply
+
+  uint32_t            sent;
+  uint32_t            complete;           // Sends answered by all members
+  uint32_t            missing;            // Replies not come before the next send
+}
+x8_can_group_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init an empty group
+ *
+ * @param[in]   me            Pointer to group
+ * @param[in]   cansend       CAN send of the bus of the members
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_group_init(x8_can_group_t *me, void (*cansend) (uint16_t msg_id, uint8_t * buffer));
+
+/**
+ * @brief       Attach a motor
+ *
+ * @param[in]   me            Pointer to group
+ * @param[in]   motor         Pointer to can handler, motor id 1 ... RMD_X8_MULTI_TORQUE_MOTORS
+ *
+ * @attention   Sets motor->group
+ *
+ * @return      false if the motor id has no torque in the frame
+ */
+bool x8_can_group_add(x8_can_group_t *me, x8_can_t *motor);
+
+/**
+ * @brief       Send the torque of all motors in one frame
+ *
+ * @param[in]   me            Pointer to group
+ * @param[in]   torque        Torque of motors 1 ... RMD_X8_MULTI_TORQUE_MOTORS,
+ *                            -2000 ... 2000, also sent to motors not attached
+ *
+ * @attention   Replies are waited for from x8_can_group_transmitted
+ *
+ * @return      None
+ */
+void x8_can_group_send_torque(x8_can_group_t *me, const int16_t *torque);
+
+/**
+ * @brief       Track a frame the controller took, from the transport
+ *
+ * @param[in]   me            Pointer to group
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   buffer        Pointer to can data (8 bytes)
+ *
+ * @attention   Call for every frame sent on the bus of the members, only
+ *              the broadcast and 0xA1 to members are kept
+ *
+ * @return      None
+ */
+void x8_can_group_transmitted(x8_can_group_t *me, uint16_t msg_id, const uint8_t *buffer);
+
+/**
+ * @brief       Tell whether all members answered the last send
+ *
+ * @param[in]   me            Pointer to group
+ *
+ * @attention   None
+ *
+ * @return      true if no reply is waiting
+ */
+bool x8_can_group_complete(const x8_can_group_t *me);
+
+/**
+ * @brief       Tick off the torque reply of a member, from x8_can_receive
+ *
+ * @param[in]   me            Pointer to group
+ * @param[in]   motor_id      Motor id
+ *
+ * @attention   Only a reply to a transmitted broadcast ticks it off
+ *
+ * @return      None
+ */
+void x8_can_group_received(x8_can_group_t *me, uint8_t motor_id);
+
+#endif // __X8_CAN_GROUP_H
+
+/* End of file -------------------------------------------------------- */
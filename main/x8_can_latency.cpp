@@ -0,0 +1,269 @@
+/**
+ * @file       x8_can_latency.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Round trip latency histograms of the read commands
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_latency.h"
+
+#include <string.h>
+
+/* Private defines ---------------------------------------------------- */
+static_assert(X8_CAN_LATENCY_MOTORS <= RMD_X8_MOTOR_ID_MAX, "X8_CAN_LATENCY_MOTORS above motor id range");
+static_assert(X8_CAN_LATENCY_MAX_LOG2 <= 30, "X8_CAN_LATENCY_MAX_LOG2 beyond 32 bit time");
+static_assert(X8_CAN_LATENCY_SUB_BITS <= X8_CAN_LATENCY_MAX_LOG2, "X8_CAN_LATENCY_SUB_BITS above range");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static int8_t m_x8_can_latency_cmd_index(uint8_t cmd_byte);
+static uint16_t m_x8_can_latency_bucket(uint32_t latency_us);
+static uint32_t m_x8_can_latency_lower(uint16_t bucket);
+static void m_x8_can_latency_record(x8_can_latency_hist_t *hist, uint32_t latency_us);
+
+/* Function definitions ----------------------------------------------- */
+void x8_can_latency_init(x8_can_latency_t *me, uint32_t (*clock) (void))
+{
+  memset(me, 0, sizeof(*me));
+  me->clock = clock;
+}
+
+void x8_can_latency_reset(x8_can_latency_t *me)
+{
+  memset(me->hist, 0, sizeof(me->hist));
+  me->lost = 0;
+}
+
+void x8_can_latency_sent(x8_can_latency_t *me, uint8_t motor_id, uint8_t cmd_byte)
+{
+  int8_t cmd = m_x8_can_latency_cmd_index(cmd_byte);
+  uint8_t motor = motor_id - 1;
+  uint32_t now_us;
+
+  if ((cmd < 0) || (motor >= X8_CAN_LATENCY_MOTORS))
+    return;
+
+  now_us = me->clock();
+
+  // The reply of the read already waiting comes first, unless it is lost
+  if (me->pending[motor] & (1u << cmd))
+  {
+    if (now_us - me->sent_us[motor][cmd] < X8_CAN_LATENCY_TIMEOUT_US)
+      return;
+
+    me->lost++;
+  }
+
+  me->sent_us[motor][cmd] = now_us;
+  me->pending[motor]     |= (1u << cmd);
+}
+
+void x8_can_latency_received(x8_can_latency_t *me, uint8_t motor_id, uint8_t cmd_byte)
+{
+  int8_t cmd = m_x8_can_latency_cmd_index(cmd_byte);
+  uint8_t motor = motor_id - 1;
+  uint32_t latency_us;
+
+  if ((cmd < 0) || (motor >= X8_CAN_LATENCY_MOTORS) || !(me->pending[motor] & (1u << cmd)))
+    return;
+
+  latency_us = me->clock() - me->sent_us[motor][cmd];
+  me->pending[motor] &= ~(1u << cmd);
+
+  if (latency_us >= X8_CAN_LATENCY_TIMEOUT_US)
+  {
+    me->lost++;
+    return;
+  }
+
+  m_x8_can_latency_record(&me->hist[motor][cmd], latency_us);
+}
+
+uint32_t x8_can_latency_count(x8_can_latency_t *me, uint8_t cmd_byte, uint8_t motor_id)
+{
+  int8_t cmd = m_x8_can_latency_cmd_index(cmd_byte);
+  uint32_t count = 0;
+
+  if (cmd < 0)
+    return 0;
+
+  for (uint8_t motor = 0; motor < X8_CAN_LATENCY_MOTORS; motor++)
+  {
+    if ((motor_id == 0) || (motor_id == motor + 1))
+    {
+      count += me->hist[motor][cmd].count;
+    }
+  }
+
+  return count;
+}
+
+uint32_t x8_can_latency_percentile(x8_can_latency_t *me, uint8_t cmd_byte, uint8_t motor_id, uint16_t permille)
+{
+  int8_t cmd = m_x8_can_latency_cmd_index(cmd_byte);
+  uint32_t total = 0;
+  uint32_t max_us = 0;
+  uint32_t rank, sum = 0;
+
+  if (cmd < 0)
+    return 0;
+
+  // Histograms of the selected motors are merged bucket by bucket
+  for (uint8_t motor = 0; motor < X8_CAN_LATENCY_MOTORS; motor++)
+  {
+    if ((motor_id != 0) && (motor_id != motor + 1))
+      continue;
+
+    for (uint16_t b = 0; b < X8_CAN_LATENCY_BUCKETS; b++)
+    {
+      total += me->hist[motor][cmd].bucket[b];
+    }
+
+    if (me->hist[motor][cmd].max_us > max_us)
+    {
+      max_us = me->hist[motor][cmd].max_us;
+    }
+  }
+
+  if ((total == 0) || (permille >= 1000))
+    return max_us;
+
+  // Nearest rank
+  rank = (uint32_t)(((uint64_t)total * permille + 999) / 1000);
+  if (rank == 0)
+  {
+    rank = 1;
+  }
+
+  for (uint16_t b = 0; b < X8_CAN_LATENCY_BUCKETS; b++)
+  {
+    for (uint8_t motor = 0; motor < X8_CAN_LATENCY_MOTORS; motor++)
+    {
+      if ((motor_id == 0) || (motor_id == motor + 1))
+      {
+        sum += me->hist[motor][cmd].bucket[b];
+      }
+    }
+
+    if (sum >= rank)
+    {
+      uint32_t upper_us = (b + 1u < X8_CAN_LATENCY_BUCKETS) ? m_x8_can_latency_lower(b + 1) - 1 : max_us;
+
+      return (upper_us < max_us) ? upper_us : max_us;
+    }
+  }
+
+  return max_us;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Histogram index of a command byte
+ *
+ * @param[in]   cmd_byte      Command byte
+ *
+ * @attention   None
+ *
+ * @return      0 ... X8_CAN_LATENCY_CMDS - 1, -1 if not timed
+ */
+static int8_t m_x8_can_latency_cmd_index(uint8_t cmd_byte)
+{
+  switch (cmd_byte)
+  {
+  case RMD_X8_READ_MOTOR_STATUS_2_CMD:      return 0;
+  case RMD_X8_READ_MULTI_TURNS_ANGLE_CMD:   return 1;
+  case RMD_X8_READ_PID_DATA_CMD:            return 2;
+  default:                                  return -1;
+  }
+}
+
+/**
+ * @brief       Bucket of a latency
+ *
+ * @param[in]   latency_us    Latency (us)
+ *
+ * @attention   None
+ *
+ * @return      Bucket index
+ */
+static uint16_t m_x8_can_latency_bucket(uint32_t latency_us)
+{
+  uint8_t  msb = X8_CAN_LATENCY_SUB_BITS;
+  uint16_t bucket;
+
+  // Exact below one octave of sub buckets
+  if (latency_us < X8_CAN_LATENCY_SUB)
+    return (uint16_t)latency_us;
+
+  while ((msb < 31) && (latency_us >> (msb + 1)))
+  {
+    msb++;
+  }
+
+  if (msb > X8_CAN_LATENCY_MAX_LOG2)
+    return X8_CAN_LATENCY_BUCKETS - 1;
+
+  bucket = (uint16_t)((msb - X8_CAN_LATENCY_SUB_BITS + 1) * X8_CAN_LATENCY_SUB +
+                      ((latency_us >> (msb - X8_CAN_LATENCY_SUB_BITS)) & (X8_CAN_LATENCY_SUB - 1)));
+
+  return bucket;
+}
+
+/**
+ * @brief       Smallest latency of a bucket
+ *
+ * @param[in]   bucket        Bucket index
+ *
+ * @attention   None
+ *
+ * @return      Latency (us)
+ */
+static uint32_t m_x8_can_latency_lower(uint16_t bucket)
+{
+  uint8_t msb;
+
+  if (bucket < X8_CAN_LATENCY_SUB)
+    return bucket;
+
+  msb = bucket / X8_CAN_LATENCY_SUB + X8_CAN_LATENCY_SUB_BITS - 1;
+
+  return (uint32_t)(X8_CAN_LATENCY_SUB + bucket % X8_CAN_LATENCY_SUB) << (msb - X8_CAN_LATENCY_SUB_BITS);
+}
+
+/**
+ * @brief       Add a sample
+ *
+ * @param[in]   hist          Pointer to histogram
+ * @param[in]   latency_us    Latency (us)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_can_latency_record(x8_can_latency_hist_t *hist, uint32_t latency_us)
+{
+  X8_CAN_LATENCY_COUNTER *bucket = &hist->bucket[m_x8_can_latency_bucket(latency_us)];
+
+  // Saturate instead of wrapping to 0
+  if ((X8_CAN_LATENCY_COUNTER)(*bucket + 1) != 0)
+  {
+    (*bucket)++;
+  }
+
+  hist->count++;
+  if (latency_us > hist->max_us)
+  {
+    hist->max_us = latency_us;
+  }
+}
+
+/* End of file -------------------------------------------------------- */
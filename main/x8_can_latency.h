@@ -0,0 +1,145 @@
+/**
+ * @file       x8_can_latency.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Round trip latency histograms of the read commands
+ * @note       Attach to a motor with x8_can_t::latency. A 0x9C, 0x92 or 0x30
+ *             read is timestamped by the transport when the controller takes
+ *             it (x8_can_latency_sent), not when it is queued, and matched
+ *             to the next reply of the same command in x8_can_receive.
+ *             While a read is waiting, further reads of the same command are
+ *             not timed, so one sample is taken per reply cycle.
+ *             Samples go to fixed size log2 histograms, one per command and
+ *             motor, with 2^X8_CAN_LATENCY_SUB_BITS buckets per power of 2.
+ *             Percentiles are the upper edge of their bucket, capped at the
+ *             largest sample.
+ * @example    x8_can_latency_init(&latency, micros);
+ *             motor.latency = &latency;
+ *             transmit: if (sent) x8_can_latency_sent(&latency, motor_id, buffer[0]);
+ *             p99 = x8_can_latency_percentile(&latency, RMD_X8_READ_MOTOR_STATUS_2_CMD, 0, 990);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_LATENCY_H
+#define __X8_CAN_LATENCY_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_config.h"
+
+/* Public defines ----------------------------------------------------- */
+#define X8_CAN_LATENCY_CMDS             (3)     // 0x9C, 0x92, 0x30
+#define X8_CAN_LATENCY_SUB              (1u << X8_CAN_LATENCY_SUB_BITS)
+#define X8_CAN_LATENCY_BUCKETS          ((X8_CAN_LATENCY_MAX_LOG2 - X8_CAN_LATENCY_SUB_BITS + 2) * X8_CAN_LATENCY_SUB)
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Latency histogram
+ */
+typedef struct
+{
+  X8_CAN_LATENCY_COUNTER bucket[X8_CAN_LATENCY_BUCKETS];
+  uint32_t               count;
+  uint32_t               max_us;
+}
+x8_can_latency_hist_t;
+
+/**
+ * @brief Latency of the read commands of motors 1 ... X8_CAN_LATENCY_MOTORS
+ */
+typedef struct x8_can_latency
+{
+  uint32_t (*clock) (void);                                   // Time (us), e.g. micros
+
+  uint32_t              sent_us[X8_CAN_LATENCY_MOTORS][X8_CAN_LATENCY_CMDS];
+  uint8_t               pending[X8_CAN_LATENCY_MOTORS];       // Bit n => command n waiting
+  uint32_t              lost;                                 // Reads without reply in time
+  x8_can_latency_hist_t hist[X8_CAN_LATENCY_MOTORS][X8_CAN_LATENCY_CMDS];
+}
+x8_can_latency_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init latency histograms
+ *
+ * @param[in]   me            Pointer to latency
+ * @param[in]   clock         Time source (us)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_latency_init(x8_can_latency_t *me, uint32_t (*clock) (void));
+
+/**
+ * @brief       Clear histograms, reads in flight stay timed
+ *
+ * @param[in]   me            Pointer to latency
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_latency_reset(x8_can_latency_t *me);
+
+/**
+ * @brief       Timestamp a sent frame if it is a timed read
+ *
+ * @param[in]   me            Pointer to latency
+ * @param[in]   motor_id      Motor ID
+ * @param[in]   cmd_byte      Command byte
+ *
+ * @attention   Called by the transport once the frame is in the controller
+ *
+ * @return      None
+ */
+void x8_can_latency_sent(x8_can_latency_t *me, uint8_t motor_id, uint8_t cmd_byte);
+
+/**
+ * @brief       Take a sample if the reply answers a timed read
+ *
+ * @param[in]   me            Pointer to latency
+ * @param[in]   motor_id      Motor ID
+ * @param[in]   cmd_byte      Command byte of the reply
+ *
+ * @attention   Called by the library
+ *
+ * @return      None
+ */
+void x8_can_latency_received(x8_can_latency_t *me, uint8_t motor_id, uint8_t cmd_byte);
+
+/**
+ * @brief       Number of samples
+ *
+ * @param[in]   me            Pointer to latency
+ * @param[in]   cmd_byte      0x9C, 0x92 or 0x30
+ * @param[in]   motor_id      Motor ID, 0 => all motors
+ *
+ * @attention   None
+ *
+ * @return      Samples
+ */
+uint32_t x8_can_latency_count(x8_can_latency_t *me, uint8_t cmd_byte, uint8_t motor_id);
+
+/**
+ * @brief       Latency percentile
+ *
+ * @param[in]   me            Pointer to latency
+ * @param[in]   cmd_byte      0x9C, 0x92 or 0x30
+ * @param[in]   motor_id      Motor ID, 0 => all motors
+ * @param[in]   permille      500 => p50, 990 => p99, 1000 => max
+ *
+ * @attention   None
+ *
+ * @return      Latency (us), 0 without samples
+ */
+uint32_t x8_can_latency_percentile(x8_can_latency_t *me, uint8_t cmd_byte, uint8_t motor_id, uint16_t permille);
+
+#endif // __X8_CAN_LATENCY_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,94 @@
+/**
+ * @file       x8_can_recorder.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      RAM ring of the last sent and received CAN frames
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_recorder.h"
+
+#include <string.h>
+
+#if (X8_CAN_RECORDER_SIZE > 0)
+
+/* Private defines ---------------------------------------------------- */
+#define X8_CAN_RECORDER_MASK    (X8_CAN_RECORDER_SIZE - 1)
+
+static_assert((X8_CAN_RECORDER_SIZE & X8_CAN_RECORDER_MASK) == 0, "X8_CAN_RECORDER_SIZE must be a power of 2");
+static_assert(X8_CAN_RECORDER_SIZE <= 32768, "X8_CAN_RECORDER_SIZE must fit 16 bit indexes");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+/* Function definitions ----------------------------------------------- */
+void x8_can_recorder_init(x8_can_recorder_t *me)
+{
+  me->frozen = false;
+  x8_can_recorder_clear(me);
+}
+
+void x8_can_recorder_clear(x8_can_recorder_t *me)
+{
+  me->head  = 0;
+  me->count = 0;
+  me->total = 0;
+}
+
+void x8_can_recorder_put(x8_can_recorder_t *me, uint32_t timestamp_us, uint16_t msg_id,
+                         uint8_t dlc, const uint8_t *data, uint8_t flags)
+{
+  x8_can_frame_t *frame;
+
+  if (me->frozen)
+    return;
+
+  if (dlc > sizeof(frame->data))
+  {
+    dlc = sizeof(frame->data);
+  }
+
+  frame = &me->frame[me->head];
+  frame->timestamp_us = timestamp_us;
+  frame->msg_id       = msg_id;
+  frame->dlc          = dlc;
+  frame->flags        = flags;
+  memset(frame->data, 0, sizeof(frame->data));
+  memcpy(frame->data, data, dlc);
+
+  me->head = (me->head + 1) & X8_CAN_RECORDER_MASK;
+  if (me->count < X8_CAN_RECORDER_SIZE)
+  {
+    me->count++;
+  }
+  me->total++;
+}
+
+void x8_can_recorder_freeze(x8_can_recorder_t *me, bool frozen)
+{
+  me->frozen = frozen;
+}
+
+uint16_t x8_can_recorder_count(x8_can_recorder_t *me)
+{
+  return me->count;
+}
+
+const x8_can_frame_t *x8_can_recorder_get(x8_can_recorder_t *me, uint16_t index)
+{
+  if (index >= me->count)
+    return NULL;
+
+  return &me->frame[(me->head - me->count + index) & X8_CAN_RECORDER_MASK];
+}
+
+#endif // X8_CAN_RECORDER_SIZE
+
+/* End of file -------------------------------------------------------- */
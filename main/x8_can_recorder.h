@@ -0,0 +1,128 @@
+/**
+ * @file       x8_can_recorder.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      RAM ring of the last sent and received CAN frames
+ * @note       Every frame is kept as an x8_can_frame_t (16 bytes: time, ID,
+ *             DLC, flags, 8 data bytes), the same record as the host capture
+ *             files of host/x8_capture.h. When the ring is full the oldest
+ *             frame is overwritten, so it always holds the traffic that led
+ *             to an incident. Freeze it to keep that traffic until it is read.
+ *             The recorder is filled from the main loop, not from interrupts.
+ *             With X8_CAN_RECORDER_SIZE 0 there is no recorder, nothing of
+ *             this file is declared.
+ * @example    x8_can_recorder_init(&rec);
+ *             x8_can_recorder_put(&rec, micros(), msg_id, 8, data, X8_CAN_FRAME_TX);
+ *             for (i = 0; i < x8_can_recorder_count(&rec); i++) frame = x8_can_recorder_get(&rec, i);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_RECORDER_H
+#define __X8_CAN_RECORDER_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_config.h"
+
+#if (X8_CAN_RECORDER_SIZE > 0)
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Frame recorder
+ */
+typedef struct
+{
+  x8_can_frame_t frame[X8_CAN_RECORDER_SIZE];
+  uint16_t       head;                        // Next slot to write
+  uint16_t       count;                       // Frames kept
+  uint32_t       total;                       // Frames recorded since clear, kept or not
+  bool           frozen;                      // true => new frames are dropped
+}
+x8_can_recorder_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init empty recorder, recording
+ *
+ * @param[in]   me            Pointer to recorder
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_recorder_init(x8_can_recorder_t *me);
+
+/**
+ * @brief       Drop all frames, freeze state is kept
+ *
+ * @param[in]   me            Pointer to recorder
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_recorder_clear(x8_can_recorder_t *me);
+
+/**
+ * @brief       Record a frame, overwriting the oldest one when full
+ *
+ * @param[in]   me            Pointer to recorder
+ * @param[in]   timestamp_us  Send or receive time (us)
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   dlc           Data length (0 ... 8)
+ * @param[in]   data          Pointer to can data (dlc bytes)
+ * @param[in]   flags         X8_CAN_FRAME_TX for sent frames, 0 for received
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_recorder_put(x8_can_recorder_t *me, uint32_t timestamp_us, uint16_t msg_id,
+                         uint8_t dlc, const uint8_t *data, uint8_t flags);
+
+/**
+ * @brief       Stop or resume recording
+ *
+ * @param[in]   me            Pointer to recorder
+ * @param[in]   frozen        true => keep the frames recorded so far
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_recorder_freeze(x8_can_recorder_t *me, bool frozen);
+
+/**
+ * @brief       Number of frames kept
+ *
+ * @param[in]   me            Pointer to recorder
+ *
+ * @attention   None
+ *
+ * @return      0 ... X8_CAN_RECORDER_SIZE
+ */
+uint16_t x8_can_recorder_count(x8_can_recorder_t *me);
+
+/**
+ * @brief       Frame kept, oldest first
+ *
+ * @param[in]   me            Pointer to recorder
+ * @param[in]   index         0 => oldest
+ *
+ * @attention   None
+ *
+ * @return      Pointer to frame, NULL if index >= x8_can_recorder_count()
+ */
+const x8_can_frame_t *x8_can_recorder_get(x8_can_recorder_t *me, uint16_t index);
+
+#endif // X8_CAN_RECORDER_SIZE
+
+#endif // __X8_CAN_RECORDER_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,176 @@
+/**
+ * @file       x8_can_request.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Pending request table matching RMD X8 PRO replies to their reads
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_request.h"
+
+/* Private defines ---------------------------------------------------- */
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static void m_x8_can_request_finish(x8_can_request_t *req, uint8_t state);
+
+/* Function definitions ----------------------------------------------- */
+void x8_can_request_init(x8_can_request_table_t *table)
+{
+  for (uint8_t i = 0; i < X8_CAN_REQUEST_TABLE_SIZE; i++)
+  {
+    table->request[i].state = X8_CAN_REQUEST_FREE;
+  }
+
+  table->seq = 0;
+}
+
+x8_can_request_t *x8_can_request_send(x8_can_request_table_t *table, x8_can_t *me, uint8_t cmd_byte,
+                                      uint32_t now_us, uint32_t timeout_us,
+                                      x8_can_request_cb_t callback, void *context)
+{
+  x8_can_request_t *req;
+
+  req = x8_can_request_expect(table, me, cmd_byte, now_us, timeout_us, callback, context);
+  if (req == NULL)
+    return NULL;
+
+  // Can send message
+  x8_can_send_cmd(me, cmd_byte);
+
+  return req;
+}
+
+x8_can_request_t *x8_can_request_expect(x8_can_request_table_t *table, x8_can_t *me, uint8_t cmd_byte,
+                                        uint32_t now_us, uint32_t timeout_us,
+                                        x8_can_request_cb_t callback, void *context)
+{
+  x8_can_request_t *req = NULL;
+
+  // Find a free slot
+  for (uint8_t i = 0; i < X8_CAN_REQUEST_TABLE_SIZE; i++)
+  {
+    if (table->request[i].state == X8_CAN_REQUEST_FREE)
+    {
+      req = &table->request[i];
+      break;
+    }
+  }
+
+  if (req == NULL)
+    return NULL;
+
+  req->state       = X8_CAN_REQUEST_PENDING;
+  req->motor_id    = me->motor_id;
+  req->cmd_byte    = cmd_byte;
+  req->seq         = table->seq++;
+  req->sent_us     = now_us;
+  req->deadline_us = now_us + timeout_us;
+  req->callback    = callback;
+  req->context     = context;
+
+  return req;
+}
+
+bool x8_can_request_receive(x8_can_request_table_t *table, uint16_t msg_id, uint8_t *can_rx_data)
+{
+  x8_can_request_t *oldest = NULL;
+  uint8_t motor_id = RMD_X8_MOTOR_ID_OF(msg_id);
+
+  // Replies of one motor come back in order, the oldest matching request owns the frame
+  for (uint8_t i = 0; i < X8_CAN_REQUEST_TABLE_SIZE; i++)
+  {
+    x8_can_request_t *req = &table->request[i];
+
+    if ((req->state != X8_CAN_REQUEST_PENDING) ||
+        (req->motor_id != motor_id) ||
+        (req->cmd_byte != can_rx_data[0]))
+      continue;
+
+    if ((oldest == NULL) || ((int16_t)(req->seq - oldest->seq) < 0))
+    {
+      oldest = req;
+    }
+  }
+
+  if (oldest == NULL)
+    return false;
+
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    oldest->can_rx_data[i] = can_rx_data[i];
+  }
+
+  m_x8_can_request_finish(oldest, X8_CAN_REQUEST_DONE);
+
+  return true;
+}
+
+uint8_t x8_can_request_expire(x8_can_request_table_t *table, uint32_t now_us)
+{
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < X8_CAN_REQUEST_TABLE_SIZE; i++)
+  {
+    x8_can_request_t *req = &table->request[i];
+
+    if ((req->state == X8_CAN_REQUEST_PENDING) && ((int32_t)(now_us - req->deadline_us) >= 0))
+    {
+      m_x8_can_request_finish(req, X8_CAN_REQUEST_TIMEOUT);
+      count++;
+    }
+  }
+
+  return count;
+}
+
+void x8_can_request_release(x8_can_request_t *req)
+{
+  req->state = X8_CAN_REQUEST_FREE;
+}
+
+uint8_t x8_can_request_pending(x8_can_request_table_t *table)
+{
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < X8_CAN_REQUEST_TABLE_SIZE; i++)
+  {
+    if (table->request[i].state == X8_CAN_REQUEST_PENDING)
+    {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Set final state of request and run its callback
+ *
+ * @param[in]   req           Pointer to request
+ * @param[in]   state         X8_CAN_REQUEST_DONE or X8_CAN_REQUEST_TIMEOUT
+ *
+ * @attention   Slot of a request with callback is freed after the callback
+ *
+ * @return      None
+ */
+static void m_x8_can_request_finish(x8_can_request_t *req, uint8_t state)
+{
+  req->state = state;
+
+  if (req->callback != NULL)
+  {
+    req->callback(req, req->context);
+    req->state = X8_CAN_REQUEST_FREE;
+  }
+}
+
+/* End of file -------------------------------------------------------- */
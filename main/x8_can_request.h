@@ -0,0 +1,172 @@
+/**
+ * @file       x8_can_request.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Pending request table matching RMD X8 PRO replies to their reads
+ * @note       Requests are keyed by motor id and reply command byte. Replies
+ *             of the same key complete requests in the order they were sent.
+ * @example    None
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_REQUEST_H
+#define __X8_CAN_REQUEST_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_config.h"
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Request state enum
+ */
+typedef enum
+{
+  X8_CAN_REQUEST_FREE,
+  X8_CAN_REQUEST_PENDING,
+  X8_CAN_REQUEST_DONE,
+  X8_CAN_REQUEST_TIMEOUT
+}
+x8_can_request_state_t;
+
+typedef struct x8_can_request x8_can_request_t;
+
+/**
+ * @brief Request completion callback, called once with state DONE or TIMEOUT
+ */
+typedef void (*x8_can_request_cb_t)(x8_can_request_t *req, void *context);
+
+/**
+ * @brief Request
+ */
+struct x8_can_request
+{
+  uint8_t             state;              // x8_can_request_state_t
+  uint8_t             motor_id;
+  uint8_t             cmd_byte;           // Command byte of request and reply
+  uint8_t             can_rx_data[8];     // Reply frame, valid when DONE
+  uint16_t            seq;                // Send order
+  uint32_t            sent_us;
+  uint32_t            deadline_us;
+  x8_can_request_cb_t callback;
+  void               *context;
+};
+
+/**
+ * @brief Pending request table
+ */
+typedef struct
+{
+  x8_can_request_t request[X8_CAN_REQUEST_TABLE_SIZE];
+  uint16_t         seq;
+}
+x8_can_request_table_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Clear request table
+ *
+ * @param[in]   table           Pointer to request table
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_request_init(x8_can_request_table_t *table);
+
+/**
+ * @brief       Send a read command and register it as pending
+ *
+ * @param[in]   table           Pointer to request table
+ * @param[in]   me              Pointer to can handler of the motor
+ * @param[in]   cmd_byte        Read command byte (e.g. RMD_X8_READ_MOTOR_STATUS_2_CMD)
+ * @param[in]   now_us          Current time (us)
+ * @param[in]   timeout_us      Time to wait for the reply (us)
+ * @param[in]   callback        Completion callback, NULL to poll the returned handle
+ * @param[in]   context         Passed back to callback
+ *
+ * @attention   With a callback the slot is freed after the callback returns,
+ *              without it the caller must x8_can_request_release() the handle
+ *
+ * @return      Request handle, NULL if the table is full (nothing sent)
+ */
+x8_can_request_t *x8_can_request_send(x8_can_request_table_t *table, x8_can_t *me, uint8_t cmd_byte,
+                                      uint32_t now_us, uint32_t timeout_us,
+                                      x8_can_request_cb_t callback, void *context);
+
+/**
+ * @brief       Register a pending request for a command the caller sends itself
+ *
+ * @param[in]   table           Pointer to request table
+ * @param[in]   me              Pointer to can handler of the motor
+ * @param[in]   cmd_byte        Command byte of the reply (e.g. RMD_X8_WRITE_PID_TO_RAM_CMD)
+ * @param[in]   now_us          Current time (us)
+ * @param[in]   timeout_us      Time to wait for the reply (us)
+ * @param[in]   callback        Completion callback, NULL to poll the returned handle
+ * @param[in]   context         Passed back to callback
+ *
+ * @attention   Send the command right after, for writes and motion commands
+ *              whose frame is not a bare read
+ *
+ * @return      Request handle, NULL if the table is full
+ */
+x8_can_request_t *x8_can_request_expect(x8_can_request_table_t *table, x8_can_t *me, uint8_t cmd_byte,
+                                        uint32_t now_us, uint32_t timeout_us,
+                                        x8_can_request_cb_t callback, void *context);
+
+/**
+ * @brief       Complete the oldest pending request matching a received frame
+ *
+ * @param[in]   table           Pointer to request table
+ * @param[in]   msg_id          CAN ID of received frame
+ * @param[in]   can_rx_data     Pointer to can rx data
+ *
+ * @attention   None
+ *
+ * @return      true if the frame completed a request
+ */
+bool x8_can_request_receive(x8_can_request_table_t *table, uint16_t msg_id, uint8_t *can_rx_data);
+
+/**
+ * @brief       Expire pending requests past their deadline
+ *
+ * @param[in]   table           Pointer to request table
+ * @param[in]   now_us          Current time (us)
+ *
+ * @attention   None
+ *
+ * @return      Number of requests expired
+ */
+uint8_t x8_can_request_expire(x8_can_request_table_t *table, uint32_t now_us);
+
+/**
+ * @brief       Free a polled request after reading its result
+ *
+ * @param[in]   req             Request handle
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_request_release(x8_can_request_t *req);
+
+/**
+ * @brief       Number of pending requests
+ *
+ * @param[in]   table           Pointer to request table
+ *
+ * @attention   None
+ *
+ * @return      Number of pending requests
+ */
+uint8_t x8_can_request_pending(x8_can_request_table_t *table);
+
+#endif // __X8_CAN_REQUEST_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,137 @@
+/**
+ * @file       x8_can_rx.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Lock-free ring of received CAN frames
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_rx.h"
+
+/* Private defines ---------------------------------------------------- */
+#define X8_CAN_RX_RING_MASK     (X8_CAN_RX_RING_SIZE - 1)
+
+static_assert((X8_CAN_RX_RING_SIZE & X8_CAN_RX_RING_MASK) == 0, "X8_CAN_RX_RING_SIZE must be a power of 2");
+static_assert(X8_CAN_RX_RING_SIZE <= 128, "X8_CAN_RX_RING_SIZE must fit 8 bit indexes");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+// ACQUIRE: index of the other side, slot accesses after it stay after it
+// OWN: index only this side writes
+// RELEASE: index update, slot accesses before it stay before it
+#if defined(__AVR__)
+#define X8_CAN_RX_BARRIER()             __asm__ __volatile__ ("" ::: "memory")
+#define X8_CAN_RX_ACQUIRE(index)        m_x8_can_rx_acquire(&(index))
+#define X8_CAN_RX_OWN(index)            ((uint8_t)(index))
+#define X8_CAN_RX_RELEASE(index, value) do { X8_CAN_RX_BARRIER(); (index) = (value); } while (0)
+#else
+#define X8_CAN_RX_ACQUIRE(index)        ((index).load(std::memory_order_acquire))
+#define X8_CAN_RX_OWN(index)            ((index).load(std::memory_order_relaxed))
+#define X8_CAN_RX_RELEASE(index, value) ((index).store((value), std::memory_order_release))
+#endif
+
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+#if defined(__AVR__)
+static inline uint8_t m_x8_can_rx_acquire(x8_can_rx_index_t *index);
+#endif
+
+/* Function definitions ----------------------------------------------- */
+void x8_can_rx_ring_init(x8_can_rx_ring_t *ring)
+{
+  ring->head    = 0;
+  ring->tail    = 0;
+  ring->overrun = 0;
+}
+
+x8_can_frame_t *x8_can_rx_ring_claim(x8_can_rx_ring_t *ring)
+{
+  uint8_t head = X8_CAN_RX_OWN(ring->head);
+
+  // Slot given back by pop must be free before it is filled again
+  if ((uint8_t)(head - X8_CAN_RX_ACQUIRE(ring->tail)) >= X8_CAN_RX_RING_SIZE)
+  {
+#if defined(__AVR__)
+    ring->overrun = ring->overrun + 1;
+#else
+    ring->overrun.store(ring->overrun.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+#endif
+    return NULL;
+  }
+
+  return &ring->frame[head & X8_CAN_RX_RING_MASK];
+}
+
+void x8_can_rx_ring_publish(x8_can_rx_ring_t *ring)
+{
+  // Slot content must be visible before the new head
+  X8_CAN_RX_RELEASE(ring->head, (uint8_t)(X8_CAN_RX_OWN(ring->head) + 1));
+}
+
+uint8_t x8_can_rx_ring_count(x8_can_rx_ring_t *ring)
+{
+  return (uint8_t)(X8_CAN_RX_ACQUIRE(ring->head) - X8_CAN_RX_OWN(ring->tail));
+}
+
+x8_can_frame_t *x8_can_rx_ring_peek(x8_can_rx_ring_t *ring)
+{
+  uint8_t tail = X8_CAN_RX_OWN(ring->tail);
+
+  if (X8_CAN_RX_ACQUIRE(ring->head) == tail)
+    return NULL;
+
+  return &ring->frame[tail & X8_CAN_RX_RING_MASK];
+}
+
+void x8_can_rx_ring_pop(x8_can_rx_ring_t *ring)
+{
+  // Slot must be read before it is given back to the producer
+  X8_CAN_RX_RELEASE(ring->tail, (uint8_t)(X8_CAN_RX_OWN(ring->tail) + 1));
+}
+
+uint16_t x8_can_rx_ring_overrun(x8_can_rx_ring_t *ring)
+{
+#if defined(__AVR__)
+  uint16_t overrun;
+
+  // 16 bit read is not atomic on 8 bit MCU, read until stable
+  do
+  {
+    overrun = ring->overrun;
+  }
+  while (overrun != ring->overrun);
+
+  return overrun;
+#else
+  return ring->overrun.load(std::memory_order_relaxed);
+#endif
+}
+
+/* Private function definitions --------------------------------------- */
+#if defined(__AVR__)
+/**
+ * @brief       Load an index written by the other side
+ *
+ * @param[in]   index         Pointer to index
+ *
+ * @attention   None
+ *
+ * @return      Index
+ */
+static inline uint8_t m_x8_can_rx_acquire(x8_can_rx_index_t *index)
+{
+  uint8_t value = *index;
+
+  X8_CAN_RX_BARRIER();
+
+  return value;
+}
+#endif
+
+/* End of file -------------------------------------------------------- */
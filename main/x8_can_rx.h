@@ -0,0 +1,136 @@
+/**
+ * @file       x8_can_rx.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Lock-free ring of received CAN frames
+ * @note       Single producer (CAN interrupt) and single consumer (main loop).
+ *             Producer only writes head and overrun, consumer only writes tail.
+ *             On AVR the indexes are volatile bytes, read and written in one
+ *             instruction. Elsewhere producer and consumer may be threads on
+ *             other cores, the indexes are std::atomic: a new head is
+ *             published with release and read with acquire, the same for tail.
+ * @example    None
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_RX_H
+#define __X8_CAN_RX_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_config.h"
+
+#if !defined(__AVR__)
+#include <atomic>
+#endif
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+#if defined(__AVR__)
+typedef volatile uint8_t        x8_can_rx_index_t;
+typedef volatile uint16_t       x8_can_rx_counter_t;
+#else
+typedef std::atomic<uint8_t>    x8_can_rx_index_t;
+typedef std::atomic<uint16_t>   x8_can_rx_counter_t;
+#endif
+
+/**
+ * @brief Ring of received frames
+ */
+typedef struct
+{
+  x8_can_rx_index_t   head;                         // Next slot to fill, written by producer
+  x8_can_rx_index_t   tail;                         // Next slot to read, written by consumer
+  x8_can_rx_counter_t overrun;                      // Frames dropped because the ring was full
+  x8_can_frame_t      frame[X8_CAN_RX_RING_SIZE];
+}
+x8_can_rx_ring_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Clear ring
+ *
+ * @param[in]   ring          Pointer to ring
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_rx_ring_init(x8_can_rx_ring_t *ring);
+
+/**
+ * @brief       Producer: get the slot to fill with the next frame
+ *
+ * @param[in]   ring          Pointer to ring
+ *
+ * @attention   Call from the CAN interrupt only. When NULL is returned the
+ *              frame must still be read out of the controller, it is counted
+ *              as overrun.
+ *
+ * @return      Pointer to free slot, NULL if the ring is full
+ */
+x8_can_frame_t *x8_can_rx_ring_claim(x8_can_rx_ring_t *ring);
+
+/**
+ * @brief       Producer: hand the slot returned by x8_can_rx_ring_claim() to the consumer
+ *
+ * @param[in]   ring          Pointer to ring
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_rx_ring_publish(x8_can_rx_ring_t *ring);
+
+/**
+ * @brief       Consumer: number of frames ready
+ *
+ * @param[in]   ring          Pointer to ring
+ *
+ * @attention   None
+ *
+ * @return      Number of frames that can be peeked
+ */
+uint8_t x8_can_rx_ring_count(x8_can_rx_ring_t *ring);
+
+/**
+ * @brief       Consumer: oldest frame, stays valid until x8_can_rx_ring_pop()
+ *
+ * @param[in]   ring          Pointer to ring
+ *
+ * @attention   None
+ *
+ * @return      Pointer to frame, NULL if the ring is empty
+ */
+x8_can_frame_t *x8_can_rx_ring_peek(x8_can_rx_ring_t *ring);
+
+/**
+ * @brief       Consumer: release the oldest frame
+ *
+ * @param[in]   ring          Pointer to ring
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_rx_ring_pop(x8_can_rx_ring_t *ring);
+
+/**
+ * @brief       Consumer: read overrun counter
+ *
+ * @param[in]   ring          Pointer to ring
+ *
+ * @attention   None
+ *
+ * @return      Number of dropped frames since init
+ */
+uint16_t x8_can_rx_ring_overrun(x8_can_rx_ring_t *ring);
+
+#endif // __X8_CAN_RX_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,119 @@
+/**
+ * @file       x8_can_shadow.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Receive time of the values cached in the motor handlers
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_shadow.h"
+
+#include <string.h>
+
+/* Private defines ---------------------------------------------------- */
+static_assert(X8_CAN_SHADOW_MOTORS <= RMD_X8_MOTOR_ID_MAX, "X8_CAN_SHADOW_MOTORS above motor id range");
+static_assert(X8_CAN_SHADOW_ITEMS <= 8, "x8_can_shadow_t::valid holds 8 items");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+/* Function definitions ----------------------------------------------- */
+void x8_can_shadow_init(x8_can_shadow_t *me, uint32_t (*clock) (void))
+{
+  memset(me, 0, sizeof(*me));
+  me->clock = clock;
+}
+
+uint8_t x8_can_shadow_item(uint8_t cmd_byte)
+{
+  // Same grouping as the decoding of x8_can_receive
+  switch (cmd_byte)
+  {
+  case RMD_X8_READ_MOTOR_STATUS_2_CMD:
+  case RMD_X8_TORQUE_CLOSED_LOOP_CMD:
+  case RMD_X8_SPEED_CLOSED_LOOP_CMD:
+  case RMD_X8_POSITION_CTRL_1_CMD:
+  case RMD_X8_POSITION_CTRL_2_CMD:
+  case RMD_X8_POSITION_CTRL_3_CMD:
+  case RMD_X8_POSITION_CTRL_4_CMD:
+    return X8_CAN_SHADOW_STATUS;
+
+  case RMD_X8_READ_MULTI_TURNS_ANGLE_CMD:
+    return X8_CAN_SHADOW_ANGLE;
+
+  case RMD_X8_READ_PID_DATA_CMD:
+  case RMD_X8_WRITE_PID_TO_RAM_CMD:
+  case RMD_X8_WRITE_PID_TO_ROM_CMD:
+    return X8_CAN_SHADOW_PID;
+
+  case RMD_X8_READ_MOTOR_STATUS_CMD:
+  case RMD_X8_CLEAR_MOTOR_ERROR_FLAG_CMD:
+    return X8_CAN_SHADOW_ERROR;
+
+  default:
+    return X8_CAN_SHADOW_NONE;
+  }
+}
+
+void x8_can_shadow_received(x8_can_shadow_t *me, uint8_t motor_id, uint8_t cmd_byte, uint32_t rx_us)
+{
+  uint8_t item = x8_can_shadow_item(cmd_byte);
+  uint8_t motor = motor_id - 1;
+
+  if ((item == X8_CAN_SHADOW_NONE) || (motor >= X8_CAN_SHADOW_MOTORS))
+    return;
+
+  me->rx_us[motor][item] = rx_us;
+  me->valid[motor]      |= (uint8_t)(1u << item);
+}
+
+bool x8_can_shadow_fresh(x8_can_shadow_t *me, uint8_t motor_id, uint8_t item, uint32_t max_age_us)
+{
+  uint32_t age_us;
+
+  if ((max_age_us != 0) && x8_can_shadow_age(me, motor_id, item, &age_us) && (age_us <= max_age_us))
+  {
+    me->hits++;
+    return true;
+  }
+
+  me->misses++;
+  return false;
+}
+
+bool x8_can_shadow_age(const x8_can_shadow_t *me, uint8_t motor_id, uint8_t item, uint32_t *age_us)
+{
+  uint8_t motor = motor_id - 1;
+
+  if ((item >= X8_CAN_SHADOW_ITEMS) || (motor >= X8_CAN_SHADOW_MOTORS) || !(me->valid[motor] & (1u << item)))
+    return false;
+
+  *age_us = me->clock() - me->rx_us[motor][item];
+
+  return true;
+}
+
+void x8_can_shadow_expire(x8_can_shadow_t *me, uint32_t max_age_us)
+{
+  uint32_t now_us = me->clock();
+
+  for (uint8_t motor = 0; motor < X8_CAN_SHADOW_MOTORS; motor++)
+  {
+    for (uint8_t item = 0; item < X8_CAN_SHADOW_ITEMS; item++)
+    {
+      if (now_us - me->rx_us[motor][item] > max_age_us)
+      {
+        me->valid[motor] &= (uint8_t)~(1u << item);
+      }
+    }
+  }
+}
+
+/* End of file -------------------------------------------------------- */
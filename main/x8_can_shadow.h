@@ -0,0 +1,145 @@
+/**
+ * @file       x8_can_shadow.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Receive time of the values cached in the motor handlers
+ * @note       x8_can_receive decodes every reply into its motor handler:
+ *             status, multi turn angle, pid and errors. Attach with
+ *             x8_can_t::shadow to also stamp each of them with its receive
+ *             time (x8_can_receive_at, the time the frame came in, not the
+ *             time it is decoded), so a read can take the cached value when it is fresh
+ *             enough and only go to the bus otherwise. Control replies
+ *             (0xA1 ... 0xA6) refresh the status like 0x9C.
+ *             Ages are 32 bit us: a value not refreshed for 71 minutes looks
+ *             fresh again, x8_can_shadow_expire drops the old ones before.
+ * @example    x8_can_shadow_init(&shadow, micros);
+ *             motor.shadow = &shadow;
+ *             if (x8_can_shadow_fresh(&shadow, motor.motor_id, X8_CAN_SHADOW_STATUS, 20000)) { use motor.status }
+ *             else { read 0x9C }
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_SHADOW_H
+#define __X8_CAN_SHADOW_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_config.h"
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Cached values of a motor handler
+ */
+typedef enum
+{
+  X8_CAN_SHADOW_STATUS,                 // x8_can_t::status
+  X8_CAN_SHADOW_ANGLE,                  // x8_can_t::multi_turn_angle
+  X8_CAN_SHADOW_PID,                    // x8_can_t::pid
+  X8_CAN_SHADOW_ERROR,                  // x8_can_t::error
+  X8_CAN_SHADOW_ITEMS,
+  X8_CAN_SHADOW_NONE = X8_CAN_SHADOW_ITEMS
+}
+x8_can_shadow_item_t;
+
+/**
+ * @brief Receive times of motors 1 ... X8_CAN_SHADOW_MOTORS
+ */
+typedef struct x8_can_shadow
+{
+  uint32_t (*clock) (void);                                 // Time (us), e.g. micros
+
+  uint32_t rx_us[X8_CAN_SHADOW_MOTORS][X8_CAN_SHADOW_ITEMS];
+  uint8_t  valid[X8_CAN_SHADOW_MOTORS];                     // Bit n => item n received
+  uint32_t hits;                                            // Reads served from the cache
+  uint32_t misses;                                          // Reads sent to the bus
+}
+x8_can_shadow_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init with nothing cached
+ *
+ * @param[in]   me            Pointer to shadow
+ * @param[in]   clock         Time source (us)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_shadow_init(x8_can_shadow_t *me, uint32_t (*clock) (void));
+
+/**
+ * @brief       Cached item refreshed by a reply
+ *
+ * @param[in]   cmd_byte      Command byte of the reply
+ *
+ * @attention   None
+ *
+ * @return      x8_can_shadow_item_t, X8_CAN_SHADOW_NONE if the reply caches nothing
+ */
+uint8_t x8_can_shadow_item(uint8_t cmd_byte);
+
+/**
+ * @brief       Stamp the item refreshed by a reply
+ *
+ * @param[in]   me            Pointer to shadow
+ * @param[in]   motor_id      Motor ID
+ * @param[in]   cmd_byte      Command byte of the reply
+ * @param[in]   rx_us         Receive time of the reply (us), on the clock of the shadow
+ *
+ * @attention   Called by the library
+ *
+ * @return      None
+ */
+void x8_can_shadow_received(x8_can_shadow_t *me, uint8_t motor_id, uint8_t cmd_byte, uint32_t rx_us);
+
+/**
+ * @brief       Tell whether a cached item is fresh enough, counted as hit or miss
+ *
+ * @param[in]   me            Pointer to shadow
+ * @param[in]   motor_id      Motor ID
+ * @param[in]   item          x8_can_shadow_item_t
+ * @param[in]   max_age_us    Oldest receive time accepted (us), 0 => never fresh
+ *
+ * @attention   None
+ *
+ * @return      true if the cached value can be used instead of a read
+ */
+bool x8_can_shadow_fresh(x8_can_shadow_t *me, uint8_t motor_id, uint8_t item, uint32_t max_age_us);
+
+/**
+ * @brief       Age of a cached item
+ *
+ * @param[in]   me            Pointer to shadow
+ * @param[in]   motor_id      Motor ID
+ * @param[in]   item          x8_can_shadow_item_t
+ * @param[out]  age_us        Time since it was received (us)
+ *
+ * @attention   Not counted as hit or miss
+ *
+ * @return      false if never received
+ */
+bool x8_can_shadow_age(const x8_can_shadow_t *me, uint8_t motor_id, uint8_t item, uint32_t *age_us);
+
+/**
+ * @brief       Drop the items older than an age
+ *
+ * @param[in]   me            Pointer to shadow
+ * @param[in]   max_age_us    Age (us)
+ *
+ * @attention   Call periodically, max_age_us plus the period well below
+ *              71 minutes, to keep ages right across the wrap of the clock
+ *
+ * @return      None
+ */
+void x8_can_shadow_expire(x8_can_shadow_t *me, uint32_t max_age_us);
+
+#endif // __X8_CAN_SHADOW_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,179 @@
+/**
+ * @file       x8_can_stats.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Frame and bus load counters
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_stats.h"
+#include "x8_pgm.h"
+
+#include <string.h>
+
+/* Private defines ---------------------------------------------------- */
+static_assert(X8_CAN_STATS_MOTORS <= RMD_X8_MOTOR_ID_MAX, "X8_CAN_STATS_MOTORS above motor id range");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static const uint8_t M_X8_CAN_STATS_CMD[] X8_PGM =
+{
+  RMD_X8_READ_PID_DATA_CMD,
+  RMD_X8_WRITE_PID_TO_RAM_CMD,
+  RMD_X8_WRITE_PID_TO_ROM_CMD,
+  RMD_X8_READ_ACCELERATION_CMD,
+  RMD_X8_WRITE_ACCELERATION_CMD,
+  RMD_X8_READ_ENCODE_DATA_CMD,
+  RMD_X8_WRITE_ENCODER_OFFSET_CMD,
+  RMD_X8_WRITE_CURRENT_POSITION_CMD,
+  RMD_X8_READ_MULTI_TURNS_ANGLE_CMD,
+  RMD_X8_READ_SINGLE_CIRCLE_ANGLE_CMD,
+  RMD_X8_READ_MOTOR_STATUS_CMD,
+  RMD_X8_CLEAR_MOTOR_ERROR_FLAG_CMD,
+  RMD_X8_READ_MOTOR_STATUS_2_CMD,
+  RMD_X8_READ_MOTOR_STATUS_3_CMD,
+  RMD_X8_MOTOR_OFF_CMD,
+  RMD_X8_MOTOR_STOP_CMD,
+  RMD_X8_MOTOR_RUNNING_CMD,
+  RMD_X8_TORQUE_CLOSED_LOOP_CMD,
+  RMD_X8_SPEED_CLOSED_LOOP_CMD,
+  RMD_X8_POSITION_CTRL_1_CMD,
+  RMD_X8_POSITION_CTRL_2_CMD,
+  RMD_X8_POSITION_CTRL_3_CMD,
+  RMD_X8_POSITION_CTRL_4_CMD
+};
+
+static_assert(sizeof(M_X8_CAN_STATS_CMD) == X8_CAN_STATS_CMDS - 1, "X8_CAN_STATS_CMDS out of date");
+
+/* Private function prototypes ---------------------------------------- */
+static void m_x8_can_stats_count(X8_CAN_STATS_COUNTER *cmd, X8_CAN_STATS_COUNTER *motor, uint16_t msg_id, const uint8_t *can_data);
+static void m_x8_can_stats_inc(X8_CAN_STATS_COUNTER *counter);
+
+/* Function definitions ----------------------------------------------- */
+void x8_can_stats_init(x8_can_stats_t *me, uint32_t now_us)
+{
+  x8_can_stats_reset(me, now_us);
+}
+
+void x8_can_stats_reset(x8_can_stats_t *me, uint32_t now_us)
+{
+  memset(me, 0, sizeof(*me));
+  me->start_us = now_us;
+}
+
+void x8_can_stats_tx(x8_can_stats_t *me, uint16_t msg_id, const uint8_t *can_data)
+{
+  me->tx_frames++;
+  m_x8_can_stats_count(me->tx_cmd, me->tx_motor, msg_id, can_data);
+}
+
+void x8_can_stats_rx(x8_can_stats_t *me, uint16_t msg_id, const uint8_t *can_data)
+{
+  me->rx_frames++;
+  m_x8_can_stats_count(me->rx_cmd, me->rx_motor, msg_id, can_data);
+}
+
+void x8_can_stats_tx_fail(x8_can_stats_t *me, uint32_t count)
+{
+  me->tx_fail += count;
+}
+
+void x8_can_stats_rx_overrun(x8_can_stats_t *me, uint32_t count)
+{
+  me->rx_overrun += count;
+}
+
+void x8_can_stats_snapshot(x8_can_stats_t *me, uint32_t now_us, uint32_t bitrate, x8_can_stats_snapshot_t *snap)
+{
+  snap->elapsed_us    = now_us - me->start_us;
+  snap->tx_fps        = x8_can_stats_rate(me->tx_frames, snap->elapsed_us);
+  snap->rx_fps        = x8_can_stats_rate(me->rx_frames, snap->elapsed_us);
+  snap->bps           = (snap->tx_fps + snap->rx_fps) * RMD_X8_CAN_FRAME_BITS;
+  snap->load_permille = (uint16_t)((uint64_t)snap->bps * 1000 / bitrate);
+  snap->tx_fail       = me->tx_fail;
+  snap->rx_overrun    = me->rx_overrun;
+}
+
+uint32_t x8_can_stats_rate(uint32_t count, uint32_t elapsed_us)
+{
+  if (elapsed_us == 0)
+    return 0;
+
+  return (uint32_t)((uint64_t)count * 1000000UL / elapsed_us);
+}
+
+uint8_t x8_can_stats_cmd_index(uint8_t cmd_byte)
+{
+  for (uint8_t i = 0; i < sizeof(M_X8_CAN_STATS_CMD); i++)
+  {
+    if (x8_pgm_read_byte(&M_X8_CAN_STATS_CMD[i]) == cmd_byte)
+      return i;
+  }
+
+  return X8_CAN_STATS_CMDS - 1;
+}
+
+uint8_t x8_can_stats_cmd_byte(uint8_t index)
+{
+  if (index >= sizeof(M_X8_CAN_STATS_CMD))
+    return 0;
+
+  return x8_pgm_read_byte(&M_X8_CAN_STATS_CMD[index]);
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Count a frame by command byte and motor
+ *
+ * @param[in]   cmd           Per command counters
+ * @param[in]   motor         Per motor counters
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   can_data      Pointer to can data
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_can_stats_count(X8_CAN_STATS_COUNTER *cmd, X8_CAN_STATS_COUNTER *motor, uint16_t msg_id, const uint8_t *can_data)
+{
+  // Frames of other CAN IDs (0x280) have no command byte
+  if ((msg_id < RMD_X8_CAN_MSG_ID_OF(RMD_X8_MOTOR_ID_MIN)) ||
+      (msg_id > RMD_X8_CAN_MSG_ID_OF(RMD_X8_MOTOR_ID_MAX)))
+  {
+    m_x8_can_stats_inc(&cmd[X8_CAN_STATS_CMDS - 1]);
+    return;
+  }
+
+  m_x8_can_stats_inc(&cmd[x8_can_stats_cmd_index(can_data[0])]);
+
+  if (msg_id <= RMD_X8_CAN_MSG_ID_OF(X8_CAN_STATS_MOTORS))
+  {
+    m_x8_can_stats_inc(&motor[RMD_X8_MOTOR_ID_OF(msg_id) - 1]);
+  }
+}
+
+/**
+ * @brief       Count one frame
+ *
+ * @param[in]   counter       Pointer to counter
+ *
+ * @attention   Saturates instead of wrapping to 0
+ *
+ * @return      None
+ */
+static void m_x8_can_stats_inc(X8_CAN_STATS_COUNTER *counter)
+{
+  if ((X8_CAN_STATS_COUNTER)(*counter + 1) != 0)
+  {
+    (*counter)++;
+  }
+}
+
+/* End of file -------------------------------------------------------- */
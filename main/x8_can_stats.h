@@ -0,0 +1,199 @@
+/**
+ * @file       x8_can_stats.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Frame and bus load counters
+ * @note       Counters cover a window that starts at init or reset. Attach to
+ *             a motor with x8_can_t::stats, frames are then counted when
+ *             decoded by x8_can_receive. Sent frames are counted by the
+ *             transport when the controller takes them (x8_can_stats_tx), so
+ *             a frame queued and dropped is a TX failure only. Every frame is
+ *             costed RMD_X8_CAN_FRAME_BITS on the wire.
+ *             TX failures and RX overruns happen below the library, the
+ *             transport reports them. Per command and per motor counters are
+ *             X8_CAN_STATS_COUNTER (16 bit on AVR: 65 s of 1 kHz setpoints),
+ *             they stop at their maximum until the next reset.
+ * @example    x8_can_stats_init(&stats, micros());
+ *             motor.stats = &stats;
+ *             transmit: if (sent) x8_can_stats_tx(&stats, msg_id, buffer);
+ *             x8_can_stats_snapshot(&stats, micros(), 1000000, &snap);
+ *             x8_can_stats_reset(&stats, micros());
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_STATS_H
+#define __X8_CAN_STATS_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_config.h"
+
+/* Public defines ----------------------------------------------------- */
+#define X8_CAN_STATS_CMDS                       (24)  // Command bytes of x8_can.h and "other"
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Counters of the current window
+ */
+typedef struct x8_can_stats
+{
+  uint32_t             start_us;
+
+  uint32_t             tx_frames;
+  uint32_t             rx_frames;
+  uint32_t             tx_fail;                        // Frames the transport could not send
+  uint32_t             rx_overrun;                     // Frames lost before decoding
+
+  X8_CAN_STATS_COUNTER tx_cmd[X8_CAN_STATS_CMDS];      // Index x8_can_stats_cmd_index()
+  X8_CAN_STATS_COUNTER rx_cmd[X8_CAN_STATS_CMDS];
+  X8_CAN_STATS_COUNTER tx_motor[X8_CAN_STATS_MOTORS];  // Index motor_id - 1
+  X8_CAN_STATS_COUNTER rx_motor[X8_CAN_STATS_MOTORS];
+}
+x8_can_stats_t;
+
+/**
+ * @brief Rates of a window
+ */
+typedef struct
+{
+  uint32_t elapsed_us;
+  uint32_t tx_fps;                                // Frames per second
+  uint32_t rx_fps;
+  uint32_t bps;                                   // Bits per second, both directions
+  uint16_t load_permille;                         // Of bitrate
+  uint32_t tx_fail;
+  uint32_t rx_overrun;
+}
+x8_can_stats_snapshot_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Clear counters and start a window
+ *
+ * @param[in]   me            Pointer to statistics
+ * @param[in]   now_us        Current time (us)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_stats_init(x8_can_stats_t *me, uint32_t now_us);
+
+/**
+ * @brief       Clear counters and start a new window
+ *
+ * @param[in]   me            Pointer to statistics
+ * @param[in]   now_us        Current time (us)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_stats_reset(x8_can_stats_t *me, uint32_t now_us);
+
+/**
+ * @brief       Count a sent frame
+ *
+ * @param[in]   me            Pointer to statistics
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   can_data      Pointer to can data
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_stats_tx(x8_can_stats_t *me, uint16_t msg_id, const uint8_t *can_data);
+
+/**
+ * @brief       Count a received frame
+ *
+ * @param[in]   me            Pointer to statistics
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   can_data      Pointer to can data
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_stats_rx(x8_can_stats_t *me, uint16_t msg_id, const uint8_t *can_data);
+
+/**
+ * @brief       Count frames the transport failed to send
+ *
+ * @param[in]   me            Pointer to statistics
+ * @param[in]   count         Number of frames
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_stats_tx_fail(x8_can_stats_t *me, uint32_t count);
+
+/**
+ * @brief       Count frames lost on receive
+ *
+ * @param[in]   me            Pointer to statistics
+ * @param[in]   count         Number of frames
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_stats_rx_overrun(x8_can_stats_t *me, uint32_t count);
+
+/**
+ * @brief       Rates of the current window
+ *
+ * @param[in]   me            Pointer to statistics
+ * @param[in]   now_us        Current time (us)
+ * @param[in]   bitrate       CAN bitrate (bit/s)
+ * @param[out]  snap          Rates
+ *
+ * @attention   Counters keep running, reset to start a new window
+ *
+ * @return      None
+ */
+void x8_can_stats_snapshot(x8_can_stats_t *me, uint32_t now_us, uint32_t bitrate, x8_can_stats_snapshot_t *snap);
+
+/**
+ * @brief       Per second rate of a counter of the window
+ *
+ * @param[in]   count         Counter value
+ * @param[in]   elapsed_us    Window length (us)
+ *
+ * @attention   None
+ *
+ * @return      Count per second
+ */
+uint32_t x8_can_stats_rate(uint32_t count, uint32_t elapsed_us);
+
+/**
+ * @brief       Counter index of a command byte
+ *
+ * @param[in]   cmd_byte      Command byte
+ *
+ * @attention   None
+ *
+ * @return      0 ... X8_CAN_STATS_CMDS - 2, X8_CAN_STATS_CMDS - 1 for unknown bytes
+ */
+uint8_t x8_can_stats_cmd_index(uint8_t cmd_byte);
+
+/**
+ * @brief       Command byte of a counter index
+ *
+ * @param[in]   index         Counter index
+ *
+ * @attention   None
+ *
+ * @return      Command byte, 0 for "other"
+ */
+uint8_t x8_can_stats_cmd_byte(uint8_t index);
+
+#endif // __X8_CAN_STATS_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,198 @@
+/**
+ * @file       x8_can_telemetry.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Periodic telemetry reads under a bus load budget
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_telemetry.h"
+
+/* Private defines ---------------------------------------------------- */
+// Request and reply
+#define X8_CAN_TELEMETRY_READ_BITS      (2UL * RMD_X8_CAN_FRAME_BITS)
+
+static_assert(X8_CAN_TELEMETRY_STREAMS <= 255, "X8_CAN_TELEMETRY_STREAMS must fit 8 bit count");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static void m_x8_can_telemetry_plan(x8_can_telemetry_t *me);
+static uint32_t m_x8_can_telemetry_load(uint32_t period_us);
+
+/* Function definitions ----------------------------------------------- */
+void x8_can_telemetry_init(x8_can_telemetry_t *me, uint32_t bitrate, uint8_t budget_percent)
+{
+  me->count      = 0;
+  me->budget_bps = bitrate / 100 * budget_percent;
+  me->load_bps   = 0;
+  me->running    = false;
+}
+
+bool x8_can_telemetry_add(x8_can_telemetry_t *me, x8_can_t *motor, uint8_t cmd_byte,
+                          uint32_t period_us, uint8_t priority)
+{
+  x8_can_telemetry_stream_t *stream;
+
+  if ((me->count >= X8_CAN_TELEMETRY_STREAMS) || (period_us == 0))
+    return false;
+
+  stream = &me->stream[me->count++];
+  stream->motor     = motor;
+  stream->cmd_byte  = cmd_byte;
+  stream->priority  = priority;
+  stream->period_us = period_us;
+  stream->missed    = 0;
+
+  m_x8_can_telemetry_plan(me);
+
+  return true;
+}
+
+void x8_can_telemetry_start(x8_can_telemetry_t *me, uint32_t now_us)
+{
+  for (uint8_t i = 0; i < me->count; i++)
+  {
+    x8_can_telemetry_stream_t *stream = &me->stream[i];
+    uint8_t index = 0;
+    uint8_t total = 0;
+
+    // Slot of this stream among the streams of the same period
+    for (uint8_t j = 0; j < me->count; j++)
+    {
+      if (me->stream[j].plan_period_us != stream->plan_period_us)
+        continue;
+
+      if (j < i)
+      {
+        index++;
+      }
+      total++;
+    }
+
+    stream->next_us = now_us + stream->plan_period_us / total * index;
+  }
+
+  me->running = true;
+}
+
+void x8_can_telemetry_stop(x8_can_telemetry_t *me)
+{
+  me->running = false;
+}
+
+uint8_t x8_can_telemetry_poll(x8_can_telemetry_t *me, uint32_t now_us)
+{
+  uint8_t count = 0;
+
+  if (!me->running)
+    return 0;
+
+  for (uint8_t i = 0; i < me->count; i++)
+  {
+    x8_can_telemetry_stream_t *stream = &me->stream[i];
+    uint32_t late_us;
+
+    if ((stream->plan_period_us == 0) || ((int32_t)(now_us - stream->next_us) < 0))
+      continue;
+
+    x8_can_send_cmd(stream->motor, stream->cmd_byte);
+    count++;
+
+    // Keep the phase, skip the periods already missed
+    late_us = now_us - stream->next_us;
+    if (late_us >= stream->plan_period_us)
+    {
+      stream->missed  += late_us / stream->plan_period_us;
+      stream->next_us += late_us / stream->plan_period_us * stream->plan_period_us;
+    }
+    stream->next_us += stream->plan_period_us;
+  }
+
+  return count;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Fit the streams into the budget, slowing lowest priority first
+ *
+ * @param[in]   me            Pointer to scheduler
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_can_telemetry_plan(x8_can_telemetry_t *me)
+{
+  me->load_bps = 0;
+
+  for (uint8_t i = 0; i < me->count; i++)
+  {
+    me->stream[i].plan_period_us = me->stream[i].period_us;
+    me->load_bps += m_x8_can_telemetry_load(me->stream[i].period_us);
+  }
+
+  while (me->load_bps > me->budget_bps)
+  {
+    x8_can_telemetry_stream_t *victim = NULL;
+    bool slow = false;
+
+    // Lowest priority, then the stream costing the most. Streams already at
+    // the longest period are only suspended when no stream can be slowed.
+    for (uint8_t i = 0; i < me->count; i++)
+    {
+      x8_can_telemetry_stream_t *stream = &me->stream[i];
+      bool can_slow = (stream->plan_period_us <= X8_CAN_TELEMETRY_PERIOD_MAX_US / 2);
+
+      if (stream->plan_period_us == 0)
+        continue;
+
+      if ((victim == NULL) || (can_slow && !slow) ||
+          ((can_slow == slow) &&
+           ((stream->priority > victim->priority) ||
+            ((stream->priority == victim->priority) && (stream->plan_period_us < victim->plan_period_us)))))
+      {
+        victim = stream;
+        slow   = can_slow;
+      }
+    }
+
+    if (victim == NULL)
+      break;
+
+    me->load_bps -= m_x8_can_telemetry_load(victim->plan_period_us);
+
+    if (slow)
+    {
+      victim->plan_period_us *= 2;
+      me->load_bps += m_x8_can_telemetry_load(victim->plan_period_us);
+    }
+    else
+    {
+      victim->plan_period_us = 0;
+    }
+  }
+}
+
+/**
+ * @brief       Bus load of a stream
+ *
+ * @param[in]   period_us     Period (us), not 0
+ *
+ * @attention   None
+ *
+ * @return      Bits per second
+ */
+static uint32_t m_x8_can_telemetry_load(uint32_t period_us)
+{
+  return X8_CAN_TELEMETRY_READ_BITS * 1000000UL / period_us;
+}
+
+/* End of file -------------------------------------------------------- */
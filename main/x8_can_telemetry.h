@@ -0,0 +1,134 @@
+/**
+ * @file       x8_can_telemetry.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Periodic telemetry reads under a bus load budget
+ * @note       A stream reads one command of one motor at a fixed period.
+ *             Each read costs a request and a reply frame. When the streams
+ *             need more than the budget share of the bus, the period of the
+ *             lowest priority stream is doubled, one stream at a time, until
+ *             the plan fits. Streams stop slowing down at
+ *             X8_CAN_TELEMETRY_PERIOD_MAX_US, when all are there the lowest
+ *             priority ones are suspended.
+ *             Streams of equal period are spread evenly over the period.
+ *             Replies are not waited for, they reach the motor handler through
+ *             x8_can_registry_receive like any other frame.
+ * @example    x8_can_telemetry_init(&tm, 1000000, 50);
+ *             x8_can_telemetry_add(&tm, &motor, RMD_X8_READ_MOTOR_STATUS_2_CMD, 2000, 0);
+ *             x8_can_telemetry_start(&tm, micros());
+ *             loop: x8_can_telemetry_poll(&tm, micros());
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_TELEMETRY_H
+#define __X8_CAN_TELEMETRY_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_config.h"
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Telemetry stream
+ */
+typedef struct
+{
+  x8_can_t *motor;
+  uint8_t   cmd_byte;
+  uint8_t   priority;               // 0 => highest, degraded last
+  uint32_t  period_us;              // Requested period
+  uint32_t  plan_period_us;         // Period after degradation, 0 => suspended
+  uint32_t  next_us;                // Next read
+  uint16_t  missed;                 // Periods skipped because poll came late
+}
+x8_can_telemetry_stream_t;
+
+/**
+ * @brief Telemetry scheduler
+ */
+typedef struct
+{
+  x8_can_telemetry_stream_t stream[X8_CAN_TELEMETRY_STREAMS];
+  uint8_t                   count;
+
+  uint32_t                  budget_bps;     // Bus bits per second for telemetry
+  uint32_t                  load_bps;       // Bus bits per second of the plan
+  bool                      running;
+}
+x8_can_telemetry_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init telemetry scheduler without streams
+ *
+ * @param[in]   me                Pointer to scheduler
+ * @param[in]   bitrate           CAN bitrate (bit/s)
+ * @param[in]   budget_percent    Share of the bus for telemetry (1 ... 100)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_telemetry_init(x8_can_telemetry_t *me, uint32_t bitrate, uint8_t budget_percent);
+
+/**
+ * @brief       Add a stream and plan again
+ *
+ * @param[in]   me            Pointer to scheduler
+ * @param[in]   motor         Pointer to can handler
+ * @param[in]   cmd_byte      Read command (e.g. RMD_X8_READ_MOTOR_STATUS_2_CMD)
+ * @param[in]   period_us     Period (us)
+ * @param[in]   priority      0 => highest
+ *
+ * @attention   Restart the scheduler to apply the new phases
+ *
+ * @return      false if the table is full or period_us is 0
+ */
+bool x8_can_telemetry_add(x8_can_telemetry_t *me, x8_can_t *motor, uint8_t cmd_byte,
+                          uint32_t period_us, uint8_t priority);
+
+/**
+ * @brief       Start reads, streams are spread over their period from now
+ *
+ * @param[in]   me            Pointer to scheduler
+ * @param[in]   now_us        Current time (us)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_telemetry_start(x8_can_telemetry_t *me, uint32_t now_us);
+
+/**
+ * @brief       Stop reads
+ *
+ * @param[in]   me            Pointer to scheduler
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_telemetry_stop(x8_can_telemetry_t *me);
+
+/**
+ * @brief       Send the reads that are due
+ *
+ * @param[in]   me            Pointer to scheduler
+ * @param[in]   now_us        Current time (us)
+ *
+ * @attention   Call every loop. A stream more than one period late skips the
+ *              missed reads instead of sending them in a burst.
+ *
+ * @return      Number of reads sent
+ */
+uint8_t x8_can_telemetry_poll(x8_can_telemetry_t *me, uint32_t now_us);
+
+#endif // __X8_CAN_TELEMETRY_H
+
+/* End of file -------------------------------------------------------- */
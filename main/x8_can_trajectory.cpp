@@ -0,0 +1,270 @@
+/**
+ * @file       x8_can_trajectory.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Buffered trajectory of one motor, interpolated onboard
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_trajectory.h"
+
+/* Private defines ---------------------------------------------------- */
+#define M_X8_CAN_TRAJECTORY_MASK        (X8_CAN_TRAJECTORY_POINTS - 1)
+#define M_X8_CAN_TRAJECTORY_GAP_MAX_MS  (0xFFFFFFFFUL / 1000)       // Segment length in 32 bit us
+
+static_assert((X8_CAN_TRAJECTORY_POINTS & M_X8_CAN_TRAJECTORY_MASK) == 0, "X8_CAN_TRAJECTORY_POINTS must be a power of 2");
+static_assert(X8_CAN_TRAJECTORY_POINTS <= 0x8000, "X8_CAN_TRAJECTORY_POINTS above 16 bit indexes");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+#define M_X8_CAN_TRAJECTORY_POINT(me, i)    (&(me)->point[((me)->tail + (i)) & M_X8_CAN_TRAJECTORY_MASK])
+
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static void m_x8_can_trajectory_enter(x8_can_trajectory_t *me, bool from_rest);
+static void m_x8_can_trajectory_advance(x8_can_trajectory_t *me, uint32_t elapsed_us);
+static int32_t m_x8_can_trajectory_round(float value);
+
+/* Function definitions ----------------------------------------------- */
+void x8_can_trajectory_init(x8_can_trajectory_t *me, x8_can_t *motor, uint8_t mode, uint8_t interp)
+{
+  me->motor      = motor;
+  me->mode       = mode;
+  me->interp     = interp;
+  me->state      = X8_CAN_TRAJECTORY_IDLE;
+  me->tail       = 0;
+  me->count      = 0;
+  me->segment_us = 0;
+  me->tangent    = 0;
+  me->sent       = 0;
+  me->missed     = 0;
+  me->starved    = 0;
+}
+
+bool x8_can_trajectory_push(x8_can_trajectory_t *me, uint32_t t_ms, int32_t position)
+{
+  x8_can_trajectory_point_t *point;
+
+  if (me->count >= X8_CAN_TRAJECTORY_POINTS)
+    return false;
+
+  if (me->count > 0)
+  {
+    uint32_t last_ms = M_X8_CAN_TRAJECTORY_POINT(me, me->count - 1)->t_ms;
+
+    if ((t_ms <= last_ms) || (t_ms - last_ms > M_X8_CAN_TRAJECTORY_GAP_MAX_MS))
+      return false;
+  }
+
+  point = M_X8_CAN_TRAJECTORY_POINT(me, me->count);
+  point->t_ms     = t_ms;
+  point->position = position;
+  me->count++;
+
+  return true;
+}
+
+uint16_t x8_can_trajectory_space(x8_can_trajectory_t *me)
+{
+  return X8_CAN_TRAJECTORY_POINTS - me->count;
+}
+
+bool x8_can_trajectory_start(x8_can_trajectory_t *me)
+{
+  if (me->count == 0)
+    return false;
+
+  me->segment_us = 0;
+  me->state      = X8_CAN_TRAJECTORY_STARVED;
+
+  if (me->count >= 2)
+  {
+    m_x8_can_trajectory_enter(me, true);
+    me->state = X8_CAN_TRAJECTORY_RUNNING;
+  }
+
+  return true;
+}
+
+void x8_can_trajectory_stop(x8_can_trajectory_t *me)
+{
+  if ((me->state != X8_CAN_TRAJECTORY_IDLE) && (me->mode == X8_CAN_TRAJECTORY_SPEED))
+  {
+    x8_can_send_speed_close_loop_cmd(me->motor, 0);
+  }
+
+  me->state = X8_CAN_TRAJECTORY_IDLE;
+  me->count = 0;
+}
+
+bool x8_can_trajectory_tick(x8_can_trajectory_t *me, uint8_t periods)
+{
+  const uint32_t period_us = X8_CAN_TRAJECTORY_PERIOD_US;
+  int32_t position, speed;
+
+  if ((me->state == X8_CAN_TRAJECTORY_IDLE) || (periods == 0))
+    return false;
+
+  // Skip the setpoints of merged ticks, the trajectory keeps tick time
+  if (periods > 1)
+  {
+    me->missed += periods - 1;
+    m_x8_can_trajectory_advance(me, (uint32_t)(periods - 1) * period_us);
+  }
+
+  x8_can_trajectory_sample(me, &position, &speed);
+
+  if (me->mode == X8_CAN_TRAJECTORY_SPEED)
+  {
+    x8_can_send_speed_close_loop_cmd(me->motor, speed);
+  }
+  else
+  {
+    x8_can_send_position_ctrl_1_cmd(me->motor, position);
+  }
+  me->sent++;
+
+  m_x8_can_trajectory_advance(me, period_us);
+
+  return true;
+}
+
+bool x8_can_trajectory_sample(x8_can_trajectory_t *me, int32_t *position, int32_t *speed)
+{
+  const x8_can_trajectory_point_t *start = M_X8_CAN_TRAJECTORY_POINT(me, 0);
+  float u;
+
+  if (me->count == 0)
+    return false;
+
+  if (me->state != X8_CAN_TRAJECTORY_RUNNING)
+  {
+    *position = start->position;
+    *speed    = 0;
+    return true;
+  }
+
+  u = (float)me->segment_us * me->u_per_us;
+
+  *position = start->position + m_x8_can_trajectory_round(((me->coef[0] * u + me->coef[1]) * u + me->coef[2]) * u);
+  *speed    = m_x8_can_trajectory_round((((3.0f * me->coef[0]) * u + 2.0f * me->coef[1]) * u + me->coef[2]) *
+                                        me->u_per_us * 1000000.0f);
+
+  return true;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Set up the segment between the first two waypoints
+ *
+ * @param[in]   me            Pointer to trajectory
+ * @param[in]   from_rest     true => start tangent 0, else the end tangent of the last segment
+ *
+ * @attention   Needs 2 waypoints, a third gives the end tangent of a cubic segment
+ *
+ * @return      None
+ */
+static void m_x8_can_trajectory_enter(x8_can_trajectory_t *me, bool from_rest)
+{
+  const x8_can_trajectory_point_t *p0 = M_X8_CAN_TRAJECTORY_POINT(me, 0);
+  const x8_can_trajectory_point_t *p1 = M_X8_CAN_TRAJECTORY_POINT(me, 1);
+  float length_ms = (float)(p1->t_ms - p0->t_ms);
+  float delta = (float)p1->position - (float)p0->position;
+  float m0, m1;
+
+  me->u_per_us = 1.0f / (length_ms * 1000.0f);
+
+  if (me->interp == X8_CAN_TRAJECTORY_LINEAR)
+  {
+    me->coef[0] = 0;
+    me->coef[1] = 0;
+    me->coef[2] = delta;
+    return;
+  }
+
+  // Hermite tangents scaled to the segment, Catmull-Rom at the end waypoint
+  m0 = from_rest ? 0 : me->tangent * length_ms;
+  me->tangent = 0;
+  if (me->count >= 3)
+  {
+    const x8_can_trajectory_point_t *p2 = M_X8_CAN_TRAJECTORY_POINT(me, 2);
+
+    me->tangent = ((float)p2->position - (float)p0->position) / (float)(p2->t_ms - p0->t_ms);
+  }
+  m1 = me->tangent * length_ms;
+
+  me->coef[0] = -2.0f * delta + m0 + m1;
+  me->coef[1] = 3.0f * delta - 2.0f * m0 - m1;
+  me->coef[2] = m0;
+}
+
+/**
+ * @brief       Move the trajectory clock, dropping the segments left behind
+ *
+ * @param[in]   me            Pointer to trajectory
+ * @param[in]   elapsed_us    Time (us)
+ *
+ * @attention   A starved trajectory does not move, it restarts at rest when
+ *              a waypoint comes
+ *
+ * @return      None
+ */
+static void m_x8_can_trajectory_advance(x8_can_trajectory_t *me, uint32_t elapsed_us)
+{
+  if (me->state == X8_CAN_TRAJECTORY_STARVED)
+  {
+    if (me->count >= 2)
+    {
+      me->segment_us = 0;
+      m_x8_can_trajectory_enter(me, true);
+      me->state = X8_CAN_TRAJECTORY_RUNNING;
+    }
+    return;
+  }
+
+  me->segment_us += elapsed_us;
+
+  while (true)
+  {
+    uint32_t length_us = (M_X8_CAN_TRAJECTORY_POINT(me, 1)->t_ms - M_X8_CAN_TRAJECTORY_POINT(me, 0)->t_ms) * 1000;
+
+    if (me->segment_us < length_us)
+      return;
+
+    me->segment_us -= length_us;
+    me->tail = (me->tail + 1) & M_X8_CAN_TRAJECTORY_MASK;
+    me->count--;
+
+    if (me->count < 2)
+    {
+      me->segment_us = 0;
+      me->state      = X8_CAN_TRAJECTORY_STARVED;
+      me->starved++;
+      return;
+    }
+
+    m_x8_can_trajectory_enter(me, false);
+  }
+}
+
+/**
+ * @brief       Round to the nearest integer
+ *
+ * @param[in]   value         Value
+ *
+ * @attention   None
+ *
+ * @return      Rounded value
+ */
+static int32_t m_x8_can_trajectory_round(float value)
+{
+  return (int32_t)((value >= 0) ? value + 0.5f : value - 0.5f);
+}
+
+/* End of file -------------------------------------------------------- */
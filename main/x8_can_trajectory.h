@@ -0,0 +1,205 @@
+/**
+ * @file       x8_can_trajectory.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Buffered trajectory of one motor, interpolated onboard
+ * @note       Waypoints (time, position) are pushed into a ring while the
+ *             trajectory runs. Every control tick the position between the
+ *             two current waypoints is interpolated and sent, as
+ *             x8_can_send_position_ctrl_1_cmd or, in speed mode, its time
+ *             derivative as x8_can_send_speed_close_loop_cmd. Speed mode is
+ *             feed forward only, the motor integrates it.
+ *             Times are ms, only their differences count: the trajectory
+ *             starts at its first waypoint. Positions are the unit of
+ *             x8_can_send_position_ctrl_1_cmd, speeds that unit per second.
+ *             Cubic uses Hermite segments with the tangent of a waypoint
+ *             taken from its neighbours (Catmull-Rom), set when the segment
+ *             starts. The waypoint after a segment must be buffered by then,
+ *             else the segment ends at rest.
+ *             A trajectory running dry holds its last waypoint (speed 0) and
+ *             its clock stops, pushed waypoints resume from there.
+ *             The trajectory has no clock of its own: each tick moves it by
+ *             exactly the X8_CAN_TRAJECTORY_PERIOD_US periods the tick
+ *             covers, so it keeps the phase of the tick and never sends
+ *             twice or skips within one.
+ * @example    x8_can_trajectory_init(&traj, &motor, X8_CAN_TRAJECTORY_POSITION, X8_CAN_TRAJECTORY_CUBIC);
+ *             x8_can_trajectory_push(&traj, 0, 0);
+ *             x8_can_trajectory_push(&traj, 500, 90);
+ *             x8_can_trajectory_start(&traj);
+ *             tick: x8_can_trajectory_tick(&traj, 1);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_TRAJECTORY_H
+#define __X8_CAN_TRAJECTORY_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_config.h"
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Setpoint sent each period
+ */
+typedef enum
+{
+  X8_CAN_TRAJECTORY_POSITION,
+  X8_CAN_TRAJECTORY_SPEED
+}
+x8_can_trajectory_mode_t;
+
+/**
+ * @brief Interpolation between waypoints
+ */
+typedef enum
+{
+  X8_CAN_TRAJECTORY_LINEAR,
+  X8_CAN_TRAJECTORY_CUBIC
+}
+x8_can_trajectory_interp_t;
+
+/**
+ * @brief Trajectory state
+ */
+typedef enum
+{
+  X8_CAN_TRAJECTORY_IDLE,               // Not started or stopped
+  X8_CAN_TRAJECTORY_RUNNING,
+  X8_CAN_TRAJECTORY_STARVED             // Holding the last waypoint
+}
+x8_can_trajectory_state_t;
+
+/**
+ * @brief Waypoint
+ */
+typedef struct
+{
+  uint32_t t_ms;
+  int32_t  position;
+}
+x8_can_trajectory_point_t;
+
+/**
+ * @brief Trajectory of one motor
+ */
+typedef struct
+{
+  x8_can_t                 *motor;
+  uint8_t                   mode;           // x8_can_trajectory_mode_t
+  uint8_t                   interp;         // x8_can_trajectory_interp_t
+  uint8_t                   state;          // x8_can_trajectory_state_t
+
+  x8_can_trajectory_point_t point[X8_CAN_TRAJECTORY_POINTS];
+  uint16_t                  tail;           // Start of the current segment
+  uint16_t                  count;
+
+  uint32_t                  segment_us;     // Time into the current segment
+  float                     u_per_us;       // 1 / segment length (us)
+  float                     coef[3];        // Offset from the segment start: ((coef[0] u + coef[1]) u + coef[2]) u
+  float                     tangent;        // Position per ms at the segment end, start tangent of the next one
+
+  uint32_t                  sent;           // Setpoints sent
+  uint16_t                  missed;         // Periods skipped because ticks were merged
+  uint16_t                  starved;        // Times the buffer ran dry
+}
+x8_can_trajectory_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init an empty, idle trajectory
+ *
+ * @param[in]   me            Pointer to trajectory
+ * @param[in]   motor         Pointer to can handler
+ * @param[in]   mode          x8_can_trajectory_mode_t
+ * @param[in]   interp        x8_can_trajectory_interp_t
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_trajectory_init(x8_can_trajectory_t *me, x8_can_t *motor, uint8_t mode, uint8_t interp);
+
+/**
+ * @brief       Append a waypoint
+ *
+ * @param[in]   me            Pointer to trajectory
+ * @param[in]   t_ms          Time (ms), after the last waypoint and less than 71 minutes from it
+ * @param[in]   position      Position (x8_can_send_position_ctrl_1_cmd unit)
+ *
+ * @attention   None
+ *
+ * @return      false if the buffer is full or the time not after the last one
+ */
+bool x8_can_trajectory_push(x8_can_trajectory_t *me, uint32_t t_ms, int32_t position);
+
+/**
+ * @brief       Free waypoints of the buffer
+ *
+ * @param[in]   me            Pointer to trajectory
+ *
+ * @attention   None
+ *
+ * @return      Waypoints that can be pushed
+ */
+uint16_t x8_can_trajectory_space(x8_can_trajectory_t *me);
+
+/**
+ * @brief       Start from the first waypoint, its setpoint goes at the next tick
+ *
+ * @param[in]   me            Pointer to trajectory
+ *
+ * @attention   None
+ *
+ * @return      false without waypoint
+ */
+bool x8_can_trajectory_start(x8_can_trajectory_t *me);
+
+/**
+ * @brief       Stop and drop the waypoints
+ *
+ * @param[in]   me            Pointer to trajectory
+ *
+ * @attention   Speed mode sends speed 0, position mode leaves the motor at
+ *              the last setpoint
+ *
+ * @return      None
+ */
+void x8_can_trajectory_stop(x8_can_trajectory_t *me);
+
+/**
+ * @brief       Send the setpoint of a control tick
+ *
+ * @param[in]   me            Pointer to trajectory
+ * @param[in]   periods       X8_CAN_TRAJECTORY_PERIOD_US periods since the
+ *                            last tick, 1 unless ticks were merged
+ *
+ * @attention   Call once per tick of period X8_CAN_TRAJECTORY_PERIOD_US.
+ *              Merged ticks skip their setpoints, the trajectory still
+ *              moves by them.
+ *
+ * @return      true if a setpoint was sent
+ */
+bool x8_can_trajectory_tick(x8_can_trajectory_t *me, uint8_t periods);
+
+/**
+ * @brief       Setpoint at the current trajectory time, without sending it
+ *
+ * @param[in]   me            Pointer to trajectory
+ * @param[out]  position      Position
+ * @param[out]  speed         Position per second
+ *
+ * @attention   None
+ *
+ * @return      false without waypoint
+ */
+bool x8_can_trajectory_sample(x8_can_trajectory_t *me, int32_t *position, int32_t *speed);
+
+#endif // __X8_CAN_TRAJECTORY_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,382 @@
+/**
+ * @file       x8_can_tx.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Prioritised, coalescing CAN transmit scheduler
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can_tx.h"
+
+/* Private defines ---------------------------------------------------- */
+#define X8_CAN_TX_QUEUE_MASK    (X8_CAN_TX_QUEUE_SIZE - 1)
+
+static_assert((X8_CAN_TX_QUEUE_SIZE & X8_CAN_TX_QUEUE_MASK) == 0, "X8_CAN_TX_QUEUE_SIZE must be a power of 2");
+static_assert(X8_CAN_TX_QUEUE_SIZE <= 128, "X8_CAN_TX_QUEUE_SIZE must fit 8 bit indexes");
+static_assert(X8_CAN_TX_SETPOINT_MOTORS <= RMD_X8_MOTOR_ID_MAX, "X8_CAN_TX_SETPOINT_MOTORS above motor id range");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+#define X8_CAN_TX_BIT(motor_id) ((uint32_t)1 << ((motor_id) - 1))
+#define X8_CAN_TX_MULTI_BITS    (X8_CAN_TX_BIT(RMD_X8_MULTI_TORQUE_MOTORS + 1) - 1)
+
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static bool m_x8_can_tx_flags(x8_can_tx_t *me, uint32_t *pending, uint8_t cmd_byte);
+static bool m_x8_can_tx_setpoints(x8_can_tx_t *me);
+static void m_x8_can_tx_halt(x8_can_tx_t *me, uint16_t motor_id);
+static bool m_x8_can_tx_restarts(uint8_t cmd_byte);
+static void m_x8_can_tx_copy(uint8_t *dst, const uint8_t *src);
+
+/* Function definitions ----------------------------------------------- */
+void x8_can_tx_init(x8_can_tx_t *me, bool (*transmit) (uint16_t msg_id, uint8_t * buffer, bool urgent))
+{
+  me->transmit         = transmit;
+  me->off_pending      = 0;
+  me->stop_pending     = 0;
+  me->setpoint_pending = 0;
+  me->setpoint_next    = 0;
+  me->multi_pending    = false;
+  me->head             = 0;
+  me->tail             = 0;
+  me->dropped          = 0;
+}
+
+bool x8_can_tx_enqueue(x8_can_tx_t *me, uint16_t msg_id, uint8_t *buffer)
+{
+  x8_can_tx_entry_t *entry;
+  uint16_t motor_id = RMD_X8_MOTOR_ID_OF(msg_id);
+  bool motor_frame  = (msg_id >= RMD_X8_CAN_MSG_ID_OF(RMD_X8_MOTOR_ID_MIN)) &&
+                      (msg_id <= RMD_X8_CAN_MSG_ID_OF(RMD_X8_MOTOR_ID_MAX));
+
+  if (msg_id == RMD_X8_CAN_MULTI_TORQUE_MSG_ID)
+  {
+    m_x8_can_tx_copy(me->multi, buffer);
+    me->multi_pending = true;
+    return true;
+  }
+
+  if (motor_frame)
+  {
+    switch (buffer[0])
+    {
+    case RMD_X8_MOTOR_OFF_CMD:
+    {
+      me->off_pending |= X8_CAN_TX_BIT(motor_id);
+      m_x8_can_tx_halt(me, motor_id);
+      return true;
+    }
+
+    case RMD_X8_MOTOR_STOP_CMD:
+    {
+      me->stop_pending |= X8_CAN_TX_BIT(motor_id);
+      m_x8_can_tx_halt(me, motor_id);
+      return true;
+    }
+
+    case RMD_X8_TORQUE_CLOSED_LOOP_CMD:
+    case RMD_X8_SPEED_CLOSED_LOOP_CMD:
+    case RMD_X8_POSITION_CTRL_1_CMD:
+    case RMD_X8_POSITION_CTRL_2_CMD:
+    case RMD_X8_POSITION_CTRL_3_CMD:
+    case RMD_X8_POSITION_CTRL_4_CMD:
+    {
+      if (motor_id > X8_CAN_TX_SETPOINT_MOTORS)
+        break;
+
+      // Latest wins, an older setpoint of this motor is overwritten
+      m_x8_can_tx_copy(me->setpoint[motor_id - 1], buffer);
+      me->setpoint_pending |= X8_CAN_TX_BIT(motor_id);
+      return true;
+    }
+
+    default:
+      break;
+    }
+  }
+
+  // Other frames keep their order
+  if ((uint8_t)(me->head - me->tail) >= X8_CAN_TX_QUEUE_SIZE)
+  {
+    me->dropped++;
+    return false;
+  }
+
+  entry = &me->queue[me->head & X8_CAN_TX_QUEUE_MASK];
+  entry->msg_id = msg_id;
+  m_x8_can_tx_copy(entry->data, buffer);
+  me->head++;
+
+  return true;
+}
+
+bool x8_can_tx_requeue(x8_can_tx_t *me, uint16_t msg_id, uint8_t *buffer)
+{
+  x8_can_tx_entry_t *entry;
+  uint16_t motor_id = RMD_X8_MOTOR_ID_OF(msg_id);
+  uint32_t halted   = me->off_pending | me->stop_pending;
+  bool motor_frame  = (msg_id >= RMD_X8_CAN_MSG_ID_OF(RMD_X8_MOTOR_ID_MIN)) &&
+                      (msg_id <= RMD_X8_CAN_MSG_ID_OF(RMD_X8_MOTOR_ID_MAX));
+
+  if (msg_id == RMD_X8_CAN_MULTI_TORQUE_MSG_ID)
+  {
+    if (me->multi_pending || (halted & X8_CAN_TX_MULTI_BITS))
+      return false;
+
+    m_x8_can_tx_copy(me->multi, buffer);
+    me->multi_pending = true;
+    return true;
+  }
+
+  if (motor_frame && m_x8_can_tx_restarts(buffer[0]))
+  {
+    // Would undo the off or stop about to be sent
+    if (halted & X8_CAN_TX_BIT(motor_id))
+      return false;
+
+    if ((buffer[0] != RMD_X8_MOTOR_RUNNING_CMD) && (motor_id <= X8_CAN_TX_SETPOINT_MOTORS))
+    {
+      if (me->setpoint_pending & X8_CAN_TX_BIT(motor_id))
+        return false;
+
+      m_x8_can_tx_copy(me->setpoint[motor_id - 1], buffer);
+      me->setpoint_pending |= X8_CAN_TX_BIT(motor_id);
+      return true;
+    }
+  }
+
+  // Handed over before the queued frames, so back ahead of them
+  if ((uint8_t)(me->head - me->tail) >= X8_CAN_TX_QUEUE_SIZE)
+  {
+    me->dropped++;
+    return false;
+  }
+
+  me->tail--;
+  entry = &me->queue[me->tail & X8_CAN_TX_QUEUE_MASK];
+  entry->msg_id = msg_id;
+  m_x8_can_tx_copy(entry->data, buffer);
+
+  return true;
+}
+
+uint8_t x8_can_tx_poll(x8_can_tx_t *me)
+{
+  x8_can_tx_entry_t *entry;
+  uint8_t count = 0;
+
+  // Motor off first, then motor stop
+  while (m_x8_can_tx_flags(me, &me->off_pending, RMD_X8_MOTOR_OFF_CMD))
+  {
+    count++;
+  }
+
+  if (me->off_pending)
+    return count;
+
+  while (m_x8_can_tx_flags(me, &me->stop_pending, RMD_X8_MOTOR_STOP_CMD))
+  {
+    count++;
+  }
+
+  if (me->stop_pending)
+    return count;
+
+  if (me->multi_pending)
+  {
+    if (!me->transmit(RMD_X8_CAN_MULTI_TORQUE_MSG_ID, me->multi, false))
+      return count;
+
+    me->multi_pending = false;
+    count++;
+  }
+
+  // Setpoints ahead of queued frames
+  while (m_x8_can_tx_setpoints(me))
+  {
+    count++;
+  }
+
+  if (me->setpoint_pending)
+    return count;
+
+  // Queued frames
+  while (me->head != me->tail)
+  {
+    entry = &me->queue[me->tail & X8_CAN_TX_QUEUE_MASK];
+
+    if (!me->transmit(entry->msg_id, entry->data, false))
+      return count;
+
+    me->tail++;
+    count++;
+  }
+
+  return count;
+}
+
+bool x8_can_tx_idle(x8_can_tx_t *me)
+{
+  return (me->off_pending == 0) && (me->stop_pending == 0) && !me->multi_pending &&
+         (me->setpoint_pending == 0) && (me->head == me->tail);
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Transmit the command of the lowest motor with a pending flag
+ *
+ * @param[in]   me            Pointer to scheduler
+ * @param[in]   pending       Pointer to pending flags
+ * @param[in]   cmd_byte      Command byte sent for a flag
+ *
+ * @attention   None
+ *
+ * @return      true if a frame was transmitted
+ */
+static bool m_x8_can_tx_flags(x8_can_tx_t *me, uint32_t *pending, uint8_t cmd_byte)
+{
+  uint8_t can_tx_data[8];
+
+  for (uint8_t motor_id = RMD_X8_MOTOR_ID_MIN; (*pending != 0) && (motor_id <= RMD_X8_MOTOR_ID_MAX); motor_id++)
+  {
+    if (!(*pending & X8_CAN_TX_BIT(motor_id)))
+      continue;
+
+    x8_can_encode_cmd(can_tx_data, cmd_byte);
+    if (!me->transmit(RMD_X8_CAN_MSG_ID_OF(motor_id), can_tx_data, true))
+      return false;
+
+    *pending &= ~X8_CAN_TX_BIT(motor_id);
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief       Transmit the next pending setpoint, round robin between motors
+ *
+ * @param[in]   me            Pointer to scheduler
+ *
+ * @attention   None
+ *
+ * @return      true if a frame was transmitted
+ */
+static bool m_x8_can_tx_setpoints(x8_can_tx_t *me)
+{
+  uint8_t index = me->setpoint_next;
+
+  if (me->setpoint_pending == 0)
+    return false;
+
+  for (uint8_t i = 0; i < X8_CAN_TX_SETPOINT_MOTORS; i++)
+  {
+    if (me->setpoint_pending & X8_CAN_TX_BIT(index + 1))
+    {
+      if (!me->transmit(RMD_X8_CAN_MSG_ID_OF(index + 1), me->setpoint[index], false))
+        return false;
+
+      me->setpoint_pending &= ~X8_CAN_TX_BIT(index + 1);
+      me->setpoint_next     = (index + 1) % X8_CAN_TX_SETPOINT_MOTORS;
+      return true;
+    }
+
+    index = (index + 1) % X8_CAN_TX_SETPOINT_MOTORS;
+  }
+
+  return false;
+}
+
+/**
+ * @brief       Drop the frames waiting to drive a motor being turned off or stopped
+ *
+ * @param[in]   me            Pointer to scheduler
+ * @param[in]   motor_id      Motor id
+ *
+ * @attention   Drops its setpoint, the multi motor torque if the motor is one
+ *              of it, and its run and setpoint frames in the queue, which
+ *              keeps the order of the others
+ *
+ * @return      None
+ */
+static void m_x8_can_tx_halt(x8_can_tx_t *me, uint16_t motor_id)
+{
+  x8_can_tx_entry_t *entry;
+  uint16_t msg_id = RMD_X8_CAN_MSG_ID_OF(motor_id);
+  uint8_t  kept   = me->tail;
+
+  me->setpoint_pending &= ~X8_CAN_TX_BIT(motor_id);
+  if (motor_id <= RMD_X8_MULTI_TORQUE_MOTORS)
+  {
+    me->multi_pending = false;
+  }
+
+  for (uint8_t i = me->tail; i != me->head; i++)
+  {
+    entry = &me->queue[i & X8_CAN_TX_QUEUE_MASK];
+
+    if ((entry->msg_id == msg_id) && m_x8_can_tx_restarts(entry->data[0]))
+      continue;
+
+    if (i != kept)
+    {
+      me->queue[kept & X8_CAN_TX_QUEUE_MASK] = *entry;
+    }
+    kept++;
+  }
+
+  me->head = kept;
+}
+
+/**
+ * @brief       Check if a command drives the motor
+ *
+ * @param[in]   cmd_byte      Command byte
+ *
+ * @attention   None
+ *
+ * @return      true for run and the control setpoints
+ */
+static bool m_x8_can_tx_restarts(uint8_t cmd_byte)
+{
+  switch (cmd_byte)
+  {
+  case RMD_X8_MOTOR_RUNNING_CMD:
+  case RMD_X8_TORQUE_CLOSED_LOOP_CMD:
+  case RMD_X8_SPEED_CLOSED_LOOP_CMD:
+  case RMD_X8_POSITION_CTRL_1_CMD:
+  case RMD_X8_POSITION_CTRL_2_CMD:
+  case RMD_X8_POSITION_CTRL_3_CMD:
+  case RMD_X8_POSITION_CTRL_4_CMD:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief       Copy 8 bytes of can data
+ *
+ * @param[in]   dst           Destination
+ * @param[in]   src           Source
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_can_tx_copy(uint8_t *dst, const uint8_t *src)
+{
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    dst[i] = src[i];
+  }
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,150 @@
+/**
+ * @file       x8_can_tx.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Prioritised, coalescing CAN transmit scheduler
+ * @note       Frames are released in this order, one per free controller
+ *             TX buffer:
+ *             1. Motor off, then motor stop (one pending flag per motor),
+ *                handed over as urgent
+ *             2. Multi motor torque (0x280), latest wins
+ *             3. Control setpoints 0xA1 ... 0xA6, latest wins per motor,
+ *                round robin between motors
+ *             4. Other frames (reads, run, writes) in FIFO order
+ *             A setpoint is never stuck behind a backlog of reads: there is
+ *             at most one per motor, so the reads go out once it is sent.
+ *             The transmit function puts urgent frames in a controller
+ *             buffer of higher priority than the others, and first aborts
+ *             the frames still waiting in the other buffers and gives them
+ *             back with x8_can_tx_requeue(), so an off or stop goes on the
+ *             bus before them. A frame already on the bus when the abort
+ *             comes is sent.
+ *             A stop or off drops the pending setpoint of that motor, the
+ *             pending multi motor torque if the motor is one of it, and the
+ *             run and setpoint frames of that motor still in the queue.
+ *             Motors above X8_CAN_TX_SETPOINT_MOTORS have their setpoints
+ *             queued with the other frames.
+ * @example    None
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CAN_TX_H
+#define __X8_CAN_TX_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+#include "x8_can_config.h"
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Queued frame
+ */
+typedef struct
+{
+  uint16_t msg_id;
+  uint8_t  data[8];
+}
+x8_can_tx_entry_t;
+
+/**
+ * @brief Transmit scheduler
+ */
+typedef struct
+{
+  // Hand frame to the controller without waiting, false if no TX buffer is free.
+  // urgent frames must win the bus over frames already in the controller.
+  bool (*transmit) (uint16_t msg_id, uint8_t * buffer, bool urgent);
+
+  uint32_t          off_pending;                              // Bit n => motor n + 1
+  uint32_t          stop_pending;
+  uint32_t          setpoint_pending;
+  uint8_t           setpoint[X8_CAN_TX_SETPOINT_MOTORS][8];
+  uint8_t           setpoint_next;                            // Round robin start
+  bool              multi_pending;
+  uint8_t           multi[8];                                 // Multi motor torque
+
+  uint8_t           head;
+  uint8_t           tail;
+  x8_can_tx_entry_t queue[X8_CAN_TX_QUEUE_SIZE];
+
+  uint16_t          dropped;                                  // Frames lost, queue full
+}
+x8_can_tx_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init transmit scheduler
+ *
+ * @param[in]   me            Pointer to scheduler
+ * @param[in]   transmit      Non blocking controller transmit function
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_can_tx_init(x8_can_tx_t *me, bool (*transmit) (uint16_t msg_id, uint8_t * buffer, bool urgent));
+
+/**
+ * @brief       Queue a frame, classified by its CAN ID and command byte
+ *
+ * @param[in]   me            Pointer to scheduler
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   buffer        Pointer to can data (8 bytes), copied
+ *
+ * @attention   Matches x8_can_t::cansend once wrapped in a function without
+ *              the scheduler argument
+ *
+ * @return      false if the frame was dropped because the queue is full
+ */
+bool x8_can_tx_enqueue(x8_can_tx_t *me, uint16_t msg_id, uint8_t *buffer);
+
+/**
+ * @brief       Give back a frame the controller took but did not send
+ *
+ * @param[in]   me            Pointer to scheduler
+ * @param[in]   msg_id        CAN ID
+ * @param[in]   buffer        Pointer to can data (8 bytes), copied
+ *
+ * @attention   For the transmit function, when it aborts frames to put an
+ *              urgent one ahead of them. A run or setpoint of a motor with an
+ *              off or stop pending is dropped, as is the multi motor torque
+ *              if one of its motors has. A setpoint or multi motor torque
+ *              older than the pending one is dropped. Other frames go back
+ *              to the head of the queue, so give back the newest
+ *              first.
+ *
+ * @return      false if the frame was dropped
+ */
+bool x8_can_tx_requeue(x8_can_tx_t *me, uint16_t msg_id, uint8_t *buffer);
+
+/**
+ * @brief       Release queued frames while the controller accepts them
+ *
+ * @param[in]   me            Pointer to scheduler
+ *
+ * @attention   Never blocks, call every loop
+ *
+ * @return      Number of frames handed to the controller
+ */
+uint8_t x8_can_tx_poll(x8_can_tx_t *me);
+
+/**
+ * @brief       Check if frames are waiting
+ *
+ * @param[in]   me            Pointer to scheduler
+ *
+ * @attention   None
+ *
+ * @return      true if nothing is waiting
+ */
+bool x8_can_tx_idle(x8_can_tx_t *me);
+
+#endif // __X8_CAN_TX_H
+
+/* End of file -------------------------------------------------------- */
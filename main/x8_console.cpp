@@ -0,0 +1,131 @@
+/**
+ * @file       x8_console.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Text console: fixed buffer line reader and command dispatch
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_console.h"
+
+#include <stdlib.h>
+
+/* Private defines ---------------------------------------------------- */
+static_assert(X8_CONSOLE_LINE_MAX < 0xFF, "Line length is counted in 8 bit");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+#define M_X8_CONSOLE_IS_SEPARATOR(c)    (((c) == '_') || ((c) == ' ') || ((c) == ','))
+
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+/* Function definitions ----------------------------------------------- */
+void x8_console_init(x8_console_t *me, const x8_console_table_t *table)
+{
+  me->table    = table;
+  me->len      = 0;
+  me->overflow = false;
+  me->line[0]  = '\0';
+}
+
+x8_console_result_t x8_console_receive(x8_console_t *me, char c)
+{
+  bool overflow;
+
+  if (c == '\r')
+    return X8_CONSOLE_PENDING;
+
+  if (c != '\n')
+  {
+    if (me->len < X8_CONSOLE_LINE_MAX)
+    {
+      me->line[me->len++] = c;
+    }
+    else
+    {
+      me->overflow = true;
+    }
+    return X8_CONSOLE_PENDING;
+  }
+
+  me->line[me->len] = '\0';
+  overflow          = me->overflow;
+  me->len           = 0;
+  me->overflow      = false;
+
+  if (overflow)
+    return X8_CONSOLE_TOO_LONG;
+
+  return x8_console_execute(me, me->line);
+}
+
+x8_console_result_t x8_console_execute(x8_console_t *me, const char *line)
+{
+  const x8_console_table_t *table = me->table;
+  const x8_console_cmd_t *cmds;
+  x8_console_cmd_t cmd;
+  int32_t arg[X8_CONSOLE_ARGS] = { 0 };
+  uint8_t argc = 0;
+  uint16_t code;
+  uint8_t index;
+  char *end;
+
+  if ((line[0] == '\0') || (line[1] == '\0'))
+    return (line[0] == '\0') ? X8_CONSOLE_EMPTY : X8_CONSOLE_UNKNOWN;
+
+  code  = X8_CONSOLE_CODE(line[0], line[1]);
+  index = x8_pgm_read_byte(&table->slot[x8_console_hash(code, x8_pgm_read_byte(&table->mul))]);
+
+  if (index == X8_CONSOLE_NO_SLOT)
+    return X8_CONSOLE_UNKNOWN;
+
+  // The slot may hold another code
+  cmds = (const x8_console_cmd_t *)x8_pgm_read_ptr(&table->cmd);
+  x8_pgm_copy(&cmd, &cmds[index], sizeof(cmd));
+  if (cmd.code != code)
+    return X8_CONSOLE_UNKNOWN;
+
+  line += 2;
+
+  while (true)
+  {
+    // Each integer comes after a separator
+    if (!M_X8_CONSOLE_IS_SEPARATOR(*line))
+    {
+      if (*line == '\0')
+        break;
+
+      return X8_CONSOLE_BAD_ARG;
+    }
+
+    while (M_X8_CONSOLE_IS_SEPARATOR(*line))
+    {
+      line++;
+    }
+
+    if (*line == '\0')
+      break;
+
+    if (argc >= X8_CONSOLE_ARGS)
+      return X8_CONSOLE_BAD_ARG;
+
+    arg[argc] = (int32_t)strtol(line, &end, 10);
+    if (end == line)
+      return X8_CONSOLE_BAD_ARG;
+
+    argc++;
+    line = end;
+  }
+
+  cmd.handler(cmd.param, arg, argc);
+
+  return X8_CONSOLE_DONE;
+}
+
+/* End of file -------------------------------------------------------- */
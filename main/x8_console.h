@@ -0,0 +1,247 @@
+/**
+ * @file       x8_console.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Text console: fixed buffer line reader and command dispatch
+ * @note       A line is a two letter code and up to X8_CONSOLE_ARGS integers,
+ *             each after one or more '_', ' ' or ',', e.g. "SP_100" or
+ *             "PR_100_50_40_30_60_30". Lines end with '\n', a '\r' before it
+ *             is dropped. Longer lines than X8_CONSOLE_LINE_MAX are dropped.
+ *             Commands are found through a table of X8_CONSOLE_SLOTS slots
+ *             built at compile time: code hi * mul + code lo, mul being the
+ *             first odd multiplier that gives every code its own slot. A
+ *             line costs one hash, one compare and one call whatever the
+ *             number of commands, nothing is allocated.
+ *             The commands and the table stay in flash (X8_PGM), only the
+ *             line buffer takes RAM.
+ * @example    static constexpr x8_console_cmd_t CMD[] X8_PGM =
+ *             {
+ *               { X8_CONSOLE_CODE('S', 'P'), m_cmd_speed, 0 }
+ *             };
+ *             static constexpr x8_console_table_t TABLE X8_PGM = x8_console_table(CMD);
+ *             static_assert(TABLE.mul != 0, "No perfect hash");
+ *
+ *             x8_console_init(&console, &TABLE);
+ *             loop: x8_console_receive(&console, SERIAL.read());
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_CONSOLE_H
+#define __X8_CONSOLE_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_pgm.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Public defines ----------------------------------------------------- */
+#ifndef X8_CONSOLE_LINE_MAX
+#define X8_CONSOLE_LINE_MAX             (48)    // Characters of a line, '\n' excluded
+#endif
+
+#ifndef X8_CONSOLE_ARGS
+#define X8_CONSOLE_ARGS                 (6)     // Integers after the code
+#endif
+
+#ifndef X8_CONSOLE_SLOTS
+#define X8_CONSOLE_SLOTS                (64)    // Power of 2, above the number of commands
+#endif
+
+#define X8_CONSOLE_NO_SLOT              (0xFF)
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Command handler
+ *
+ * @param[in]   param         x8_console_cmd_t::param
+ * @param[in]   arg           X8_CONSOLE_ARGS integers, missing ones are 0
+ * @param[in]   argc          Number of integers given
+ */
+typedef void (*x8_console_handler_t) (uint8_t param, const int32_t *arg, uint8_t argc);
+
+/**
+ * @brief Command
+ */
+typedef struct
+{
+  uint16_t             code;          // X8_CONSOLE_CODE()
+  x8_console_handler_t handler;
+  uint8_t              param;         // Handed to the handler, one handler can serve several codes
+}
+x8_console_cmd_t;
+
+/**
+ * @brief Dispatch table, build with x8_console_table()
+ */
+typedef struct
+{
+  const x8_console_cmd_t *cmd;
+  uint8_t                 count;
+  uint8_t                 mul;                        // Hash multiplier, 0 => no perfect hash
+  uint8_t                 slot[X8_CONSOLE_SLOTS];     // Index in cmd, X8_CONSOLE_NO_SLOT => empty
+}
+x8_console_table_t;
+
+/**
+ * @brief Result of a received character
+ */
+typedef enum
+{
+  X8_CONSOLE_PENDING,                 // Line not complete
+  X8_CONSOLE_DONE,                    // Handler called
+  X8_CONSOLE_EMPTY,                   // Empty line
+  X8_CONSOLE_UNKNOWN,                 // No command of that code
+  X8_CONSOLE_BAD_ARG,                 // Not an integer or too many
+  X8_CONSOLE_TOO_LONG                 // Line dropped
+}
+x8_console_result_t;
+
+/**
+ * @brief Console
+ */
+typedef struct
+{
+  const x8_console_table_t *table;
+
+  char    line[X8_CONSOLE_LINE_MAX + 1];      // NUL terminated once complete
+  uint8_t len;
+  bool    overflow;
+}
+x8_console_t;
+
+/* Public macros ------------------------------------------------------ */
+#define X8_CONSOLE_CODE(a, b)           ((uint16_t)(((uint16_t)(uint8_t)(a) << 8) | (uint8_t)(b)))
+
+/* Compile time table ------------------------------------------------- */
+/**
+ * @brief Slot of a code
+ */
+constexpr uint8_t x8_console_hash(uint16_t code, uint8_t mul)
+{
+  return (uint8_t)(((code >> 8) * mul + (code & 0xFF)) & (X8_CONSOLE_SLOTS - 1));
+}
+
+/**
+ * @brief Code i shares its slot with one of the codes j ... n - 1
+ */
+constexpr bool x8_console_collides(const x8_console_cmd_t *cmd, uint8_t n, uint8_t i, uint8_t j, uint8_t mul)
+{
+  return (j < n) && ((x8_console_hash(cmd[i].code, mul) == x8_console_hash(cmd[j].code, mul)) ||
+                     x8_console_collides(cmd, n, i, j + 1, mul));
+}
+
+/**
+ * @brief Codes i ... n - 1 each have their own slot
+ */
+constexpr bool x8_console_is_perfect(const x8_console_cmd_t *cmd, uint8_t n, uint8_t i, uint8_t mul)
+{
+  return (i >= n) || (!x8_console_collides(cmd, n, i, i + 1, mul) && x8_console_is_perfect(cmd, n, i + 1, mul));
+}
+
+/**
+ * @brief First odd multiplier from mul giving a perfect hash, 0 if none
+ */
+constexpr uint8_t x8_console_mul(const x8_console_cmd_t *cmd, uint8_t n, uint16_t mul)
+{
+  return (mul > 0xFF) ? 0 :
+         x8_console_is_perfect(cmd, n, 0, (uint8_t)mul) ? (uint8_t)mul : x8_console_mul(cmd, n, mul + 2);
+}
+
+/**
+ * @brief Index of the command hashed to slot, X8_CONSOLE_NO_SLOT if none
+ */
+constexpr uint8_t x8_console_slot(const x8_console_cmd_t *cmd, uint8_t n, uint8_t mul, uint8_t slot, uint8_t i)
+{
+  return (i >= n) ? X8_CONSOLE_NO_SLOT :
+         (x8_console_hash(cmd[i].code, mul) == slot) ? i : x8_console_slot(cmd, n, mul, slot, i + 1);
+}
+
+/**
+ * @brief Slot numbers 0 ... N - 1 as a parameter pack (no <utility> on AVR)
+ */
+template <uint8_t... S>
+struct x8_console_seq
+{
+};
+
+template <uint8_t N, uint8_t... S>
+struct x8_console_make_seq : x8_console_make_seq<N - 1, N - 1, S...>
+{
+};
+
+template <uint8_t... S>
+struct x8_console_make_seq<0, S...>
+{
+  typedef x8_console_seq<S...> type;
+};
+
+template <uint8_t... S>
+constexpr x8_console_table_t x8_console_table_of(const x8_console_cmd_t *cmd, uint8_t n, uint8_t mul, x8_console_seq<S...>)
+{
+  return x8_console_table_t { cmd, n, mul, { x8_console_slot(cmd, n, mul, S, 0)... } };
+}
+
+/**
+ * @brief       Build the dispatch table of commands
+ *
+ * @param[in]   cmd           Commands, in flash (X8_PGM)
+ *
+ * @attention   Check mul != 0 with a static_assert, 0 means duplicate codes
+ *              or no multiplier found for X8_CONSOLE_SLOTS
+ *
+ * @return      Dispatch table
+ */
+template <uint8_t N>
+constexpr x8_console_table_t x8_console_table(const x8_console_cmd_t (&cmd)[N])
+{
+  static_assert(N < X8_CONSOLE_SLOTS, "X8_CONSOLE_SLOTS too small for the commands");
+  static_assert((X8_CONSOLE_SLOTS & (X8_CONSOLE_SLOTS - 1)) == 0, "X8_CONSOLE_SLOTS must be a power of 2");
+
+  return x8_console_table_of(cmd, N, x8_console_mul(cmd, N, 1), typename x8_console_make_seq<X8_CONSOLE_SLOTS>::type());
+}
+
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init console
+ *
+ * @param[in]   me            Pointer to console
+ * @param[in]   table         Dispatch table, in flash (X8_PGM)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_console_init(x8_console_t *me, const x8_console_table_t *table);
+
+/**
+ * @brief       Take a received character, run the command when the line is complete
+ *
+ * @param[in]   me            Pointer to console
+ * @param[in]   c             Character
+ *
+ * @attention   The line stays in me->line until the next character
+ *
+ * @return      x8_console_result_t
+ */
+x8_console_result_t x8_console_receive(x8_console_t *me, char c);
+
+/**
+ * @brief       Run a complete line
+ *
+ * @param[in]   me            Pointer to console
+ * @param[in]   line          NUL terminated line without '\n'
+ *
+ * @attention   None
+ *
+ * @return      x8_console_result_t
+ */
+x8_console_result_t x8_console_execute(x8_console_t *me, const char *line);
+
+#endif // __X8_CONSOLE_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,486 @@
+/**
+ * @file       x8_host_proto.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Binary protocol between a host and the controller over UART
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_host_proto.h"
+
+/* Private defines ---------------------------------------------------- */
+#define X8_HOST_PROTO_HEADER        (2)     // Type and motor id
+#define X8_HOST_PROTO_CRC           (2)
+
+static_assert(X8_HOST_PROTO_PACKET_MAX < 0xFF, "COBS blocks of one code byte only");
+static_assert(3 + 8 * X8_HOST_PROTO_WAYPOINTS_MAX + 2 <= X8_HOST_PROTO_PACKET_MAX, "WAYPOINTS longer than X8_HOST_PROTO_PACKET_MAX");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static void m_x8_host_proto_put(uint8_t *data, uint64_t value, uint8_t width);
+static uint64_t m_x8_host_proto_get(const uint8_t *data, uint8_t width);
+static uint16_t m_x8_host_proto_crc(const uint8_t *data, uint8_t len);
+static uint8_t m_x8_host_proto_cobs_decode(uint8_t *data, uint8_t len);
+static bool m_x8_host_proto_unpack(const uint8_t *packet, uint8_t len, x8_host_proto_msg_t *msg);
+
+/* Function definitions ----------------------------------------------- */
+void x8_host_proto_rx_init(x8_host_proto_rx_t *me)
+{
+  me->len      = 0;
+  me->in_frame = false;
+  me->overflow = false;
+  me->frames   = 0;
+  me->errors   = 0;
+}
+
+bool x8_host_proto_is_frame_byte(x8_host_proto_rx_t *me, uint8_t byte)
+{
+  return me->in_frame || (byte == X8_HOST_PROTO_DELIMITER);
+}
+
+bool x8_host_proto_receive(x8_host_proto_rx_t *me, uint8_t byte, x8_host_proto_msg_t *msg)
+{
+  uint8_t len;
+  bool ok;
+
+  if (byte != X8_HOST_PROTO_DELIMITER)
+  {
+    if (me->len < sizeof(me->buf))
+    {
+      me->buf[me->len++] = byte;
+    }
+    else
+    {
+      me->overflow = true;
+    }
+    return false;
+  }
+
+  // Opening delimiter, or empty frame
+  if (!me->in_frame || (me->len == 0))
+  {
+    me->in_frame = true;
+    return false;
+  }
+
+  len = me->overflow ? 0 : m_x8_host_proto_cobs_decode(me->buf, me->len);
+  ok  = (len >= X8_HOST_PROTO_HEADER + X8_HOST_PROTO_CRC) &&
+        (m_x8_host_proto_crc(me->buf, len - X8_HOST_PROTO_CRC) ==
+         (uint16_t)m_x8_host_proto_get(&me->buf[len - X8_HOST_PROTO_CRC], X8_HOST_PROTO_CRC)) &&
+        m_x8_host_proto_unpack(me->buf, len - X8_HOST_PROTO_CRC, msg);
+
+  me->len      = 0;
+  me->overflow = false;
+
+  if (!ok)
+  {
+    // Stay in frame, this delimiter may open the next one
+    me->errors++;
+    return false;
+  }
+
+  me->in_frame = false;
+  me->frames++;
+
+  return true;
+}
+
+uint8_t x8_host_proto_pack(const x8_host_proto_msg_t *msg, uint8_t *frame)
+{
+  // Built after the delimiter and first code byte, encoded in place
+  uint8_t *packet = &frame[2];
+  uint8_t len = 0;
+  uint8_t code_at, code, n;
+
+  packet[len++] = msg->type;
+  packet[len++] = msg->motor_id;
+
+  switch (msg->type)
+  {
+  case X8_HOST_PROTO_SPEED:
+    m_x8_host_proto_put(&packet[len], (uint32_t)msg->speed, 4);
+    len += 4;
+    break;
+
+  case X8_HOST_PROTO_POSITION:
+    m_x8_host_proto_put(&packet[len], msg->position.max_speed, 2);
+    m_x8_host_proto_put(&packet[len + 2], (uint32_t)msg->position.angle, 4);
+    len += 6;
+    break;
+
+  case X8_HOST_PROTO_TORQUE:
+    m_x8_host_proto_put(&packet[len], (uint16_t)msg->torque, 2);
+    len += 2;
+    break;
+
+  case X8_HOST_PROTO_COMMAND:
+    packet[len++] = msg->command;
+    break;
+
+  case X8_HOST_PROTO_SETPOINTS:
+    if (msg->setpoints.count > X8_HOST_PROTO_SETPOINTS_MAX)
+      return 0;
+
+    packet[len++] = msg->setpoints.mode;
+    packet[len++] = msg->setpoints.count;
+    for (uint8_t i = 0; i < msg->setpoints.count; i++)
+    {
+      packet[len] = msg->setpoints.motor_id[i];
+      m_x8_host_proto_put(&packet[len + 1], (uint32_t)msg->setpoints.value[i], 4);
+      len += 5;
+    }
+    break;
+
+  case X8_HOST_PROTO_READ:
+  case X8_HOST_PROTO_VALUE:
+    packet[len++] = msg->read.item;
+    packet[len++] = msg->read.tag;
+    if (msg->type == X8_HOST_PROTO_VALUE)
+    {
+      m_x8_host_proto_put(&packet[len], (uint64_t)msg->read.value, 8);
+      len += 8;
+    }
+    else
+    {
+      m_x8_host_proto_put(&packet[len], msg->read.max_age_ms, 2);
+      len += 2;
+    }
+    break;
+
+  case X8_HOST_PROTO_ERROR:
+    packet[len++] = msg->error.code;
+    packet[len++] = msg->error.tag;
+    packet[len++] = msg->error.type;
+    break;
+
+  case X8_HOST_PROTO_LOG:
+    if (msg->log.count > X8_HOST_PROTO_LOG_VALUES)
+      return 0;
+
+    packet[len++] = msg->log.level;
+    packet[len++] = msg->log.event;
+    packet[len++] = msg->log.count;
+    for (uint8_t i = 0; i < msg->log.count; i++)
+    {
+      m_x8_host_proto_put(&packet[len], (uint32_t)msg->log.value[i], 4);
+      len += 4;
+    }
+    break;
+
+  case X8_HOST_PROTO_WAYPOINTS:
+    if (msg->waypoints.count > X8_HOST_PROTO_WAYPOINTS_MAX)
+      return 0;
+
+    packet[len++] = msg->waypoints.count;
+    for (uint8_t i = 0; i < msg->waypoints.count; i++)
+    {
+      m_x8_host_proto_put(&packet[len], msg->waypoints.t_ms[i], 4);
+      m_x8_host_proto_put(&packet[len + 4], (uint32_t)msg->waypoints.position[i], 4);
+      len += 8;
+    }
+    break;
+
+  case X8_HOST_PROTO_TRAJECTORY:
+    packet[len++] = msg->trajectory.action;
+    packet[len++] = msg->trajectory.mode;
+    packet[len++] = msg->trajectory.interp;
+    break;
+
+  case X8_HOST_PROTO_TRAJ_STATE:
+    packet[len++] = msg->traj_state.state;
+    m_x8_host_proto_put(&packet[len], msg->traj_state.space, 2);
+    m_x8_host_proto_put(&packet[len + 2], msg->traj_state.starved, 2);
+    m_x8_host_proto_put(&packet[len + 4], msg->traj_state.missed, 2);
+    len += 6;
+    break;
+
+  default:
+    return 0;
+  }
+
+  m_x8_host_proto_put(&packet[len], m_x8_host_proto_crc(packet, len), X8_HOST_PROTO_CRC);
+  len += X8_HOST_PROTO_CRC;
+
+  // COBS: each code byte gives the distance to the next 0x00 of the packet.
+  // Byte i of the packet is written to frame[2 + i], where it is read from.
+  frame[0] = X8_HOST_PROTO_DELIMITER;
+  code_at  = 1;
+  code     = 1;
+  n        = 2;
+
+  for (uint8_t i = 0; i < len; i++)
+  {
+    if (packet[i] == 0)
+    {
+      frame[code_at] = code;
+      code_at        = n++;
+      code           = 1;
+    }
+    else
+    {
+      frame[n++] = packet[i];
+      code++;
+    }
+  }
+
+  frame[code_at] = code;
+  frame[n++]     = X8_HOST_PROTO_DELIMITER;
+
+  return n;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Store a little endian value
+ *
+ * @param[out]  data          Pointer to bytes
+ * @param[in]   value         Value
+ * @param[in]   width         Number of bytes
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+static void m_x8_host_proto_put(uint8_t *data, uint64_t value, uint8_t width)
+{
+  for (uint8_t i = 0; i < width; i++)
+  {
+    data[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+/**
+ * @brief       Load a little endian value
+ *
+ * @param[in]   data          Pointer to bytes
+ * @param[in]   width         Number of bytes
+ *
+ * @attention   None
+ *
+ * @return      Value, not sign extended
+ */
+static uint64_t m_x8_host_proto_get(const uint8_t *data, uint8_t width)
+{
+  uint64_t value = 0;
+
+  for (uint8_t i = width; i > 0; i--)
+  {
+    value = (value << 8) | data[i - 1];
+  }
+
+  return value;
+}
+
+/**
+ * @brief       CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+ *
+ * @param[in]   data          Pointer to bytes
+ * @param[in]   len           Number of bytes
+ *
+ * @attention   Bitwise, no table in RAM
+ *
+ * @return      CRC
+ */
+static uint16_t m_x8_host_proto_crc(const uint8_t *data, uint8_t len)
+{
+  uint16_t crc = 0xFFFF;
+
+  for (uint8_t i = 0; i < len; i++)
+  {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+
+  return crc;
+}
+
+/**
+ * @brief       Decode COBS in place
+ *
+ * @param[in]   data          Pointer to frame bytes, without delimiters
+ * @param[in]   len           Number of bytes
+ *
+ * @attention   None
+ *
+ * @return      Packet length, 0 if the frame is not valid COBS
+ */
+static uint8_t m_x8_host_proto_cobs_decode(uint8_t *data, uint8_t len)
+{
+  uint8_t in = 0, out = 0;
+
+  while (in < len)
+  {
+    uint8_t code = data[in++];
+
+    if ((code == 0) || (in + code - 1 > len))
+      return 0;
+
+    for (uint8_t i = 1; i < code; i++)
+    {
+      data[out++] = data[in++];
+    }
+
+    // A zero follows every block but the last
+    if (in < len)
+    {
+      data[out++] = 0;
+    }
+  }
+
+  return out;
+}
+
+/**
+ * @brief       Check the length of a packet and decode its fields
+ *
+ * @param[in]   packet        Pointer to packet, without CRC
+ * @param[in]   len           Packet length
+ * @param[out]  msg           Decoded packet
+ *
+ * @attention   None
+ *
+ * @return      false if the type is unknown or the length does not match it
+ */
+static bool m_x8_host_proto_unpack(const uint8_t *packet, uint8_t len, x8_host_proto_msg_t *msg)
+{
+  const uint8_t *payload = &packet[X8_HOST_PROTO_HEADER];
+  uint8_t size = len - X8_HOST_PROTO_HEADER;
+
+  msg->type     = packet[0];
+  msg->motor_id = packet[1];
+
+  switch (msg->type)
+  {
+  case X8_HOST_PROTO_SPEED:
+    if (size != 4)
+      return false;
+
+    msg->speed = (int32_t)m_x8_host_proto_get(payload, 4);
+    return true;
+
+  case X8_HOST_PROTO_POSITION:
+    if (size != 6)
+      return false;
+
+    msg->position.max_speed = (uint16_t)m_x8_host_proto_get(payload, 2);
+    msg->position.angle     = (int32_t)m_x8_host_proto_get(&payload[2], 4);
+    return true;
+
+  case X8_HOST_PROTO_TORQUE:
+    if (size != 2)
+      return false;
+
+    msg->torque = (int16_t)m_x8_host_proto_get(payload, 2);
+    return true;
+
+  case X8_HOST_PROTO_COMMAND:
+    if (size != 1)
+      return false;
+
+    msg->command = payload[0];
+    return true;
+
+  case X8_HOST_PROTO_SETPOINTS:
+    if ((size < 2) || (payload[1] > X8_HOST_PROTO_SETPOINTS_MAX) || (size != 2 + 5 * payload[1]))
+      return false;
+
+    msg->setpoints.mode  = payload[0];
+    msg->setpoints.count = payload[1];
+    for (uint8_t i = 0; i < msg->setpoints.count; i++)
+    {
+      msg->setpoints.motor_id[i] = payload[2 + 5 * i];
+      msg->setpoints.value[i]    = (int32_t)m_x8_host_proto_get(&payload[3 + 5 * i], 4);
+    }
+    return true;
+
+  case X8_HOST_PROTO_READ:
+    // Without max age from hosts older than the shadow cache
+    if ((size != 2) && (size != 4))
+      return false;
+
+    msg->read.item       = payload[0];
+    msg->read.tag        = payload[1];
+    msg->read.max_age_ms = (size == 4) ? (uint16_t)m_x8_host_proto_get(&payload[2], 2) : 0;
+    msg->read.value      = 0;
+    return true;
+
+  case X8_HOST_PROTO_VALUE:
+    if (size != 10)
+      return false;
+
+    msg->read.item       = payload[0];
+    msg->read.tag        = payload[1];
+    msg->read.max_age_ms = 0;
+    msg->read.value      = (int64_t)m_x8_host_proto_get(&payload[2], 8);
+    return true;
+
+  case X8_HOST_PROTO_ERROR:
+    if (size != 3)
+      return false;
+
+    msg->error.code = payload[0];
+    msg->error.tag  = payload[1];
+    msg->error.type = payload[2];
+    return true;
+
+  case X8_HOST_PROTO_LOG:
+    if ((size < 3) || (payload[2] > X8_HOST_PROTO_LOG_VALUES) || (size != 3 + 4 * payload[2]))
+      return false;
+
+    msg->log.level = payload[0];
+    msg->log.event = payload[1];
+    msg->log.count = payload[2];
+    for (uint8_t i = 0; i < msg->log.count; i++)
+    {
+      msg->log.value[i] = (int32_t)m_x8_host_proto_get(&payload[3 + 4 * i], 4);
+    }
+    return true;
+
+  case X8_HOST_PROTO_WAYPOINTS:
+    if ((size < 1) || (payload[0] > X8_HOST_PROTO_WAYPOINTS_MAX) || (size != 1 + 8 * payload[0]))
+      return false;
+
+    msg->waypoints.count = payload[0];
+    for (uint8_t i = 0; i < msg->waypoints.count; i++)
+    {
+      msg->waypoints.t_ms[i]     = (uint32_t)m_x8_host_proto_get(&payload[1 + 8 * i], 4);
+      msg->waypoints.position[i] = (int32_t)m_x8_host_proto_get(&payload[5 + 8 * i], 4);
+    }
+    return true;
+
+  case X8_HOST_PROTO_TRAJECTORY:
+    if (size != 3)
+      return false;
+
+    msg->trajectory.action = payload[0];
+    msg->trajectory.mode   = payload[1];
+    msg->trajectory.interp = payload[2];
+    return true;
+
+  case X8_HOST_PROTO_TRAJ_STATE:
+    if (size != 7)
+      return false;
+
+    msg->traj_state.state   = payload[0];
+    msg->traj_state.space   = (uint16_t)m_x8_host_proto_get(&payload[1], 2);
+    msg->traj_state.starved = (uint16_t)m_x8_host_proto_get(&payload[3], 2);
+    msg->traj_state.missed  = (uint16_t)m_x8_host_proto_get(&payload[5], 2);
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,274 @@
+/**
+ * @file       x8_host_proto.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Binary protocol between a host and the controller over UART
+ * @note       A frame is 0x00, the COBS encoded packet and 0x00. A packet is
+ *             type, motor id, the payload of the type (little endian) and a
+ *             CRC-16/CCITT-FALSE of all that. COBS leaves no 0x00 inside the
+ *             frame, so text lines can share the port: bytes outside frames
+ *             are text.
+ *             A frame that fails its COBS or CRC check is dropped and its
+ *             closing 0x00 taken as the opening of the next frame, so the
+ *             decoder is in step again after one good frame.
+ *             Both ends use the same fixed buffers, nothing is allocated.
+ *
+ *             Packets                 Payload after type and motor id
+ *             SPEED       host => MCU int32 speed (as x8_can_send_speed_close_loop_cmd)
+ *             POSITION    host => MCU uint16 max speed, int32 angle (as x8_can_send_position_ctrl_2_cmd)
+ *             TORQUE      host => MCU int16 iq (as x8_can_send_torque_close_loop_cmd)
+ *             COMMAND     host => MCU uint8 x8_motor_command_t
+ *             SETPOINTS   host => MCU uint8 mode (SPEED, TORQUE or POSITION), uint8 count,
+ *                                     count x (uint8 motor id, int32 value), motor id of packet 0
+ *             READ        host => MCU uint8 x8_host_proto_item_t, uint8 tag, uint16 max age ms
+ *             WAYPOINTS   host => MCU uint8 count, count x (uint32 t ms, int32 position)
+ *             TRAJECTORY  host => MCU uint8 x8_host_proto_action_t, uint8 mode, uint8 interp
+ *             VALUE       MCU => host uint8 item, uint8 tag, int64 value
+ *             ERROR       MCU => host uint8 x8_host_proto_error_t, uint8 tag, uint8 packet type
+ *             LOG         MCU => host uint8 level, uint8 event, uint8 count, count x int32 value
+ *             TRAJ_STATE  MCU => host uint8 state, uint16 space, uint16 starved, uint16 missed
+ *             POSITION in SETPOINTS uses x8_can_send_position_ctrl_1_cmd.
+ *             READ is answered from the value cached by the MCU when it is
+ *             not older than max age, else read from the motor. Max age 0,
+ *             or a READ without it, always reads from the motor.
+ *             WAYPOINTS and TRAJECTORY are those of x8_can_trajectory.h, mode
+ *             and interp its enums. Both are answered by TRAJ_STATE, whose
+ *             space tells how many waypoints the host may send.
+ * @example    len = x8_host_proto_pack(&msg, frame);        // send frame[0 ... len - 1]
+ *             if (x8_host_proto_receive(&rx, byte, &msg))  // msg holds a packet
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_HOST_PROTO_H
+#define __X8_HOST_PROTO_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_can.h"
+
+/* Public defines ----------------------------------------------------- */
+#define X8_HOST_PROTO_DELIMITER         (0x00)
+#define X8_HOST_PROTO_SETPOINTS_MAX     (16)
+#define X8_HOST_PROTO_LOG_VALUES        (4)
+#define X8_HOST_PROTO_WAYPOINTS_MAX     (8)
+#define X8_HOST_PROTO_PACKET_MAX        (4 + 5 * X8_HOST_PROTO_SETPOINTS_MAX + 2)   // SETPOINTS and CRC
+#define X8_HOST_PROTO_FRAME_MAX         (X8_HOST_PROTO_PACKET_MAX + 3)              // COBS code and delimiters
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Packet type
+ */
+typedef enum
+{
+  X8_HOST_PROTO_SPEED      = 0x01,
+  X8_HOST_PROTO_POSITION   = 0x02,
+  X8_HOST_PROTO_TORQUE     = 0x03,
+  X8_HOST_PROTO_COMMAND    = 0x04,
+  X8_HOST_PROTO_SETPOINTS  = 0x05,
+  X8_HOST_PROTO_READ       = 0x06,
+  X8_HOST_PROTO_WAYPOINTS  = 0x07,
+  X8_HOST_PROTO_TRAJECTORY = 0x08,
+  X8_HOST_PROTO_VALUE      = 0x81,
+  X8_HOST_PROTO_ERROR      = 0x82,
+  X8_HOST_PROTO_LOG        = 0x83,
+  X8_HOST_PROTO_TRAJ_STATE = 0x84
+}
+x8_host_proto_type_t;
+
+/**
+ * @brief Value of a READ packet
+ */
+typedef enum
+{
+  X8_HOST_PROTO_ANGLE_KP,
+  X8_HOST_PROTO_ANGLE_KI,
+  X8_HOST_PROTO_SPEED_KP,
+  X8_HOST_PROTO_SPEED_KI,
+  X8_HOST_PROTO_TORQUE_KP,
+  X8_HOST_PROTO_TORQUE_KI,
+  X8_HOST_PROTO_MOTOR_SPEED,
+  X8_HOST_PROTO_ENCODER,
+  X8_HOST_PROTO_TEMPERATURE,
+  X8_HOST_PROTO_MULTI_TURN_ANGLE,
+  X8_HOST_PROTO_ITEMS
+}
+x8_host_proto_item_t;
+
+/**
+ * @brief Action of a TRAJECTORY packet
+ */
+typedef enum
+{
+  X8_HOST_PROTO_TRAJ_CLEAR,             // Stop, drop the waypoints and set mode and interp
+  X8_HOST_PROTO_TRAJ_START              // Start from the buffered waypoints
+}
+x8_host_proto_action_t;
+
+/**
+ * @brief Code of an ERROR packet
+ */
+typedef enum
+{
+  X8_HOST_PROTO_ERR_PACKET = 1,         // Unknown type or bad length
+  X8_HOST_PROTO_ERR_MOTOR,              // Motor id not on the bus
+  X8_HOST_PROTO_ERR_BUSY,               // Too many reads waiting
+  X8_HOST_PROTO_ERR_TIMEOUT,            // Motor did not answer the read
+  X8_HOST_PROTO_ERR_WAYPOINT            // Buffer full or time not increasing, the rest is dropped
+}
+x8_host_proto_error_t;
+
+/**
+ * @brief Decoded packet
+ */
+typedef struct
+{
+  uint8_t type;                         // x8_host_proto_type_t
+  uint8_t motor_id;
+
+  union
+  {
+    int32_t speed;                      // SPEED
+    int16_t torque;                     // TORQUE
+    uint8_t command;                    // COMMAND
+
+    struct
+    {
+      uint16_t max_speed;
+      int32_t  angle;
+    }
+    position;                           // POSITION
+
+    struct
+    {
+      uint8_t mode;                     // SPEED, TORQUE or POSITION
+      uint8_t count;
+      uint8_t motor_id[X8_HOST_PROTO_SETPOINTS_MAX];
+      int32_t value[X8_HOST_PROTO_SETPOINTS_MAX];
+    }
+    setpoints;                          // SETPOINTS
+
+    struct
+    {
+      uint8_t item;                     // x8_host_proto_item_t
+      uint8_t tag;                      // Copied to the VALUE or ERROR answer
+      uint16_t max_age_ms;              // READ only
+      int64_t value;                    // VALUE only
+    }
+    read;                               // READ and VALUE
+
+    struct
+    {
+      uint8_t code;                     // x8_host_proto_error_t
+      uint8_t tag;                      // Tag of the READ, else 0
+      uint8_t type;                     // Type of the packet in error
+    }
+    error;                              // ERROR
+
+    struct
+    {
+      uint8_t level;                    // x8_log.h level
+      uint8_t event;                    // Event id of the application
+      uint8_t count;
+      int32_t value[X8_HOST_PROTO_LOG_VALUES];
+    }
+    log;                                // LOG
+
+    struct
+    {
+      uint8_t  count;
+      uint32_t t_ms[X8_HOST_PROTO_WAYPOINTS_MAX];
+      int32_t  position[X8_HOST_PROTO_WAYPOINTS_MAX];
+    }
+    waypoints;                          // WAYPOINTS
+
+    struct
+    {
+      uint8_t action;                   // x8_host_proto_action_t
+      uint8_t mode;                     // x8_can_trajectory_mode_t
+      uint8_t interp;                   // x8_can_trajectory_interp_t
+    }
+    trajectory;                         // TRAJECTORY
+
+    struct
+    {
+      uint8_t  state;                   // x8_can_trajectory_state_t
+      uint16_t space;                   // Waypoints that can be sent
+      uint16_t starved;
+      uint16_t missed;
+    }
+    traj_state;                         // TRAJ_STATE
+  };
+}
+x8_host_proto_msg_t;
+
+/**
+ * @brief Frame decoder
+ */
+typedef struct
+{
+  uint8_t  buf[X8_HOST_PROTO_FRAME_MAX];
+  uint8_t  len;
+  bool     in_frame;
+  bool     overflow;
+
+  uint16_t frames;                      // Good packets
+  uint16_t errors;                      // Frames dropped on COBS, CRC or length
+}
+x8_host_proto_rx_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init decoder, outside of a frame
+ *
+ * @param[in]   me            Pointer to decoder
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_host_proto_rx_init(x8_host_proto_rx_t *me);
+
+/**
+ * @brief       Tell whether a byte belongs to a frame
+ *
+ * @param[in]   me            Pointer to decoder
+ * @param[in]   byte          Next received byte
+ *
+ * @attention   Bytes for which this is false are text
+ *
+ * @return      true if the byte must go to x8_host_proto_receive()
+ */
+bool x8_host_proto_is_frame_byte(x8_host_proto_rx_t *me, uint8_t byte);
+
+/**
+ * @brief       Feed a frame byte
+ *
+ * @param[in]   me            Pointer to decoder
+ * @param[in]   byte          Received byte
+ * @param[out]  msg           Decoded packet
+ *
+ * @attention   None
+ *
+ * @return      true if the byte completed a valid packet, msg is filled
+ */
+bool x8_host_proto_receive(x8_host_proto_rx_t *me, uint8_t byte, x8_host_proto_msg_t *msg);
+
+/**
+ * @brief       Encode a packet into a frame
+ *
+ * @param[in]   msg           Packet
+ * @param[out]  frame         Frame, X8_HOST_PROTO_FRAME_MAX bytes
+ *
+ * @attention   The packet is built in frame, no other buffer on the stack
+ *
+ * @return      Frame length, 0 if the type is unknown or count too large
+ */
+uint8_t x8_host_proto_pack(const x8_host_proto_msg_t *msg, uint8_t *frame);
+
+#endif // __X8_HOST_PROTO_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,299 @@
+/**
+ * @file       x8_log.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Non blocking, level gated diagnostic output
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_log.h"
+
+/* Private defines ---------------------------------------------------- */
+static_assert((X8_LOG_RING_SIZE & (X8_LOG_RING_SIZE - 1)) == 0, "X8_LOG_RING_SIZE must be a power of 2");
+static_assert(X8_LOG_RING_SIZE <= 0x8000, "X8_LOG_RING_SIZE above 16 bit indexes");
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static uint8_t m_x8_log_text(char *line, uint8_t motor_id, const char *label, const int32_t *value, uint8_t count);
+static uint8_t m_x8_log_int(char *text, int32_t value);
+static uint8_t m_x8_log_uint(char *text, uint32_t value);
+
+/* Function definitions ----------------------------------------------- */
+void x8_log_init(x8_log_t *me, uint16_t (*room) (void), void (*write) (const uint8_t *data, uint16_t len))
+{
+  me->room    = room;
+  me->write   = write;
+  me->head    = 0;
+  me->tail    = 0;
+  me->level   = X8_LOG_LEVEL;
+  me->machine = false;
+  me->dropped = 0;
+}
+
+void x8_log_set(x8_log_t *me, uint8_t level, bool machine)
+{
+  me->level   = (level > X8_LOG_LEVEL) ? X8_LOG_LEVEL : level;
+  me->machine = machine;
+}
+
+bool x8_log_write(x8_log_t *me, uint8_t level, uint8_t event, uint8_t motor_id,
+                  const char *label, const int32_t *value, uint8_t count)
+{
+  uint8_t record[(X8_LOG_LINE_MAX > X8_HOST_PROTO_FRAME_MAX) ? X8_LOG_LINE_MAX : X8_HOST_PROTO_FRAME_MAX];
+  x8_host_proto_msg_t msg;
+  uint8_t len;
+
+  if (level > me->level)
+    return false;
+
+  if (count > X8_HOST_PROTO_LOG_VALUES)
+  {
+    count = X8_HOST_PROTO_LOG_VALUES;
+  }
+
+  if (me->machine)
+  {
+    msg.type      = X8_HOST_PROTO_LOG;
+    msg.motor_id  = motor_id;
+    msg.log.level = level;
+    msg.log.event = event;
+    msg.log.count = count;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      msg.log.value[i] = value[i];
+    }
+
+    len = x8_host_proto_pack(&msg, record);
+  }
+  else
+  {
+    len = m_x8_log_text((char *)record, motor_id, label, value, count);
+  }
+
+  return x8_log_put(me, record, len);
+}
+
+bool x8_log_put(x8_log_t *me, const uint8_t *data, uint16_t len)
+{
+  if (len > x8_log_free(me))
+  {
+    me->dropped++;
+    return false;
+  }
+
+  for (uint16_t i = 0; i < len; i++)
+  {
+    me->ring[me->head++ & (X8_LOG_RING_SIZE - 1)] = data[i];
+  }
+
+  return true;
+}
+
+uint16_t x8_log_free(const x8_log_t *me)
+{
+  return X8_LOG_RING_SIZE - (uint16_t)(me->head - me->tail);
+}
+
+void x8_log_line_init(x8_log_line_t *line)
+{
+  line->len = 0;
+}
+
+void x8_log_line_text(x8_log_line_t *line, const char *text)
+{
+  while ((x8_pgm_read_byte(text) != '\0') && (line->len < X8_LOG_LINE_MAX - 2))
+  {
+    line->text[line->len++] = (char)x8_pgm_read_byte(text++);
+  }
+}
+
+void x8_log_line_int(x8_log_line_t *line, int32_t value)
+{
+  // "-2147483648" and "\r\n"
+  if (line->len <= X8_LOG_LINE_MAX - 11 - 2)
+  {
+    line->len += m_x8_log_int(&line->text[line->len], value);
+  }
+}
+
+void x8_log_line_uint(x8_log_line_t *line, uint32_t value)
+{
+  // "4294967295" and "\r\n"
+  if (line->len <= X8_LOG_LINE_MAX - 10 - 2)
+  {
+    line->len += m_x8_log_uint(&line->text[line->len], value);
+  }
+}
+
+void x8_log_line_hex(x8_log_line_t *line, uint32_t value, uint8_t digits)
+{
+  uint8_t nibble;
+
+  if (line->len + digits > X8_LOG_LINE_MAX - 2)
+    return;
+
+  while (digits--)
+  {
+    nibble = (uint8_t)((value >> (digits * 4)) & 0x0F);
+    line->text[line->len++] = (char)((nibble < 10) ? '0' + nibble : 'A' + nibble - 10);
+  }
+}
+
+bool x8_log_line_put(x8_log_t *me, x8_log_line_t *line)
+{
+  line->text[line->len++] = '\r';
+  line->text[line->len++] = '\n';
+
+  return x8_log_put(me, (const uint8_t *)line->text, line->len);
+}
+
+uint16_t x8_log_flush(x8_log_t *me)
+{
+  uint16_t queued = (uint16_t)(me->head - me->tail);
+  uint16_t room, at, len;
+
+  // At most two writes, the ring wraps once
+  for (uint8_t part = 0; (part < 2) && (queued > 0); part++)
+  {
+    room = me->room();
+    if (room == 0)
+      break;
+
+    at  = me->tail & (X8_LOG_RING_SIZE - 1);
+    len = X8_LOG_RING_SIZE - at;
+    if (len > queued)
+    {
+      len = queued;
+    }
+    if (len > room)
+    {
+      len = room;
+    }
+
+    me->write(&me->ring[at], len);
+    me->tail += len;
+    queued   -= len;
+  }
+
+  return queued;
+}
+
+void x8_log_sync(x8_log_t *me)
+{
+  while (x8_log_flush(me) != 0)
+  {
+  }
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief       Format a text record
+ *
+ * @param[out]  line          X8_LOG_LINE_MAX characters
+ * @param[in]   motor_id      Motor id, 0 => none
+ * @param[in]   label         Text in flash
+ * @param[in]   value         Values
+ * @param[in]   count         Number of values
+ *
+ * @attention   The label is cut to keep room for the values
+ *
+ * @return      Length
+ */
+static uint8_t m_x8_log_text(char *line, uint8_t motor_id, const char *label, const int32_t *value, uint8_t count)
+{
+  // " -2147483648" per value and "\r\n"
+  const uint8_t reserve = 12 * count + 2;
+  uint8_t len = 0;
+
+  // "Motor 255 " and all values
+  static_assert(X8_LOG_LINE_MAX > 10 + 12 * X8_HOST_PROTO_LOG_VALUES + 2, "X8_LOG_LINE_MAX too small for the values");
+
+  if (motor_id != 0)
+  {
+    const char *prefix = X8_PSTR("Motor ");
+
+    while (x8_pgm_read_byte(prefix) != '\0')
+    {
+      line[len++] = (char)x8_pgm_read_byte(prefix++);
+    }
+    len += m_x8_log_int(&line[len], motor_id);
+    line[len++] = ' ';
+  }
+
+  while ((x8_pgm_read_byte(label) != '\0') && (len < X8_LOG_LINE_MAX - reserve))
+  {
+    line[len++] = (char)x8_pgm_read_byte(label++);
+  }
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    line[len++] = ' ';
+    len += m_x8_log_int(&line[len], value[i]);
+  }
+
+  line[len++] = '\r';
+  line[len++] = '\n';
+
+  return len;
+}
+
+/**
+ * @brief       Decimal text of an integer
+ *
+ * @param[out]  text          11 characters
+ * @param[in]   value         Value
+ *
+ * @attention   Not NUL terminated
+ *
+ * @return      Length
+ */
+static uint8_t m_x8_log_int(char *text, int32_t value)
+{
+  if (value < 0)
+  {
+    text[0] = '-';
+    return 1 + m_x8_log_uint(&text[1], (uint32_t)0 - (uint32_t)value);
+  }
+
+  return m_x8_log_uint(text, (uint32_t)value);
+}
+
+/**
+ * @brief       Decimal text of an unsigned integer
+ *
+ * @param[out]  text          10 characters
+ * @param[in]   value         Value
+ *
+ * @attention   Not NUL terminated
+ *
+ * @return      Length
+ */
+static uint8_t m_x8_log_uint(char *text, uint32_t value)
+{
+  char digit[10];
+  uint8_t n = 0, len = 0;
+
+  do
+  {
+    digit[n++] = (char)('0' + value % 10);
+    value /= 10;
+  }
+  while (value != 0);
+
+  while (n > 0)
+  {
+    text[len++] = digit[--n];
+  }
+
+  return len;
+}
+
+/* End of file -------------------------------------------------------- */
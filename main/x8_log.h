@@ -0,0 +1,310 @@
+/**
+ * @file       x8_log.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Non blocking, level gated diagnostic output
+ * @note       Records go to a RAM ring as a whole or not at all, x8_log_flush
+ *             moves from the ring only as many bytes as the transport takes
+ *             without waiting (on Arduino SERIAL.availableForWrite, the UART
+ *             interrupt sends them). A full ring drops records and counts them,
+ *             the caller never waits.
+ *             Levels above X8_LOG_LEVEL compile to nothing, arguments are not
+ *             evaluated and labels take no flash. Below it the level can be
+ *             lowered at run time.
+ *             A record is an event id, a motor id (0 => none), a label and up
+ *             to X8_HOST_PROTO_LOG_VALUES integers. In text mode it is printed
+ *             as "[Motor <id> ]<label> <value> ...", in machine mode it is
+ *             sent as a LOG packet of the host protocol (x8_host_proto.h).
+ *             Labels are read from flash (x8_pgm.h): X8_LOG_<LEVEL> takes a
+ *             string literal and places it there, X8_LOG_<LEVEL>_P a label
+ *             already in flash.
+ *             Printouts of many lines are built one x8_log_line_t at a time
+ *             and queued with x8_log_line_put when x8_log_free has room, a
+ *             few per loop, so they never wait on the transport either.
+ * @example    x8_log_init(&log, m_log_room, m_log_write);
+ *             X8_LOG_WARN(&log, LOG_CAN_OVERRUN, 0, "Can rx overrun:", overrun);
+ *             X8_LOG_INFO_P(&log, LOG_READ, 1, READ_LABEL, value);
+ *             loop: x8_log_flush(&log);
+ *
+ *             x8_log_line_init(&line);
+ *             x8_log_line_text(&line, X8_PSTR("Lost: "));
+ *             x8_log_line_uint(&line, lost);
+ *             if (x8_log_free(&log) >= X8_LOG_LINE_MAX) x8_log_line_put(&log, &line);
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_LOG_H
+#define __X8_LOG_H
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_host_proto.h"
+#include "x8_pgm.h"
+
+/* Public defines ----------------------------------------------------- */
+#define X8_LOG_LEVEL_NONE               (0)
+#define X8_LOG_LEVEL_ERROR              (1)
+#define X8_LOG_LEVEL_WARN               (2)
+#define X8_LOG_LEVEL_INFO               (3)
+#define X8_LOG_LEVEL_DEBUG              (4)
+
+#ifndef X8_LOG_LEVEL
+#define X8_LOG_LEVEL                    X8_LOG_LEVEL_INFO       // Highest level compiled in
+#endif
+
+#ifndef X8_LOG_RING_SIZE
+#if defined(__AVR__)
+#define X8_LOG_RING_SIZE                (128)
+#else
+#define X8_LOG_RING_SIZE                (4096)
+#endif
+#endif
+
+#define X8_LOG_LINE_MAX                 (80)    // Text record, longer labels are cut
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Log
+ */
+typedef struct
+{
+  uint16_t (*room) (void);                              // Bytes the transport takes without waiting
+  void (*write) (const uint8_t *data, uint16_t len);
+
+  uint8_t  ring[X8_LOG_RING_SIZE];
+  uint16_t head;                                        // Next byte to write
+  uint16_t tail;                                        // Next byte to send
+
+  uint8_t  level;                                       // Run time level, up to X8_LOG_LEVEL
+  bool     machine;                                     // LOG packets instead of text
+  uint32_t dropped;                                     // Records lost on a full ring
+}
+x8_log_t;
+
+/**
+ * @brief Text line of a printout, "\r\n" added by x8_log_line_put
+ */
+typedef struct
+{
+  char    text[X8_LOG_LINE_MAX];
+  uint8_t len;
+}
+x8_log_line_t;
+
+/* Public macros ------------------------------------------------------ */
+/**
+ * @brief Log a record with 0 ... X8_HOST_PROTO_LOG_VALUES integer values, label in flash
+ */
+#define X8_LOG(me, level, event, motor_id, label, ...)                                    \
+  do                                                                                      \
+  {                                                                                       \
+    const int32_t x8_log_value_[] = { 0, ##__VA_ARGS__ };                                 \
+    x8_log_write((me), (level), (event), (motor_id), (label), &x8_log_value_[1],          \
+                 (uint8_t)(sizeof(x8_log_value_) / sizeof(x8_log_value_[0]) - 1));        \
+  }                                                                                       \
+  while (0)
+
+#define X8_LOG_NOTHING()                do { } while (0)
+
+#if X8_LOG_LEVEL >= X8_LOG_LEVEL_ERROR
+#define X8_LOG_ERROR(me, event, motor_id, label, ...)   X8_LOG(me, X8_LOG_LEVEL_ERROR, event, motor_id, X8_PSTR(label), ##__VA_ARGS__)
+#define X8_LOG_ERROR_P(me, event, motor_id, label, ...) X8_LOG(me, X8_LOG_LEVEL_ERROR, event, motor_id, label, ##__VA_ARGS__)
+#else
+#define X8_LOG_ERROR(me, event, motor_id, label, ...)   X8_LOG_NOTHING()
+#define X8_LOG_ERROR_P(me, event, motor_id, label, ...) X8_LOG_NOTHING()
+#endif
+
+#if X8_LOG_LEVEL >= X8_LOG_LEVEL_WARN
+#define X8_LOG_WARN(me, event, motor_id, label, ...)    X8_LOG(me, X8_LOG_LEVEL_WARN, event, motor_id, X8_PSTR(label), ##__VA_ARGS__)
+#define X8_LOG_WARN_P(me, event, motor_id, label, ...)  X8_LOG(me, X8_LOG_LEVEL_WARN, event, motor_id, label, ##__VA_ARGS__)
+#else
+#define X8_LOG_WARN(me, event, motor_id, label, ...)    X8_LOG_NOTHING()
+#define X8_LOG_WARN_P(me, event, motor_id, label, ...)  X8_LOG_NOTHING()
+#endif
+
+#if X8_LOG_LEVEL >= X8_LOG_LEVEL_INFO
+#define X8_LOG_INFO(me, event, motor_id, label, ...)    X8_LOG(me, X8_LOG_LEVEL_INFO, event, motor_id, X8_PSTR(label), ##__VA_ARGS__)
+#define X8_LOG_INFO_P(me, event, motor_id, label, ...)  X8_LOG(me, X8_LOG_LEVEL_INFO, event, motor_id, label, ##__VA_ARGS__)
+#else
+#define X8_LOG_INFO(me, event, motor_id, label, ...)    X8_LOG_NOTHING()
+#define X8_LOG_INFO_P(me, event, motor_id, label, ...)  X8_LOG_NOTHING()
+#endif
+
+#if X8_LOG_LEVEL >= X8_LOG_LEVEL_DEBUG
+#define X8_LOG_DEBUG(me, event, motor_id, label, ...)   X8_LOG(me, X8_LOG_LEVEL_DEBUG, event, motor_id, X8_PSTR(label), ##__VA_ARGS__)
+#define X8_LOG_DEBUG_P(me, event, motor_id, label, ...) X8_LOG(me, X8_LOG_LEVEL_DEBUG, event, motor_id, label, ##__VA_ARGS__)
+#else
+#define X8_LOG_DEBUG(me, event, motor_id, label, ...)   X8_LOG_NOTHING()
+#define X8_LOG_DEBUG_P(me, event, motor_id, label, ...) X8_LOG_NOTHING()
+#endif
+
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init log, text mode at X8_LOG_LEVEL
+ *
+ * @param[in]   me            Pointer to log
+ * @param[in]   room          Bytes the transport takes without waiting
+ * @param[in]   write         Hand bytes to the transport
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_log_init(x8_log_t *me, uint16_t (*room) (void), void (*write) (const uint8_t *data, uint16_t len));
+
+/**
+ * @brief       Set run time level and output mode
+ *
+ * @param[in]   me            Pointer to log
+ * @param[in]   level         X8_LOG_LEVEL_NONE ... X8_LOG_LEVEL, higher is capped
+ * @param[in]   machine       true => LOG packets, false => text
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_log_set(x8_log_t *me, uint8_t level, bool machine);
+
+/**
+ * @brief       Queue a record, use the X8_LOG_<LEVEL> macros
+ *
+ * @param[in]   me            Pointer to log
+ * @param[in]   level         X8_LOG_LEVEL_ERROR ... X8_LOG_LEVEL_DEBUG
+ * @param[in]   event         Event id of the application, used in machine mode
+ * @param[in]   motor_id      Motor id, 0 => none
+ * @param[in]   label         Text, used in text mode
+ * @param[in]   value         Values
+ * @param[in]   count         Number of values, cut to X8_HOST_PROTO_LOG_VALUES
+ *
+ * @attention   None
+ *
+ * @return      false if dropped, by level or on a full ring
+ */
+bool x8_log_write(x8_log_t *me, uint8_t level, uint8_t event, uint8_t motor_id,
+                  const char *label, const int32_t *value, uint8_t count);
+
+/**
+ * @brief       Queue bytes as they are, at any level
+ *
+ * @param[in]   me            Pointer to log
+ * @param[in]   data          Bytes, e.g. a host protocol frame
+ * @param[in]   len           Number of bytes
+ *
+ * @attention   Whatever goes out on the same port must go through the ring,
+ *              else it can land inside a record
+ *
+ * @return      false if dropped on a full ring
+ */
+bool x8_log_put(x8_log_t *me, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief       Free bytes of the ring
+ *
+ * @param[in]   me            Pointer to log
+ *
+ * @attention   None
+ *
+ * @return      Bytes x8_log_put takes now
+ */
+uint16_t x8_log_free(const x8_log_t *me);
+
+/**
+ * @brief       Start an empty printout line
+ *
+ * @param[in]   line          Pointer to line
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_log_line_init(x8_log_line_t *line);
+
+/**
+ * @brief       Append text to a printout line
+ *
+ * @param[in]   line          Pointer to line
+ * @param[in]   text          NUL terminated text in flash (X8_PSTR)
+ *
+ * @attention   Text beyond X8_LOG_LINE_MAX - 2 characters is cut
+ *
+ * @return      None
+ */
+void x8_log_line_text(x8_log_line_t *line, const char *text);
+
+/**
+ * @brief       Append a decimal integer to a printout line
+ *
+ * @param[in]   line          Pointer to line
+ * @param[in]   value         Value
+ *
+ * @attention   Dropped if it does not fit
+ *
+ * @return      None
+ */
+void x8_log_line_int(x8_log_line_t *line, int32_t value);
+
+/**
+ * @brief       Append a decimal unsigned integer to a printout line
+ *
+ * @param[in]   line          Pointer to line
+ * @param[in]   value         Value
+ *
+ * @attention   Dropped if it does not fit
+ *
+ * @return      None
+ */
+void x8_log_line_uint(x8_log_line_t *line, uint32_t value);
+
+/**
+ * @brief       Append a hex value with leading zeros to a printout line
+ *
+ * @param[in]   line          Pointer to line
+ * @param[in]   value         Value
+ * @param[in]   digits        Number of hex digits, 1 ... 8
+ *
+ * @attention   Dropped if it does not fit
+ *
+ * @return      None
+ */
+void x8_log_line_hex(x8_log_line_t *line, uint32_t value, uint8_t digits);
+
+/**
+ * @brief       Queue a printout line with "\r\n", at any level
+ *
+ * @param[in]   me            Pointer to log
+ * @param[in]   line          Pointer to line
+ *
+ * @attention   Check x8_log_free first to keep the line, a full ring drops it
+ *
+ * @return      false if dropped on a full ring
+ */
+bool x8_log_line_put(x8_log_t *me, x8_log_line_t *line);
+
+/**
+ * @brief       Hand queued bytes to the transport without waiting
+ *
+ * @param[in]   me            Pointer to log
+ *
+ * @attention   Call every loop
+ *
+ * @return      Bytes still queued
+ */
+uint16_t x8_log_flush(x8_log_t *me);
+
+/**
+ * @brief       Hand all queued bytes to the transport, waiting for room
+ *
+ * @param[in]   me            Pointer to log
+ *
+ * @attention   Blocks, only for output written directly to the port
+ *
+ * @return      None
+ */
+void x8_log_sync(x8_log_t *me);
+
+#endif // __X8_LOG_H
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,48 @@
+/**
+ * @file       x8_pgm.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Constant tables and strings kept in flash
+ * @note       On AVR, constants are copied to RAM at start unless placed in
+ *             program memory, which is then read with the LPM instruction
+ *             (avr/pgmspace.h). Data marked X8_PGM must be read with the
+ *             x8_pgm_* macros. Elsewhere flash and RAM share one address
+ *             space, the macros are plain reads.
+ * @example    static const char LABEL[] X8_PGM = "Speed rpm :";
+ *             c = x8_pgm_read_byte(&LABEL[i]);
+ *             X8_LOG_INFO(&log, event, 0, "Text in flash");
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_PGM_H
+#define __X8_PGM_H
+
+/* Includes ----------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#endif
+
+/* Public macros ------------------------------------------------------ */
+#if defined(__AVR__)
+#define X8_PGM                          PROGMEM
+#define X8_PSTR(s)                      PSTR(s)
+#define x8_pgm_read_byte(p)             pgm_read_byte(p)
+#define x8_pgm_read_ptr(p)              pgm_read_ptr(p)
+#define x8_pgm_copy(dst, src, len)      memcpy_P((dst), (src), (len))
+#else
+#define X8_PGM
+#define X8_PSTR(s)                      (s)
+#define x8_pgm_read_byte(p)             (*(const uint8_t *)(p))
+#define x8_pgm_read_ptr(p)              (*(void * const *)(p))
+#define x8_pgm_copy(dst, src, len)      memcpy((dst), (src), (len))
+#endif
+
+#endif // __X8_PGM_H
+
+/* End of file -------------------------------------------------------- */
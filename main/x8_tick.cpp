@@ -0,0 +1,110 @@
+/**
+ * @file       x8_tick.cpp
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Fixed period control tick with jitter and overrun counters
+ * @note       None
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "x8_tick.h"
+
+/* Private defines ---------------------------------------------------- */
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+/* Function definitions ----------------------------------------------- */
+void x8_tick_init(x8_tick_t *me, uint32_t period_us, uint32_t now_us)
+{
+  me->period_us = period_us;
+  me->raised    = 0;
+  me->taken     = 0;
+  me->due_us    = now_us + period_us;
+  me->start_us  = now_us;
+  me->periods   = 0;
+
+  x8_tick_reset(me);
+}
+
+void x8_tick_raise(x8_tick_t *me)
+{
+  me->raised++;
+}
+
+void x8_tick_poll(x8_tick_t *me, uint32_t now_us)
+{
+  while ((int32_t)(now_us - me->due_us) >= 0)
+  {
+    me->due_us += me->period_us;
+    me->raised++;
+  }
+}
+
+bool x8_tick_pending(const x8_tick_t *me)
+{
+  return me->raised != me->taken;
+}
+
+bool x8_tick_begin(x8_tick_t *me, uint32_t now_us)
+{
+  uint8_t pending = (uint8_t)(me->raised - me->taken);
+  uint32_t expected_us, jitter_us;
+
+  if (pending == 0)
+    return false;
+
+  me->taken   += pending;
+  me->missed  += pending - 1;
+  me->periods  = pending;
+
+  // The first tick of a window has no previous start to compare with
+  if (me->ticks > 0)
+  {
+    expected_us = me->start_us + pending * me->period_us;
+    jitter_us   = ((int32_t)(now_us - expected_us) >= 0) ? now_us - expected_us : expected_us - now_us;
+
+    me->jitter_sum_us += jitter_us;
+    if (jitter_us > me->jitter_max_us)
+    {
+      me->jitter_max_us = jitter_us;
+    }
+  }
+
+  me->start_us = now_us;
+  me->ticks++;
+
+  return true;
+}
+
+void x8_tick_end(x8_tick_t *me, uint32_t now_us)
+{
+  uint32_t work_us = now_us - me->start_us;
+
+  if (work_us > me->work_max_us)
+  {
+    me->work_max_us = work_us;
+  }
+
+  if (work_us > me->period_us)
+  {
+    me->overruns++;
+  }
+}
+
+void x8_tick_reset(x8_tick_t *me)
+{
+  me->ticks         = 0;
+  me->missed        = 0;
+  me->overruns      = 0;
+  me->jitter_max_us = 0;
+  me->jitter_sum_us = 0;
+  me->work_max_us   = 0;
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,147 @@
+/**
+ * @file       x8_tick.h
+ * @copyright  Copyright (C) 2020 ThuanLe. All rights reserved.
+ * @license    This project is released under the ThuanLe License.
+ * @version    1.0.0
+ * @date       2020-08-26
+ * @author     Thuan Le
+ * @brief      Fixed period control tick with jitter and overrun counters
+ * @note       A timer interrupt calls x8_tick_raise every period, the main
+ *             loop runs the control work between x8_tick_begin and
+ *             x8_tick_end and background work while no tick is pending.
+ *             The interrupt only counts, so it never waits on the loop: the
+ *             interrupt owns raised, the loop owns taken.
+ *             Counters cover a window that starts at init or reset:
+ *             - missed: ticks raised while an earlier one was still pending,
+ *               their work was merged into one
+ *             - overruns: ticks whose work took longer than the period
+ *             - jitter: distance of a tick start from the previous start
+ *               plus the periods it took
+ *             - work: time from x8_tick_begin to x8_tick_end
+ *             Boards without the timer call x8_tick_poll from the loop
+ *             instead, the tick then has the jitter of the loop.
+ * @example    ISR(TIMER1_COMPA_vect) { x8_tick_raise(&tick); }
+ *             loop: if (x8_tick_begin(&tick, micros())) { ...; x8_tick_end(&tick, micros()); }
+ *                   while (!x8_tick_pending(&tick)) { background }
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __X8_TICK_H
+#define __X8_TICK_H
+
+/* Includes ----------------------------------------------------------- */
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Control tick
+ */
+typedef struct
+{
+  uint32_t         period_us;
+  volatile uint8_t raised;              // Ticks raised, written by the interrupt only
+  uint8_t          taken;               // Ticks begun, written by the loop only
+  uint32_t         due_us;              // Next tick of x8_tick_poll
+  uint32_t         start_us;            // Start of the last tick
+  uint8_t          periods;             // Periods the last tick covers, above 1 when ticks were merged
+
+  uint32_t         ticks;
+  uint32_t         missed;
+  uint32_t         overruns;
+  uint32_t         jitter_max_us;
+  uint32_t         jitter_sum_us;
+  uint32_t         work_max_us;
+}
+x8_tick_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief       Init tick, none pending
+ *
+ * @param[in]   me            Pointer to tick
+ * @param[in]   period_us     Period (us)
+ * @param[in]   now_us        Current time (us)
+ *
+ * @attention   Start the timer after
+ *
+ * @return      None
+ */
+void x8_tick_init(x8_tick_t *me, uint32_t period_us, uint32_t now_us);
+
+/**
+ * @brief       Raise a tick, from the timer interrupt
+ *
+ * @param[in]   me            Pointer to tick
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_tick_raise(x8_tick_t *me);
+
+/**
+ * @brief       Raise the ticks due, for boards without the timer
+ *
+ * @param[in]   me            Pointer to tick
+ * @param[in]   now_us        Current time (us)
+ *
+ * @attention   Call every loop, never together with a timer
+ *
+ * @return      None
+ */
+void x8_tick_poll(x8_tick_t *me, uint32_t now_us);
+
+/**
+ * @brief       Tell whether a tick is waiting
+ *
+ * @param[in]   me            Pointer to tick
+ *
+ * @attention   Background work checks it to give way to the tick
+ *
+ * @return      true if x8_tick_begin would begin a tick
+ */
+bool x8_tick_pending(const x8_tick_t *me);
+
+/**
+ * @brief       Begin the pending tick
+ *
+ * @param[in]   me            Pointer to tick
+ * @param[in]   now_us        Current time (us)
+ *
+ * @attention   Ticks raised more than once are counted as missed and begun
+ *              once, periods tells how many were merged
+ *
+ * @return      false if no tick is pending
+ */
+bool x8_tick_begin(x8_tick_t *me, uint32_t now_us);
+
+/**
+ * @brief       End the tick begun last
+ *
+ * @param[in]   me            Pointer to tick
+ * @param[in]   now_us        Current time (us)
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_tick_end(x8_tick_t *me, uint32_t now_us);
+
+/**
+ * @brief       Clear the counters, start a new window
+ *
+ * @param[in]   me            Pointer to tick
+ *
+ * @attention   None
+ *
+ * @return      None
+ */
+void x8_tick_reset(x8_tick_t *me);
+
+#endif // __X8_TICK_H
+
+/* End of file -------------------------------------------------------- */